@@ -0,0 +1,44 @@
+#ifndef PS_BENCH_BENCH_H_
+#define PS_BENCH_BENCH_H_
+
+#include <picoscad/porting.h>
+
+typedef enum BenchPrecision {
+    BENCH_F32,
+    BENCH_F64
+} BenchPrecision;
+
+/**
+ * One kernel over n 4 component elements, out[i] = op(a[i], b[i]). Matrix ops
+ * read 4 consecutive elements as one column-major matrix.
+ */
+typedef struct BenchOp {
+    const char *name;
+    BenchPrecision precision;
+    const char *backend;
+    void (*run)(const void *a, const void *b, void *out, size_t n);
+} BenchOp;
+
+// The math headers pick their backend at compile time, so the ops are built once per variant
+#ifdef BENCH_VARIANT
+#define _BENCH_CAT2(name, variant) name##_##variant
+#define _BENCH_CAT(name, variant) _BENCH_CAT2(name, variant)
+#define BENCH_VARIANT_NAME(name) _BENCH_CAT(name, BENCH_VARIANT)
+#endif
+
+// Terminated by an op with a NULL name
+extern const BenchOp bench_math_ops_scalar[];
+extern const BenchOp bench_math_ops_native[];
+extern const BenchOp bench_math_ops_avx[];
+extern const BenchOp bench_math_ops_avx2[];
+
+/**
+ * Heap bytes in use and the high-water mark since the last reset. Only counted
+ * when malloc is wrapped at link time (BENCH_TRACK_HEAP), see heap.c.
+ */
+bool bench_heap_tracked();
+size_t bench_heap_current();
+size_t bench_heap_peak();
+void bench_heap_reset_peak();
+
+#endif // PS_BENCH_BENCH_H_
@@ -0,0 +1,137 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <picoscad/cg/arc.h>
+#include <picoscad/lang/scad.h>
+
+/*
+ * Times ps_ellipse_points4d against a sin and cos per point and prints the
+ * largest difference between the two relative to the radius, then evaluates a
+ * model with circles from a fraction of a unit to hundreds of units across with
+ * the script's own counts ("tolerance":0) and at a few tolerances, once at
+ * OpenSCAD's default resolution and once with $fn = 64 throughout:
+ *
+ *   {"bench":"arc","op":"points","segments":64,"method":"recurrence","mpoints_per_s":...,"max_error":...}
+ *   {"bench":"arc","op":"model","resolution":"fn64","tolerance":0.01,"output_vertices":...,"evaluate_ms":...}
+ */
+
+static const char *model =
+        "$fn = %d;\n"
+        "difference() {\n"
+        "    circle(150);\n"
+        "    for (i = [0:11]) rotate(i * 30) translate([120, 0]) circle(8);\n"
+        "    for (i = [0:47]) rotate(i * 7.5) translate([95, 0]) circle(1.5);\n"
+        "    for (x = [-4:4], y = [-4:4]) translate([x * 12, y * 12]) circle(0.4);\n"
+        "}\n"
+        "translate([400, 0]) scale(40) circle(2);\n";
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--points COUNT]\n", argv0);
+}
+
+static void sincos_points(double rx, double ry, double rotation, double step, size_t count, Ps4d *out) {
+    const double cos_rotation = cos(rotation), sin_rotation = sin(rotation);
+    for (size_t i = 0; i < count; ++i) {
+        const double angle = step * (double) i;
+        const double x = rx * cos(angle), y = ry * sin(angle);
+        out[i] = ps_4d(x * cos_rotation - y * sin_rotation, x * sin_rotation + y * cos_rotation, 0.0, 1.0);
+    }
+}
+
+static void run_points(size_t segments, size_t points) {
+    Ps4d *exact = aligned_alloc(_Alignof(Ps4d), sizeof(Ps4d) * segments);
+    Ps4d *out = aligned_alloc(_Alignof(Ps4d), sizeof(Ps4d) * segments);
+    const double rx = 25.0, ry = 10.0, rotation = 0.5, step = 6.283185307179586 / (double) segments;
+    const size_t rounds = points / segments ? points / segments : 1;
+
+    double start = now();
+    for (size_t r = 0; r < rounds; ++r) {
+        sincos_points(rx, ry, rotation, step, segments, exact);
+    }
+    double elapsed = now() - start;
+    printf("{\"bench\":\"arc\",\"op\":\"points\",\"segments\":%zu,\"method\":\"sincos\",\"mpoints_per_s\":%.1f}\n",
+           segments, (double) (rounds * segments) / elapsed * 1e-6);
+
+    start = now();
+    for (size_t r = 0; r < rounds; ++r) {
+        ps_ellipse_points4d(0.0, 0.0, rx, ry, rotation, 0.0, step, segments, out);
+    }
+    elapsed = now() - start;
+    double error = 0.0;
+    for (size_t i = 0; i < segments; ++i) {
+        error = fmax(error, fabs(ps_4d_x(out[i]) - ps_4d_x(exact[i])));
+        error = fmax(error, fabs(ps_4d_y(out[i]) - ps_4d_y(exact[i])));
+    }
+    printf("{\"bench\":\"arc\",\"op\":\"points\",\"segments\":%zu,\"method\":\"recurrence\",\"mpoints_per_s\":%.1f,"
+           "\"max_error\":%.3g}\n", segments, (double) (rounds * segments) / elapsed * 1e-6, error / rx);
+    fflush(stdout);
+    free(exact);
+    free(out);
+}
+
+static void run_model(const char *resolution, const PsScadResult *result, double tolerance) {
+    PsCsg *csg = ps_csg_new();
+    const double start = now();
+    const PsCsgNode root = ps_scad_result_to_csg(result, tolerance, csg, NULL);
+    const double convert_elapsed = now() - start;
+    const double evaluate_start = now();
+    PsArray OF(PsGHPolygon4d *) *polygons = ps_csg_evaluate(csg, root, NULL, NULL);
+    const double elapsed = now() - evaluate_start;
+    size_t output_vertices = 0;
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        output_vertices += ps_ghpolygon4d_get_size(ps_array_get(polygons, i));
+        ps_ghpolygon4d_free(ps_array_get(polygons, i));
+    }
+    printf("{\"bench\":\"arc\",\"op\":\"model\",\"resolution\":\"%s\",\"tolerance\":%g,\"output_vertices\":%zu,"
+           "\"convert_ms\":%.3f,\"evaluate_ms\":%.3f}\n",
+           resolution, tolerance, output_vertices, convert_elapsed * 1e3, elapsed * 1e3);
+    fflush(stdout);
+    ps_array_free(polygons);
+    ps_csg_free(csg);
+}
+
+int main(int argc, char **argv) {
+    size_t points = 1 << 24;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--points") == 0 && i + 1 < argc) {
+            points = strtoull(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    static const size_t segment_counts[] = {12, 64, 1024};
+    for (size_t i = 0; i < sizeof(segment_counts) / sizeof(segment_counts[0]); ++i) {
+        run_points(segment_counts[i], points);
+    }
+
+    static const char *resolutions[] = {"default", "fn64"};
+    for (size_t r = 0; r < 2; ++r) {
+        char source[1024];
+        snprintf(source, sizeof(source), model, r ? 64 : 0);
+        PsScadError error;
+        PsScadResult result;
+        PsScadProgram *program = ps_scad_compile(source, strlen(source), &error);
+        if (!program || !ps_scad_run(program, &result, &error)) {
+            fprintf(stderr, "model:%d:%d: %s\n", error.line, error.column, error.message);
+            return 1;
+        }
+        ps_scad_program_free(program);
+        static const double tolerances[] = {0.0, 0.1, 0.01, 0.001};
+        for (size_t i = 0; i < sizeof(tolerances) / sizeof(tolerances[0]); ++i) {
+            run_model(resolutions[r], &result, tolerances[i]);
+        }
+        ps_scad_result_free(&result);
+    }
+    return 0;
+}
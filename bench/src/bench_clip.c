@@ -0,0 +1,261 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <picoscad/cg/ghclipping.h>
+#include <picoscad/sys/trace.h>
+
+#include "bench.h"
+
+/*
+ * Runs union, diff and intersect over generated polygon pairs and prints one
+ * JSON object per line:
+ *
+ *   {"bench":"clip","workload":"star","size":256,"op":"union",...}
+ *
+ * The clipper inserts its intersections into both inputs, so every iteration
+ * clips fresh copies; only the clip itself is timed. peak_heap_bytes is the
+ * high-water mark above the inputs during one clip, null when the heap is not
+ * tracked. --trace records the clipper's trace zones into a Chrome trace.
+ */
+
+typedef struct Shape {
+    Ps4f *points;
+    size_t length;
+} Shape;
+
+typedef struct Workload {
+    const char *name;
+    size_t size;
+    void (*generate)(size_t size, unsigned int *seed, Shape *poly, Shape *clip);
+} Workload;
+
+static const double tau = 6.283185307179586;
+
+static Shape shape_new(size_t length) {
+    return (Shape) {malloc(sizeof(Ps4f) * length), length};
+}
+
+static void shape_set(Shape *shape, size_t i, double x, double y) {
+    shape->points[i] = ps_4f((float) x, (float) y, 0.0f, 1.0f);
+}
+
+static double random_unit(unsigned int *seed) {
+    return rand_r(seed) / (double) RAND_MAX;
+}
+
+static Shape circle(size_t fn, double radius, double cx, double cy, double phase) {
+    Shape shape = shape_new(fn);
+    for (size_t i = 0; i < fn; ++i) {
+        const double angle = phase + tau * i / fn;
+        shape_set(&shape, i, cx + radius * cos(angle), cy + radius * sin(angle));
+    }
+    return shape;
+}
+
+static int compare_doubles(const void *lhs, const void *rhs) {
+    const double a = *(const double *) lhs, b = *(const double *) rhs;
+    return (a > b) - (a < b);
+}
+
+// Random radii at sorted random angles: star-shaped around the center, so always simple
+static Shape random_simple(size_t length, double cx, double cy, unsigned int *seed) {
+    double *angles = malloc(sizeof(double) * length);
+    for (size_t i = 0; i < length; ++i) {
+        angles[i] = tau * random_unit(seed);
+    }
+    qsort(angles, length, sizeof(double), compare_doubles);
+    Shape shape = shape_new(length);
+    for (size_t i = 0; i < length; ++i) {
+        const double radius = 0.5 + 0.5 * random_unit(seed);
+        shape_set(&shape, i, cx + radius * cos(angles[i]), cy + radius * sin(angles[i]));
+    }
+    free(angles);
+    return shape;
+}
+
+static Shape star(size_t spikes, double cx, double cy, double phase) {
+    Shape shape = shape_new(spikes * 2);
+    for (size_t i = 0; i < spikes * 2; ++i) {
+        const double angle = phase + tau * i / (spikes * 2);
+        const double radius = i % 2 ? 0.4 : 1.0;
+        shape_set(&shape, i, cx + radius * cos(angle), cy + radius * sin(angle));
+    }
+    return shape;
+}
+
+// Trapezoid teeth between a root and a tip circle, 4 vertices per tooth
+static Shape gear(size_t teeth, double cx, double cy, double phase) {
+    static const double offsets[4] = {0.0, 0.3, 0.5, 0.8};
+    static const double radii[4] = {0.8, 1.0, 1.0, 0.8};
+    Shape shape = shape_new(teeth * 4);
+    for (size_t i = 0; i < teeth; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+            const double angle = phase + tau * (i + offsets[j]) / teeth;
+            shape_set(&shape, i * 4 + j, cx + radii[j] * cos(angle), cy + radii[j] * sin(angle));
+        }
+    }
+    return shape;
+}
+
+// The offsets below are deliberately irregular so no vertex lands on an edge of the other shape
+
+static void generate_random(size_t size, unsigned int *seed, Shape *poly, Shape *clip) {
+    *poly = random_simple(size, 0.0, 0.0, seed);
+    *clip = random_simple(size, 0.41, 0.27, seed);
+}
+
+static void generate_star(size_t size, unsigned int *seed, Shape *poly, Shape *clip) {
+    *poly = star(size, 0.0, 0.0, 0.0);
+    *clip = star(size, 0.013, 0.007, tau / (size * 4) + 0.001);
+}
+
+static void generate_circle(size_t size, unsigned int *seed, Shape *poly, Shape *clip) {
+    *poly = circle(size, 1.0, 0.0, 0.0, 0.0);
+    *clip = circle(size, 1.0, 0.53, 0.31, 0.017);
+}
+
+static void generate_gear(size_t size, unsigned int *seed, Shape *poly, Shape *clip) {
+    *poly = gear(size, 0.0, 0.0, 0.0);
+    *clip = gear(size, 1.83, 0.011, tau / (size * 2) + 0.003);
+}
+
+static void generate_nested(size_t size, unsigned int *seed, Shape *poly, Shape *clip) {
+    *poly = circle(size, 1.0, 0.0, 0.0, 0.0);
+    *clip = circle(size, 0.5, 0.11, 0.07, 0.017);
+}
+
+static void generate_disjoint(size_t size, unsigned int *seed, Shape *poly, Shape *clip) {
+    *poly = circle(size, 1.0, 0.0, 0.0, 0.0);
+    *clip = circle(size, 1.0, 3.1, 0.07, 0.017);
+}
+
+static const Workload workloads[] = {
+        {"random", 64, generate_random},
+        {"random", 1024, generate_random},
+        {"star", 16, generate_star},
+        {"star", 256, generate_star},
+        {"circle", 32, generate_circle},
+        {"circle", 256, generate_circle},
+        {"circle", 2048, generate_circle},
+        {"gear", 12, generate_gear},
+        {"gear", 64, generate_gear},
+        {"nested", 256, generate_nested},
+        {"disjoint", 256, generate_disjoint},
+};
+
+static const struct {
+    const char *name;
+    PsGHOperation operation;
+} operations[] = {
+        {"union", PS_GH_UNION},
+        {"diff", PS_GH_DIFF},
+        {"intersect", PS_GH_INTERSECT},
+};
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void free_result(PsArray OF(PsGHPolygon *) *result) {
+    for (size_t i = 0; i < ps_array_get_length(result); ++i) {
+        ps_ghpolygon_free(ps_array_get(result, i));
+    }
+    ps_array_free(result);
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--min-time SECONDS] [--filter WORKLOAD] [--seed SEED] [--trace FILE]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    double min_time = 0.2;
+    const char *filter = NULL;
+    unsigned int seed = 1;
+    const char *trace_path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int) strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (trace_path) {
+        ps_trace_start();
+    }
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+        const Workload *workload = &workloads[w];
+        if (filter != NULL && strcmp(workload->name, filter) != 0) {
+            continue;
+        }
+        Shape poly, clip;
+        unsigned int workload_seed = seed;
+        workload->generate(workload->size, &workload_seed, &poly, &clip);
+
+        for (size_t o = 0; o < sizeof(operations) / sizeof(operations[0]); ++o) {
+            PsGHClipStats stats = {0};
+            size_t iterations = 0, peak_heap = 0;
+            double elapsed = 0.0, best = INFINITY;
+            // At least one run, then repeat until min_time of clipping has been measured
+            while (iterations == 0 || elapsed < min_time) {
+                PsGHPolygon *a = ps_ghpolygon_new_with_points(poly.points, poly.length);
+                PsGHPolygon *b = ps_ghpolygon_new_with_points(clip.points, clip.length);
+                const size_t heap_before = bench_heap_current();
+                bench_heap_reset_peak();
+
+                const double start = now();
+                PsArray OF(PsGHPolygon *) *result = ps_ghpolygon_clip(a, b, operations[o].operation, &stats);
+                const double time = now() - start;
+
+                if (bench_heap_peak() - heap_before > peak_heap) {
+                    peak_heap = bench_heap_peak() - heap_before;
+                }
+                free_result(result);
+                ps_ghpolygon_free(a);
+                ps_ghpolygon_free(b);
+                elapsed += time;
+                best = time < best ? time : best;
+                iterations++;
+            }
+
+            printf("{\"bench\":\"clip\",\"workload\":\"%s\",\"size\":%zu,\"op\":\"%s\","
+                   "\"poly_vertices\":%zu,\"clip_vertices\":%zu,\"iterations\":%zu,"
+                   "\"mean_us\":%.3f,\"min_us\":%.3f,\"intersections\":%zu,"
+                   "\"output_polygons\":%zu,\"output_vertices\":%zu,",
+                   workload->name, workload->size, operations[o].name, poly.length, clip.length, iterations,
+                   elapsed * 1e6 / iterations, best * 1e6, stats.intersections, stats.output_polygons,
+                   stats.output_vertices);
+            if (bench_heap_tracked()) {
+                printf("\"peak_heap_bytes\":%zu}\n", peak_heap);
+            } else {
+                printf("\"peak_heap_bytes\":null}\n");
+            }
+            fflush(stdout);
+        }
+        free(poly.points);
+        free(clip.points);
+    }
+
+    if (trace_path) {
+        ps_trace_stop();
+        FILE *file = fopen(trace_path, "w");
+        if (!file || !ps_trace_write(file)) {
+            fprintf(stderr, "failed to write the trace to %s\n", trace_path);
+            return 1;
+        }
+        fclose(file);
+    }
+    return 0;
+}
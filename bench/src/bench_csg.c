@@ -0,0 +1,207 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <picoscad/cg/csg.h>
+#include <picoscad/io/diskcache.h>
+#include <picoscad/lang/scad.h>
+#include <picoscad/sys/cpu.h>
+
+/*
+ * Evaluates generated 2D models through the CSG graph and prints one JSON
+ * object per workload and cache mode:
+ *
+ *   {"bench":"csg","workload":"brackets","mode":"cold","evaluate_ms":...,"evaluated":...}
+ *
+ * "none" evaluates without a cache, "cold" with an empty one, "warm" again
+ * with the cache the cold run filled, and "tight" with a budget of a tenth of
+ * what the cold run kept, so it evicts. The disk modes put a disk cache in a
+ * fresh temporary directory behind an empty memory cache each run, the way a
+ * new process sees it: "disk-cold" fills it, "disk-warm" loads from it and
+ * "disk-tight" fills one with a budget of a tenth of what disk-cold stored.
+ * Those all run on one thread; "parallel" evaluates without a cache on
+ * --threads threads (default one per CPU), "parallel-cold" with an empty
+ * cache, and "parallel-capped" lets only two results wait for a sibling.
+ */
+
+typedef struct Workload {
+    const char *name;
+    const char *source;
+} Workload;
+
+static const Workload workloads[] = {
+        // The same drilled plate placed many times: one plate evaluated, the rest reused
+        {"brackets",
+                "module bracket() difference() {\n"
+                "    square([20, 10]);\n"
+                "    for (i = [0:7]) translate([1.5 + i * 2.4, 5]) circle(0.8, $fn = 24);\n"
+                "}\n"
+                "for (x = [0:7], y = [0:7]) translate([x * 25, y * 12]) bracket();\n"},
+        // Overlapping gears with a shared hub cut out of each
+        {"gears",
+                "module gear(teeth) difference() {\n"
+                "    union() {\n"
+                "        circle(10, $fn = 64);\n"
+                "        for (i = [0:teeth - 1]) rotate(i * 360 / teeth) translate([9.5, -1]) square([2.5, 2]);\n"
+                "    }\n"
+                "    circle(3, $fn = 32);\n"
+                "}\n"
+                "for (i = [0:5]) translate([i * 19, (i % 2) * 8]) gear(12 + (i % 3) * 4);\n"},
+        // Plates that all differ, so there is nothing to reuse and every subtree is clipped
+        {"parts",
+                "module part(n) difference() {\n"
+                "    square([20 + n % 5, 10]);\n"
+                "    for (i = [0:n % 6 + 3]) translate([1.5 + i * 2, 5 + (n % 3) * 0.5]) circle(0.8, $fn = 24 + n);\n"
+                "}\n"
+                "for (x = [0:7], y = [0:7]) translate([x * 20, y * 12]) part(x * 8 + y);\n"},
+};
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--filter WORKLOAD] [--threads N]\n", argv0);
+}
+
+static void free_polygons(PsArray OF(PsGHPolygon4d *) *polygons) {
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        ps_ghpolygon4d_free(ps_array_get(polygons, i));
+    }
+    ps_array_free(polygons);
+}
+
+static void run(const char *workload, const char *mode, PsCsg *csg, PsCsgNode root, PsCsgCache *cache,
+                PsDiskCache *disk_cache, size_t threads, size_t max_live) {
+    PsCsgStats stats;
+    const double start = now();
+    PsArray OF(PsGHPolygon4d *) *result = ps_csg_evaluate_parallel(csg, root, cache, threads, max_live, &stats);
+    const double elapsed = now() - start;
+    size_t vertices = 0;
+    for (size_t i = 0; i < ps_array_get_length(result); ++i) {
+        vertices += ps_ghpolygon4d_get_size(ps_array_get(result, i));
+    }
+    PsCsgCacheStats cache_stats = {0};
+    if (cache) {
+        ps_csg_cache_get_stats(cache, &cache_stats);
+    }
+    PsDiskCacheStats disk_stats = {0};
+    if (disk_cache) {
+        ps_disk_cache_get_stats(disk_cache, &disk_stats);
+    }
+    printf("{\"bench\":\"csg\",\"workload\":\"%s\",\"mode\":\"%s\",\"threads\":%zu,\"nodes\":%zu,\"evaluate_ms\":%.3f,"
+           "\"evaluated\":%zu,\"reused\":%zu,\"loaded\":%zu,\"clips\":%zu,\"output_polygons\":%zu,"
+           "\"output_vertices\":%zu,\"cache_entries\":%zu,\"cache_bytes\":%zu,\"evictions\":%zu,"
+           "\"disk_writes\":%zu,\"disk_bytes\":%llu,\"disk_evictions\":%zu}\n",
+           workload, mode, threads, ps_csg_get_node_count(csg), elapsed * 1e3, stats.evaluated, stats.reused, stats.loaded,
+           stats.clips, ps_array_get_length(result), vertices, cache_stats.entries, cache_stats.bytes,
+           cache_stats.evictions, disk_stats.writes, (unsigned long long) disk_stats.bytes, disk_stats.evictions);
+    fflush(stdout);
+    free_polygons(result);
+}
+
+// The disk cache only ever puts files straight in its directory
+static void remove_directory(const char *directory) {
+    DIR *dir = opendir(directory);
+    if (dir) {
+        for (struct dirent *dirent; (dirent = readdir(dir));) {
+            if (strcmp(dirent->d_name, ".") != 0 && strcmp(dirent->d_name, "..") != 0) {
+                unlinkat(dirfd(dir), dirent->d_name, 0);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(directory);
+}
+
+// A new memory cache in front of a disk cache in directory, as a fresh process would have; returns what it stored
+static uint64_t run_disk(const char *workload, const char *mode, PsCsg *csg, PsCsgNode root,
+                         const char *directory, uint64_t budget) {
+    const char *error;
+    PsDiskCache *disk_cache = ps_disk_cache_open(directory, budget, &error);
+    if (!disk_cache) {
+        fprintf(stderr, "%s: %s\n", directory, error);
+        exit(1);
+    }
+    PsCsgCache *cache = ps_csg_cache_new(SIZE_MAX);
+    const PsCsgStore store = ps_disk_cache_get_store(disk_cache);
+    ps_csg_cache_set_store(cache, &store);
+    run(workload, mode, csg, root, cache, disk_cache, 1, 0);
+    PsDiskCacheStats disk_stats;
+    ps_disk_cache_get_stats(disk_cache, &disk_stats);
+    ps_csg_cache_free(cache);
+    ps_disk_cache_close(disk_cache);
+    return disk_stats.bytes;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    size_t threads = ps_cpu_count();
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = (size_t) strtoul(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+        const Workload *workload = &workloads[w];
+        if (filter != NULL && strcmp(workload->name, filter) != 0) {
+            continue;
+        }
+        PsScadError error;
+        PsScadResult result;
+        PsScadProgram *program = ps_scad_compile(workload->source, strlen(workload->source), &error);
+        if (!program || !ps_scad_run(program, &result, &error)) {
+            fprintf(stderr, "%s:%d:%d: %s\n", workload->name, error.line, error.column, error.message);
+            return 1;
+        }
+        ps_scad_program_free(program);
+        PsCsg *csg = ps_csg_new();
+        const PsCsgNode root = ps_scad_result_to_csg(&result, 0.01, csg, NULL);
+        ps_scad_result_free(&result);
+
+        run(workload->name, "none", csg, root, NULL, NULL, 1, 0);
+        PsCsgCache *cache = ps_csg_cache_new(SIZE_MAX);
+        run(workload->name, "cold", csg, root, cache, NULL, 1, 0);
+        run(workload->name, "warm", csg, root, cache, NULL, 1, 0);
+        PsCsgCacheStats cache_stats;
+        ps_csg_cache_get_stats(cache, &cache_stats);
+        ps_csg_cache_free(cache);
+        cache = ps_csg_cache_new(cache_stats.bytes / 10);
+        run(workload->name, "tight", csg, root, cache, NULL, 1, 0);
+        ps_csg_cache_free(cache);
+
+        run(workload->name, "parallel", csg, root, NULL, NULL, threads, 0);
+        cache = ps_csg_cache_new(SIZE_MAX);
+        run(workload->name, "parallel-cold", csg, root, cache, NULL, threads, 0);
+        ps_csg_cache_free(cache);
+        run(workload->name, "parallel-capped", csg, root, NULL, NULL, threads, 2);
+
+        char directory[] = "/tmp/bench_csg.XXXXXX";
+        if (!mkdtemp(directory)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        const uint64_t stored = run_disk(workload->name, "disk-cold", csg, root, directory, UINT64_MAX);
+        run_disk(workload->name, "disk-warm", csg, root, directory, UINT64_MAX);
+        remove_directory(directory);
+        if (!mkdtemp(strcpy(directory, "/tmp/bench_csg.XXXXXX"))) {
+            perror("mkdtemp");
+            return 1;
+        }
+        run_disk(workload->name, "disk-tight", csg, root, directory, stored / 10);
+        remove_directory(directory);
+        ps_csg_free(csg);
+    }
+    return 0;
+}
@@ -0,0 +1,288 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <picoscad/sys/cpu.h>
+
+#include "bench.h"
+
+/*
+ * Times every op of every backend variant over the same random inputs and
+ * prints one JSON object per line:
+ *
+ *   {"bench":"math","variant":"avx2","op":"dot3","precision":"f32",...}
+ *
+ * Errors are measured against a long double evaluation of the same formula,
+ * per element as max |out - ref| over the four lanes divided by the formula
+ * evaluated on |a| and |b|, so cancellation in a dot product is not blamed on
+ * the kernel.
+ */
+
+typedef struct BenchVariant {
+    const char *name;
+    const BenchOp *ops;
+    PsCpuIsa isa;
+} BenchVariant;
+
+static const BenchVariant variants[] = {
+        {"scalar", bench_math_ops_scalar, PS_CPU_ISA_GENERIC},
+        {"native", bench_math_ops_native, PS_CPU_ISA_GENERIC},
+#ifdef BENCH_HAVE_AVX
+        {"avx", bench_math_ops_avx, PS_CPU_ISA_AVX},
+#endif
+#ifdef BENCH_HAVE_AVX2
+        {"avx2", bench_math_ops_avx2, PS_CPU_ISA_AVX2},
+#endif
+};
+
+typedef long double Ref[4];
+
+static void ref_dot3(const Ref a, const Ref b, Ref out) {
+    const long double dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    out[0] = out[1] = out[2] = out[3] = dot;
+}
+
+static void ref_cross(const Ref a, const Ref b, Ref out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+    out[3] = 0.0L;
+}
+
+static void ref_length3(const Ref a, const Ref b, Ref out) {
+    const long double length = sqrtl(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    out[0] = out[1] = out[2] = out[3] = length;
+}
+
+static void ref_normalize3(const Ref a, const Ref b, Ref out) {
+    const long double scale = 1.0L / sqrtl(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    for (int i = 0; i < 4; ++i) {
+        out[i] = a[i] * scale;
+    }
+}
+
+static void ref_sqrt(const Ref a, const Ref b, Ref out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = sqrtl(a[i]);
+    }
+}
+
+static void ref_rsqrt(const Ref a, const Ref b, Ref out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = 1.0L / sqrtl(a[i]);
+    }
+}
+
+static void ref_recip(const Ref a, const Ref b, Ref out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = 1.0L / a[i];
+    }
+}
+
+static void ref_sin(const Ref a, const Ref b, Ref out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = sinl(a[i]);
+    }
+}
+
+// Column-major: element j of the result is sum_k m[k][j] * v[k]
+static void ref_mat4_vec(const Ref *m, const Ref v, Ref out) {
+    for (int j = 0; j < 4; ++j) {
+        out[j] = m[0][j] * v[0] + m[1][j] * v[1] + m[2][j] * v[2] + m[3][j] * v[3];
+    }
+}
+
+typedef struct BenchRef {
+    const char *prefix;
+    void (*element)(const Ref a, const Ref b, Ref out);
+} BenchRef;
+
+// Matched against the op name up to an optional _fast or _soa suffix
+static const BenchRef refs[] = {
+        {"dot3", ref_dot3},
+        {"cross", ref_cross},
+        {"length3", ref_length3},
+        {"normalize3", ref_normalize3},
+        {"sqrt", ref_sqrt},
+        {"rsqrt", ref_rsqrt},
+        {"recip", ref_recip},
+        {"sin", ref_sin},
+        {"mat4_mul", NULL},
+        {"mat4_vec_mul", NULL},
+};
+
+static const BenchRef *find_ref(const char *name) {
+    for (size_t i = 0; i < sizeof(refs) / sizeof(refs[0]); ++i) {
+        const size_t length = strlen(refs[i].prefix);
+        if (strncmp(name, refs[i].prefix, length) == 0 && (name[length] == '\0' || name[length] == '_')) {
+            return &refs[i];
+        }
+    }
+    return NULL;
+}
+
+static void load_ref(const void *data, BenchPrecision precision, size_t i, Ref out) {
+    for (int lane = 0; lane < 4; ++lane) {
+        out[lane] = precision == BENCH_F32 ? ((const float *) data)[i * 4 + lane]
+                                           : ((const double *) data)[i * 4 + lane];
+    }
+}
+
+static void abs_ref(Ref ref) {
+    for (int lane = 0; lane < 4; ++lane) {
+        ref[lane] = fabsl(ref[lane]);
+    }
+}
+
+static double max_rel_error(const BenchOp *op, const void *a, const void *b, const void *out, size_t n) {
+    const BenchRef *ref = find_ref(op->name);
+    if (ref == NULL) {
+        return NAN;
+    }
+    double max_error = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        Ref ra, rb, expected, magnitude, actual;
+        if (ref->element != NULL) {
+            load_ref(a, op->precision, i, ra);
+            load_ref(b, op->precision, i, rb);
+            ref->element(ra, rb, expected);
+            abs_ref(ra);
+            abs_ref(rb);
+            ref->element(ra, rb, magnitude);
+        } else {
+            // mat4_mul takes 4 elements as a matrix, mat4_vec_mul transforms b[i] by the first 4 of a
+            Ref m[4];
+            const size_t base = strcmp(ref->prefix, "mat4_mul") == 0 ? i / 4 * 4 : 0;
+            for (int k = 0; k < 4; ++k) {
+                load_ref(a, op->precision, base + k, m[k]);
+            }
+            load_ref(b, op->precision, i, rb);
+            ref_mat4_vec((const Ref *) m, rb, expected);
+            for (int k = 0; k < 4; ++k) {
+                abs_ref(m[k]);
+            }
+            abs_ref(rb);
+            ref_mat4_vec((const Ref *) m, rb, magnitude);
+        }
+        load_ref(out, op->precision, i, actual);
+        long double scale = 0.0L, error = 0.0L;
+        for (int lane = 0; lane < 4; ++lane) {
+            scale = fmaxl(scale, fabsl(magnitude[lane]));
+            error = fmaxl(error, fabsl(actual[lane] - expected[lane]));
+        }
+        if (scale > 0.0L) {
+            max_error = fmax(max_error, (double) (error / scale));
+        } else if (error > 0.0L) {
+            max_error = INFINITY;
+        }
+    }
+    return max_error;
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *alloc_elements(size_t n, BenchPrecision precision) {
+    const size_t size = n * 4 * (precision == BENCH_F32 ? sizeof(float) : sizeof(double));
+    // 64 covers every Ps4d/Ps8f alignment and keeps rows on their own cache lines
+    return aligned_alloc(64, (size + 63) / 64 * 64);
+}
+
+static void fill(void *data, BenchPrecision precision, size_t n, double low, double high, unsigned int *seed) {
+    for (size_t i = 0; i < n * 4; ++i) {
+        const double value = low + (high - low) * (rand_r(seed) / (double) RAND_MAX);
+        if (precision == BENCH_F32) {
+            ((float *) data)[i] = (float) value;
+        } else {
+            ((double *) data)[i] = value;
+        }
+    }
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--n ELEMENTS] [--min-time SECONDS] [--filter SUBSTRING]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 1 << 18;
+    double min_time = 0.2;
+    const char *filter = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+            n = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    // Matrix ops consume the inputs 4 elements at a time
+    n = (n + 3) / 4 * 4;
+    if (n == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // a stays positive for sqrt, rsqrt and recip, b covers both signs
+    void *a[2], *b[2], *out[2];
+    unsigned int seed = 1;
+    for (int p = BENCH_F32; p <= BENCH_F64; ++p) {
+        a[p] = alloc_elements(n, p);
+        b[p] = alloc_elements(n, p);
+        out[p] = alloc_elements(n, p);
+        fill(a[p], p, n, 0.125, 8.0, &seed);
+        fill(b[p], p, n, -8.0, 8.0, &seed);
+    }
+
+    const PsCpuIsa isa = ps_cpu_detect_isa();
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); ++v) {
+        if (variants[v].isa > isa) {
+            fprintf(stderr, "skipping %s: the CPU only supports %s\n", variants[v].name, ps_cpu_isa_name(isa));
+            continue;
+        }
+        for (const BenchOp *op = variants[v].ops; op->name != NULL; ++op) {
+            if (filter != NULL && strstr(op->name, filter) == NULL) {
+                continue;
+            }
+            const int p = op->precision;
+
+            // Warm up, then double the iterations until a run takes min_time
+            op->run(a[p], b[p], out[p], n);
+            size_t iterations = 1;
+            double elapsed;
+            for (;;) {
+                const double start = now();
+                for (size_t i = 0; i < iterations; ++i) {
+                    op->run(a[p], b[p], out[p], n);
+                }
+                elapsed = now() - start;
+                if (elapsed >= min_time) {
+                    break;
+                }
+                iterations *= 2;
+            }
+
+            const double ns_per_op = elapsed * 1e9 / ((double) iterations * n);
+            printf("{\"bench\":\"math\",\"variant\":\"%s\",\"backend\":\"%s\",\"op\":\"%s\",\"precision\":\"%s\","
+                   "\"n\":%zu,\"iterations\":%zu,\"ns_per_op\":%.4f,\"mops_per_s\":%.2f,\"max_rel_error\":%.3e}\n",
+                   variants[v].name, op->backend, op->name, p == BENCH_F32 ? "f32" : "f64",
+                   n, iterations, ns_per_op, 1e3 / ns_per_op, max_rel_error(op, a[p], b[p], out[p], n));
+            fflush(stdout);
+        }
+    }
+
+    for (int p = BENCH_F32; p <= BENCH_F64; ++p) {
+        free(a[p]);
+        free(b[p]);
+        free(out[p]);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <picoscad/lang/scad.h>
+
+/*
+ * Compiles and runs generated SCAD scripts and prints one JSON object per
+ * workload:
+ *
+ *   {"bench":"scad","workload":"grid","compile_us":...,"run_us":...,"nodes":...}
+ *
+ * Compiling and running are timed separately, run_us is the mean over enough
+ * runs to fill --min-time.
+ */
+
+typedef struct Workload {
+    const char *name;
+    const char *source;
+} Workload;
+
+static const Workload workloads[] = {
+        // Nested loops over primitives, mostly node emission
+        {"grid",
+                "for (x = [0:99], y = [0:99]) translate([x * 2, y * 2, 0]) cube([1, 1, 1 + (x + y) % 5]);\n"},
+        // Recursive modules with transforms, mostly calls and children()
+        {"tree",
+                "module branch(depth, length) {\n"
+                "    cylinder(h = length, r1 = length / 10, r2 = length / 14, $fn = 6);\n"
+                "    if (depth > 0) translate([0, 0, length]) for (a = [0:120:240])\n"
+                "        rotate([35, 0, a]) branch(depth - 1, length * 0.7);\n"
+                "}\n"
+                "branch(8, 10);\n"},
+        // Recursive functions and comprehensions, mostly expression evaluation
+        {"functions",
+                "function fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2);\n"
+                "function sum(v, i = 0) = i >= len(v) ? 0 : v[i] + sum(v, i + 1);\n"
+                "function wave(i, n) = [cos(360 * i / n), sin(360 * i / n)] * (10 + sin(i * 7) * 2);\n"
+                "n = 20000;\n"
+                "points = [for (i = [0:n - 1]) wave(i, n)];\n"
+                "echo(fib(20), sum([for (i = [1:2000]) i * i]));\n"
+                "linear_extrude(height = 5) polygon(points);\n"},
+        // Long flat loop over arithmetic, mostly the dispatch loop
+        {"arithmetic",
+                "total = [for (i = [0:199999]) let (x = i * 0.5, y = x * x - i) if (i % 3 < 1) y];\n"
+                "echo(len(total), max(total));\n"},
+};
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--min-time SECONDS] [--filter WORKLOAD]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    double min_time = 0.2;
+    const char *filter = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+        const Workload *workload = &workloads[w];
+        if (filter != NULL && strcmp(workload->name, filter) != 0) {
+            continue;
+        }
+        PsScadError error;
+        double start = now();
+        PsScadProgram *program = ps_scad_compile(workload->source, strlen(workload->source), &error);
+        const double compile_time = now() - start;
+        if (!program) {
+            fprintf(stderr, "%s:%d:%d: %s\n", workload->name, error.line, error.column, error.message);
+            return 1;
+        }
+
+        PsScadResult result = {0};
+        size_t iterations = 0, nodes = 0, points = 0;
+        double elapsed = 0.0, best = INFINITY;
+        while (iterations == 0 || elapsed < min_time) {
+            start = now();
+            const bool ok = ps_scad_run(program, &result, &error);
+            const double time = now() - start;
+            if (!ok) {
+                fprintf(stderr, "%s:%d:%d: %s\n", workload->name, error.line, error.column, error.message);
+                ps_scad_program_free(program);
+                return 1;
+            }
+            nodes = result.node_count;
+            points = result.point_count;
+            ps_scad_result_free(&result);
+            elapsed += time;
+            best = time < best ? time : best;
+            iterations++;
+        }
+        ps_scad_program_free(program);
+
+        printf("{\"bench\":\"scad\",\"workload\":\"%s\",\"compile_us\":%.3f,\"iterations\":%zu,"
+               "\"run_mean_us\":%.3f,\"run_min_us\":%.3f,\"nodes\":%zu,\"points\":%zu}\n",
+               workload->name, compile_time * 1e6, iterations, elapsed * 1e6 / iterations, best * 1e6, nodes,
+               points);
+        fflush(stdout);
+    }
+    return 0;
+}
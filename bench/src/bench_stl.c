@@ -0,0 +1,103 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <picoscad/io/stl.h>
+
+/*
+ * Streams the same block of random triangles through the STL writer until the
+ * requested count is reached and prints one JSON object per format. Writing to
+ * /dev/null (the default) measures the CPU side alone. When the output is a
+ * regular file it is read back with ps_stl_read and timed too, the first read
+ * is served from the page cache the write just filled.
+ */
+
+#define BLOCK_TRIANGLES 65536
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--triangles COUNT] [--output FILE]\n", argv0);
+}
+
+static bool run(PsStlFormat format, const char *path, const Ps4f *block, size_t triangles) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    const double start = now();
+    PsStlWriter *writer = ps_stl_writer_new(fd, format, "bench_stl", (uint32_t) triangles);
+    bool ok = writer != NULL;
+    for (size_t written = 0; ok && written < triangles; written += BLOCK_TRIANGLES) {
+        const size_t count = triangles - written < BLOCK_TRIANGLES ? triangles - written : BLOCK_TRIANGLES;
+        ok = ps_stl_writer_add(writer, block, count);
+    }
+    ok = writer && ps_stl_writer_close(writer) && ok;
+    // Count the time to get the data to the device too, not just into the page cache
+    ok = (fsync(fd) == 0 || strcmp(path, "/dev/null") == 0) && ok;
+    const double elapsed = now() - start;
+
+    struct stat st;
+    const long long bytes = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? (long long) st.st_size : -1;
+    close(fd);
+    if (!ok) {
+        fprintf(stderr, "writing %s failed\n", path);
+        return false;
+    }
+    const char *name = format == PS_STL_BINARY ? "binary" : "ascii";
+    printf("{\"bench\":\"stl\",\"op\":\"write\",\"format\":\"%s\",\"output\":\"%s\",\"triangles\":%zu,"
+           "\"bytes\":%lld,\"seconds\":%.4f,\"mtris_per_s\":%.2f}\n",
+           name, path, triangles, bytes, elapsed, triangles / elapsed * 1e-6);
+    if (bytes < 0) {
+        return true;
+    }
+
+    const double read_start = now();
+    const char *error = NULL;
+    PsMesh *mesh = ps_stl_read(path, &error);
+    const double read_elapsed = now() - read_start;
+    if (!mesh || mesh->triangle_count != triangles) {
+        fprintf(stderr, "reading %s back failed: %s\n", path, mesh ? "wrong triangle count" : error);
+        return false;
+    }
+    ps_mesh_free(mesh);
+    printf("{\"bench\":\"stl\",\"op\":\"read\",\"format\":\"%s\",\"output\":\"%s\",\"triangles\":%zu,"
+           "\"bytes\":%lld,\"seconds\":%.4f,\"mtris_per_s\":%.2f}\n",
+           name, path, triangles, bytes, read_elapsed, triangles / read_elapsed * 1e-6);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    size_t triangles = 1 << 24;
+    const char *path = "/dev/null";
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) {
+            triangles = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Ps4f *block = malloc(sizeof(Ps4f) * BLOCK_TRIANGLES * 3);
+    unsigned int seed = 1;
+    for (size_t i = 0; i < BLOCK_TRIANGLES * 3; ++i) {
+        block[i] = ps_4f(rand_r(&seed) / (float) RAND_MAX, rand_r(&seed) / (float) RAND_MAX,
+                         rand_r(&seed) / (float) RAND_MAX, 1.0f);
+    }
+    // ASCII is about 5x the size and formats every float, run it on a tenth of the triangles
+    bool ok = run(PS_STL_BINARY, path, block, triangles) && run(PS_STL_ASCII, path, block, triangles / 10);
+    free(block);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include <string.h>
+
+#include "bench.h"
+
+/*
+ * Linked with -Wl,--wrap=malloc and friends, every allocation made by the bench
+ * and the static libpicoscad goes through here and carries a 16 byte header
+ * with its size and the address the real allocator returned. libc's own
+ * allocations are not wrapped and never reach these functions.
+ */
+
+#ifdef BENCH_TRACK_HEAP
+
+void *__real_malloc(size_t size);
+void *__real_aligned_alloc(size_t alignment, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+#define HEADER_SIZE 16
+
+typedef struct HeapHeader {
+    size_t size;
+    void *base;
+} HeapHeader;
+
+static size_t heap_current = 0;
+static size_t heap_peak = 0;
+
+static void *heap_track(void *base, size_t offset, size_t size) {
+    if (!base) {
+        return NULL;
+    }
+    unsigned char *ptr = (unsigned char *) base + offset;
+    HeapHeader *header = (HeapHeader *) (ptr - HEADER_SIZE);
+    header->size = size;
+    header->base = base;
+    heap_current += size;
+    if (heap_current > heap_peak) {
+        heap_peak = heap_current;
+    }
+    return ptr;
+}
+
+static HeapHeader *heap_header(void *ptr) {
+    return (HeapHeader *) ((unsigned char *) ptr - HEADER_SIZE);
+}
+
+void *__wrap_malloc(size_t size) {
+    return heap_track(__real_malloc(size + HEADER_SIZE), HEADER_SIZE, size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    void *ptr = __wrap_malloc(count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size) {
+    // The header goes in front, so pad by a whole alignment to keep the result aligned
+    const size_t offset = alignment > HEADER_SIZE ? alignment : HEADER_SIZE;
+    const size_t total = (size + offset + alignment - 1) / alignment * alignment;
+    return heap_track(__real_aligned_alloc(alignment, total), offset, size);
+}
+
+void __wrap_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    HeapHeader *header = heap_header(ptr);
+    heap_current -= header->size;
+    __real_free(header->base);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    if (!ptr) {
+        return __wrap_malloc(size);
+    }
+    HeapHeader *header = heap_header(ptr);
+    const size_t old_size = header->size;
+    if ((unsigned char *) header->base + HEADER_SIZE != ptr) {
+        // Over-aligned blocks can't be handed back to realloc, move them by hand
+        void *moved = __wrap_malloc(size);
+        if (moved) {
+            memcpy(moved, ptr, old_size < size ? old_size : size);
+            __wrap_free(ptr);
+        }
+        return moved;
+    }
+    unsigned char *base = __real_realloc(header->base, size + HEADER_SIZE);
+    if (!base) {
+        return NULL;
+    }
+    heap_current -= old_size;
+    return heap_track(base, HEADER_SIZE, size);
+}
+
+bool bench_heap_tracked() {
+    return true;
+}
+
+size_t bench_heap_current() {
+    return heap_current;
+}
+
+size_t bench_heap_peak() {
+    return heap_peak;
+}
+
+void bench_heap_reset_peak() {
+    heap_peak = heap_current;
+}
+
+#else
+
+bool bench_heap_tracked() {
+    return false;
+}
+
+size_t bench_heap_current() {
+    return 0;
+}
+
+size_t bench_heap_peak() {
+    return 0;
+}
+
+void bench_heap_reset_peak() {
+}
+
+#endif
@@ -0,0 +1,148 @@
+#include <picoscad/math/mat4f.h>
+#include <picoscad/math/mat4d.h>
+#include <picoscad/math/8x3f.h>
+
+#include "bench.h"
+
+#if defined(__SSE2__) && !defined(PS_NO_SIMD)
+#define BACKEND_4F "simd"
+#else
+#define BACKEND_4F "scalar"
+#endif
+
+#if defined(__AVX__) && !defined(PS_NO_SIMD)
+#define BACKEND_4D "simd"
+#define BACKEND_8F "simd"
+#else
+#define BACKEND_4D "scalar"
+#define BACKEND_8F "scalar"
+#endif
+
+#define BINARY(name, type, expr) \
+    static void name(const void *a, const void *b, void *out, size_t n) { \
+        const type *lhs = a, *rhs = b; \
+        type *o = out; \
+        for (size_t i = 0; i < n; ++i) { \
+            o[i] = (expr); \
+        } \
+    }
+
+#define UNARY(name, type, expr) \
+    static void name(const void *a, const void *b, void *out, size_t n) { \
+        const type *lhs = a; \
+        type *o = out; \
+        for (size_t i = 0; i < n; ++i) { \
+            o[i] = (expr); \
+        } \
+    }
+
+BINARY(dot3_4f, Ps4f, ps_4f_dot3(lhs[i], rhs[i]))
+BINARY(cross_4f, Ps4f, ps_4f_cross(lhs[i], rhs[i]))
+UNARY(length3_4f, Ps4f, ps_4f_length3(lhs[i]))
+UNARY(length3_fast_4f, Ps4f, ps_4f_length3_fast(lhs[i]))
+UNARY(normalize3_4f, Ps4f, ps_4f_normalize3(lhs[i]))
+UNARY(normalize3_fast_4f, Ps4f, ps_4f_normalize3_fast(lhs[i]))
+UNARY(sqrt_4f, Ps4f, ps_4f_sqrt(lhs[i]))
+UNARY(sqrt_fast_4f, Ps4f, ps_4f_sqrt_fast(lhs[i]))
+UNARY(rsqrt_4f, Ps4f, ps_4f_rsqrt(lhs[i]))
+UNARY(rsqrt_fast_4f, Ps4f, ps_4f_rsqrt_fast(lhs[i]))
+UNARY(recip_4f, Ps4f, ps_4f_recip(lhs[i]))
+UNARY(recip_fast_4f, Ps4f, ps_4f_recip_fast(lhs[i]))
+UNARY(sin_4f, Ps4f, ps_4f_sin(lhs[i]))
+
+static void mat4f_mul_4f(const void *a, const void *b, void *out, size_t n) {
+    const PsMat4f *lhs = a, *rhs = b;
+    PsMat4f *o = out;
+    for (size_t i = 0; i < n / 4; ++i) {
+        ps_mat4f_mul(&lhs[i], &rhs[i], &o[i]);
+    }
+}
+
+static void mat4f_4f_mul_4f(const void *a, const void *b, void *out, size_t n) {
+    const PsMat4f *m4f = a;
+    const Ps4f *rhs = b;
+    Ps4f *o = out;
+    for (size_t i = 0; i < n; ++i) {
+        ps_mat4f_4f_mul(m4f, &rhs[i], &o[i]);
+    }
+}
+
+// The same dot3 over Ps8x3f packets, the result is splatted like ps_4f_dot3's
+static void dot3_8x3f(const void *a, const void *b, void *out, size_t n) {
+    const Ps4f *lhs = a, *rhs = b;
+    Ps4f *o = out;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const Ps8f dot = ps_8x3f_dot(ps_8x3f_load(&lhs[i]), ps_8x3f_load(&rhs[i]));
+        ps_8f_store_4f(dot, dot, dot, dot, &o[i]);
+    }
+    for (; i < n; ++i) {
+        o[i] = ps_4f_dot3(lhs[i], rhs[i]);
+    }
+}
+
+BINARY(dot3_4d, Ps4d, ps_4d_dot3(lhs[i], rhs[i]))
+BINARY(cross_4d, Ps4d, ps_4d_cross(lhs[i], rhs[i]))
+UNARY(length3_4d, Ps4d, ps_4d_length3(lhs[i]))
+UNARY(length3_fast_4d, Ps4d, ps_4d_length3_fast(lhs[i]))
+UNARY(normalize3_4d, Ps4d, ps_4d_normalize3(lhs[i]))
+UNARY(normalize3_fast_4d, Ps4d, ps_4d_normalize3_fast(lhs[i]))
+UNARY(sqrt_4d, Ps4d, ps_4d_sqrt(lhs[i]))
+UNARY(sqrt_fast_4d, Ps4d, ps_4d_sqrt_fast(lhs[i]))
+UNARY(rsqrt_4d, Ps4d, ps_4d_rsqrt(lhs[i]))
+UNARY(rsqrt_fast_4d, Ps4d, ps_4d_rsqrt_fast(lhs[i]))
+UNARY(recip_4d, Ps4d, ps_4d_recip(lhs[i]))
+UNARY(recip_fast_4d, Ps4d, ps_4d_recip_fast(lhs[i]))
+UNARY(sin_4d, Ps4d, ps_4d_sin(lhs[i]))
+
+static void mat4d_mul_4d(const void *a, const void *b, void *out, size_t n) {
+    const PsMat4d *lhs = a, *rhs = b;
+    PsMat4d *o = out;
+    for (size_t i = 0; i < n / 4; ++i) {
+        ps_mat4d_mul(&lhs[i], &rhs[i], &o[i]);
+    }
+}
+
+static void mat4d_4d_mul_4d(const void *a, const void *b, void *out, size_t n) {
+    const PsMat4d *m4d = a;
+    const Ps4d *rhs = b;
+    Ps4d *o = out;
+    for (size_t i = 0; i < n; ++i) {
+        ps_mat4d_4d_mul(m4d, &rhs[i], &o[i]);
+    }
+}
+
+const BenchOp BENCH_VARIANT_NAME(bench_math_ops)[] = {
+        {"dot3", BENCH_F32, BACKEND_4F, dot3_4f},
+        {"dot3_soa", BENCH_F32, BACKEND_8F, dot3_8x3f},
+        {"cross", BENCH_F32, BACKEND_4F, cross_4f},
+        {"length3", BENCH_F32, BACKEND_4F, length3_4f},
+        {"length3_fast", BENCH_F32, BACKEND_4F, length3_fast_4f},
+        {"normalize3", BENCH_F32, BACKEND_4F, normalize3_4f},
+        {"normalize3_fast", BENCH_F32, BACKEND_4F, normalize3_fast_4f},
+        {"sqrt", BENCH_F32, BACKEND_4F, sqrt_4f},
+        {"sqrt_fast", BENCH_F32, BACKEND_4F, sqrt_fast_4f},
+        {"rsqrt", BENCH_F32, BACKEND_4F, rsqrt_4f},
+        {"rsqrt_fast", BENCH_F32, BACKEND_4F, rsqrt_fast_4f},
+        {"recip", BENCH_F32, BACKEND_4F, recip_4f},
+        {"recip_fast", BENCH_F32, BACKEND_4F, recip_fast_4f},
+        {"sin", BENCH_F32, BACKEND_4F, sin_4f},
+        {"mat4_mul", BENCH_F32, BACKEND_4F, mat4f_mul_4f},
+        {"mat4_vec_mul", BENCH_F32, BACKEND_4F, mat4f_4f_mul_4f},
+        {"dot3", BENCH_F64, BACKEND_4D, dot3_4d},
+        {"cross", BENCH_F64, BACKEND_4D, cross_4d},
+        {"length3", BENCH_F64, BACKEND_4D, length3_4d},
+        {"length3_fast", BENCH_F64, BACKEND_4D, length3_fast_4d},
+        {"normalize3", BENCH_F64, BACKEND_4D, normalize3_4d},
+        {"normalize3_fast", BENCH_F64, BACKEND_4D, normalize3_fast_4d},
+        {"sqrt", BENCH_F64, BACKEND_4D, sqrt_4d},
+        {"sqrt_fast", BENCH_F64, BACKEND_4D, sqrt_fast_4d},
+        {"rsqrt", BENCH_F64, BACKEND_4D, rsqrt_4d},
+        {"rsqrt_fast", BENCH_F64, BACKEND_4D, rsqrt_fast_4d},
+        {"recip", BENCH_F64, BACKEND_4D, recip_4d},
+        {"recip_fast", BENCH_F64, BACKEND_4D, recip_fast_4d},
+        {"sin", BENCH_F64, BACKEND_4D, sin_4d},
+        {"mat4_mul", BENCH_F64, BACKEND_4D, mat4d_mul_4d},
+        {"mat4_vec_mul", BENCH_F64, BACKEND_4D, mat4d_4d_mul_4d},
+        {NULL}
+};
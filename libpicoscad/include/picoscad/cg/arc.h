@@ -0,0 +1,37 @@
+#ifndef PS_CG_ARC_H_
+#define PS_CG_ARC_H_
+
+#include <picoscad/math/4d.h>
+
+PS_EXTERN_BEGIN
+
+/*
+ * Circles, arcs and ellipses as polygons. The segment count follows from how
+ * far a chord may stray from the curve, so small features stay cheap and large
+ * ones stay round. The points come from a rotation recurrence, four lanes at a
+ * time where the CPU has the registers, with an exact sin and cos only every
+ * few dozen points to keep the drift below a few ulps.
+ */
+
+/**
+ * Keeps a tiny tolerance or a huge radius from asking for millions of points
+ */
+#define PS_ARC_MAX_SEGMENTS 4096
+
+/**
+ * Chords needed for sweep radians of a circle of radius so that none is
+ * further than tolerance from the arc, at least one per third of a turn
+ */
+size_t ps_arc_segments(double radius, double sweep, double tolerance);
+
+/**
+ * count points of the ellipse around (cx, cy) with radii rx and ry turned by
+ * rotation, point i at parameter angle start + i * step (radians, positive is
+ * counter-clockwise); z is 0 and w is 1
+ */
+void ps_ellipse_points4d(double cx, double cy, double rx, double ry, double rotation, double start, double step,
+                         size_t count, Ps4d *out);
+
+PS_EXTERN_END
+
+#endif // PS_CG_ARC_H_
@@ -0,0 +1,157 @@
+#ifndef PS_CG_CSG_H_
+#define PS_CG_CSG_H_
+
+#include <picoscad/math/mat4d.h>
+#include <picoscad/data/array.h>
+#include <picoscad/cg/ghclipping4d.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * A graph of 2D boolean expressions. Nodes are hash-consed: building a node
+ * structurally identical to an existing one returns the existing one, so a
+ * subtree repeated across a model (the same hole 200 times) is a single node.
+ * Every node has a content hash over its whole subtree, the same in any graph.
+ */
+typedef struct PsCsg PsCsg;
+
+/**
+ * Index of a node in its graph
+ */
+typedef uint32_t PsCsgNode;
+
+/**
+ * Evaluated operation results keyed by content hash, so they outlive the graph
+ * that produced them and serve every graph that rebuilds the same subtree.
+ * The least recently used results are evicted to stay under a byte budget.
+ */
+typedef struct PsCsgCache PsCsgCache;
+
+typedef struct PsCsgStats {
+    /**
+     * Operation nodes clipped, and those served from the cache instead
+     */
+    size_t evaluated;
+    size_t reused;
+    /**
+     * Operation nodes loaded from the cache's store
+     */
+    size_t loaded;
+    size_t clips;
+    size_t intersections;
+    /**
+     * The clips' phase times added up, see PsGHClipStats; with several threads
+     * they add up to more than the evaluation took
+     */
+    uint64_t intersect_ns;
+    uint64_t mark_ns;
+    uint64_t walk_ns;
+} PsCsgStats;
+
+typedef struct PsCsgCacheStats {
+    size_t entries;
+    size_t bytes;
+    size_t budget;
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} PsCsgCacheStats;
+
+/**
+ * A slower tier behind a cache, usually on disk (see picoscad/io/diskcache.h),
+ * asked on every cache miss. It is given the evaluated root, and any result
+ * once the clipping it would save outweighs the cost of storing it. load
+ * returns a result the caller owns, or NULL; store copies what it keeps.
+ */
+typedef struct PsCsgStore {
+    PsArray OF(PsGHPolygon4d *) *(*load)(void *userdata, uint64_t key);
+    void (*store)(void *userdata, uint64_t key, PsArray OF(PsGHPolygon4d *) *polygons);
+    void *userdata;
+} PsCsgStore;
+
+PsCsg *ps_csg_new();
+void ps_csg_free(PsCsg *csg);
+
+size_t ps_csg_get_node_count(const PsCsg *csg);
+uint64_t ps_csg_get_hash(const PsCsg *csg, PsCsgNode node);
+
+/**
+ * The empty set. Operations on it fold away when they are built.
+ */
+PsCsgNode ps_csg_empty(PsCsg *csg);
+
+/**
+ * A polygon leaf, the points are copied. Fewer than 3 points make the empty set.
+ */
+PsCsgNode ps_csg_polygon(PsCsg *csg, const Ps4d *points, size_t length);
+
+/**
+ * child transformed by m4d, which should keep points in the xy plane
+ */
+PsCsgNode ps_csg_transform(PsCsg *csg, const PsMat4d *m4d, PsCsgNode child);
+
+/**
+ * Every polygon of rhs applied in turn to all the pieces of lhs. A union
+ * merges each polygon into the pieces it overlaps. Holes, whether a union
+ * encloses them or a difference cuts them, are joined to their outline by a
+ * zero width slit.
+ */
+PsCsgNode ps_csg_operation(PsCsg *csg, PsGHOperation operation, PsCsgNode lhs, PsCsgNode rhs);
+
+/**
+ * nodes combined with operation as if folded left to right, but built as a
+ * balanced tree: neighbours pair up, and a difference takes the union of all
+ * but the first node from the first. Siblings can then evaluate in parallel,
+ * and an edit to one node only redoes the operations above it. No nodes make
+ * the empty set.
+ */
+PsCsgNode ps_csg_fold(PsCsg *csg, PsGHOperation operation, const PsCsgNode *nodes, size_t count);
+
+/**
+ * Evaluates node, reusing and filling cache (which may be NULL). The result
+ * belongs to the caller. stats may be NULL, it only counts this call.
+ */
+PsArray OF(PsGHPolygon4d *) *ps_csg_evaluate(PsCsg *csg, PsCsgNode node, PsCsgCache *cache, PsCsgStats *stats);
+
+/**
+ * ps_csg_evaluate on threads threads (0 for one per CPU), with the same result.
+ * Independent subtrees are clipped at the same time: a node waits for a count
+ * of unfinished inputs, the thread finishing the last one queues it on its own
+ * deque, and idle threads steal from the others' deques. New leaves are only
+ * started while fewer than max_live results (0 for 4 per thread) wait for a
+ * sibling, which bounds the memory intermediates hold. The cache is used
+ * under a lock; its store is called from any of the threads.
+ */
+PsArray OF(PsGHPolygon4d *) *ps_csg_evaluate_parallel(PsCsg *csg, PsCsgNode node, PsCsgCache *cache, size_t threads,
+                                                      size_t max_live, PsCsgStats *stats);
+
+/**
+ * Makes evaluations of csg call cancelled(userdata) before each operation and
+ * give up once it returns true. They then return NULL, and the results
+ * finished by then stay in the cache for the next attempt. The parallel
+ * evaluator calls it from any of its threads. NULL turns this off.
+ */
+void ps_csg_set_cancel(PsCsg *csg, bool (*cancelled)(void *userdata), void *userdata);
+
+/**
+ * How many operations the last evaluation of csg clipped in the subtree of
+ * node, and the time that took in ns (ns may be NULL). Only what the cache
+ * couldn't answer is clipped, so after an edit this is the edited subtrees
+ * and the operations above them. Shared nodes count once.
+ */
+size_t ps_csg_count_rebuilt(PsCsg *csg, PsCsgNode node, uint64_t *ns);
+
+PsCsgCache *ps_csg_cache_new(size_t budget);
+void ps_csg_cache_free(PsCsgCache *cache);
+void ps_csg_cache_get_stats(const PsCsgCache *cache, PsCsgCacheStats *stats);
+
+/**
+ * Puts store behind cache, or detaches it if store is NULL. Keys are the node
+ * hashes salted with a version of what evaluation produces, so results stored
+ * by an older build are never loaded.
+ */
+void ps_csg_cache_set_store(PsCsgCache *cache, const PsCsgStore *store);
+
+PS_EXTERN_END
+
+#endif // PS_CG_CSG_H_
@@ -11,8 +11,31 @@ PS_EXTERN_BEGIN
  */
 typedef struct PsGHPolygon PsGHPolygon;
 
+typedef enum PsGHOperation {
+    PS_GH_UNION,
+    PS_GH_DIFF,
+    PS_GH_INTERSECT
+} PsGHOperation;
+
+/**
+ * What a clip did, filled in by ps_ghpolygon_clip
+ */
+typedef struct PsGHClipStats {
+    size_t intersections;
+    size_t output_polygons;
+    size_t output_vertices;
+    /**
+     * Nanoseconds spent finding the intersections, marking them as entries or
+     * exits, and walking the marked polygons into the output
+     */
+    uint64_t intersect_ns;
+    uint64_t mark_ns;
+    uint64_t walk_ns;
+} PsGHClipStats;
+
 PsGHPolygon *ps_ghpolygon_new();
 PsGHPolygon *ps_ghpolygon_new_with_points(Ps4f *points, size_t length);
+PsGHPolygon *ps_ghpolygon_dup(PsGHPolygon *poly);
 void ps_ghpolygon_free(PsGHPolygon *poly);
 
 size_t ps_ghpolygon_get_size(PsGHPolygon *poly);
@@ -21,6 +44,19 @@ void ps_ghpolygon_add(PsGHPolygon *poly, Ps4f point);
 
 bool ps_ghpolygon_foreach(PsGHPolygon *poly, bool (*foreach)(Ps4f *point, void *userdata), void *userdata);
 
+/**
+ * Clips poly against clip. The intersections are inserted into both inputs, so
+ * neither should be clipped again. stats may be NULL.
+ *
+ * When the boundaries don't cross, including where they only touch, one
+ * vertex decides: a union returns the polygon holding the other, or copies of
+ * both when they are apart; an intersection returns the one held, or nothing;
+ * a difference returns nothing when poly lies in clip, poly with clip cut out
+ * as one keyhole contour when clip lies in poly, and poly otherwise.
+ */
+PsArray OF(PsGHPolygon *) *ps_ghpolygon_clip(PsGHPolygon *poly, PsGHPolygon *clip, PsGHOperation operation,
+                                             PsGHClipStats *stats);
+
 PsArray OF(PsGHPolygon *) *ps_ghpolygon_union(PsGHPolygon *poly, PsGHPolygon *target);
 
 PsArray OF(PsGHPolygon *) *ps_ghpolygon_diff(PsGHPolygon *poly, PsGHPolygon *target);
@@ -0,0 +1,44 @@
+#ifndef PS_CG_GHCLIPPING4D_H_
+#define PS_CG_GHCLIPPING4D_H_
+
+#include <picoscad/math/4d.h>
+#include <picoscad/data/array.h>
+#include <picoscad/cg/ghclipping.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * A Greiner-Hormann Polygon in double precision, see PsGHPolygon
+ */
+typedef struct PsGHPolygon4d PsGHPolygon4d;
+
+PsGHPolygon4d *ps_ghpolygon4d_new();
+PsGHPolygon4d *ps_ghpolygon4d_new_with_points(Ps4d *points, size_t length);
+PsGHPolygon4d *ps_ghpolygon4d_dup(PsGHPolygon4d *poly);
+void ps_ghpolygon4d_free(PsGHPolygon4d *poly);
+
+size_t ps_ghpolygon4d_get_size(PsGHPolygon4d *poly);
+
+/**
+ * Takes the point by pointer: Ps4d changes representation with -mavx, a pointer
+ * to it does not
+ */
+void ps_ghpolygon4d_add(PsGHPolygon4d *poly, const Ps4d *point);
+
+bool ps_ghpolygon4d_foreach(PsGHPolygon4d *poly, bool (*foreach)(Ps4d *point, void *userdata), void *userdata);
+
+/**
+ * See ps_ghpolygon_clip
+ */
+PsArray OF(PsGHPolygon4d *) *ps_ghpolygon4d_clip(PsGHPolygon4d *poly, PsGHPolygon4d *clip, PsGHOperation operation,
+                                                 PsGHClipStats *stats);
+
+PsArray OF(PsGHPolygon4d *) *ps_ghpolygon4d_union(PsGHPolygon4d *poly, PsGHPolygon4d *target);
+
+PsArray OF(PsGHPolygon4d *) *ps_ghpolygon4d_diff(PsGHPolygon4d *poly, PsGHPolygon4d *target);
+
+PsArray OF(PsGHPolygon4d *) *ps_ghpolygon4d_intersect(PsGHPolygon4d *poly, PsGHPolygon4d *target);
+
+PS_EXTERN_END
+
+#endif // PS_CG_GHCLIPPING4D_H_
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef PS_CG_MESH_H_
+#define PS_CG_MESH_H_
+
+#include <picoscad/math/4f.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * A triangle mesh. vertices are 16 byte aligned with w = 1. Triangle i is
+ * indices[3i .. 3i + 2], or vertices[3i .. 3i + 2] when indices is NULL (a
+ * triangle soup, as STL stores them).
+ */
+typedef struct PsMesh {
+    Ps4f *vertices;
+    uint32_t *indices;
+    size_t vertex_count;
+    size_t triangle_count;
+} PsMesh;
+
+PsMesh *ps_mesh_new();
+
+/**
+ * Takes ownership of vertices (from aligned_alloc or malloc) and indices (malloc, may be NULL)
+ */
+PsMesh *ps_mesh_new_with_arrays(Ps4f *vertices, size_t vertex_count, uint32_t *indices, size_t triangle_count);
+void ps_mesh_free(PsMesh *mesh);
+
+PS_INLINE void ps_mesh_get_triangle(const PsMesh *mesh, size_t index, Ps4f *a, Ps4f *b, Ps4f *c) {
+    if (mesh->indices) {
+        *a = mesh->vertices[mesh->indices[index * 3]];
+        *b = mesh->vertices[mesh->indices[index * 3 + 1]];
+        *c = mesh->vertices[mesh->indices[index * 3 + 2]];
+    } else {
+        *a = mesh->vertices[index * 3];
+        *b = mesh->vertices[index * 3 + 1];
+        *c = mesh->vertices[index * 3 + 2];
+    }
+}
+
+PS_EXTERN_END
+
+#endif // PS_CG_MESH_H_
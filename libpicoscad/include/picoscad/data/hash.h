@@ -0,0 +1,25 @@
+#ifndef PS_DATA_HASH_H_
+#define PS_DATA_HASH_H_
+
+#include <picoscad/porting.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * 64 bit non-cryptographic hash of size bytes (the XXH64 algorithm, so values
+ * match other implementations). Runs at memory bandwidth on large blocks.
+ * Chain blocks by passing the previous hash as the seed.
+ */
+uint64_t ps_hash64(const void *data, size_t size, uint64_t seed);
+
+/**
+ * Mixes value into hash, for combining hashes that are already well distributed
+ */
+PS_INLINE uint64_t ps_hash64_combine(uint64_t hash, uint64_t value) {
+    hash ^= value + UINT64_C(0x9e3779b97f4a7c15) + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+PS_EXTERN_END
+
+#endif // PS_DATA_HASH_H_
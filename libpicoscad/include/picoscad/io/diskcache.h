@@ -0,0 +1,74 @@
+#ifndef PS_IO_DISKCACHE_H_
+#define PS_IO_DISKCACHE_H_
+
+#include <picoscad/cg/csg.h>
+
+PS_EXTERN_BEGIN
+
+/*
+ * Evaluated geometry kept across runs, one geometry file (picoscad/io/geofile.h)
+ * per key in a directory:
+ *
+ *   <directory>/<key as 16 hex digits>.psgeo
+ *   <directory>/lock
+ *
+ * Any number of processes can share a directory, and threads a PsDiskCache.
+ * Files are written under a temporary name and renamed into place, so readers
+ * see a whole file or none, and two writers of the same key write the same
+ * bytes. Loading checks the content hash and deletes files that fail it. Hits
+ * bump the modification time, and whoever sees the directory over budget
+ * takes the lock and deletes the least recently used files down to three
+ * quarters of it.
+ */
+
+typedef struct PsDiskCache PsDiskCache;
+
+typedef struct PsDiskCacheStats {
+    size_t hits;
+    size_t misses;
+    /**
+     * Files rejected by the hash check and deleted
+     */
+    size_t corrupt;
+    size_t writes;
+    size_t evictions;
+    /**
+     * The size of the directory as of the last scan, plus what this process wrote since
+     */
+    uint64_t bytes;
+    uint64_t budget;
+} PsDiskCacheStats;
+
+/**
+ * Opens directory, creating it and its parents as needed, and trims it if it
+ * is already over budget. On failure returns NULL and points error at a static
+ * message.
+ */
+PsDiskCache *ps_disk_cache_open(const char *directory, uint64_t budget, const char **error);
+void ps_disk_cache_close(PsDiskCache *cache);
+
+/**
+ * The polygons stored under key, or NULL
+ */
+PsArray OF(PsGHPolygon4d *) *ps_disk_cache_load(PsDiskCache *cache, uint64_t key);
+
+/**
+ * Stores polygons under key, replacing whatever was there
+ */
+bool ps_disk_cache_store(PsDiskCache *cache, uint64_t key, PsArray OF(PsGHPolygon4d *) *polygons);
+
+/**
+ * Deletes the least recently used files until the directory is within budget
+ */
+void ps_disk_cache_trim(PsDiskCache *cache);
+
+void ps_disk_cache_get_stats(const PsDiskCache *cache, PsDiskCacheStats *stats);
+
+/**
+ * A store for ps_csg_cache_set_store backed by cache
+ */
+PsCsgStore ps_disk_cache_get_store(PsDiskCache *cache);
+
+PS_EXTERN_END
+
+#endif // PS_IO_DISKCACHE_H_
@@ -0,0 +1,21 @@
+#ifndef PS_IO_DXF_H_
+#define PS_IO_DXF_H_
+
+#include <picoscad/io/outline.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * Imports the ENTITIES section of an ASCII DXF: closed LWPOLYLINEs (including
+ * bulge arcs) and CIRCLEs become contours directly, while LINEs, ARCs and open
+ * LWPOLYLINEs are joined end to end into closed loops once the file has been
+ * read; pieces that don't close are dropped. Blocks and INSERTs are ignored.
+ * tolerance is the largest distance allowed between an arc and its chords, in
+ * drawing units. On failure returns false and points error at a static
+ * message; contours already passed to sink stay with it.
+ */
+bool ps_dxf_read(const char *path, double tolerance, PsOutlineSink sink, void *userdata, const char **error);
+
+PS_EXTERN_END
+
+#endif // PS_IO_DXF_H_
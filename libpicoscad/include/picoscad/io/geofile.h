@@ -0,0 +1,105 @@
+#ifndef PS_IO_GEOFILE_H_
+#define PS_IO_GEOFILE_H_
+
+#include <picoscad/cg/mesh.h>
+#include <picoscad/cg/ghclipping4d.h>
+
+PS_EXTERN_BEGIN
+
+/*
+ * picoSCAD's own geometry file, made to be memory mapped and used in place:
+ *
+ *   header    64 bytes: magic, version, byte order, size, TOC offset and hash
+ *   blocks    vertex and index blocks, each 64 byte aligned
+ *   TOC       one 64 byte record per entry, sorted by key
+ *
+ * Opening checks the header and that every TOC record stays inside the file,
+ * nothing else is read until used. Content hashes cover each entry's blocks
+ * and are only checked on request. Files are written to a temporary name and
+ * renamed into place, so other processes never map a half written file.
+ */
+
+#define PS_GEOFILE_VERSION 1
+
+typedef enum PsGeofileKind {
+    /**
+     * Polygons back to back in vertices, indices holds the vertex count of each
+     */
+    PS_GEOFILE_POLYGONS = 1,
+    /**
+     * A PsMesh, indices holds 3 per triangle or is empty for a triangle soup
+     */
+    PS_GEOFILE_MESH = 2
+} PsGeofileKind;
+
+typedef enum PsGeofilePrecision {
+    PS_GEOFILE_4F = 1,
+    PS_GEOFILE_4D = 2
+} PsGeofilePrecision;
+
+/**
+ * One entry, pointing straight into the mapping. vertices are Ps4f or Ps4d
+ * (4 consecutive floats or doubles) according to precision.
+ */
+typedef struct PsGeofileEntry {
+    PsGeofileKind kind;
+    PsGeofilePrecision precision;
+    uint64_t key;
+    uint64_t hash;
+    const void *vertices;
+    size_t vertex_count;
+    const uint32_t *indices;
+    size_t index_count;
+} PsGeofileEntry;
+
+typedef struct PsGeofile PsGeofile;
+typedef struct PsGeofileWriter PsGeofileWriter;
+
+/**
+ * Maps path and checks its structure. On failure returns NULL and points error
+ * at a static message.
+ */
+PsGeofile *ps_geofile_open(const char *path, const char **error);
+void ps_geofile_close(PsGeofile *file);
+
+size_t ps_geofile_get_entry_count(const PsGeofile *file);
+void ps_geofile_get_entry(const PsGeofile *file, size_t index, PsGeofileEntry *entry);
+
+/**
+ * Binary search of the TOC, false if no entry has key
+ */
+bool ps_geofile_find(const PsGeofile *file, uint64_t key, PsGeofileEntry *entry);
+
+/**
+ * Rehashes the entry's blocks and compares against the stored hash
+ */
+bool ps_geofile_verify(const PsGeofileEntry *entry);
+
+/**
+ * Copies a PS_GEOFILE_POLYGONS entry out of the mapping, converting to double
+ * if it is stored as float
+ */
+PsArray OF(PsGHPolygon4d *) *ps_geofile_entry_to_polygons4d(const PsGeofileEntry *entry);
+
+/**
+ * Starts writing path; nothing appears at path until a successful close
+ */
+PsGeofileWriter *ps_geofile_writer_new(const char *path);
+
+/**
+ * Appends an entry from kind, precision, key and the blocks; hash is computed
+ */
+bool ps_geofile_writer_add(PsGeofileWriter *writer, const PsGeofileEntry *entry);
+bool ps_geofile_writer_add_mesh(PsGeofileWriter *writer, uint64_t key, const PsMesh *mesh);
+bool ps_geofile_writer_add_polygons4d(PsGeofileWriter *writer, uint64_t key,
+                                      PsArray OF(PsGHPolygon4d *) *polygons);
+
+/**
+ * Writes the TOC and renames the file into place, then frees the writer. On
+ * false the temporary file is removed and path is left as it was.
+ */
+bool ps_geofile_writer_close(PsGeofileWriter *writer);
+
+PS_EXTERN_END
+
+#endif // PS_IO_GEOFILE_H_
@@ -0,0 +1,19 @@
+#ifndef PS_IO_OBJ_H_
+#define PS_IO_OBJ_H_
+
+#include <picoscad/cg/mesh.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * Reads the geometry of a Wavefront OBJ into an indexed mesh: "v" lines become
+ * vertices and "f" lines are fan-triangulated, with texture and normal indices
+ * ignored and negative (relative) indices resolved. Every other statement is
+ * skipped. The file is memory mapped and large files are parsed in parallel
+ * chunks. On failure returns NULL and points error at a static message.
+ */
+PsMesh *ps_obj_read(const char *path, const char **error);
+
+PS_EXTERN_END
+
+#endif // PS_IO_OBJ_H_
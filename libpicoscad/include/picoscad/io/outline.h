@@ -0,0 +1,27 @@
+#ifndef PS_IO_OUTLINE_H_
+#define PS_IO_OUTLINE_H_
+
+#include <picoscad/cg/ghclipping.h>
+
+PS_EXTERN_BEGIN
+
+/*
+ * Shared by the 2D importers (picoscad/io/svg.h, picoscad/io/dxf.h). They scan
+ * the memory mapped file once and hand each closed contour to a sink as soon
+ * as it is complete, so only the contour being built is held in memory. Curves
+ * are flattened into as few chords as keep within tolerance of the curve.
+ */
+
+/**
+ * Receives a contour and takes ownership of it; returning false stops the import
+ */
+typedef bool (*PsOutlineSink)(PsGHPolygon *contour, void *userdata);
+
+/**
+ * A sink adding every contour to userdata, a PsArray OF(PsGHPolygon *)
+ */
+bool ps_outline_collect(PsGHPolygon *contour, void *userdata);
+
+PS_EXTERN_END
+
+#endif // PS_IO_OUTLINE_H_
@@ -0,0 +1,54 @@
+#ifndef PS_IO_STL_H_
+#define PS_IO_STL_H_
+
+#include <picoscad/cg/mesh.h>
+
+PS_EXTERN_BEGIN
+
+typedef enum PsStlFormat {
+    PS_STL_BINARY,
+    PS_STL_ASCII
+} PsStlFormat;
+
+/**
+ * Streams triangles to a file descriptor through a fixed buffer, so memory
+ * stays bounded whatever the mesh size. Normals are computed from the winding
+ * (counter-clockwise seen from outside).
+ */
+typedef struct PsStlWriter PsStlWriter;
+
+/**
+ * Starts a file on fd, which stays owned by the caller. triangle_count goes in
+ * the binary header; close patches it with the real count when fd can seek, so
+ * it only has to be right for pipes and sockets.
+ */
+PsStlWriter *ps_stl_writer_new(int fd, PsStlFormat format, const char *name, uint32_t triangle_count);
+
+/**
+ * Writes triangles from 3 consecutive corners each, w is ignored
+ */
+bool ps_stl_writer_add(PsStlWriter *writer, const Ps4f *corners, size_t triangles);
+
+/**
+ * Writes triangles from 3 consecutive indices into vertices each
+ */
+bool ps_stl_writer_add_indexed(PsStlWriter *writer, const Ps4f *vertices, const uint32_t *indices,
+                               size_t triangles);
+
+/**
+ * Flushes, finishes the file and frees the writer. False if any write failed,
+ * in which case the file is incomplete.
+ */
+bool ps_stl_writer_close(PsStlWriter *writer);
+
+/**
+ * Reads a binary or ASCII STL into a triangle soup (no indices). The file is
+ * memory mapped; binary corners are decoded straight from the mapping and
+ * ASCII files are parsed in parallel chunks on large inputs. On failure returns
+ * NULL and points error at a static message.
+ */
+PsMesh *ps_stl_read(const char *path, const char **error);
+
+PS_EXTERN_END
+
+#endif // PS_IO_STL_H_
@@ -0,0 +1,22 @@
+#ifndef PS_IO_SVG_H_
+#define PS_IO_SVG_H_
+
+#include <picoscad/io/outline.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * Imports the outlines of <path>, <polygon>, <polyline>, <rect>, <circle> and
+ * <ellipse> elements. Every subpath becomes its own contour, open ones are
+ * closed as SVG fills them. The transform attributes of the element and the
+ * elements enclosing it are applied, then y is negated so drawings are not
+ * mirrored in picoSCAD's y-up space; units and viewBox are not applied.
+ * tolerance is the largest distance allowed between a curve and its chords,
+ * in the units of the output. On failure returns false and points error at a static
+ * message; contours already passed to sink stay with it.
+ */
+bool ps_svg_read(const char *path, double tolerance, PsOutlineSink sink, void *userdata, const char **error);
+
+PS_EXTERN_END
+
+#endif // PS_IO_SVG_H_
@@ -0,0 +1,156 @@
+#ifndef PS_LANG_SCAD_H_
+#define PS_LANG_SCAD_H_
+
+#include <stdio.h>
+
+#include <picoscad/math/mat4d.h>
+#include <picoscad/cg/csg.h>
+
+PS_EXTERN_BEGIN
+
+/*
+ * An OpenSCAD compatible subset: top level modules and functions with default
+ * parameters, variables, let, if/else, for over ranges and vectors, list
+ * comprehensions, echo, children() and the usual 2D/3D primitives, transforms
+ * and booleans. Scripts are compiled in one pass straight to register
+ * bytecode (no syntax tree) and run by a small VM that emits geometry nodes.
+ *
+ * Differences to OpenSCAD: variables take the value of their last assignment
+ * so far rather than the last one in their scope, modules and functions can
+ * only be defined at the top level, polygon() ignores paths, and include/use,
+ * string functions and hull/minkowski are not supported.
+ */
+
+typedef struct PsScadProgram PsScadProgram;
+
+typedef struct PsScadError {
+    int line;
+    int column;
+    char message[160];
+} PsScadError;
+
+typedef enum PsScadNodeKind {
+    /**
+     * Implicit union: the root, user module instances and color()
+     */
+    PS_SCAD_GROUP,
+    PS_SCAD_UNION,
+    PS_SCAD_DIFFERENCE,
+    PS_SCAD_INTERSECTION,
+    /**
+     * transform applies to the children; translate, rotate, scale, mirror and multmatrix all become one
+     * matrix, laid out as ps_csg_transform takes it
+     */
+    PS_SCAD_TRANSFORM,
+    /**
+     * dims.x is the height, the children are 2D
+     */
+    PS_SCAD_LINEAR_EXTRUDE,
+    /**
+     * dims.xy is the size
+     */
+    PS_SCAD_SQUARE,
+    /**
+     * dims.x is the radius
+     */
+    PS_SCAD_CIRCLE,
+    /**
+     * point_count points starting at first_point of the result
+     */
+    PS_SCAD_POLYGON,
+    /**
+     * dims.xyz is the size
+     */
+    PS_SCAD_CUBE,
+    /**
+     * dims.x is the radius
+     */
+    PS_SCAD_SPHERE,
+    /**
+     * dims.x and dims.y are the bottom and top radii, dims.z the height
+     */
+    PS_SCAD_CYLINDER
+} PsScadNodeKind;
+
+/**
+ * Nodes are stored in pre-order: the first child of node i is i + 1 and the
+ * sibling after a child c is c + nodes[c].size. segments is resolved from
+ * $fn, $fa and $fs for the round primitives. Geometry stays in double like the
+ * CSG it feeds, so literal and computed coordinates still meet exactly.
+ */
+typedef struct PsScadNode {
+    PsMat4d transform;
+    Ps4d dims;
+    PsScadNodeKind kind;
+    uint32_t size;
+    uint32_t first_point;
+    uint32_t point_count;
+    uint32_t segments;
+    /**
+     * Source line of the statement that made the node, 0 for the root
+     */
+    uint32_t line;
+    bool center;
+    /**
+     * Whether $fn, $fa or $fs differed from their defaults, segments is then
+     * the most the conversion may use rather than a count it replaces
+     */
+    bool custom_segments;
+} PsScadNode;
+
+typedef struct PsScadResult {
+    /**
+     * nodes[0] is the root group
+     */
+    PsScadNode *nodes;
+    size_t node_count;
+    Ps4d *points;
+    size_t point_count;
+    /**
+     * Output of echo(), NUL terminated
+     */
+    char *echo;
+    size_t echo_length;
+} PsScadResult;
+
+/**
+ * Compiles source; on failure returns NULL and fills error
+ */
+PsScadProgram *ps_scad_compile(const char *source, size_t length, PsScadError *error);
+void ps_scad_program_free(PsScadProgram *program);
+
+/**
+ * Runs the program from scratch. Programs are immutable, several threads may
+ * run one at the same time. On failure returns false, fills error and leaves
+ * result empty.
+ */
+bool ps_scad_run(const PsScadProgram *program, PsScadResult *result, PsScadError *error);
+void ps_scad_result_free(PsScadResult *result);
+
+/**
+ * Adds the 2D part of result to csg and returns its root: squares, circles and
+ * polygons under transforms and booleans. Other primitives and extrusions
+ * become the empty set and are counted in skipped, which may be NULL.
+ *
+ * Circles get as many segments as keep them within tolerance of the true
+ * circle once transformed (see ps_arc_segments), but no more than $fn, $fa or
+ * $fs give where the script set them. A tolerance of 0 keeps OpenSCAD's counts.
+ */
+PsCsgNode ps_scad_result_to_csg(const PsScadResult *result, double tolerance, PsCsg *csg, size_t *skipped);
+
+/**
+ * ps_scad_result_to_csg for the subtree at index of result->nodes. The root is
+ * the union of its children, so converting those one by one and folding them
+ * (see ps_csg_fold) gives the same graph with a handle on each top level object.
+ */
+PsCsgNode ps_scad_node_to_csg(const PsScadResult *result, size_t index, double tolerance, PsCsg *csg,
+                              size_t *skipped);
+
+/**
+ * Writes a listing of the bytecode, for debugging the compiler
+ */
+void ps_scad_program_dump(const PsScadProgram *program, FILE *file);
+
+PS_EXTERN_END
+
+#endif // PS_LANG_SCAD_H_
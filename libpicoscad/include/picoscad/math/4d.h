@@ -1,7 +1,9 @@
 #ifndef PS_MATH_4D_H_
 #define PS_MATH_4D_H_
 
-#ifdef __AVX__
+#include <picoscad/math/4f.h>
+
+#if defined(__AVX__) && !defined(PS_NO_SIMD)
 #include <picoscad/math/simd/4d.h>
 #else
 #include <picoscad/math/scalar/4d.h>
@@ -92,6 +94,13 @@ PS_INLINE Ps4d ps_4d_surfnorm(Ps4d p1, Ps4d p2, Ps4d p3) {
     return ps_4d_cross(ps_4d_sub(p2, p1), ps_4d_sub(p3, p1));
 }
 
+/**
+ * Converts length points at once, e.g. double geometry for a float vertex buffer
+ */
+void ps_4d_to_4f_array(const Ps4d *in, Ps4f *out, size_t length);
+
+void ps_4f_to_4d_array(const Ps4f *in, Ps4d *out, size_t length);
+
 PS_EXTERN_END
 
 #endif // PS_MATH_4D_H_
\ No newline at end of file
@@ -1,7 +1,8 @@
 #ifndef PS_MATH_4F_H_
 #define PS_MATH_4F_H_
 
-#ifdef __SSE__
+// Defining PS_NO_SIMD forces the scalar backends, e.g. to compare against them
+#if defined(__SSE2__) && !defined(PS_NO_SIMD)
 #include <picoscad/math/simd/4f.h>
 #else
 #include <picoscad/math/scalar/4f.h>
@@ -0,0 +1,12 @@
+#ifndef PS_MATH_8F_H_
+#define PS_MATH_8F_H_
+
+#include <picoscad/math/4f.h>
+
+#if defined(__AVX__) && !defined(PS_NO_SIMD)
+#include <picoscad/math/simd/8f.h>
+#else
+#include <picoscad/math/scalar/8f.h>
+#endif
+
+#endif // PS_MATH_8F_H_
@@ -0,0 +1,201 @@
+#ifndef PS_MATH_8X3F_H_
+#define PS_MATH_8X3F_H_
+
+#include <picoscad/math/8f.h>
+
+PS_EXTERN_BEGIN
+
+/*
+ * Structure-of-arrays packets of 8 vectors, one Ps8f per component. Where Ps4f
+ * spends a register (and a few shuffles per dot product) on every point, these
+ * keep all lanes busy with independent points. Loads and stores transpose from
+ * and to arrays of exactly 8 Ps4f, loops finish their tail with Ps4f.
+ */
+
+typedef struct Ps8x3f {
+    Ps8f x, y, z;
+} Ps8x3f;
+
+typedef struct Ps8x2f {
+    Ps8f x, y;
+} Ps8x2f;
+
+PS_INLINE Ps8x3f ps_8x3f(Ps8f x, Ps8f y, Ps8f z) {
+    return (Ps8x3f) {x, y, z};
+}
+
+PS_INLINE Ps8x3f ps_8x3f_splat(Ps4f v4f) {
+    return ps_8x3f(ps_8f_splat(ps_4f_x(v4f)), ps_8f_splat(ps_4f_y(v4f)), ps_8f_splat(ps_4f_z(v4f)));
+}
+
+PS_INLINE Ps8x3f ps_8x3f_load(const Ps4f *points) {
+    Ps8x3f out;
+    Ps8f w;
+    ps_8f_load_4f(points, &out.x, &out.y, &out.z, &w);
+    return out;
+}
+
+/**
+ * Stores 8 points with w set to w (1 for points, 0 for directions)
+ */
+PS_INLINE void ps_8x3f_store(Ps8x3f v8x3f, float w, Ps4f *points) {
+    ps_8f_store_4f(v8x3f.x, v8x3f.y, v8x3f.z, ps_8f_splat(w), points);
+}
+
+PS_INLINE Ps8x3f ps_8x3f_add(Ps8x3f lhs, Ps8x3f rhs) {
+    return ps_8x3f(ps_8f_add(lhs.x, rhs.x), ps_8f_add(lhs.y, rhs.y), ps_8f_add(lhs.z, rhs.z));
+}
+
+PS_INLINE Ps8x3f ps_8x3f_sub(Ps8x3f lhs, Ps8x3f rhs) {
+    return ps_8x3f(ps_8f_sub(lhs.x, rhs.x), ps_8f_sub(lhs.y, rhs.y), ps_8f_sub(lhs.z, rhs.z));
+}
+
+PS_INLINE Ps8x3f ps_8x3f_mul(Ps8x3f lhs, Ps8x3f rhs) {
+    return ps_8x3f(ps_8f_mul(lhs.x, rhs.x), ps_8f_mul(lhs.y, rhs.y), ps_8f_mul(lhs.z, rhs.z));
+}
+
+PS_INLINE Ps8x3f ps_8x3f_scale(Ps8x3f v8x3f, Ps8f scale) {
+    return ps_8x3f(ps_8f_mul(v8x3f.x, scale), ps_8f_mul(v8x3f.y, scale), ps_8f_mul(v8x3f.z, scale));
+}
+
+/**
+ * v8x3f * scale + add
+ */
+PS_INLINE Ps8x3f ps_8x3f_madd(Ps8x3f v8x3f, Ps8f scale, Ps8x3f add) {
+    return ps_8x3f(ps_8f_madd(v8x3f.x, scale, add.x),
+                   ps_8f_madd(v8x3f.y, scale, add.y),
+                   ps_8f_madd(v8x3f.z, scale, add.z));
+}
+
+PS_INLINE Ps8x3f ps_8x3f_min(Ps8x3f lhs, Ps8x3f rhs) {
+    return ps_8x3f(ps_8f_min(lhs.x, rhs.x), ps_8f_min(lhs.y, rhs.y), ps_8f_min(lhs.z, rhs.z));
+}
+
+PS_INLINE Ps8x3f ps_8x3f_max(Ps8x3f lhs, Ps8x3f rhs) {
+    return ps_8x3f(ps_8f_max(lhs.x, rhs.x), ps_8f_max(lhs.y, rhs.y), ps_8f_max(lhs.z, rhs.z));
+}
+
+PS_INLINE Ps8f ps_8x3f_dot(Ps8x3f lhs, Ps8x3f rhs) {
+    return ps_8f_madd(lhs.x, rhs.x, ps_8f_madd(lhs.y, rhs.y, ps_8f_mul(lhs.z, rhs.z)));
+}
+
+PS_INLINE Ps8x3f ps_8x3f_cross(Ps8x3f lhs, Ps8x3f rhs) {
+    return ps_8x3f(ps_8f_madd(lhs.y, rhs.z, ps_8f_neg(ps_8f_mul(lhs.z, rhs.y))),
+                   ps_8f_madd(lhs.z, rhs.x, ps_8f_neg(ps_8f_mul(lhs.x, rhs.z))),
+                   ps_8f_madd(lhs.x, rhs.y, ps_8f_neg(ps_8f_mul(lhs.y, rhs.x))));
+}
+
+PS_INLINE Ps8f ps_8x3f_square_length(Ps8x3f v8x3f) {
+    return ps_8x3f_dot(v8x3f, v8x3f);
+}
+
+PS_INLINE Ps8f ps_8x3f_length(Ps8x3f v8x3f) {
+    return ps_8f_sqrt(ps_8x3f_dot(v8x3f, v8x3f));
+}
+
+PS_INLINE Ps8f ps_8x3f_length_fast(Ps8x3f v8x3f) {
+    return ps_8f_sqrt_fast(ps_8x3f_dot(v8x3f, v8x3f));
+}
+
+PS_INLINE Ps8x3f ps_8x3f_normalize(Ps8x3f v8x3f) {
+    return ps_8x3f_scale(v8x3f, ps_8f_rsqrt(ps_8x3f_dot(v8x3f, v8x3f)));
+}
+
+PS_INLINE Ps8x3f ps_8x3f_normalize_fast(Ps8x3f v8x3f) {
+    return ps_8x3f_scale(v8x3f, ps_8f_rsqrt_fast(ps_8x3f_dot(v8x3f, v8x3f)));
+}
+
+/**
+ * Triangle normals (unnormalized), see ps_4f_surfnorm
+ */
+PS_INLINE Ps8x3f ps_8x3f_surfnorm(Ps8x3f p1, Ps8x3f p2, Ps8x3f p3) {
+    return ps_8x3f_cross(ps_8x3f_sub(p2, p1), ps_8x3f_sub(p3, p1));
+}
+
+PS_INLINE Ps8x2f ps_8x2f(Ps8f x, Ps8f y) {
+    return (Ps8x2f) {x, y};
+}
+
+PS_INLINE Ps8x2f ps_8x2f_splat(Ps4f v4f) {
+    return ps_8x2f(ps_8f_splat(ps_4f_x(v4f)), ps_8f_splat(ps_4f_y(v4f)));
+}
+
+PS_INLINE Ps8x2f ps_8x2f_load(const Ps4f *points) {
+    Ps8x2f out;
+    Ps8f z, w;
+    ps_8f_load_4f(points, &out.x, &out.y, &z, &w);
+    return out;
+}
+
+/**
+ * Stores 8 points with the given z and w
+ */
+PS_INLINE void ps_8x2f_store(Ps8x2f v8x2f, float z, float w, Ps4f *points) {
+    ps_8f_store_4f(v8x2f.x, v8x2f.y, ps_8f_splat(z), ps_8f_splat(w), points);
+}
+
+PS_INLINE Ps8x2f ps_8x2f_add(Ps8x2f lhs, Ps8x2f rhs) {
+    return ps_8x2f(ps_8f_add(lhs.x, rhs.x), ps_8f_add(lhs.y, rhs.y));
+}
+
+PS_INLINE Ps8x2f ps_8x2f_sub(Ps8x2f lhs, Ps8x2f rhs) {
+    return ps_8x2f(ps_8f_sub(lhs.x, rhs.x), ps_8f_sub(lhs.y, rhs.y));
+}
+
+PS_INLINE Ps8x2f ps_8x2f_mul(Ps8x2f lhs, Ps8x2f rhs) {
+    return ps_8x2f(ps_8f_mul(lhs.x, rhs.x), ps_8f_mul(lhs.y, rhs.y));
+}
+
+PS_INLINE Ps8x2f ps_8x2f_scale(Ps8x2f v8x2f, Ps8f scale) {
+    return ps_8x2f(ps_8f_mul(v8x2f.x, scale), ps_8f_mul(v8x2f.y, scale));
+}
+
+/**
+ * v8x2f * scale + add
+ */
+PS_INLINE Ps8x2f ps_8x2f_madd(Ps8x2f v8x2f, Ps8f scale, Ps8x2f add) {
+    return ps_8x2f(ps_8f_madd(v8x2f.x, scale, add.x), ps_8f_madd(v8x2f.y, scale, add.y));
+}
+
+PS_INLINE Ps8x2f ps_8x2f_min(Ps8x2f lhs, Ps8x2f rhs) {
+    return ps_8x2f(ps_8f_min(lhs.x, rhs.x), ps_8f_min(lhs.y, rhs.y));
+}
+
+PS_INLINE Ps8x2f ps_8x2f_max(Ps8x2f lhs, Ps8x2f rhs) {
+    return ps_8x2f(ps_8f_max(lhs.x, rhs.x), ps_8f_max(lhs.y, rhs.y));
+}
+
+PS_INLINE Ps8f ps_8x2f_dot(Ps8x2f lhs, Ps8x2f rhs) {
+    return ps_8f_madd(lhs.x, rhs.x, ps_8f_mul(lhs.y, rhs.y));
+}
+
+/**
+ * z of the 3D cross product, positive when rhs is counter-clockwise of lhs
+ */
+PS_INLINE Ps8f ps_8x2f_cross(Ps8x2f lhs, Ps8x2f rhs) {
+    return ps_8f_madd(lhs.x, rhs.y, ps_8f_neg(ps_8f_mul(lhs.y, rhs.x)));
+}
+
+PS_INLINE Ps8f ps_8x2f_square_length(Ps8x2f v8x2f) {
+    return ps_8x2f_dot(v8x2f, v8x2f);
+}
+
+PS_INLINE Ps8f ps_8x2f_length(Ps8x2f v8x2f) {
+    return ps_8f_sqrt(ps_8x2f_dot(v8x2f, v8x2f));
+}
+
+PS_INLINE Ps8f ps_8x2f_length_fast(Ps8x2f v8x2f) {
+    return ps_8f_sqrt_fast(ps_8x2f_dot(v8x2f, v8x2f));
+}
+
+PS_INLINE Ps8x2f ps_8x2f_normalize(Ps8x2f v8x2f) {
+    return ps_8x2f_scale(v8x2f, ps_8f_rsqrt(ps_8x2f_dot(v8x2f, v8x2f)));
+}
+
+PS_INLINE Ps8x2f ps_8x2f_normalize_fast(Ps8x2f v8x2f) {
+    return ps_8x2f_scale(v8x2f, ps_8f_rsqrt_fast(ps_8x2f_dot(v8x2f, v8x2f)));
+}
+
+PS_EXTERN_END
+
+#endif // PS_MATH_8X3F_H_
@@ -0,0 +1,168 @@
+#ifndef PS_MATH_AABB4F_H_
+#define PS_MATH_AABB4F_H_
+
+#include <picoscad/math/ray4f.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * An axis-aligned box over xyz, w is carried along but never tested. An empty
+ * box has min above max so that union with it is the identity.
+ */
+typedef struct PsAabb4f {
+    Ps4f min;
+    Ps4f max;
+} PsAabb4f;
+
+PS_INLINE PsAabb4f ps_aabb4f(Ps4f min, Ps4f max) {
+    return (PsAabb4f) {min, max};
+}
+
+PS_INLINE PsAabb4f ps_aabb4f_empty() {
+    return (PsAabb4f) {ps_4f_splat(INFINITY), ps_4f_splat(-INFINITY)};
+}
+
+PS_INLINE bool ps_aabb4f_is_empty(const PsAabb4f *box) {
+    return (ps_4f_lt_mask(box->max, box->min) & 0x7) != 0;
+}
+
+PS_INLINE PsAabb4f ps_aabb4f_union(const PsAabb4f *lhs, const PsAabb4f *rhs) {
+    return (PsAabb4f) {ps_4f_min(lhs->min, rhs->min), ps_4f_max(lhs->max, rhs->max)};
+}
+
+/**
+ * The overlap of both boxes, empty when they are disjoint
+ */
+PS_INLINE PsAabb4f ps_aabb4f_intersection(const PsAabb4f *lhs, const PsAabb4f *rhs) {
+    return (PsAabb4f) {ps_4f_max(lhs->min, rhs->min), ps_4f_min(lhs->max, rhs->max)};
+}
+
+PS_INLINE PsAabb4f ps_aabb4f_extend(const PsAabb4f *box, Ps4f point) {
+    return (PsAabb4f) {ps_4f_min(box->min, point), ps_4f_max(box->max, point)};
+}
+
+PS_INLINE PsAabb4f ps_aabb4f_from_points(const Ps4f *points, size_t length) {
+    PsAabb4f box = ps_aabb4f_empty();
+    for (size_t i = 0; i < length; ++i) {
+        box = ps_aabb4f_extend(&box, points[i]);
+    }
+    return box;
+}
+
+/**
+ * Touching boxes overlap
+ */
+PS_INLINE bool ps_aabb4f_overlaps(const PsAabb4f *lhs, const PsAabb4f *rhs) {
+    const int mask = ps_4f_le_mask(lhs->min, rhs->max) & ps_4f_le_mask(rhs->min, lhs->max);
+    return (mask & 0x7) == 0x7;
+}
+
+PS_INLINE bool ps_aabb4f_contains_point(const PsAabb4f *box, Ps4f point) {
+    const int mask = ps_4f_le_mask(box->min, point) & ps_4f_le_mask(point, box->max);
+    return (mask & 0x7) == 0x7;
+}
+
+/**
+ * Whether inner lies entirely inside (or on) box
+ */
+PS_INLINE bool ps_aabb4f_contains(const PsAabb4f *box, const PsAabb4f *inner) {
+    const int mask = ps_4f_le_mask(box->min, inner->min) & ps_4f_le_mask(inner->max, box->max);
+    return (mask & 0x7) == 0x7;
+}
+
+PS_INLINE Ps4f ps_aabb4f_center(const PsAabb4f *box) {
+    return ps_4f_mul(ps_4f_add(box->min, box->max), ps_4f_splat(0.5f));
+}
+
+PS_INLINE Ps4f ps_aabb4f_size(const PsAabb4f *box) {
+    return ps_4f_sub(box->max, box->min);
+}
+
+/**
+ * Half the surface area, enough to compare boxes for a SAH split
+ */
+PS_INLINE float ps_aabb4f_half_area(const PsAabb4f *box) {
+    const Ps4f size = ps_aabb4f_size(box);
+    const Ps4f yzx = ps_4f(ps_4f_y(size), ps_4f_z(size), ps_4f_x(size), 0.0f);
+    return ps_4f_x(ps_4f_dot3(size, yzx));
+}
+
+/**
+ * Slab test against the ray's [t_min, t_max]; on a hit the entry distance is
+ * written to t_near if it is not NULL. A ray running exactly within the plane
+ * of a face may go either way. An empty box is never hit.
+ */
+PS_INLINE bool ps_aabb4f_ray_intersect(const PsAabb4f *box, const PsRay4f *ray, float *t_near) {
+    const Ps4f t1 = ps_4f_mul(ps_4f_sub(box->min, ray->origin), ray->inv_direction);
+    const Ps4f t2 = ps_4f_mul(ps_4f_sub(box->max, ray->origin), ray->inv_direction);
+    const Ps4f near = ps_4f_min(t1, t2);
+    const Ps4f far = ps_4f_max(t1, t2);
+    // Latest entry and earliest exit over the three slabs and the ray's own range
+    const Ps4f enter = ps_4f_max(ps_4f_max(ps_4f_splat_x(near), ps_4f_splat_y(near)),
+                                 ps_4f_max(ps_4f_splat_z(near), ps_4f_splat(ray->t_min)));
+    const Ps4f leave = ps_4f_min(ps_4f_min(ps_4f_splat_x(far), ps_4f_splat_y(far)),
+                                 ps_4f_min(ps_4f_splat_z(far), ps_4f_splat(ray->t_max)));
+    // Swapping the slabs would turn an empty box inside out into all of space
+    const bool valid = (ps_4f_le_mask(box->min, box->max) & 0x7) == 0x7;
+    const bool hit = valid & ps_4f_le_mask(enter, leave) & 0x1;
+    if (hit && t_near) {
+        *t_near = ps_4f_x(enter);
+    }
+    return hit;
+}
+
+/**
+ * Four boxes in structure-of-arrays form, one lane per box, for testing the
+ * children of a 4-wide BVH node against one ray at once
+ */
+typedef struct PsAabbPacket4f {
+    Ps4f min_x, min_y, min_z;
+    Ps4f max_x, max_y, max_z;
+} PsAabbPacket4f;
+
+PS_INLINE PsAabbPacket4f ps_aabb_packet4f(const PsAabb4f *boxes) {
+    PsAabbPacket4f packet;
+    Ps4f min_x = boxes[0].min, min_y = boxes[1].min, min_z = boxes[2].min, min_w = boxes[3].min;
+    Ps4f max_x = boxes[0].max, max_y = boxes[1].max, max_z = boxes[2].max, max_w = boxes[3].max;
+    ps_4f_transpose(&min_x, &min_y, &min_z, &min_w);
+    ps_4f_transpose(&max_x, &max_y, &max_z, &max_w);
+    packet.min_x = min_x;
+    packet.min_y = min_y;
+    packet.min_z = min_z;
+    packet.max_x = max_x;
+    packet.max_y = max_y;
+    packet.max_z = max_z;
+    return packet;
+}
+
+/**
+ * Slab test of all four boxes; returns a mask with bit i set when box i is hit
+ * and writes the entry distances to t_near if it is not NULL. Empty boxes, such
+ * as the lanes padding out a node with fewer children, are never hit.
+ */
+PS_INLINE int ps_aabb_packet4f_ray_intersect(const PsAabbPacket4f *packet, const PsRay4f *ray, Ps4f *t_near) {
+    const Ps4f ox = ps_4f_splat_x(ray->origin), oy = ps_4f_splat_y(ray->origin), oz = ps_4f_splat_z(ray->origin);
+    const Ps4f ix = ps_4f_splat_x(ray->inv_direction);
+    const Ps4f iy = ps_4f_splat_y(ray->inv_direction);
+    const Ps4f iz = ps_4f_splat_z(ray->inv_direction);
+    const Ps4f x1 = ps_4f_mul(ps_4f_sub(packet->min_x, ox), ix);
+    const Ps4f x2 = ps_4f_mul(ps_4f_sub(packet->max_x, ox), ix);
+    const Ps4f y1 = ps_4f_mul(ps_4f_sub(packet->min_y, oy), iy);
+    const Ps4f y2 = ps_4f_mul(ps_4f_sub(packet->max_y, oy), iy);
+    const Ps4f z1 = ps_4f_mul(ps_4f_sub(packet->min_z, oz), iz);
+    const Ps4f z2 = ps_4f_mul(ps_4f_sub(packet->max_z, oz), iz);
+    const Ps4f enter = ps_4f_max(ps_4f_max(ps_4f_min(x1, x2), ps_4f_min(y1, y2)),
+                                 ps_4f_max(ps_4f_min(z1, z2), ps_4f_splat(ray->t_min)));
+    const Ps4f leave = ps_4f_min(ps_4f_min(ps_4f_max(x1, x2), ps_4f_max(y1, y2)),
+                                 ps_4f_min(ps_4f_max(z1, z2), ps_4f_splat(ray->t_max)));
+    if (t_near) {
+        *t_near = enter;
+    }
+    const int valid = ps_4f_le_mask(packet->min_x, packet->max_x) & ps_4f_le_mask(packet->min_y, packet->max_y) &
+                      ps_4f_le_mask(packet->min_z, packet->max_z);
+    return valid & ps_4f_le_mask(enter, leave);
+}
+
+PS_EXTERN_END
+
+#endif // PS_MATH_AABB4F_H_
@@ -0,0 +1,193 @@
+#ifndef PS_MATH_AFFINE3F_H_
+#define PS_MATH_AFFINE3F_H_
+
+#include <picoscad/math/mat4f.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * An affine transform stored as the top three rows of a 4x4 matrix, each row
+ * holding a 3x3 part in xyz and the translation in w. The implied bottom row
+ * is 0 0 0 1, so it is 48 bytes against PsMat4f's 64 and composing takes 12
+ * vector multiplies instead of 16.
+ */
+typedef struct PsAffine3f {
+    Ps4f x, y, z;
+} PsAffine3f;
+
+PS_INLINE PsAffine3f ps_affine3f(Ps4f x, Ps4f y, Ps4f z) {
+    return (PsAffine3f) {x, y, z};
+}
+
+PS_INLINE void ps_affine3f_identity(PsAffine3f *a3f) {
+    *a3f = (PsAffine3f) {
+            ps_4f(1.0f, 0.0f, 0.0f, 0.0f),
+            ps_4f(0.0f, 1.0f, 0.0f, 0.0f),
+            ps_4f(0.0f, 0.0f, 1.0f, 0.0f)
+    };
+}
+
+PS_INLINE void ps_affine3f_translation(PsAffine3f *a3f, float x, float y, float z) {
+    *a3f = (PsAffine3f) {
+            ps_4f(1.0f, 0.0f, 0.0f, x),
+            ps_4f(0.0f, 1.0f, 0.0f, y),
+            ps_4f(0.0f, 0.0f, 1.0f, z)
+    };
+}
+
+PS_INLINE void ps_affine3f_scale(PsAffine3f *a3f, float x, float y, float z) {
+    *a3f = (PsAffine3f) {
+            ps_4f(x, 0.0f, 0.0f, 0.0f),
+            ps_4f(0.0f, y, 0.0f, 0.0f),
+            ps_4f(0.0f, 0.0f, z, 0.0f)
+    };
+}
+
+// Same rotations as ps_mat4f_rot_*, written as rows
+PS_INLINE void ps_affine3f_rot_x(PsAffine3f *a3f, float radians) {
+    Ps4f s4f, c4f;
+    ps_4f_sincos(ps_4f_splat(radians), &s4f, &c4f);
+    const float s = ps_4f_x(s4f), c = ps_4f_x(c4f);
+    *a3f = (PsAffine3f) {
+            ps_4f(1.0f, 0.0f, 0.0f, 0.0f),
+            ps_4f(0.0f, c, s, 0.0f),
+            ps_4f(0.0f, -s, c, 0.0f)
+    };
+}
+
+PS_INLINE void ps_affine3f_rot_y(PsAffine3f *a3f, float radians) {
+    Ps4f s4f, c4f;
+    ps_4f_sincos(ps_4f_splat(radians), &s4f, &c4f);
+    const float s = ps_4f_x(s4f), c = ps_4f_x(c4f);
+    *a3f = (PsAffine3f) {
+            ps_4f(c, 0.0f, -s, 0.0f),
+            ps_4f(0.0f, 1.0f, 0.0f, 0.0f),
+            ps_4f(s, 0.0f, c, 0.0f)
+    };
+}
+
+PS_INLINE void ps_affine3f_rot_z(PsAffine3f *a3f, float radians) {
+    Ps4f s4f, c4f;
+    ps_4f_sincos(ps_4f_splat(radians), &s4f, &c4f);
+    const float s = ps_4f_x(s4f), c = ps_4f_x(c4f);
+    *a3f = (PsAffine3f) {
+            ps_4f(c, s, 0.0f, 0.0f),
+            ps_4f(-s, c, 0.0f, 0.0f),
+            ps_4f(0.0f, 0.0f, 1.0f, 0.0f)
+    };
+}
+
+PS_INLINE Ps4f _ps_affine3f_row_mul(Ps4f row, const PsAffine3f *rhs) {
+    // Row times the rows of rhs, the implied 0 0 0 1 row only carries w over
+    return ps_4f_add(ps_4f_mul(ps_4f_splat_x(row), rhs->x),
+                     ps_4f_add(ps_4f_mul(ps_4f_splat_y(row), rhs->y),
+                               ps_4f_add(ps_4f_mul(ps_4f_splat_z(row), rhs->z),
+                                         ps_4f_mul(row, ps_4f(0.0f, 0.0f, 0.0f, 1.0f)))));
+}
+
+/**
+ * out = lhs * rhs, applying rhs first; out may alias either operand
+ */
+PS_INLINE void ps_affine3f_mul(const PsAffine3f *lhs, const PsAffine3f *rhs, PsAffine3f *out) {
+    *out = (PsAffine3f) {
+            _ps_affine3f_row_mul(lhs->x, rhs),
+            _ps_affine3f_row_mul(lhs->y, rhs),
+            _ps_affine3f_row_mul(lhs->z, rhs)
+    };
+}
+
+PS_INLINE bool ps_affine3f_inverse(const PsAffine3f *a3f, PsAffine3f *out) {
+    // The columns of an inverted 3x3 are the cross products of its rows
+    Ps4f x = ps_4f_cross(a3f->y, a3f->z);
+    Ps4f y = ps_4f_cross(a3f->z, a3f->x);
+    Ps4f z = ps_4f_cross(a3f->x, a3f->y);
+    const Ps4f det = ps_4f_dot3(a3f->x, x);
+    if (ps_4f_x(det) == 0.0f) {
+        return false;
+    }
+    const Ps4f inv_det = ps_4f_recip(det);
+    Ps4f w = ps_4f_zero();
+    ps_4f_transpose(&x, &y, &z, &w);
+    x = ps_4f_mul(x, inv_det);
+    y = ps_4f_mul(y, inv_det);
+    z = ps_4f_mul(z, inv_det);
+    // The translation becomes -inverse(3x3) * t
+    const Ps4f t = ps_4f(ps_4f_w(a3f->x), ps_4f_w(a3f->y), ps_4f_w(a3f->z), 0.0f);
+    const Ps4f lane_w = ps_4f(0.0f, 0.0f, 0.0f, 1.0f);
+    *out = (PsAffine3f) {
+            ps_4f_sub(x, ps_4f_mul(ps_4f_dot3(x, t), lane_w)),
+            ps_4f_sub(y, ps_4f_mul(ps_4f_dot3(y, t), lane_w)),
+            ps_4f_sub(z, ps_4f_mul(ps_4f_dot3(z, t), lane_w))
+    };
+    return true;
+}
+
+/**
+ * Transforms a point, taking w as 1 whatever it holds; the result has w = 1
+ */
+PS_INLINE Ps4f ps_affine3f_transform_point(const PsAffine3f *a3f, Ps4f point) {
+    const Ps4f p = ps_4f_add(ps_4f_mul(point, ps_4f(1.0f, 1.0f, 1.0f, 0.0f)), ps_4f(0.0f, 0.0f, 0.0f, 1.0f));
+    Ps4f x = ps_4f_mul(a3f->x, p);
+    Ps4f y = ps_4f_mul(a3f->y, p);
+    Ps4f z = ps_4f_mul(a3f->z, p);
+    Ps4f w = ps_4f(0.0f, 0.0f, 0.0f, 1.0f);
+    // Horizontal sums of the three products, four at a time
+    ps_4f_transpose(&x, &y, &z, &w);
+    return ps_4f_add(ps_4f_add(x, y), ps_4f_add(z, w));
+}
+
+/**
+ * Transforms a direction, ignoring the translation; the result has w = 0
+ */
+PS_INLINE Ps4f ps_affine3f_transform_vector(const PsAffine3f *a3f, Ps4f vector) {
+    const Ps4f v = ps_4f_mul(vector, ps_4f(1.0f, 1.0f, 1.0f, 0.0f));
+    Ps4f x = ps_4f_mul(a3f->x, v);
+    Ps4f y = ps_4f_mul(a3f->y, v);
+    Ps4f z = ps_4f_mul(a3f->z, v);
+    Ps4f w = ps_4f_zero();
+    ps_4f_transpose(&x, &y, &z, &w);
+    return ps_4f_add(ps_4f_add(x, y), ps_4f_add(z, w));
+}
+
+/**
+ * Transforms a normal by the inverse transpose, so pass the inverse of the
+ * transform the geometry went through. Not normalized, the result has w = 0.
+ */
+PS_INLINE Ps4f ps_affine3f_transform_normal(const PsAffine3f *inverse, Ps4f normal) {
+    // Multiplying by the transpose is a sum of scaled rows, no transpose needed
+    const Ps4f n = ps_4f_add(ps_4f_mul(ps_4f_splat_x(normal), inverse->x),
+                             ps_4f_add(ps_4f_mul(ps_4f_splat_y(normal), inverse->y),
+                                       ps_4f_mul(ps_4f_splat_z(normal), inverse->z)));
+    return ps_4f_mul(n, ps_4f(1.0f, 1.0f, 1.0f, 0.0f));
+}
+
+/**
+ * Expands to the column-major PsMat4f used for GL uniforms
+ */
+PS_INLINE void ps_affine3f_to_mat4f(const PsAffine3f *a3f, PsMat4f *out) {
+    *out = (PsMat4f) {a3f->x, a3f->y, a3f->z, ps_4f(0.0f, 0.0f, 0.0f, 1.0f)};
+    ps_mat4f_transpose(out);
+}
+
+/**
+ * Drops the bottom row of m4f, which is assumed to be 0 0 0 1
+ */
+PS_INLINE void ps_affine3f_from_mat4f(const PsMat4f *m4f, PsAffine3f *out) {
+    PsMat4f rows = *m4f;
+    ps_mat4f_transpose(&rows);
+    *out = (PsAffine3f) {rows.x, rows.y, rows.z};
+}
+
+/**
+ * Transforms length points from in to out with the dispatched matrix kernel; in
+ * and out may be the same array
+ */
+PS_INLINE void ps_affine3f_transform_points(const PsAffine3f *a3f, const Ps4f *in, Ps4f *out, size_t length) {
+    PsMat4f m4f;
+    ps_affine3f_to_mat4f(a3f, &m4f);
+    ps_mat4f_transform_points(&m4f, in, out, length);
+}
+
+PS_EXTERN_END
+
+#endif // PS_MATH_AFFINE3F_H_
@@ -48,23 +48,103 @@ PS_INLINE void ps_mat4d_sub(const PsMat4d *lhs, const PsMat4d *rhs, PsMat4d *out
 }
 
 PS_INLINE void ps_mat4d_mul(const PsMat4d *lhs, const PsMat4d *rhs, PsMat4d *out) {
-    *out = (PsMat4d) {
-            ps_4d_mul(lhs->x, rhs->x),
-            ps_4d_mul(lhs->y, rhs->y),
-            ps_4d_mul(lhs->z, rhs->z),
-            ps_4d_mul(lhs->w, rhs->w)
+    // out may alias either operand
+    PsMat4d m4d;
+    ps_mat4d_4d_mul(lhs, &rhs->x, &m4d.x);
+    ps_mat4d_4d_mul(lhs, &rhs->y, &m4d.y);
+    ps_mat4d_4d_mul(lhs, &rhs->z, &m4d.z);
+    ps_mat4d_4d_mul(lhs, &rhs->w, &m4d.w);
+    *out = m4d;
+}
+
+PS_INLINE void ps_mat4d_transpose(PsMat4d *m4d) {
+    const Ps4d dx = ps_4d(ps_4d_x(m4d->x), ps_4d_x(m4d->y),
+                          ps_4d_x(m4d->z), ps_4d_x(m4d->w));
+    const Ps4d dy = ps_4d(ps_4d_y(m4d->x), ps_4d_y(m4d->y),
+                          ps_4d_y(m4d->z), ps_4d_y(m4d->w));
+    const Ps4d dz = ps_4d(ps_4d_z(m4d->x), ps_4d_z(m4d->y),
+                          ps_4d_z(m4d->z), ps_4d_z(m4d->w));
+    const Ps4d dw = ps_4d(ps_4d_w(m4d->x), ps_4d_w(m4d->y),
+                          ps_4d_w(m4d->z), ps_4d_w(m4d->w));
+    *m4d = (PsMat4d) {dx, dy, dz, dw};
+}
+
+PS_INLINE bool ps_mat4d_inverse(const PsMat4d *m4d, PsMat4d *out) {
+    // Columns are treated as 3d vectors a, b, c, d over a bottom row x, y, z, w
+    const Ps4d a = m4d->x, b = m4d->y, c = m4d->z, d = m4d->w;
+    const Ps4d x = ps_4d_splat_w(a), y = ps_4d_splat_w(b);
+    const Ps4d z = ps_4d_splat_w(c), w = ps_4d_splat_w(d);
+    Ps4d s = ps_4d_cross(a, b);
+    Ps4d t = ps_4d_cross(c, d);
+    Ps4d u = ps_4d_sub(ps_4d_mul(a, y), ps_4d_mul(b, x));
+    Ps4d v = ps_4d_sub(ps_4d_mul(c, w), ps_4d_mul(d, z));
+    const Ps4d det = ps_4d_add(ps_4d_dot3(s, v), ps_4d_dot3(t, u));
+    if (ps_4d_x(det) == 0.0) {
+        return false;
+    }
+    const Ps4d inv_det = ps_4d_recip(det);
+    s = ps_4d_mul(s, inv_det);
+    t = ps_4d_mul(t, inv_det);
+    u = ps_4d_mul(u, inv_det);
+    v = ps_4d_mul(v, inv_det);
+    // cross() leaves w at zero, so the last column of each row can be added in
+    const Ps4d lane_w = ps_4d(0.0, 0.0, 0.0, 1.0);
+    PsMat4d inv = {
+            ps_4d_add(ps_4d_add(ps_4d_cross(b, v), ps_4d_mul(t, y)),
+                      ps_4d_mul(lane_w, ps_4d_neg(ps_4d_dot3(b, t)))),
+            ps_4d_add(ps_4d_sub(ps_4d_cross(v, a), ps_4d_mul(t, x)),
+                      ps_4d_mul(lane_w, ps_4d_dot3(a, t))),
+            ps_4d_add(ps_4d_add(ps_4d_cross(d, u), ps_4d_mul(s, w)),
+                      ps_4d_mul(lane_w, ps_4d_neg(ps_4d_dot3(d, s)))),
+            ps_4d_add(ps_4d_sub(ps_4d_cross(u, c), ps_4d_mul(s, z)),
+                      ps_4d_mul(lane_w, ps_4d_dot3(c, s)))
     };
+    // Those were rows
+    ps_mat4d_transpose(&inv);
+    *out = inv;
+    return true;
 }
 
-PS_INLINE void ps_mat4d_div(const PsMat4d *lhs, const PsMat4d *rhs, PsMat4d *out) {
-    *out = (PsMat4d) {
-            ps_4d_div(lhs->x, rhs->x),
-            ps_4d_div(lhs->y, rhs->y),
-            ps_4d_div(lhs->z, rhs->z),
-            ps_4d_div(lhs->w, rhs->w)
+PS_INLINE bool ps_mat4d_inverse_affine(const PsMat4d *m4d, PsMat4d *out) {
+    // The rows of an inverted 3x3 are the cross products of its columns
+    const Ps4d r0 = ps_4d_cross(m4d->y, m4d->z);
+    const Ps4d r1 = ps_4d_cross(m4d->z, m4d->x);
+    const Ps4d r2 = ps_4d_cross(m4d->x, m4d->y);
+    const Ps4d det = ps_4d_dot3(m4d->x, r0);
+    if (ps_4d_x(det) == 0.0) {
+        return false;
+    }
+    const Ps4d inv_det = ps_4d_recip(det);
+    const Ps4d lane_w = ps_4d(0.0, 0.0, 0.0, 1.0);
+    PsMat4d inv = {
+            ps_4d_mul(r0, inv_det),
+            ps_4d_mul(r1, inv_det),
+            ps_4d_mul(r2, inv_det),
+            lane_w
     };
+    ps_mat4d_transpose(&inv);
+    const Ps4d t = m4d->w;
+    inv.w = ps_4d_sub(lane_w, ps_4d_add(ps_4d_mul(inv.x, ps_4d_splat_x(t)),
+                                        ps_4d_add(ps_4d_mul(inv.y, ps_4d_splat_y(t)),
+                                                  ps_4d_mul(inv.z, ps_4d_splat_z(t)))));
+    *out = inv;
+    return true;
 }
 
+PS_INLINE bool ps_mat4d_div(const PsMat4d *lhs, const PsMat4d *rhs, PsMat4d *out) {
+    PsMat4d inv;
+    if (!ps_mat4d_inverse(rhs, &inv)) {
+        return false;
+    }
+    ps_mat4d_mul(lhs, &inv, out);
+    return true;
+}
+
+/**
+ * Transforms length points from in to out; in and out may be the same array
+ */
+void ps_mat4d_transform_points(const PsMat4d *m4d, const Ps4d *in, Ps4d *out, size_t length);
+
 PS_INLINE void ps_mat4d_perspective(PsMat4d *m4d, double fovy, double aspect, double znear, double zfar) {
     const double dz = zfar - znear;
     const double cot = tan(PS_MATH_TAU - fovy * 0.5);
@@ -109,8 +189,10 @@ PS_INLINE void ps_mat4d_scale(PsMat4d *m4d, double x, double y, double z) {
 }
 
 PS_INLINE void ps_mat4d_rot_x(PsMat4d *m4d, double radians) {
-    const double s = sin(radians);
-    const double c = cos(radians);
+    Ps4d s4d, c4d;
+    ps_4d_sincos(ps_4d_splat(radians), &s4d, &c4d);
+    const double s = ps_4d_x(s4d);
+    const double c = ps_4d_x(c4d);
     *m4d = (PsMat4d) {
             ps_4d(1.0, 0.0, 0.0, 0.0),
             ps_4d(0.0, c, -s, 0.0),
@@ -120,8 +202,10 @@ PS_INLINE void ps_mat4d_rot_x(PsMat4d *m4d, double radians) {
 }
 
 PS_INLINE void ps_mat4d_rot_y(PsMat4d *m4d, double radians) {
-    const double s = sin(radians);
-    const double c = cos(radians);
+    Ps4d s4d, c4d;
+    ps_4d_sincos(ps_4d_splat(radians), &s4d, &c4d);
+    const double s = ps_4d_x(s4d);
+    const double c = ps_4d_x(c4d);
     *m4d = (PsMat4d) {
             ps_4d(c, 0.0, s, 0.0),
             ps_4d(0.0, 1.0, 0.0, 0.0),
@@ -131,8 +215,10 @@ PS_INLINE void ps_mat4d_rot_y(PsMat4d *m4d, double radians) {
 }
 
 PS_INLINE void ps_mat4d_rot_z(PsMat4d *m4d, double radians) {
-    const double s = sin(radians);
-    const double c = cos(radians);
+    Ps4d s4d, c4d;
+    ps_4d_sincos(ps_4d_splat(radians), &s4d, &c4d);
+    const double s = ps_4d_x(s4d);
+    const double c = ps_4d_x(c4d);
     *m4d = (PsMat4d) {
             ps_4d(c, -s, 0.0, 0.0),
             ps_4d(s, c, 0.0, 0.0),
@@ -141,18 +227,6 @@ PS_INLINE void ps_mat4d_rot_z(PsMat4d *m4d, double radians) {
     };
 }
 
-PS_INLINE void ps_mat4d_transpose(PsMat4d *m4d) {
-    const Ps4d dx = ps_4d(ps_4d_x(m4d->x), ps_4d_x(m4d->y),
-                          ps_4d_x(m4d->z), ps_4d_x(m4d->w));
-    const Ps4d dy = ps_4d(ps_4d_y(m4d->x), ps_4d_y(m4d->y),
-                          ps_4d_y(m4d->z), ps_4d_y(m4d->w));
-    const Ps4d dz = ps_4d(ps_4d_z(m4d->x), ps_4d_z(m4d->y),
-                          ps_4d_z(m4d->z), ps_4d_z(m4d->w));
-    const Ps4d dw = ps_4d(ps_4d_w(m4d->x), ps_4d_w(m4d->y),
-                          ps_4d_w(m4d->z), ps_4d_w(m4d->w));
-    *m4d = (PsMat4d) {dx, dy, dz, dw};
-}
-
 PS_EXTERN_END
 
 #endif // PS_MATH_MAT4D_H_
\ No newline at end of file
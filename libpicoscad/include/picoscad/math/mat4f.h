@@ -48,23 +48,95 @@ PS_INLINE void ps_mat4f_sub(const PsMat4f *lhs, const PsMat4f *rhs, PsMat4f *out
 }
 
 PS_INLINE void ps_mat4f_mul(const PsMat4f *lhs, const PsMat4f *rhs, PsMat4f *out) {
-    *out = (PsMat4f) {
-            ps_4f_mul(lhs->x, rhs->x),
-            ps_4f_mul(lhs->y, rhs->y),
-            ps_4f_mul(lhs->z, rhs->z),
-            ps_4f_mul(lhs->w, rhs->w)
+    // out may alias either operand
+    PsMat4f m4f;
+    ps_mat4f_4f_mul(lhs, &rhs->x, &m4f.x);
+    ps_mat4f_4f_mul(lhs, &rhs->y, &m4f.y);
+    ps_mat4f_4f_mul(lhs, &rhs->z, &m4f.z);
+    ps_mat4f_4f_mul(lhs, &rhs->w, &m4f.w);
+    *out = m4f;
+}
+
+PS_INLINE void ps_mat4f_transpose(PsMat4f *m4f) {
+    ps_4f_transpose(&m4f->x, &m4f->y, &m4f->z, &m4f->w);
+}
+
+PS_INLINE bool ps_mat4f_inverse(const PsMat4f *m4f, PsMat4f *out) {
+    // Columns are treated as 3d vectors a, b, c, d over a bottom row x, y, z, w
+    const Ps4f a = m4f->x, b = m4f->y, c = m4f->z, d = m4f->w;
+    const Ps4f x = ps_4f_splat_w(a), y = ps_4f_splat_w(b);
+    const Ps4f z = ps_4f_splat_w(c), w = ps_4f_splat_w(d);
+    Ps4f s = ps_4f_cross(a, b);
+    Ps4f t = ps_4f_cross(c, d);
+    Ps4f u = ps_4f_sub(ps_4f_mul(a, y), ps_4f_mul(b, x));
+    Ps4f v = ps_4f_sub(ps_4f_mul(c, w), ps_4f_mul(d, z));
+    const Ps4f det = ps_4f_add(ps_4f_dot3(s, v), ps_4f_dot3(t, u));
+    if (ps_4f_x(det) == 0.0f) {
+        return false;
+    }
+    const Ps4f inv_det = ps_4f_recip(det);
+    s = ps_4f_mul(s, inv_det);
+    t = ps_4f_mul(t, inv_det);
+    u = ps_4f_mul(u, inv_det);
+    v = ps_4f_mul(v, inv_det);
+    // cross() leaves w at zero, so the last column of each row can be added in
+    const Ps4f lane_w = ps_4f(0.0f, 0.0f, 0.0f, 1.0f);
+    PsMat4f inv = {
+            ps_4f_add(ps_4f_add(ps_4f_cross(b, v), ps_4f_mul(t, y)),
+                      ps_4f_mul(lane_w, ps_4f_neg(ps_4f_dot3(b, t)))),
+            ps_4f_add(ps_4f_sub(ps_4f_cross(v, a), ps_4f_mul(t, x)),
+                      ps_4f_mul(lane_w, ps_4f_dot3(a, t))),
+            ps_4f_add(ps_4f_add(ps_4f_cross(d, u), ps_4f_mul(s, w)),
+                      ps_4f_mul(lane_w, ps_4f_neg(ps_4f_dot3(d, s)))),
+            ps_4f_add(ps_4f_sub(ps_4f_cross(u, c), ps_4f_mul(s, z)),
+                      ps_4f_mul(lane_w, ps_4f_dot3(c, s)))
     };
+    // Those were rows
+    ps_mat4f_transpose(&inv);
+    *out = inv;
+    return true;
 }
 
-PS_INLINE void ps_mat4f_div(const PsMat4f *lhs, const PsMat4f *rhs, PsMat4f *out) {
-    *out = (PsMat4f) {
-            ps_4f_div(lhs->x, rhs->x),
-            ps_4f_div(lhs->y, rhs->y),
-            ps_4f_div(lhs->z, rhs->z),
-            ps_4f_div(lhs->w, rhs->w)
+PS_INLINE bool ps_mat4f_inverse_affine(const PsMat4f *m4f, PsMat4f *out) {
+    // The rows of an inverted 3x3 are the cross products of its columns
+    const Ps4f r0 = ps_4f_cross(m4f->y, m4f->z);
+    const Ps4f r1 = ps_4f_cross(m4f->z, m4f->x);
+    const Ps4f r2 = ps_4f_cross(m4f->x, m4f->y);
+    const Ps4f det = ps_4f_dot3(m4f->x, r0);
+    if (ps_4f_x(det) == 0.0f) {
+        return false;
+    }
+    const Ps4f inv_det = ps_4f_recip(det);
+    const Ps4f lane_w = ps_4f(0.0f, 0.0f, 0.0f, 1.0f);
+    PsMat4f inv = {
+            ps_4f_mul(r0, inv_det),
+            ps_4f_mul(r1, inv_det),
+            ps_4f_mul(r2, inv_det),
+            lane_w
     };
+    ps_mat4f_transpose(&inv);
+    const Ps4f t = m4f->w;
+    inv.w = ps_4f_sub(lane_w, ps_4f_add(ps_4f_mul(inv.x, ps_4f_splat_x(t)),
+                                        ps_4f_add(ps_4f_mul(inv.y, ps_4f_splat_y(t)),
+                                                  ps_4f_mul(inv.z, ps_4f_splat_z(t)))));
+    *out = inv;
+    return true;
 }
 
+PS_INLINE bool ps_mat4f_div(const PsMat4f *lhs, const PsMat4f *rhs, PsMat4f *out) {
+    PsMat4f inv;
+    if (!ps_mat4f_inverse(rhs, &inv)) {
+        return false;
+    }
+    ps_mat4f_mul(lhs, &inv, out);
+    return true;
+}
+
+/**
+ * Transforms length points from in to out; in and out may be the same array
+ */
+void ps_mat4f_transform_points(const PsMat4f *m4f, const Ps4f *in, Ps4f *out, size_t length);
+
 PS_INLINE void ps_mat4f_perspective(PsMat4f *m4f, float fovy, float aspect, float znear, float zfar) {
     const float dz = zfar - znear;
     const float cot = tanf(PS_MATH_TAU - fovy * 0.5f);
@@ -109,8 +181,10 @@ PS_INLINE void ps_mat4f_scale(PsMat4f *m4f, float x, float y, float z) {
 }
 
 PS_INLINE void ps_mat4f_rot_x(PsMat4f *m4f, float radians) {
-    const float s = sinf(radians);
-    const float c = cosf(radians);
+    Ps4f s4f, c4f;
+    ps_4f_sincos(ps_4f_splat(radians), &s4f, &c4f);
+    const float s = ps_4f_x(s4f);
+    const float c = ps_4f_x(c4f);
     *m4f = (PsMat4f) {
             ps_4f(1.0f, 0.0f, 0.0f, 0.0f),
             ps_4f(0.0f, c, -s, 0.0f),
@@ -120,8 +194,10 @@ PS_INLINE void ps_mat4f_rot_x(PsMat4f *m4f, float radians) {
 }
 
 PS_INLINE void ps_mat4f_rot_y(PsMat4f *m4f, float radians) {
-    const float s = sinf(radians);
-    const float c = cosf(radians);
+    Ps4f s4f, c4f;
+    ps_4f_sincos(ps_4f_splat(radians), &s4f, &c4f);
+    const float s = ps_4f_x(s4f);
+    const float c = ps_4f_x(c4f);
     *m4f = (PsMat4f) {
             ps_4f(c, 0.0f, s, 0.0f),
             ps_4f(0.0f, 1.0f, 0.0f, 0.0f),
@@ -131,8 +207,10 @@ PS_INLINE void ps_mat4f_rot_y(PsMat4f *m4f, float radians) {
 }
 
 PS_INLINE void ps_mat4f_rot_z(PsMat4f *m4f, float radians) {
-    const float s = sinf(radians);
-    const float c = cosf(radians);
+    Ps4f s4f, c4f;
+    ps_4f_sincos(ps_4f_splat(radians), &s4f, &c4f);
+    const float s = ps_4f_x(s4f);
+    const float c = ps_4f_x(c4f);
     *m4f = (PsMat4f) {
             ps_4f(c, -s, 0.0f, 0.0f),
             ps_4f(s, c, 0.0f, 0.0f),
@@ -141,18 +219,6 @@ PS_INLINE void ps_mat4f_rot_z(PsMat4f *m4f, float radians) {
     };
 }
 
-PS_INLINE void ps_mat4f_transpose(PsMat4f *m4f) {
-    const Ps4f dx = ps_4f(ps_4f_x(m4f->x), ps_4f_x(m4f->y),
-                          ps_4f_x(m4f->z), ps_4f_x(m4f->w));
-    const Ps4f dy = ps_4f(ps_4f_y(m4f->x), ps_4f_y(m4f->y),
-                          ps_4f_y(m4f->z), ps_4f_y(m4f->w));
-    const Ps4f dz = ps_4f(ps_4f_z(m4f->x), ps_4f_z(m4f->y),
-                          ps_4f_z(m4f->z), ps_4f_z(m4f->w));
-    const Ps4f dw = ps_4f(ps_4f_w(m4f->x), ps_4f_w(m4f->y),
-                          ps_4f_w(m4f->z), ps_4f_w(m4f->w));
-    *m4f = (PsMat4f) {dx, dy, dz, dw};
-}
-
 PS_EXTERN_END
 
 #endif // PS_MATH_MAT4F_H_
\ No newline at end of file
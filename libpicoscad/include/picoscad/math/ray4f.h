@@ -0,0 +1,39 @@
+#ifndef PS_MATH_RAY4F_H_
+#define PS_MATH_RAY4F_H_
+
+#include <float.h>
+
+#include <picoscad/math/4f.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * A ray origin + t * direction for t in [t_min, t_max]. The reciprocal of the
+ * direction is kept for slab tests.
+ */
+typedef struct PsRay4f {
+    Ps4f origin;
+    Ps4f direction;
+    Ps4f inv_direction;
+    float t_min;
+    float t_max;
+} PsRay4f;
+
+PS_INLINE PsRay4f ps_ray4f(Ps4f origin, Ps4f direction, float t_min, float t_max) {
+    return (PsRay4f) {
+            origin,
+            direction,
+            // Clamped so an origin on a slab plane gives 0 * FLT_MAX, not 0 * inf = NaN
+            ps_4f_min(ps_4f_max(ps_4f_recip(direction), ps_4f_splat(-FLT_MAX)), ps_4f_splat(FLT_MAX)),
+            t_min,
+            t_max
+    };
+}
+
+PS_INLINE Ps4f ps_ray4f_at(const PsRay4f *ray, float t) {
+    return ps_4f_add(ray->origin, ps_4f_mul(ray->direction, ps_4f_splat(t)));
+}
+
+PS_EXTERN_END
+
+#endif // PS_MATH_RAY4F_H_
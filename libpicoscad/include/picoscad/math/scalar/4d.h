@@ -3,7 +3,7 @@
 
 #include <string.h>
 
-#include <picoscad/math/scalar/4f.h>
+#include <picoscad/math/math.h>
 
 typedef struct Ps4d {
     union {
@@ -62,17 +62,26 @@ PS_INLINE double ps_4d_w(Ps4d v4d) {
     return v4d._w;
 }
 
-PS_INLINE Ps4d ps_4d_swizzle(Ps4d v4d, Ps4fSwizzle swizzle) {
-    return ps_4d(v4d._arr[(swizzle & 0xC0) >> 6],
-                 v4d._arr[(swizzle & 0x30) >> 4],
+PS_INLINE Ps4d ps_4d_swizzle(Ps4d v4d, PsSwizzle swizzle) {
+    // Same lane order as _mm_shuffle_ps: the low bits pick x
+    return ps_4d(v4d._arr[(swizzle & 0x03)],
                  v4d._arr[(swizzle & 0x0C) >> 2],
-                 v4d._arr[(swizzle & 0x03)]);
+                 v4d._arr[(swizzle & 0x30) >> 4],
+                 v4d._arr[(swizzle & 0xC0) >> 6]);
 }
 
 PS_INLINE Ps4d ps_4d_splat(double f) {
     return ps_4d(f, f, f, f);
 }
 
+PS_INLINE Ps4f ps_4d_to_4f(Ps4d v4d) {
+    return ps_4f((float) v4d._x, (float) v4d._y, (float) v4d._z, (float) v4d._w);
+}
+
+PS_INLINE Ps4d ps_4f_to_4d(Ps4f v4f) {
+    return ps_4d(ps_4f_x(v4f), ps_4f_y(v4f), ps_4f_z(v4f), ps_4f_w(v4f));
+}
+
 PS_INLINE Ps4d ps_4d_splat_x(Ps4d v4d) {
     return ps_4d_splat(v4d._x);
 }
@@ -153,4 +162,25 @@ PS_INLINE Ps4d ps_4d_neg(Ps4d v4d) {
     return ps_4d(-v4d._x, -v4d._y, -v4d._z, -v4d._w);
 }
 
+PS_INLINE Ps4d ps_4d_sin(Ps4d v4d) {
+    return ps_4d(sin(v4d._x), sin(v4d._y), sin(v4d._z), sin(v4d._w));
+}
+
+PS_INLINE Ps4d ps_4d_cos(Ps4d v4d) {
+    return ps_4d(cos(v4d._x), cos(v4d._y), cos(v4d._z), cos(v4d._w));
+}
+
+PS_INLINE void ps_4d_sincos(Ps4d v4d, Ps4d *sin_out, Ps4d *cos_out) {
+    *sin_out = ps_4d_sin(v4d);
+    *cos_out = ps_4d_cos(v4d);
+}
+
+PS_INLINE Ps4d ps_4d_acos(Ps4d v4d) {
+    return ps_4d(acos(v4d._x), acos(v4d._y), acos(v4d._z), acos(v4d._w));
+}
+
+PS_INLINE Ps4d ps_4d_atan2(Ps4d y, Ps4d x) {
+    return ps_4d(atan2(y._x, x._x), atan2(y._y, x._y), atan2(y._z, x._z), atan2(y._w, x._w));
+}
+
 #endif // PS_MATH_SCALAR_4D_H_
\ No newline at end of file
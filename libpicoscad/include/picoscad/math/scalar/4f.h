@@ -297,6 +297,18 @@ PS_INLINE bool ps_4f_gt(Ps4f lhs, Ps4f rhs) {
     return lhs._x > rhs._x && lhs._y > rhs._y && lhs._z > rhs._z && lhs._w > rhs._w;
 }
 
+/*
+ * Per-lane comparisons, bit i of the result is set when lane i (x = 0) passes
+ */
+
+PS_INLINE int ps_4f_lt_mask(Ps4f lhs, Ps4f rhs) {
+    return (lhs._x < rhs._x) | ((lhs._y < rhs._y) << 1) | ((lhs._z < rhs._z) << 2) | ((lhs._w < rhs._w) << 3);
+}
+
+PS_INLINE int ps_4f_le_mask(Ps4f lhs, Ps4f rhs) {
+    return (lhs._x <= rhs._x) | ((lhs._y <= rhs._y) << 1) | ((lhs._z <= rhs._z) << 2) | ((lhs._w <= rhs._w) << 3);
+}
+
 PS_INLINE Ps4f ps_4f_map(Ps4f v4f, float(*fn)(float)) {
     return ps_4f(fn(v4f._x), fn(v4f._y), fn(v4f._z), fn(v4f._w));
 }
@@ -326,10 +338,19 @@ PS_INLINE float ps_4f_w(Ps4f v4f) {
 }
 
 PS_INLINE Ps4f ps_4f_swizzle(Ps4f v4f, PsSwizzle swizzle) {
-    return ps_4f(v4f._arr[(swizzle & 0xC0) >> 6],
-                 v4f._arr[(swizzle & 0x30) >> 4],
+    // Same lane order as _mm_shuffle_ps: the low bits pick x
+    return ps_4f(v4f._arr[(swizzle & 0x03)],
                  v4f._arr[(swizzle & 0x0C) >> 2],
-                 v4f._arr[(swizzle & 0x03)]);
+                 v4f._arr[(swizzle & 0x30) >> 4],
+                 v4f._arr[(swizzle & 0xC0) >> 6]);
+}
+
+// x and y are picked from lhs, z and w from rhs
+PS_INLINE Ps4f ps_4f_shuffle(Ps4f lhs, Ps4f rhs, PsSwizzle swizzle) {
+    return ps_4f(lhs._arr[(swizzle & 0x03)],
+                 lhs._arr[(swizzle & 0x0C) >> 2],
+                 rhs._arr[(swizzle & 0x30) >> 4],
+                 rhs._arr[(swizzle & 0xC0) >> 6]);
 }
 
 PS_INLINE Ps4f ps_4f_splat(float f) {
@@ -392,6 +413,20 @@ PS_INLINE Ps4f ps_4f_rsqrt_fast(Ps4f v4f) {
     return ps_4f_rsqrt(v4f);
 }
 
+/**
+ * Transposes the 4x4 matrix with rows (or columns) x, y, z, w in place
+ */
+PS_INLINE void ps_4f_transpose(Ps4f *x, Ps4f *y, Ps4f *z, Ps4f *w) {
+    const Ps4f dx = ps_4f(x->_x, y->_x, z->_x, w->_x);
+    const Ps4f dy = ps_4f(x->_y, y->_y, z->_y, w->_y);
+    const Ps4f dz = ps_4f(x->_z, y->_z, z->_z, w->_z);
+    const Ps4f dw = ps_4f(x->_w, y->_w, z->_w, w->_w);
+    *x = dx;
+    *y = dy;
+    *z = dz;
+    *w = dw;
+}
+
 PS_INLINE Ps4f ps_4f_cross(Ps4f lhs, Ps4f rhs) {
     return ps_4f(lhs._y * rhs._z - lhs._z * rhs._y,
                  lhs._z * rhs._x - lhs._x * rhs._z,
@@ -416,4 +451,25 @@ PS_INLINE Ps4f ps_4f_neg(Ps4f v4f) {
     return ps_4f(-v4f._x, -v4f._y, -v4f._z, -v4f._w);
 }
 
+PS_INLINE Ps4f ps_4f_sin(Ps4f v4f) {
+    return ps_4f(sinf(v4f._x), sinf(v4f._y), sinf(v4f._z), sinf(v4f._w));
+}
+
+PS_INLINE Ps4f ps_4f_cos(Ps4f v4f) {
+    return ps_4f(cosf(v4f._x), cosf(v4f._y), cosf(v4f._z), cosf(v4f._w));
+}
+
+PS_INLINE void ps_4f_sincos(Ps4f v4f, Ps4f *sin_out, Ps4f *cos_out) {
+    *sin_out = ps_4f_sin(v4f);
+    *cos_out = ps_4f_cos(v4f);
+}
+
+PS_INLINE Ps4f ps_4f_acos(Ps4f v4f) {
+    return ps_4f(acosf(v4f._x), acosf(v4f._y), acosf(v4f._z), acosf(v4f._w));
+}
+
+PS_INLINE Ps4f ps_4f_atan2(Ps4f y, Ps4f x) {
+    return ps_4f(atan2f(y._x, x._x), atan2f(y._y, x._y), atan2f(y._z, x._z), atan2f(y._w, x._w));
+}
+
 #endif // PS_MATH_SCALAR_4F_H_
\ No newline at end of file
@@ -0,0 +1,205 @@
+#ifndef PS_MATH_SCALAR_8F_H_
+#define PS_MATH_SCALAR_8F_H_
+
+#include <string.h>
+
+#include <picoscad/math/math.h>
+
+typedef struct Ps8f {
+    float _arr[8];
+} Ps8f;
+
+#define _PS_8F_MAP(expr) do { \
+        for (size_t i = 0; i < 8; ++i) { \
+            out._arr[i] = (expr); \
+        } \
+    } while (0)
+
+PS_INLINE Ps8f ps_8f(float a, float b, float c, float d, float e, float f, float g, float h) {
+    return (Ps8f) {{a, b, c, d, e, f, g, h}};
+}
+
+PS_INLINE Ps8f ps_8f_zero() {
+    return (Ps8f) {{0.0f}};
+}
+
+PS_INLINE bool ps_8f_eq(Ps8f lhs, Ps8f rhs) {
+    bool eq = true;
+    for (size_t i = 0; i < 8; ++i) {
+        eq &= lhs._arr[i] == rhs._arr[i];
+    }
+    return eq;
+}
+
+PS_INLINE bool ps_8f_lt(Ps8f lhs, Ps8f rhs) {
+    bool lt = true;
+    for (size_t i = 0; i < 8; ++i) {
+        lt &= lhs._arr[i] < rhs._arr[i];
+    }
+    return lt;
+}
+
+PS_INLINE bool ps_8f_gt(Ps8f lhs, Ps8f rhs) {
+    bool gt = true;
+    for (size_t i = 0; i < 8; ++i) {
+        gt &= lhs._arr[i] > rhs._arr[i];
+    }
+    return gt;
+}
+
+// arr needs no particular alignment, here or in ps_8f_store
+PS_INLINE Ps8f ps_8f_load(const float *arr) {
+    Ps8f out;
+    memcpy(&out, arr, sizeof(Ps8f));
+    return out;
+}
+
+PS_INLINE void ps_8f_store(Ps8f v8f, float *arr) {
+    memcpy(arr, &v8f, sizeof(Ps8f));
+}
+
+PS_INLINE float ps_8f_get(Ps8f v8f, size_t index) {
+    return v8f._arr[index];
+}
+
+PS_INLINE Ps8f ps_8f_splat(float f) {
+    return ps_8f(f, f, f, f, f, f, f, f);
+}
+
+PS_INLINE Ps8f ps_8f_add(Ps8f lhs, Ps8f rhs) {
+    Ps8f out;
+    _PS_8F_MAP(lhs._arr[i] + rhs._arr[i]);
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_sub(Ps8f lhs, Ps8f rhs) {
+    Ps8f out;
+    _PS_8F_MAP(lhs._arr[i] - rhs._arr[i]);
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_mul(Ps8f lhs, Ps8f rhs) {
+    Ps8f out;
+    _PS_8F_MAP(lhs._arr[i] * rhs._arr[i]);
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_div(Ps8f lhs, Ps8f rhs) {
+    Ps8f out;
+    _PS_8F_MAP(lhs._arr[i] / rhs._arr[i]);
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_madd(Ps8f lhs, Ps8f rhs, Ps8f add) {
+    Ps8f out;
+    _PS_8F_MAP(fmaf(lhs._arr[i], rhs._arr[i], add._arr[i]));
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_recip(Ps8f v8f) {
+    Ps8f out;
+    _PS_8F_MAP(1.0f / v8f._arr[i]);
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_recip_fast(Ps8f v8f) {
+    return ps_8f_recip(v8f);
+}
+
+PS_INLINE Ps8f ps_8f_sqrt(Ps8f v8f) {
+    Ps8f out;
+    _PS_8F_MAP(sqrtf(v8f._arr[i]));
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_sqrt_fast(Ps8f v8f) {
+    return ps_8f_sqrt(v8f);
+}
+
+PS_INLINE Ps8f ps_8f_rsqrt(Ps8f v8f) {
+    return ps_8f_recip(ps_8f_sqrt(v8f));
+}
+
+PS_INLINE Ps8f ps_8f_rsqrt_fast(Ps8f v8f) {
+    return ps_8f_rsqrt(v8f);
+}
+
+PS_INLINE Ps8f ps_8f_min(Ps8f lhs, Ps8f rhs) {
+    Ps8f out;
+    _PS_8F_MAP(fminf(lhs._arr[i], rhs._arr[i]));
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_max(Ps8f lhs, Ps8f rhs) {
+    Ps8f out;
+    _PS_8F_MAP(fmaxf(lhs._arr[i], rhs._arr[i]));
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_abs(Ps8f v8f) {
+    Ps8f out;
+    _PS_8F_MAP(fabsf(v8f._arr[i]));
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_neg(Ps8f v8f) {
+    Ps8f out;
+    _PS_8F_MAP(-v8f._arr[i]);
+    return out;
+}
+
+/**
+ * Transposes 8 xyzw points into one register per component
+ */
+PS_INLINE void ps_8f_load_4f(const Ps4f *points, Ps8f *x, Ps8f *y, Ps8f *z, Ps8f *w) {
+    for (size_t i = 0; i < 8; ++i) {
+        float arr[4];
+        ps_4f_store(points[i], arr);
+        x->_arr[i] = arr[0];
+        y->_arr[i] = arr[1];
+        z->_arr[i] = arr[2];
+        w->_arr[i] = arr[3];
+    }
+}
+
+/**
+ * Inverse of ps_8f_load_4f
+ */
+PS_INLINE void ps_8f_store_4f(Ps8f x, Ps8f y, Ps8f z, Ps8f w, Ps4f *points) {
+    for (size_t i = 0; i < 8; ++i) {
+        points[i] = ps_4f(x._arr[i], y._arr[i], z._arr[i], w._arr[i]);
+    }
+}
+
+PS_INLINE Ps8f ps_8f_sin(Ps8f v8f) {
+    Ps8f out;
+    _PS_8F_MAP(sinf(v8f._arr[i]));
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_cos(Ps8f v8f) {
+    Ps8f out;
+    _PS_8F_MAP(cosf(v8f._arr[i]));
+    return out;
+}
+
+PS_INLINE void ps_8f_sincos(Ps8f v8f, Ps8f *sin_out, Ps8f *cos_out) {
+    *sin_out = ps_8f_sin(v8f);
+    *cos_out = ps_8f_cos(v8f);
+}
+
+PS_INLINE Ps8f ps_8f_acos(Ps8f v8f) {
+    Ps8f out;
+    _PS_8F_MAP(acosf(v8f._arr[i]));
+    return out;
+}
+
+PS_INLINE Ps8f ps_8f_atan2(Ps8f y, Ps8f x) {
+    Ps8f out;
+    _PS_8F_MAP(atan2f(y._arr[i], x._arr[i]));
+    return out;
+}
+
+#undef _PS_8F_MAP
+
+#endif // PS_MATH_SCALAR_8F_H_
@@ -43,7 +43,7 @@ PS_INLINE Ps4d ps_4d_map(Ps4d v4d, double(*fn)(double)) {
 }
 
 PS_INLINE Ps4d ps_4d_load(const double* arr) {
-    return _mm256_load_pd(arr);
+    return _mm256_loadu_pd(arr);
 }
 
 PS_INLINE void ps_4d_store(Ps4d v4d, double* arr) {
@@ -70,26 +70,43 @@ PS_INLINE double ps_4d_w(Ps4d v4d) {
     return u.w;
 }
 
-#define ps_4d_swizzle(v4d, swizzle) (_mm256_shuffle_pd((v4d), (v4d), (swizzle)))
+#ifdef __AVX2__
+#define ps_4d_swizzle(v4d, swizzle) (_mm256_permute4x64_pd((v4d), (swizzle)))
+#else
+// AVX1 can't shuffle across 128-bit lanes in one go
+PS_INLINE Ps4d ps_4d_swizzle(Ps4d v4d, PsSwizzle swizzle) {
+    _Ps4dSIMDUnion u = {v4d};
+    return ps_4d(u.arr[swizzle & 0x03], u.arr[(swizzle >> 2) & 0x03],
+                 u.arr[(swizzle >> 4) & 0x03], u.arr[(swizzle >> 6) & 0x03]);
+}
+#endif
 
 PS_INLINE Ps4d ps_4d_splat(double f) {
     return _mm256_set1_pd(f);
 }
 
+PS_INLINE Ps4f ps_4d_to_4f(Ps4d v4d) {
+    return _mm256_cvtpd_ps(v4d);
+}
+
+PS_INLINE Ps4d ps_4f_to_4d(Ps4f v4f) {
+    return _mm256_cvtps_pd(v4f);
+}
+
 PS_INLINE Ps4d ps_4d_splat_x(Ps4d v4d) {
-    return ps_4d_swizzle(v4d, PS_SWIZZLE_XXXX);
+    return _mm256_permute_pd(_mm256_permute2f128_pd(v4d, v4d, 0x00), 0x0);
 }
 
 PS_INLINE Ps4d ps_4d_splat_y(Ps4d v4d) {
-    return ps_4d_swizzle(v4d, PS_SWIZZLE_YYYY);
+    return _mm256_permute_pd(_mm256_permute2f128_pd(v4d, v4d, 0x00), 0xF);
 }
 
 PS_INLINE Ps4d ps_4d_splat_z(Ps4d v4d) {
-    return ps_4d_swizzle(v4d, PS_SWIZZLE_ZZZZ);
+    return _mm256_permute_pd(_mm256_permute2f128_pd(v4d, v4d, 0x11), 0x0);
 }
 
 PS_INLINE Ps4d ps_4d_splat_w(Ps4d v4d) {
-    return ps_4d_swizzle(v4d, PS_SWIZZLE_WWWW);
+    return _mm256_permute_pd(_mm256_permute2f128_pd(v4d, v4d, 0x11), 0xF);
 }
 
 PS_INLINE Ps4d ps_4d_add(Ps4d lhs, Ps4d rhs) {
@@ -118,8 +135,7 @@ PS_INLINE Ps4d ps_4d_recip_fast(Ps4d v4d) {
 }
 
 PS_INLINE Ps4d ps_4d_sqrt(Ps4d v4d) {
-    _Ps4dSIMDUnion u = {v4d};
-    return ps_4d(sqrtf(u.x), sqrtf(u.y), sqrtf(u.z), sqrtf(u.w));
+    return _mm256_sqrt_pd(v4d);
 }
 
 PS_INLINE Ps4d ps_4d_sqrt_fast(Ps4d v4d) {
@@ -161,6 +177,163 @@ PS_INLINE Ps4d ps_4d_neg(Ps4d v4d) {
     return _mm256_xor_pd(_mm256_castsi256_pd(_mm256_set1_epi64x(0x8000000000000000)), v4d);
 }
 
+PS_INLINE Ps4d _ps_4d_madd(Ps4d lhs, Ps4d rhs, Ps4d add) {
+#ifdef __FMA__
+    return _mm256_fmadd_pd(lhs, rhs, add);
+#else
+    return _mm256_add_pd(_mm256_mul_pd(lhs, rhs), add);
+#endif
+}
+
+PS_INLINE Ps4d _ps_4d_select(Ps4d mask, Ps4d lhs, Ps4d rhs) {
+    return _mm256_blendv_pd(rhs, lhs, mask);
+}
+
+PS_INLINE Ps4d _ps_4d_sign(Ps4d v4d) {
+    return _mm256_and_pd(_mm256_set1_pd(-0.0), v4d);
+}
+
+PS_INLINE Ps4d _ps_4d_mod2(Ps4d v4d) {
+    return _mm256_sub_pd(v4d, _mm256_mul_pd(_mm256_set1_pd(2.0),
+                                            _mm256_floor_pd(_mm256_mul_pd(v4d, _mm256_set1_pd(0.5)))));
+}
+
+/*
+ * Cephes sin/cos: pi/4 reduction in three parts, degree 6 polynomials.
+ * Max error 1.6 ulp for |x| < 2^30; past that the reduction falls apart.
+ */
+PS_INLINE void ps_4d_sincos(Ps4d v4d, Ps4d *sin_out, Ps4d *cos_out) {
+    const Ps4d x = ps_4d_abs(v4d);
+    Ps4d j = _mm256_floor_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.27323954473516268615)));
+    j = _mm256_add_pd(j, _ps_4d_mod2(j));
+    // q = (j / 2) mod 4 is the quadrant
+    const Ps4d q = _mm256_sub_pd(_mm256_mul_pd(j, _mm256_set1_pd(0.5)),
+                                 _mm256_mul_pd(_mm256_set1_pd(4.0),
+                                               _mm256_floor_pd(_mm256_mul_pd(j, _mm256_set1_pd(0.125)))));
+    const Ps4d swap = _mm256_cmp_pd(_ps_4d_mod2(q), _mm256_set1_pd(1.0), _CMP_EQ_OQ);
+    const Ps4d sin_sign = _mm256_xor_pd(_ps_4d_sign(v4d),
+                                        _mm256_and_pd(_mm256_set1_pd(-0.0),
+                                                      _mm256_cmp_pd(q, _mm256_set1_pd(2.0), _CMP_GE_OQ)));
+    const Ps4d cos_sign = _mm256_and_pd(_mm256_set1_pd(-0.0),
+                                        _mm256_cmp_pd(ps_4d_abs(_mm256_sub_pd(q, _mm256_set1_pd(1.5))),
+                                                      _mm256_set1_pd(1.0), _CMP_LT_OQ));
+    Ps4d r = _ps_4d_madd(j, _mm256_set1_pd(-7.85398125648498535156e-1), x);
+    r = _ps_4d_madd(j, _mm256_set1_pd(-3.77489470793079817668e-8), r);
+    r = _ps_4d_madd(j, _mm256_set1_pd(-2.69515142907905952645e-15), r);
+    const Ps4d z = _mm256_mul_pd(r, r);
+    Ps4d ps = _ps_4d_madd(_mm256_set1_pd(1.58962301576546568060e-10), z,
+                          _mm256_set1_pd(-2.50507477628578072866e-8));
+    ps = _ps_4d_madd(ps, z, _mm256_set1_pd(2.75573136213857245213e-6));
+    ps = _ps_4d_madd(ps, z, _mm256_set1_pd(-1.98412698295895385996e-4));
+    ps = _ps_4d_madd(ps, z, _mm256_set1_pd(8.33333333332211858878e-3));
+    ps = _ps_4d_madd(ps, z, _mm256_set1_pd(-1.66666666666666307295e-1));
+    ps = _ps_4d_madd(_mm256_mul_pd(ps, z), r, r);
+    Ps4d pc = _ps_4d_madd(_mm256_set1_pd(-1.13585365213876817300e-11), z,
+                          _mm256_set1_pd(2.08757008419747316778e-9));
+    pc = _ps_4d_madd(pc, z, _mm256_set1_pd(-2.75573141792967388112e-7));
+    pc = _ps_4d_madd(pc, z, _mm256_set1_pd(2.48015872888517045348e-5));
+    pc = _ps_4d_madd(pc, z, _mm256_set1_pd(-1.38888888888730564116e-3));
+    pc = _ps_4d_madd(pc, z, _mm256_set1_pd(4.16666666666665929218e-2));
+    pc = _ps_4d_madd(_mm256_mul_pd(pc, z), z, _ps_4d_madd(z, _mm256_set1_pd(-0.5), _mm256_set1_pd(1.0)));
+    *sin_out = _mm256_xor_pd(_ps_4d_select(swap, pc, ps), sin_sign);
+    *cos_out = _mm256_xor_pd(_ps_4d_select(swap, ps, pc), cos_sign);
+}
+
+PS_INLINE Ps4d ps_4d_sin(Ps4d v4d) {
+    Ps4d sin, cos;
+    ps_4d_sincos(v4d, &sin, &cos);
+    return sin;
+}
+
+PS_INLINE Ps4d ps_4d_cos(Ps4d v4d) {
+    Ps4d sin, cos;
+    ps_4d_sincos(v4d, &sin, &cos);
+    return cos;
+}
+
+/*
+ * fdlibm acos with every branch evaluated and blended. Max error 1 ulp,
+ * NaN outside of [-1, 1].
+ */
+PS_INLINE Ps4d ps_4d_acos(Ps4d v4d) {
+    const Ps4d pio2_hi = _mm256_set1_pd(1.57079632679489655800e+00);
+    const Ps4d pio2_lo = _mm256_set1_pd(6.12323399573676603587e-17);
+    const Ps4d one = _mm256_set1_pd(1.0);
+    const Ps4d a = ps_4d_abs(v4d);
+    const Ps4d small = _mm256_cmp_pd(a, _mm256_set1_pd(0.5), _CMP_LT_OQ);
+    const Ps4d z = _ps_4d_select(small, _mm256_mul_pd(v4d, v4d),
+                                 _mm256_mul_pd(_mm256_sub_pd(one, a), _mm256_set1_pd(0.5)));
+    Ps4d p = _ps_4d_madd(z, _mm256_set1_pd(3.47933107596021167570e-05), _mm256_set1_pd(7.91534994289814532176e-04));
+    p = _ps_4d_madd(z, p, _mm256_set1_pd(-4.00555345006794114027e-02));
+    p = _ps_4d_madd(z, p, _mm256_set1_pd(2.01212532134862925881e-01));
+    p = _ps_4d_madd(z, p, _mm256_set1_pd(-3.25565818622400915405e-01));
+    p = _ps_4d_madd(z, p, _mm256_set1_pd(1.66666666666666657415e-01));
+    p = _mm256_mul_pd(z, p);
+    Ps4d q = _ps_4d_madd(z, _mm256_set1_pd(7.70381505559019352791e-02), _mm256_set1_pd(-6.88283971605453293030e-01));
+    q = _ps_4d_madd(z, q, _mm256_set1_pd(2.02094576023350569471e+00));
+    q = _ps_4d_madd(z, q, _mm256_set1_pd(-2.40339491173441421878e+00));
+    q = _ps_4d_madd(z, q, one);
+    const Ps4d r = _mm256_div_pd(p, q);
+    // |x| < 0.5: pi/2 - (x + x * r)
+    const Ps4d near = _mm256_sub_pd(pio2_hi, _mm256_sub_pd(v4d, _mm256_sub_pd(pio2_lo, _mm256_mul_pd(v4d, r))));
+    // x <= -0.5: pi - 2 * (s + s * r)
+    const Ps4d s = _mm256_sqrt_pd(z);
+    const Ps4d w = _mm256_sub_pd(_mm256_mul_pd(r, s), pio2_lo);
+    const Ps4d negative = _mm256_sub_pd(_mm256_set1_pd(3.14159265358979311600e+00),
+                                        _mm256_mul_pd(_mm256_set1_pd(2.0), _mm256_add_pd(s, w)));
+    // x >= 0.5: 2 * (s + s * r) with s split into a high part and a correction
+    const Ps4d df = _mm256_and_pd(s, _mm256_castsi256_pd(_mm256_set1_epi64x((long long)0xFFFFFFFF00000000ULL)));
+    // At x = 1 s and df are both 0, the correction is 0 rather than 0 / 0
+    const Ps4d c = _mm256_andnot_pd(_mm256_cmp_pd(s, _mm256_setzero_pd(), _CMP_EQ_OQ),
+                                    _mm256_div_pd(_mm256_sub_pd(z, _mm256_mul_pd(df, df)), _mm256_add_pd(s, df)));
+    const Ps4d positive = _mm256_mul_pd(_mm256_set1_pd(2.0), _mm256_add_pd(df, _ps_4d_madd(r, s, c)));
+    return _ps_4d_select(small, near,
+                         _ps_4d_select(_mm256_cmp_pd(v4d, _mm256_setzero_pd(), _CMP_LT_OQ), negative, positive));
+}
+
+/*
+ * fdlibm atan on min(|y|, |x|) / max(|y|, |x|), then unfolded into the
+ * right octant. Max error 1.6 ulp; atan2(0, 0) is 0.
+ */
+PS_INLINE Ps4d ps_4d_atan2(Ps4d y, Ps4d x) {
+    const Ps4d one = _mm256_set1_pd(1.0);
+    const Ps4d ay = ps_4d_abs(y);
+    const Ps4d ax = ps_4d_abs(x);
+    const Ps4d hi = _mm256_max_pd(ax, ay);
+    const Ps4d a = _mm256_andnot_pd(_mm256_cmp_pd(hi, _mm256_setzero_pd(), _CMP_EQ_OQ),
+                                    _mm256_div_pd(_mm256_min_pd(ax, ay), hi));
+    // Reduce around atan(0.5) and atan(1)
+    const Ps4d mid = _mm256_cmp_pd(a, _mm256_set1_pd(0.4375), _CMP_GE_OQ);
+    const Ps4d high = _mm256_cmp_pd(a, _mm256_set1_pd(0.6875), _CMP_GE_OQ);
+    const Ps4d t = _ps_4d_select(high, _mm256_div_pd(_mm256_sub_pd(a, one), _mm256_add_pd(a, one)),
+                                 _ps_4d_select(mid, _mm256_div_pd(_ps_4d_madd(a, _mm256_set1_pd(2.0), ps_4d_neg(one)),
+                                                                  _mm256_add_pd(a, _mm256_set1_pd(2.0))), a));
+    const Ps4d atan_hi = _ps_4d_select(high, _mm256_set1_pd(7.85398163397448278999e-01),
+                                       _mm256_and_pd(mid, _mm256_set1_pd(4.63647609000806093515e-01)));
+    const Ps4d atan_lo = _ps_4d_select(high, _mm256_set1_pd(3.06161699786838301793e-17),
+                                       _mm256_and_pd(mid, _mm256_set1_pd(2.26987774529616870924e-17)));
+    const Ps4d z = _mm256_mul_pd(t, t);
+    const Ps4d w = _mm256_mul_pd(z, z);
+    Ps4d s1 = _ps_4d_madd(w, _mm256_set1_pd(1.62858201153657823623e-02), _mm256_set1_pd(4.97687799461593236017e-02));
+    s1 = _ps_4d_madd(w, s1, _mm256_set1_pd(6.66107313738753120669e-02));
+    s1 = _ps_4d_madd(w, s1, _mm256_set1_pd(9.09088713343650656196e-02));
+    s1 = _ps_4d_madd(w, s1, _mm256_set1_pd(1.42857142725034663711e-01));
+    s1 = _mm256_mul_pd(z, _ps_4d_madd(w, s1, _mm256_set1_pd(3.33333333333329318027e-01)));
+    Ps4d s2 = _ps_4d_madd(w, _mm256_set1_pd(-3.65315727442169155270e-02), _mm256_set1_pd(-5.83357013379057348645e-02));
+    s2 = _ps_4d_madd(w, s2, _mm256_set1_pd(-7.69187620504482999495e-02));
+    s2 = _ps_4d_madd(w, s2, _mm256_set1_pd(-1.11111104054623557880e-01));
+    s2 = _mm256_mul_pd(w, _ps_4d_madd(w, s2, _mm256_set1_pd(-1.99999999998764832476e-01)));
+    // atan_hi - ((t * (s1 + s2) - atan_lo) - t), which is t - t * (s1 + s2) when unreduced
+    Ps4d r = _mm256_sub_pd(atan_hi, _mm256_sub_pd(_mm256_sub_pd(_mm256_mul_pd(t, _mm256_add_pd(s1, s2)), atan_lo), t));
+    r = _ps_4d_select(_mm256_cmp_pd(ay, ax, _CMP_GT_OQ),
+                      _mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(1.57079632679489655800e+00), r),
+                                    _mm256_set1_pd(6.12323399573676603587e-17)), r);
+    r = _ps_4d_select(_mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_LT_OQ),
+                      _mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(3.14159265358979311600e+00), r),
+                                    _mm256_set1_pd(1.22464679914735317723e-16)), r);
+    return _mm256_xor_pd(r, _ps_4d_sign(y));
+}
+
 PS_EXTERN_END
 
 #endif // PS_MATH_SIMD_4D_H_
\ No newline at end of file
@@ -1,7 +1,7 @@
 #ifndef PS_MATH_SIMD_4F_H_
 #define PS_MATH_SIMD_4F_H_
 
-#include <xmmintrin.h>
+#include <emmintrin.h>
 
 #include <picoscad/math/math.h>
 
@@ -295,13 +295,25 @@ PS_INLINE bool ps_4f_gt(Ps4f lhs, Ps4f rhs) {
     return 0x0F == _mm_movemask_ps(_mm_cmpgt_ps(lhs, rhs));
 }
 
+/*
+ * Per-lane comparisons, bit i of the result is set when lane i (x = 0) passes
+ */
+
+PS_INLINE int ps_4f_lt_mask(Ps4f lhs, Ps4f rhs) {
+    return _mm_movemask_ps(_mm_cmplt_ps(lhs, rhs));
+}
+
+PS_INLINE int ps_4f_le_mask(Ps4f lhs, Ps4f rhs) {
+    return _mm_movemask_ps(_mm_cmple_ps(lhs, rhs));
+}
+
 PS_INLINE Ps4f ps_4f_map(Ps4f v4f, float(*fn)(float)) {
     _Ps4fSIMDUnion u = {v4f};
     return ps_4f(fn(u.x), fn(u.y), fn(u.z), fn(u.w));
 }
 
 PS_INLINE Ps4f ps_4f_load(const float* arr) {
-    return _mm_load_ps(arr);
+    return _mm_loadu_ps(arr);
 }
 
 PS_INLINE void ps_4f_store(Ps4f v4f, float* arr) {
@@ -330,6 +342,9 @@ PS_INLINE float ps_4f_w(Ps4f v4f) {
 
 #define ps_4f_swizzle(v4f, swizzle) (_mm_shuffle_ps((v4f), (v4f), (swizzle)))
 
+// x and y are picked from lhs, z and w from rhs
+#define ps_4f_shuffle(lhs, rhs, swizzle) (_mm_shuffle_ps((lhs), (rhs), (swizzle)))
+
 PS_INLINE Ps4f ps_4f_splat(float f) {
     return _mm_set1_ps(f);
 }
@@ -375,12 +390,12 @@ PS_INLINE Ps4f ps_4f_recip_fast(Ps4f v4f) {
 }
 
 PS_INLINE Ps4f ps_4f_sqrt(Ps4f v4f) {
-    _Ps4fSIMDUnion u = {v4f};
-    return ps_4f(sqrtf(u.x), sqrtf(u.y), sqrtf(u.z), sqrtf(u.w));
+    return _mm_sqrt_ps(v4f);
 }
 
 PS_INLINE Ps4f ps_4f_sqrt_fast(Ps4f v4f) {
-    return _mm_sqrt_ps(v4f);
+    // rcp(rsqrt(0)) is still 0, unlike v * rsqrt(v)
+    return _mm_rcp_ps(_mm_rsqrt_ps(v4f));
 }
 
 PS_INLINE Ps4f ps_4f_rsqrt(Ps4f v4f) {
@@ -391,6 +406,13 @@ PS_INLINE Ps4f ps_4f_rsqrt_fast(Ps4f v4f) {
     return _mm_rsqrt_ps(v4f);
 }
 
+/**
+ * Transposes the 4x4 matrix with rows (or columns) x, y, z, w in place
+ */
+PS_INLINE void ps_4f_transpose(Ps4f *x, Ps4f *y, Ps4f *z, Ps4f *w) {
+    _MM_TRANSPOSE4_PS(*x, *y, *z, *w);
+}
+
 PS_INLINE Ps4f ps_4f_cross(Ps4f lhs, Ps4f rhs) {
     return ps_4f_sub(ps_4f_mul(ps_4f_swizzle(lhs, PS_SWIZZLE_WXZY),
                                ps_4f_swizzle(rhs, PS_SWIZZLE_WYXZ)),
@@ -416,6 +438,105 @@ PS_INLINE Ps4f ps_4f_neg(Ps4f v4f) {
     return _mm_xor_ps(_mm_castsi128_ps(_mm_set1_epi32(0x80000000)), v4f);
 }
 
+PS_INLINE Ps4f _ps_4f_select(Ps4f mask, Ps4f lhs, Ps4f rhs) {
+    return _mm_or_ps(_mm_and_ps(mask, lhs), _mm_andnot_ps(mask, rhs));
+}
+
+PS_INLINE Ps4f _ps_4f_sign(Ps4f v4f) {
+    return _mm_and_ps(_mm_castsi128_ps(_mm_set1_epi32(0x80000000)), v4f);
+}
+
+/*
+ * Cephes sinf/cosf: reduce by pi/4 in three parts, then pick the sine or
+ * cosine polynomial per quadrant. Max error is 1.6 ulp for |x| < 10. Up to
+ * |x| = 8192 the absolute error stays under 1e-7, but near the zeros that
+ * is several hundred ulp.
+ */
+PS_INLINE void ps_4f_sincos(Ps4f v4f, Ps4f *sin_out, Ps4f *cos_out) {
+    const Ps4f x = ps_4f_abs(v4f);
+    __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+    j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    const Ps4f y = _mm_cvtepi32_ps(j);
+    // Bit 1 of j swaps the polynomials, bit 2 negates the sine
+    const Ps4f swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)),
+                                                       _mm_set1_epi32(2)));
+    const Ps4f sin_sign = _mm_xor_ps(_ps_4f_sign(v4f), _mm_castsi128_ps(
+            _mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+    const Ps4f cos_sign = _mm_castsi128_ps(
+            _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+    Ps4f r = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+    const Ps4f z = _mm_mul_ps(r, r);
+    Ps4f ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), z), _mm_set1_ps(8.3321608736e-3f));
+    ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(-1.6666654611e-1f));
+    ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), r), r);
+    Ps4f pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), z), _mm_set1_ps(-1.388731625493765e-3f));
+    pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827e-2f));
+    pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+    pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+    *sin_out = _mm_xor_ps(_ps_4f_select(swap, pc, ps), sin_sign);
+    *cos_out = _mm_xor_ps(_ps_4f_select(swap, ps, pc), cos_sign);
+}
+
+PS_INLINE Ps4f ps_4f_sin(Ps4f v4f) {
+    Ps4f sin, cos;
+    ps_4f_sincos(v4f, &sin, &cos);
+    return sin;
+}
+
+PS_INLINE Ps4f ps_4f_cos(Ps4f v4f) {
+    Ps4f sin, cos;
+    ps_4f_sincos(v4f, &sin, &cos);
+    return cos;
+}
+
+/*
+ * Cephes asinf polynomial, folded around 0.5 for acos. Max error 1.3 ulp,
+ * NaN outside of [-1, 1].
+ */
+PS_INLINE Ps4f ps_4f_acos(Ps4f v4f) {
+    const Ps4f a = ps_4f_abs(v4f);
+    const Ps4f big = _mm_cmpgt_ps(a, _mm_set1_ps(0.5f));
+    const Ps4f z = _ps_4f_select(big, _mm_mul_ps(_mm_set1_ps(0.5f), _mm_sub_ps(_mm_set1_ps(1.0f), a)),
+                                 _mm_mul_ps(a, a));
+    const Ps4f x = _ps_4f_select(big, _mm_sqrt_ps(z), a);
+    Ps4f p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(4.2163199048e-2f), z), _mm_set1_ps(2.4181311049e-2f));
+    p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(4.5470025998e-2f));
+    p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(7.4953002686e-2f));
+    p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.6666752422e-1f));
+    p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), x), x);
+    // p = asin(x); near +-1 acos is 2 * asin(sqrt((1 - |v|) / 2)), otherwise pi/2 - asin(v)
+    const Ps4f twice = _mm_add_ps(p, p);
+    const Ps4f far = _ps_4f_select(_mm_cmplt_ps(v4f, _mm_setzero_ps()),
+                                   _mm_sub_ps(_mm_set1_ps(PS_MATH_PI), twice), twice);
+    const Ps4f near = _mm_sub_ps(_mm_set1_ps(PS_MATH_PI * 0.5f), _mm_xor_ps(p, _ps_4f_sign(v4f)));
+    return _ps_4f_select(big, far, near);
+}
+
+/*
+ * Cephes atanf on min(|y|, |x|) / max(|y|, |x|), then unfolded into the
+ * right octant. Max error 3.2 ulp; atan2(0, 0) is 0.
+ */
+PS_INLINE Ps4f ps_4f_atan2(Ps4f y, Ps4f x) {
+    const Ps4f ay = ps_4f_abs(y);
+    const Ps4f ax = ps_4f_abs(x);
+    const Ps4f hi = _mm_max_ps(ax, ay);
+    const Ps4f a = _mm_andnot_ps(_mm_cmpeq_ps(hi, _mm_setzero_ps()), _mm_div_ps(_mm_min_ps(ax, ay), hi));
+    const Ps4f reduce = _mm_cmpgt_ps(a, _mm_set1_ps(0.4142135623730950f));
+    const Ps4f t = _ps_4f_select(reduce, _mm_div_ps(_mm_sub_ps(a, _mm_set1_ps(1.0f)),
+                                                    _mm_add_ps(a, _mm_set1_ps(1.0f))), a);
+    const Ps4f z = _mm_mul_ps(t, t);
+    Ps4f r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(8.05374449538e-2f), z), _mm_set1_ps(-1.38776856032e-1f));
+    r = _mm_add_ps(_mm_mul_ps(r, z), _mm_set1_ps(1.99777106478e-1f));
+    r = _mm_add_ps(_mm_mul_ps(r, z), _mm_set1_ps(-3.33329491539e-1f));
+    r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, z), t), t);
+    r = _mm_add_ps(r, _mm_and_ps(reduce, _mm_set1_ps(PS_MATH_PI * 0.25f)));
+    r = _ps_4f_select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(PS_MATH_PI * 0.5f), r), r);
+    r = _ps_4f_select(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(PS_MATH_PI), r), r);
+    return _mm_xor_ps(r, _ps_4f_sign(y));
+}
+
 PS_EXTERN_END
 
 #endif // PS_MATH_SIMD_4F_H_
\ No newline at end of file
@@ -0,0 +1,266 @@
+#ifndef PS_MATH_SIMD_8F_H_
+#define PS_MATH_SIMD_8F_H_
+
+#include <immintrin.h>
+
+#include <picoscad/math/simd/4f.h>
+
+PS_EXTERN_BEGIN
+
+typedef __m256 Ps8f;
+
+typedef union {
+    Ps8f v8f;
+    float arr[8];
+} _Ps8fSIMDUnion;
+
+PS_INLINE Ps8f ps_8f(float a, float b, float c, float d, float e, float f, float g, float h) {
+    return _mm256_setr_ps(a, b, c, d, e, f, g, h);
+}
+
+PS_INLINE Ps8f ps_8f_zero() {
+    return _mm256_setzero_ps();
+}
+
+PS_INLINE bool ps_8f_eq(Ps8f lhs, Ps8f rhs) {
+    return 0xFF == _mm256_movemask_ps(_mm256_cmp_ps(lhs, rhs, _CMP_EQ_OQ));
+}
+
+PS_INLINE bool ps_8f_lt(Ps8f lhs, Ps8f rhs) {
+    return 0xFF == _mm256_movemask_ps(_mm256_cmp_ps(lhs, rhs, _CMP_LT_OQ));
+}
+
+PS_INLINE bool ps_8f_gt(Ps8f lhs, Ps8f rhs) {
+    return 0xFF == _mm256_movemask_ps(_mm256_cmp_ps(lhs, rhs, _CMP_GT_OQ));
+}
+
+// arr needs no particular alignment, here or in ps_8f_store
+PS_INLINE Ps8f ps_8f_load(const float *arr) {
+    return _mm256_loadu_ps(arr);
+}
+
+PS_INLINE void ps_8f_store(Ps8f v8f, float *arr) {
+    _mm256_storeu_ps(arr, v8f);
+}
+
+PS_INLINE float ps_8f_get(Ps8f v8f, size_t index) {
+    _Ps8fSIMDUnion u = {v8f};
+    return u.arr[index];
+}
+
+PS_INLINE Ps8f ps_8f_splat(float f) {
+    return _mm256_set1_ps(f);
+}
+
+PS_INLINE Ps8f ps_8f_add(Ps8f lhs, Ps8f rhs) {
+    return _mm256_add_ps(lhs, rhs);
+}
+
+PS_INLINE Ps8f ps_8f_sub(Ps8f lhs, Ps8f rhs) {
+    return _mm256_sub_ps(lhs, rhs);
+}
+
+PS_INLINE Ps8f ps_8f_mul(Ps8f lhs, Ps8f rhs) {
+    return _mm256_mul_ps(lhs, rhs);
+}
+
+PS_INLINE Ps8f ps_8f_div(Ps8f lhs, Ps8f rhs) {
+    return _mm256_div_ps(lhs, rhs);
+}
+
+PS_INLINE Ps8f ps_8f_madd(Ps8f lhs, Ps8f rhs, Ps8f add) {
+#ifdef __FMA__
+    return _mm256_fmadd_ps(lhs, rhs, add);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(lhs, rhs), add);
+#endif
+}
+
+PS_INLINE Ps8f ps_8f_recip(Ps8f v8f) {
+    return _mm256_div_ps(ps_8f_splat(1.0f), v8f);
+}
+
+PS_INLINE Ps8f ps_8f_recip_fast(Ps8f v8f) {
+    return _mm256_rcp_ps(v8f);
+}
+
+PS_INLINE Ps8f ps_8f_sqrt(Ps8f v8f) {
+    return _mm256_sqrt_ps(v8f);
+}
+
+PS_INLINE Ps8f ps_8f_sqrt_fast(Ps8f v8f) {
+    return _mm256_rcp_ps(_mm256_rsqrt_ps(v8f));
+}
+
+PS_INLINE Ps8f ps_8f_rsqrt(Ps8f v8f) {
+    return ps_8f_recip(ps_8f_sqrt(v8f));
+}
+
+PS_INLINE Ps8f ps_8f_rsqrt_fast(Ps8f v8f) {
+    return _mm256_rsqrt_ps(v8f);
+}
+
+PS_INLINE Ps8f ps_8f_min(Ps8f lhs, Ps8f rhs) {
+    return _mm256_min_ps(lhs, rhs);
+}
+
+PS_INLINE Ps8f ps_8f_max(Ps8f lhs, Ps8f rhs) {
+    return _mm256_max_ps(lhs, rhs);
+}
+
+PS_INLINE Ps8f ps_8f_abs(Ps8f v8f) {
+    // removes sign bit
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v8f);
+}
+
+PS_INLINE Ps8f ps_8f_neg(Ps8f v8f) {
+    // flips sign bit
+    return _mm256_xor_ps(_mm256_set1_ps(-0.0f), v8f);
+}
+
+/**
+ * Transposes 8 xyzw points into one register per component
+ */
+PS_INLINE void ps_8f_load_4f(const Ps4f *points, Ps8f *x, Ps8f *y, Ps8f *z, Ps8f *w) {
+    // Pair point i with point i + 4 so a per-lane 4x4 transpose finishes the job
+    const __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(points[0]), points[4], 1);
+    const __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(points[1]), points[5], 1);
+    const __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(points[2]), points[6], 1);
+    const __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(points[3]), points[7], 1);
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    *x = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    *y = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    *z = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    *w = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+/**
+ * Inverse of ps_8f_load_4f
+ */
+PS_INLINE void ps_8f_store_4f(Ps8f x, Ps8f y, Ps8f z, Ps8f w, Ps4f *points) {
+    const __m256 t0 = _mm256_unpacklo_ps(x, y);
+    const __m256 t1 = _mm256_unpackhi_ps(x, y);
+    const __m256 t2 = _mm256_unpacklo_ps(z, w);
+    const __m256 t3 = _mm256_unpackhi_ps(z, w);
+    const __m256 r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    points[0] = _mm256_castps256_ps128(r0);
+    points[1] = _mm256_castps256_ps128(r1);
+    points[2] = _mm256_castps256_ps128(r2);
+    points[3] = _mm256_castps256_ps128(r3);
+    points[4] = _mm256_extractf128_ps(r0, 1);
+    points[5] = _mm256_extractf128_ps(r1, 1);
+    points[6] = _mm256_extractf128_ps(r2, 1);
+    points[7] = _mm256_extractf128_ps(r3, 1);
+}
+
+PS_INLINE Ps8f _ps_8f_select(Ps8f mask, Ps8f lhs, Ps8f rhs) {
+    return _mm256_blendv_ps(rhs, lhs, mask);
+}
+
+PS_INLINE Ps8f _ps_8f_sign(Ps8f v8f) {
+    return _mm256_and_ps(_mm256_set1_ps(-0.0f), v8f);
+}
+
+/*
+ * Same reduction and polynomials as ps_4f_sincos, with the quadrant kept
+ * in float so plain AVX is enough. Same error bounds: 1.6 ulp for |x| < 10
+ * and an absolute error under 1e-7 up to |x| = 8192.
+ */
+PS_INLINE void ps_8f_sincos(Ps8f v8f, Ps8f *sin_out, Ps8f *cos_out) {
+    const Ps8f x = ps_8f_abs(v8f);
+    Ps8f j = _mm256_floor_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.27323954473516f)));
+    // Round odd octants up, then q = (j / 2) mod 4 is the quadrant
+    j = _mm256_add_ps(j, _mm256_sub_ps(j, _mm256_mul_ps(_mm256_set1_ps(2.0f),
+                                                        _mm256_floor_ps(_mm256_mul_ps(j, _mm256_set1_ps(0.5f))))));
+    const Ps8f q = _mm256_sub_ps(_mm256_mul_ps(j, _mm256_set1_ps(0.5f)),
+                                 _mm256_mul_ps(_mm256_set1_ps(4.0f),
+                                               _mm256_floor_ps(_mm256_mul_ps(j, _mm256_set1_ps(0.125f)))));
+    const Ps8f swap = _mm256_cmp_ps(_mm256_sub_ps(q, _mm256_mul_ps(_mm256_set1_ps(2.0f),
+                                                                   _mm256_floor_ps(_mm256_mul_ps(q, _mm256_set1_ps(0.5f))))),
+                                    _mm256_set1_ps(1.0f), _CMP_EQ_OQ);
+    const Ps8f sin_sign = _mm256_xor_ps(_ps_8f_sign(v8f),
+                                        _mm256_and_ps(_mm256_set1_ps(-0.0f),
+                                                      _mm256_cmp_ps(q, _mm256_set1_ps(2.0f), _CMP_GE_OQ)));
+    const Ps8f cos_sign = _mm256_and_ps(_mm256_set1_ps(-0.0f),
+                                        _mm256_cmp_ps(ps_8f_abs(_mm256_sub_ps(q, _mm256_set1_ps(1.5f))),
+                                                      _mm256_set1_ps(1.0f), _CMP_LT_OQ));
+    Ps8f r = ps_8f_madd(j, _mm256_set1_ps(-0.78515625f), x);
+    r = ps_8f_madd(j, _mm256_set1_ps(-2.4187564849853515625e-4f), r);
+    r = ps_8f_madd(j, _mm256_set1_ps(-3.77489497744594108e-8f), r);
+    const Ps8f z = _mm256_mul_ps(r, r);
+    Ps8f ps = ps_8f_madd(_mm256_set1_ps(-1.9515295891e-4f), z, _mm256_set1_ps(8.3321608736e-3f));
+    ps = ps_8f_madd(ps, z, _mm256_set1_ps(-1.6666654611e-1f));
+    ps = ps_8f_madd(_mm256_mul_ps(ps, z), r, r);
+    Ps8f pc = ps_8f_madd(_mm256_set1_ps(2.443315711809948e-5f), z, _mm256_set1_ps(-1.388731625493765e-3f));
+    pc = ps_8f_madd(pc, z, _mm256_set1_ps(4.166664568298827e-2f));
+    pc = ps_8f_madd(_mm256_mul_ps(pc, z), z, ps_8f_madd(z, _mm256_set1_ps(-0.5f), _mm256_set1_ps(1.0f)));
+    *sin_out = _mm256_xor_ps(_ps_8f_select(swap, pc, ps), sin_sign);
+    *cos_out = _mm256_xor_ps(_ps_8f_select(swap, ps, pc), cos_sign);
+}
+
+PS_INLINE Ps8f ps_8f_sin(Ps8f v8f) {
+    Ps8f sin, cos;
+    ps_8f_sincos(v8f, &sin, &cos);
+    return sin;
+}
+
+PS_INLINE Ps8f ps_8f_cos(Ps8f v8f) {
+    Ps8f sin, cos;
+    ps_8f_sincos(v8f, &sin, &cos);
+    return cos;
+}
+
+/*
+ * See ps_4f_acos. Max error 1.3 ulp, NaN outside of [-1, 1].
+ */
+PS_INLINE Ps8f ps_8f_acos(Ps8f v8f) {
+    const Ps8f a = ps_8f_abs(v8f);
+    const Ps8f big = _mm256_cmp_ps(a, _mm256_set1_ps(0.5f), _CMP_GT_OQ);
+    const Ps8f z = _ps_8f_select(big, _mm256_mul_ps(_mm256_set1_ps(0.5f), _mm256_sub_ps(_mm256_set1_ps(1.0f), a)),
+                                 _mm256_mul_ps(a, a));
+    const Ps8f x = _ps_8f_select(big, _mm256_sqrt_ps(z), a);
+    Ps8f p = ps_8f_madd(_mm256_set1_ps(4.2163199048e-2f), z, _mm256_set1_ps(2.4181311049e-2f));
+    p = ps_8f_madd(p, z, _mm256_set1_ps(4.5470025998e-2f));
+    p = ps_8f_madd(p, z, _mm256_set1_ps(7.4953002686e-2f));
+    p = ps_8f_madd(p, z, _mm256_set1_ps(1.6666752422e-1f));
+    p = ps_8f_madd(_mm256_mul_ps(p, z), x, x);
+    const Ps8f twice = _mm256_add_ps(p, p);
+    const Ps8f far = _ps_8f_select(_mm256_cmp_ps(v8f, _mm256_setzero_ps(), _CMP_LT_OQ),
+                                   _mm256_sub_ps(_mm256_set1_ps(PS_MATH_PI), twice), twice);
+    const Ps8f near = _mm256_sub_ps(_mm256_set1_ps(PS_MATH_PI * 0.5f), _mm256_xor_ps(p, _ps_8f_sign(v8f)));
+    return _ps_8f_select(big, far, near);
+}
+
+/*
+ * See ps_4f_atan2. Max error 3.2 ulp; atan2(0, 0) is 0.
+ */
+PS_INLINE Ps8f ps_8f_atan2(Ps8f y, Ps8f x) {
+    const Ps8f ay = ps_8f_abs(y);
+    const Ps8f ax = ps_8f_abs(x);
+    const Ps8f hi = _mm256_max_ps(ax, ay);
+    const Ps8f a = _mm256_andnot_ps(_mm256_cmp_ps(hi, _mm256_setzero_ps(), _CMP_EQ_OQ),
+                                    _mm256_div_ps(_mm256_min_ps(ax, ay), hi));
+    const Ps8f reduce = _mm256_cmp_ps(a, _mm256_set1_ps(0.4142135623730950f), _CMP_GT_OQ);
+    const Ps8f t = _ps_8f_select(reduce, _mm256_div_ps(_mm256_sub_ps(a, _mm256_set1_ps(1.0f)),
+                                                       _mm256_add_ps(a, _mm256_set1_ps(1.0f))), a);
+    const Ps8f z = _mm256_mul_ps(t, t);
+    Ps8f r = ps_8f_madd(_mm256_set1_ps(8.05374449538e-2f), z, _mm256_set1_ps(-1.38776856032e-1f));
+    r = ps_8f_madd(r, z, _mm256_set1_ps(1.99777106478e-1f));
+    r = ps_8f_madd(r, z, _mm256_set1_ps(-3.33329491539e-1f));
+    r = ps_8f_madd(_mm256_mul_ps(r, z), t, t);
+    r = _mm256_add_ps(r, _mm256_and_ps(reduce, _mm256_set1_ps(PS_MATH_PI * 0.25f)));
+    r = _ps_8f_select(_mm256_cmp_ps(ay, ax, _CMP_GT_OQ), _mm256_sub_ps(_mm256_set1_ps(PS_MATH_PI * 0.5f), r), r);
+    r = _ps_8f_select(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ),
+                      _mm256_sub_ps(_mm256_set1_ps(PS_MATH_PI), r), r);
+    return _mm256_xor_ps(r, _ps_8f_sign(y));
+}
+
+PS_EXTERN_END
+
+#endif // PS_MATH_SIMD_8F_H_
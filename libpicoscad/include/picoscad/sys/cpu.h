@@ -0,0 +1,38 @@
+#ifndef PS_SYS_CPU_H_
+#define PS_SYS_CPU_H_
+
+#include <picoscad/porting.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * Instruction sets the hot kernels are built for, in increasing order
+ */
+typedef enum PsCpuIsa {
+    PS_CPU_ISA_GENERIC,
+    PS_CPU_ISA_AVX,
+    PS_CPU_ISA_AVX2,
+    PS_CPU_ISA_AVX512
+} PsCpuIsa;
+
+/**
+ * The best instruction set both the CPU and the OS support
+ */
+PsCpuIsa ps_cpu_detect_isa();
+
+/**
+ * The instruction set kernels dispatch to: the detected one, or the value of the
+ * PICOSCAD_ISA environment variable (generic, avx, avx2, avx512) if that is lower
+ */
+PsCpuIsa ps_cpu_get_isa();
+
+const char *ps_cpu_isa_name(PsCpuIsa isa);
+
+/**
+ * Online logical CPUs, at least 1
+ */
+size_t ps_cpu_count();
+
+PS_EXTERN_END
+
+#endif // PS_SYS_CPU_H_
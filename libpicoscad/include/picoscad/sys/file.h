@@ -0,0 +1,27 @@
+#ifndef PS_SYS_FILE_H_
+#define PS_SYS_FILE_H_
+
+#include <picoscad/porting.h>
+
+PS_EXTERN_BEGIN
+
+/**
+ * A read-only memory mapping of a whole file. Pages are loaded on first touch
+ * and shared with the page cache, so importers read straight from it instead
+ * of copying the file into a buffer first.
+ */
+typedef struct PsMappedFile {
+    const void *data;
+    size_t size;
+} PsMappedFile;
+
+/**
+ * Maps path read-only; empty files map to NULL with size 0. Sets errno and
+ * returns false on failure.
+ */
+bool ps_file_map(const char *path, PsMappedFile *file);
+void ps_file_unmap(PsMappedFile *file);
+
+PS_EXTERN_END
+
+#endif // PS_SYS_FILE_H_
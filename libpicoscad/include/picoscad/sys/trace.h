@@ -0,0 +1,82 @@
+#ifndef PS_SYS_TRACE_H_
+#define PS_SYS_TRACE_H_
+
+#include <stdio.h>
+
+#include <picoscad/porting.h>
+
+PS_EXTERN_BEGIN
+
+/*
+ * Trace zones, compiled in with PS_TRACE (the PICOSCAD_TRACE CMake option) and
+ * recorded only between ps_trace_start and ps_trace_stop. A stopped zone costs
+ * one relaxed load and a branch. Each thread records into its own ring of the
+ * latest PS_TRACE_RING_SIZE zones, which outlives the thread so it can still
+ * be exported. A thread started later takes over the ring of one that has
+ * exited, zones and name included, so the number of rings is bounded by the
+ * most threads alive at once.
+ *
+ *     PS_TRACE_BEGIN(zone, "clip/intersect");
+ *     ...
+ *     PS_TRACE_END(zone);
+ *
+ * Names are stored by pointer and must be string literals.
+ */
+
+#define PS_TRACE_RING_SIZE 16384
+
+typedef struct PsTraceZone {
+    const char *name;
+    uint64_t start;
+} PsTraceZone;
+
+void ps_trace_start();
+void ps_trace_stop();
+
+/**
+ * Names the calling thread in exported traces; name must outlive the trace.
+ * It may hold any text, the export escapes it.
+ */
+void ps_trace_thread_name(const char *name);
+
+/**
+ * Writes every recorded zone as Chrome trace event JSON, which chrome://tracing
+ * and Perfetto open. Zones recorded while writing may be torn, so stop first.
+ */
+bool ps_trace_write(FILE *file);
+
+#ifdef PS_TRACE
+
+#include <stdatomic.h>
+
+extern atomic_bool _ps_trace_enabled;
+
+uint64_t _ps_trace_now();
+void _ps_trace_record(const char *name, uint64_t start, uint64_t end);
+
+PS_INLINE PsTraceZone ps_trace_begin(const char *name) {
+    if (!atomic_load_explicit(&_ps_trace_enabled, memory_order_relaxed)) {
+        return (PsTraceZone) {NULL, 0};
+    }
+    return (PsTraceZone) {name, _ps_trace_now()};
+}
+
+PS_INLINE void ps_trace_end(PsTraceZone zone) {
+    if (zone.name) {
+        _ps_trace_record(zone.name, zone.start, _ps_trace_now());
+    }
+}
+
+#define PS_TRACE_BEGIN(zone, name) PsTraceZone zone = ps_trace_begin(name)
+#define PS_TRACE_END(zone) ps_trace_end(zone)
+
+#else
+
+#define PS_TRACE_BEGIN(zone, name) ((void) 0)
+#define PS_TRACE_END(zone) ((void) 0)
+
+#endif
+
+PS_EXTERN_END
+
+#endif // PS_SYS_TRACE_H_
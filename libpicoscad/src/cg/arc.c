@@ -0,0 +1,36 @@
+#include <picoscad/cg/arc.h>
+
+#include <math.h>
+
+#include "../kernel/kernels.h"
+
+static size_t arc_clamp_segments(double segments) {
+    if (!(segments >= 1.0)) {
+        return 1;
+    }
+    return segments > PS_ARC_MAX_SEGMENTS ? PS_ARC_MAX_SEGMENTS : (size_t) ceil(segments);
+}
+
+size_t ps_arc_segments(double radius, double sweep, double tolerance) {
+    // One chord per third of a turn at most, however loose the tolerance
+    const double max_angle = 6.283185307179586 / 3.0;
+    radius = fabs(radius);
+    if (!(tolerance < radius)) {
+        return arc_clamp_segments(fabs(sweep) / max_angle);
+    }
+    // A chord spanning angle a sits radius * (1 - cos(a / 2)) from the arc at its middle
+    const double angle = fmin(2.0 * acos(1.0 - tolerance / radius), max_angle);
+    return arc_clamp_segments(fabs(sweep) / angle);
+}
+
+void ps_ellipse_points4d(double cx, double cy, double rx, double ry, double rotation, double start, double step,
+                         size_t count, Ps4d *out) {
+    const double cos_rotation = cos(rotation), sin_rotation = sin(rotation);
+    const PsKernelEllipse ellipse = {
+            cx, cy,
+            rx * cos_rotation, rx * sin_rotation,
+            -ry * sin_rotation, ry * cos_rotation,
+            start, step
+    };
+    ps_kernels()->ellipse_points4d(&ellipse, count, out);
+}
@@ -0,0 +1,684 @@
+#include "graph.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <picoscad/data/hash.h>
+#include <picoscad/sys/trace.h>
+
+static bool csg_node_equals(const CsgNode *a, const CsgNode *b) {
+    if (a->hash != b->hash || a->kind != b->kind) {
+        return false;
+    }
+    switch (a->kind) {
+        case CSG_POLYGON:
+            return a->length == b->length && memcmp(a->points, b->points, sizeof(Ps4d) * a->length) == 0;
+        case CSG_TRANSFORM:
+            return a->lhs == b->lhs && memcmp(a->transform, b->transform, sizeof(PsMat4d)) == 0;
+        case CSG_OPERATION:
+            return a->operation == b->operation && a->lhs == b->lhs && a->rhs == b->rhs;
+        default:
+            return true;
+    }
+}
+
+static void csg_table_insert(PsCsg *csg, PsCsgNode index) {
+    const size_t mask = csg->table_size - 1;
+    size_t i = csg->nodes[index].hash & mask;
+    while (csg->table[i]) {
+        i = (i + 1) & mask;
+    }
+    csg->table[i] = index + 1;
+}
+
+// Returns the node equal to node, adding a copy of it when there is none
+static PsCsgNode csg_intern(PsCsg *csg, const CsgNode *node) {
+    const size_t mask = csg->table_size - 1;
+    for (size_t i = node->hash & mask; csg->table[i]; i = (i + 1) & mask) {
+        if (csg_node_equals(&csg->nodes[csg->table[i] - 1], node)) {
+            return csg->table[i] - 1;
+        }
+    }
+    if (csg->node_count == csg->node_capacity) {
+        csg->node_capacity *= 2;
+        csg->nodes = realloc(csg->nodes, sizeof(CsgNode) * csg->node_capacity);
+    }
+    CsgNode *copy = &csg->nodes[csg->node_count];
+    *copy = *node;
+    copy->evaluation = copy->visit = 0;
+    copy->clip_ns = 0;
+    if (node->kind == CSG_POLYGON) {
+        copy->points = aligned_alloc(_Alignof(Ps4d), sizeof(Ps4d) * node->length);
+        memcpy(copy->points, node->points, sizeof(Ps4d) * node->length);
+    } else if (node->kind == CSG_TRANSFORM) {
+        copy->transform = aligned_alloc(_Alignof(PsMat4d), sizeof(PsMat4d));
+        *copy->transform = *node->transform;
+    }
+    const PsCsgNode index = (PsCsgNode) csg->node_count++;
+    // Keep the table at most half full
+    if (csg->node_count * 2 > csg->table_size) {
+        free(csg->table);
+        csg->table_size *= 2;
+        csg->table = calloc(csg->table_size, sizeof(uint32_t));
+        for (size_t i = 0; i < csg->node_count; ++i) {
+            csg_table_insert(csg, (PsCsgNode) i);
+        }
+    } else {
+        csg_table_insert(csg, index);
+    }
+    return index;
+}
+
+PsCsg *ps_csg_new() {
+    PsCsg *csg = malloc(sizeof(PsCsg));
+    csg->node_capacity = 64;
+    csg->nodes = malloc(sizeof(CsgNode) * csg->node_capacity);
+    csg->node_count = 0;
+    csg->table_size = 128;
+    csg->table = calloc(csg->table_size, sizeof(uint32_t));
+    csg->evaluation = csg->visit = 0;
+    csg->cancelled = NULL;
+    csg->cancelled_userdata = NULL;
+    csg->stopped = false;
+    // Node 0 is the empty set
+    csg_intern(csg, &(CsgNode) {.hash = ps_hash64_combine(0, CSG_EMPTY), .kind = CSG_EMPTY});
+    return csg;
+}
+
+void ps_csg_free(PsCsg *csg) {
+    for (size_t i = 0; i < csg->node_count; ++i) {
+        free(csg->nodes[i].points);
+        free(csg->nodes[i].transform);
+    }
+    free(csg->nodes);
+    free(csg->table);
+    free(csg);
+}
+
+size_t ps_csg_get_node_count(const PsCsg *csg) {
+    return csg->node_count;
+}
+
+uint64_t ps_csg_get_hash(const PsCsg *csg, PsCsgNode node) {
+    return csg->nodes[node].hash;
+}
+
+PsCsgNode ps_csg_empty(PsCsg *csg) {
+    return 0;
+}
+
+PsCsgNode ps_csg_polygon(PsCsg *csg, const Ps4d *points, size_t length) {
+    if (length < 3) {
+        return ps_csg_empty(csg);
+    }
+    CsgNode node = {.kind = CSG_POLYGON, .points = (Ps4d *) points, .length = length};
+    node.hash = ps_hash64(points, sizeof(Ps4d) * length, CSG_POLYGON);
+    return csg_intern(csg, &node);
+}
+
+PsCsgNode ps_csg_transform(PsCsg *csg, const PsMat4d *m4d, PsCsgNode child) {
+    PsMat4d identity;
+    ps_mat4d_identity(&identity);
+    if (child == ps_csg_empty(csg) || memcmp(m4d, &identity, sizeof(PsMat4d)) == 0) {
+        return child;
+    }
+    // Nested transforms collapse into one, so translate(a) translate(b) x shares with translate(a + b) x
+    PsMat4d transform = *m4d;
+    if (csg->nodes[child].kind == CSG_TRANSFORM) {
+        ps_mat4d_mul(m4d, csg->nodes[child].transform, &transform);
+        child = csg->nodes[child].lhs;
+    }
+    CsgNode node = {.kind = CSG_TRANSFORM, .lhs = child, .transform = &transform};
+    node.hash = ps_hash64(&transform, sizeof(PsMat4d), ps_hash64_combine(csg->nodes[child].hash, CSG_TRANSFORM));
+    return csg_intern(csg, &node);
+}
+
+PsCsgNode ps_csg_operation(PsCsg *csg, PsGHOperation operation, PsCsgNode lhs, PsCsgNode rhs) {
+    const PsCsgNode empty = ps_csg_empty(csg);
+    switch (operation) {
+        case PS_GH_UNION:
+            if (lhs == empty || lhs == rhs) {
+                return rhs;
+            } else if (rhs == empty) {
+                return lhs;
+            }
+            break;
+        case PS_GH_DIFF:
+            if (lhs == empty || lhs == rhs) {
+                return empty;
+            } else if (rhs == empty) {
+                return lhs;
+            }
+            break;
+        case PS_GH_INTERSECT:
+            if (lhs == empty || rhs == empty) {
+                return empty;
+            } else if (lhs == rhs) {
+                return lhs;
+            }
+            break;
+    }
+    uint64_t hash = ps_hash64_combine(ps_hash64_combine(CSG_OPERATION, operation), csg->nodes[lhs].hash);
+    hash = ps_hash64_combine(hash, csg->nodes[rhs].hash);
+    return csg_intern(csg, &(CsgNode) {.hash = hash, .kind = CSG_OPERATION, .operation = operation, .lhs = lhs,
+                                       .rhs = rhs});
+}
+
+static PsCsgNode csg_fold_balanced(PsCsg *csg, PsGHOperation operation, const PsCsgNode *nodes, size_t count) {
+    if (count == 1) {
+        return nodes[0];
+    }
+    const size_t half = count / 2;
+    return ps_csg_operation(csg, operation, csg_fold_balanced(csg, operation, nodes, half),
+                            csg_fold_balanced(csg, operation, nodes + half, count - half));
+}
+
+PsCsgNode ps_csg_fold(PsCsg *csg, PsGHOperation operation, const PsCsgNode *nodes, size_t count) {
+    if (count == 0) {
+        return ps_csg_empty(csg);
+    } else if (operation == PS_GH_DIFF) {
+        // a - b - c is a - (b + c)
+        return count == 1 ? nodes[0] : ps_csg_operation(csg, PS_GH_DIFF, nodes[0],
+                                                        csg_fold_balanced(csg, PS_GH_UNION, nodes + 1, count - 1));
+    }
+    return csg_fold_balanced(csg, operation, nodes, count);
+}
+
+static void csg_cache_unlink(PsCsgCache *cache, CsgEntry *entry) {
+    *(entry->newer ? &entry->newer->older : &cache->newest) = entry->older;
+    *(entry->older ? &entry->older->newer : &cache->oldest) = entry->newer;
+}
+
+static void csg_cache_push(PsCsgCache *cache, CsgEntry *entry) {
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    *(cache->newest ? &cache->newest->newer : &cache->oldest) = entry;
+    cache->newest = entry;
+}
+
+CsgEntry *csg_cache_find(PsCsgCache *cache, uint64_t hash) {
+    for (CsgEntry *entry = cache->buckets[hash & (cache->bucket_count - 1)]; entry; entry = entry->chain) {
+        if (entry->hash == hash) {
+            csg_cache_unlink(cache, entry);
+            csg_cache_push(cache, entry);
+            cache->hits++;
+            return entry;
+        }
+    }
+    cache->misses++;
+    return NULL;
+}
+
+static void csg_cache_evict(PsCsgCache *cache) {
+    CsgEntry *entry = cache->oldest;
+    CsgEntry **link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link != entry) {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+    csg_cache_unlink(cache, entry);
+    cache->entry_count--;
+    cache->bytes -= entry->bytes;
+    cache->evictions++;
+    free(entry->points);
+    free(entry);
+}
+
+static bool csg_copy_point(Ps4d *point, void *userdata) {
+    Ps4d **out = userdata;
+    *(*out)++ = *point;
+    return false;
+}
+
+static size_t csg_point_count(PsArray OF(PsGHPolygon4d *) *polygons) {
+    size_t point_count = 0;
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        point_count += ps_ghpolygon4d_get_size(ps_array_get(polygons, i));
+    }
+    return point_count;
+}
+
+// Results bigger than the whole budget are not kept, anything else evicts the oldest until it fits
+void csg_cache_insert(PsCsgCache *cache, uint64_t hash, PsArray OF(PsGHPolygon4d *) *polygons) {
+    const size_t polygon_count = ps_array_get_length(polygons);
+    const size_t point_count = csg_point_count(polygons);
+    const size_t bytes = sizeof(CsgEntry) + sizeof(uint32_t) * polygon_count + sizeof(Ps4d) * point_count;
+    if (bytes > cache->budget) {
+        return;
+    }
+    CsgEntry *entry = malloc(sizeof(CsgEntry) + sizeof(uint32_t) * polygon_count);
+    entry->hash = hash;
+    entry->bytes = bytes;
+    entry->polygon_count = polygon_count;
+    entry->points = point_count ? aligned_alloc(_Alignof(Ps4d), sizeof(Ps4d) * point_count) : NULL;
+    Ps4d *out = entry->points;
+    for (size_t i = 0; i < polygon_count; ++i) {
+        PsGHPolygon4d *poly = ps_array_get(polygons, i);
+        entry->lengths[i] = (uint32_t) ps_ghpolygon4d_get_size(poly);
+        ps_ghpolygon4d_foreach(poly, csg_copy_point, &out);
+    }
+
+    if (cache->entry_count >= cache->bucket_count) {
+        const size_t bucket_count = cache->bucket_count * 2;
+        CsgEntry **buckets = calloc(bucket_count, sizeof(CsgEntry *));
+        for (CsgEntry *moved = cache->newest; moved; moved = moved->older) {
+            CsgEntry **bucket = &buckets[moved->hash & (bucket_count - 1)];
+            moved->chain = *bucket;
+            *bucket = moved;
+        }
+        free(cache->buckets);
+        cache->buckets = buckets;
+        cache->bucket_count = bucket_count;
+    }
+    CsgEntry **bucket = &cache->buckets[hash & (cache->bucket_count - 1)];
+    entry->chain = *bucket;
+    *bucket = entry;
+    csg_cache_push(cache, entry);
+    cache->entry_count++;
+    cache->bytes += bytes;
+    while (cache->bytes > cache->budget) {
+        csg_cache_evict(cache);
+    }
+}
+
+PsArray OF(PsGHPolygon4d *) *csg_cache_expand(const CsgEntry *entry) {
+    PsArray OF(PsGHPolygon4d *) *polygons = ps_array_new(entry->polygon_count);
+    Ps4d *points = entry->points;
+    for (size_t i = 0; i < entry->polygon_count; ++i) {
+        ps_array_add(polygons, ps_ghpolygon4d_new_with_points(points, entry->lengths[i]));
+        points += entry->lengths[i];
+    }
+    return polygons;
+}
+
+PsCsgCache *ps_csg_cache_new(size_t budget) {
+    PsCsgCache *cache = calloc(1, sizeof(PsCsgCache));
+    cache->bucket_count = 64;
+    cache->buckets = calloc(cache->bucket_count, sizeof(CsgEntry *));
+    cache->budget = budget;
+    return cache;
+}
+
+void ps_csg_cache_free(PsCsgCache *cache) {
+    while (cache->oldest) {
+        csg_cache_evict(cache);
+    }
+    free(cache->buckets);
+    free(cache);
+}
+
+void ps_csg_cache_get_stats(const PsCsgCache *cache, PsCsgCacheStats *stats) {
+    *stats = (PsCsgCacheStats) {cache->entry_count, cache->bytes, cache->budget, cache->hits, cache->misses,
+                                cache->evictions};
+}
+
+void ps_csg_cache_set_store(PsCsgCache *cache, const PsCsgStore *store) {
+    cache->store = store ? *store : (PsCsgStore) {0};
+}
+
+void csg_free_polygons(PsArray OF(PsGHPolygon4d *) *polygons) {
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        ps_ghpolygon4d_free(ps_array_get(polygons, i));
+    }
+    ps_array_free(polygons);
+}
+
+bool csg_transform_point(Ps4d *point, void *userdata) {
+    ps_mat4d_4d_mul(userdata, point, point);
+    return false;
+}
+
+typedef struct CsgArea {
+    double sum;
+    double first_x, first_y;
+    double x, y;
+    bool started;
+} CsgArea;
+
+static bool csg_add_area(Ps4d *point, void *userdata) {
+    CsgArea *area = userdata;
+    const double x = ps_4d_x(*point), y = ps_4d_y(*point);
+    if (area->started) {
+        area->sum += area->x * y - x * area->y;
+    } else {
+        area->first_x = x;
+        area->first_y = y;
+        area->started = true;
+    }
+    area->x = x;
+    area->y = y;
+    return false;
+}
+
+static double csg_area(PsGHPolygon4d *poly) {
+    CsgArea area = {0};
+    ps_ghpolygon4d_foreach(poly, csg_add_area, &area);
+    return fabs(area.sum + area.x * area.first_y - area.first_x * area.y);
+}
+
+typedef struct CsgBounds {
+    double min_x, min_y, max_x, max_y;
+} CsgBounds;
+
+static bool csg_add_bounds(Ps4d *point, void *userdata) {
+    CsgBounds *bounds = userdata;
+    const double x = ps_4d_x(*point), y = ps_4d_y(*point);
+    bounds->min_x = x < bounds->min_x ? x : bounds->min_x;
+    bounds->min_y = y < bounds->min_y ? y : bounds->min_y;
+    bounds->max_x = x > bounds->max_x ? x : bounds->max_x;
+    bounds->max_y = y > bounds->max_y ? y : bounds->max_y;
+    return false;
+}
+
+static CsgBounds csg_bounds(PsGHPolygon4d *poly) {
+    CsgBounds bounds = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+    ps_ghpolygon4d_foreach(poly, csg_add_bounds, &bounds);
+    return bounds;
+}
+
+// Polygons with disjoint boxes cannot touch, which spares a clip for most pairs in a model of many parts
+static bool csg_bounds_disjoint(const CsgBounds *a, const CsgBounds *b) {
+    return a->max_x < b->min_x || b->max_x < a->min_x || a->max_y < b->min_y || b->max_y < a->min_y;
+}
+
+static void csg_add_clip_stats(PsCsgStats *stats, const PsGHClipStats *clip_stats) {
+    stats->intersections += clip_stats->intersections;
+    stats->intersect_ns += clip_stats->intersect_ns;
+    stats->mark_ns += clip_stats->mark_ns;
+    stats->walk_ns += clip_stats->walk_ns;
+}
+
+// Merges clip into pieces: every piece it overlaps or holds is absorbed, pieces beside it are kept as they are
+static PsArray OF(PsGHPolygon4d *) *csg_union(PsArray OF(PsGHPolygon4d *) *pieces, PsGHPolygon4d *clip,
+                                              PsCsgStats *stats) {
+    PsGHPolygon4d *merged = clip;
+    CsgBounds merged_bounds = csg_bounds(merged);
+    PsArray OF(PsGHPolygon4d *) *next = ps_array_new(ps_array_get_length(pieces) + 1);
+    for (size_t i = 0; i < ps_array_get_length(pieces); ++i) {
+        PsGHPolygon4d *piece = ps_array_get(pieces, i);
+        const CsgBounds bounds = csg_bounds(piece);
+        if (csg_bounds_disjoint(&bounds, &merged_bounds)) {
+            ps_array_add(next, piece);
+            continue;
+        }
+        PsGHPolygon4d *merged_copy = ps_ghpolygon4d_dup(merged);
+        PsGHClipStats clip_stats;
+        PsArray OF(PsGHPolygon4d *) *loops = ps_ghpolygon4d_clip(piece, merged_copy, PS_GH_UNION, &clip_stats);
+        ps_ghpolygon4d_free(merged_copy);
+        stats->clips++;
+        csg_add_clip_stats(stats, &clip_stats);
+        if (clip_stats.intersections == 0 && ps_array_get_length(loops) == 2) {
+            // Side by side; without intersections the clipper left piece as it was
+            ps_array_add(next, piece);
+            csg_free_polygons(loops);
+            continue;
+        }
+        // The largest loop is the outline, any others are holes the union closed
+        size_t largest = 0;
+        double largest_area = -1.0;
+        for (size_t j = 0; j < ps_array_get_length(loops); ++j) {
+            const double area = csg_area(ps_array_get(loops, j));
+            if (area > largest_area) {
+                largest = j;
+                largest_area = area;
+            }
+        }
+        ps_ghpolygon4d_free(merged);
+        merged = ps_array_remove(loops, largest);
+        for (size_t j = 0; j < ps_array_get_length(loops); ++j) {
+            // Slit into the outline like a difference would, so the piece stays one solid region
+            PsGHPolygon4d *hole = ps_array_get(loops, j);
+            PsGHPolygon4d *outline = ps_ghpolygon4d_dup(merged);
+            PsArray OF(PsGHPolygon4d *) *keyholed = ps_ghpolygon4d_clip(outline, hole, PS_GH_DIFF, &clip_stats);
+            ps_ghpolygon4d_free(outline);
+            stats->clips++;
+            csg_add_clip_stats(stats, &clip_stats);
+            if (ps_array_get_length(keyholed) == 1) {
+                ps_ghpolygon4d_free(merged);
+                merged = ps_array_remove(keyholed, 0);
+            }
+            csg_free_polygons(keyholed);
+            ps_ghpolygon4d_free(hole);
+        }
+        merged_bounds = csg_bounds(merged);
+        ps_array_free(loops);
+        ps_ghpolygon4d_free(piece);
+    }
+    ps_array_add(next, merged);
+    ps_array_free(pieces);
+    return next;
+}
+
+// Clips every piece against clip, consuming both
+static PsArray OF(PsGHPolygon4d *) *csg_cut(PsArray OF(PsGHPolygon4d *) *pieces, PsGHPolygon4d *clip,
+                                            PsGHOperation operation, PsCsgStats *stats) {
+    const CsgBounds clip_bounds = csg_bounds(clip);
+    PsArray OF(PsGHPolygon4d *) *next = ps_array_new(ps_array_get_length(pieces) + 1);
+    for (size_t i = 0; i < ps_array_get_length(pieces); ++i) {
+        PsGHPolygon4d *piece = ps_array_get(pieces, i);
+        const CsgBounds bounds = csg_bounds(piece);
+        if (csg_bounds_disjoint(&bounds, &clip_bounds)) {
+            // Nothing to take away, or nothing in common
+            if (operation == PS_GH_DIFF) {
+                ps_array_add(next, piece);
+            } else {
+                ps_ghpolygon4d_free(piece);
+            }
+            continue;
+        }
+        // The clipper inserts its intersections into clip, so each piece gets a copy
+        PsGHPolygon4d *clip_copy = ps_ghpolygon4d_dup(clip);
+        PsGHClipStats clip_stats;
+        PsArray OF(PsGHPolygon4d *) *clipped = ps_ghpolygon4d_clip(piece, clip_copy, operation, &clip_stats);
+        for (size_t j = 0; j < ps_array_get_length(clipped); ++j) {
+            ps_array_add(next, ps_array_get(clipped, j));
+        }
+        ps_array_free(clipped);
+        ps_ghpolygon4d_free(clip_copy);
+        ps_ghpolygon4d_free(piece);
+        stats->clips++;
+        csg_add_clip_stats(stats, &clip_stats);
+    }
+    ps_ghpolygon4d_free(clip);
+    ps_array_free(pieces);
+    return next;
+}
+
+PsArray OF(PsGHPolygon4d *) *csg_dup_polygons(PsArray OF(PsGHPolygon4d *) *polygons) {
+    PsArray OF(PsGHPolygon4d *) *copy = ps_array_new(ps_array_get_length(polygons) + 1);
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        ps_array_add(copy, ps_ghpolygon4d_dup(ps_array_get(polygons, i)));
+    }
+    return copy;
+}
+
+// Folds every polygon of rhs into lhs, consuming both
+PsArray OF(PsGHPolygon4d *) *csg_clip(PsArray OF(PsGHPolygon4d *) *lhs, PsArray OF(PsGHPolygon4d *) *rhs,
+                                      PsGHOperation operation, PsCsgStats *stats) {
+    const size_t count = ps_array_get_length(rhs);
+    PsArray OF(PsGHPolygon4d *) *result = lhs;
+    if (operation == PS_GH_INTERSECT && count == 0) {
+        // Nothing meets a subtree that evaluated to nothing
+        csg_free_polygons(lhs);
+        ps_array_free(rhs);
+        return ps_array_new(1);
+    } else if (operation == PS_GH_INTERSECT && count > 1) {
+        // The pieces of rhs are disjoint, so lhs meets their union in the union of what it meets of each
+        result = ps_array_new(ps_array_get_length(lhs) + 1);
+        for (size_t i = 0; i < count; ++i) {
+            PsArray OF(PsGHPolygon4d *) *part = csg_cut(i + 1 < count ? csg_dup_polygons(lhs) : lhs,
+                                                        ps_array_get(rhs, i), operation, stats);
+            for (size_t j = 0; j < ps_array_get_length(part); ++j) {
+                ps_array_add(result, ps_array_get(part, j));
+            }
+            ps_array_free(part);
+        }
+        ps_array_free(rhs);
+        return result;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        PsGHPolygon4d *clip = ps_array_get(rhs, i);
+        result = operation == PS_GH_UNION ? csg_union(result, clip, stats) : csg_cut(result, clip, operation, stats);
+    }
+    ps_array_free(rhs);
+    return result;
+}
+
+uint64_t csg_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+// Without a cache a shared node is clipped once per use, and each one counts
+void csg_record_clip(PsCsg *csg, PsCsgNode node, uint64_t ns) {
+    CsgNode *clipped = &csg->nodes[node];
+    clipped->clip_ns = clipped->evaluation == csg->evaluation ? clipped->clip_ns + ns : ns;
+    clipped->evaluation = csg->evaluation;
+}
+
+/*
+ * A result goes to the store once the clipping it saves, its own and that of
+ * descendants not stored either, outweighs storing it, and the root always
+ * does so an unchanged model loads in one go. Writes then never cost more than
+ * the work they save, and a chain of cheap unions stores every few links
+ * instead of a file per link, each bigger than the last.
+ */
+bool csg_worth_storing(PsArray OF(PsGHPolygon4d *) *result, uint64_t unsaved_ns) {
+    const size_t bytes = sizeof(Ps4d) * csg_point_count(result) + sizeof(uint32_t) * ps_array_get_length(result);
+    return unsaved_ns >= CSG_STORE_FIXED_NS + bytes / CSG_STORE_BYTES_PER_NS;
+}
+
+void ps_csg_set_cancel(PsCsg *csg, bool (*cancelled)(void *userdata), void *userdata) {
+    csg->cancelled = cancelled;
+    csg->cancelled_userdata = userdata;
+}
+
+bool csg_cancelled(PsCsg *csg) {
+    return csg->cancelled && csg->cancelled(csg->cancelled_userdata);
+}
+
+// Once cancelled, operations come out empty without being clipped or cached
+static bool csg_stop(PsCsg *csg) {
+    csg->stopped = csg->stopped || csg_cancelled(csg);
+    return csg->stopped;
+}
+
+// unsaved_ns is the clipping time a store would have saved evaluating node
+static PsArray OF(PsGHPolygon4d *) *csg_evaluate(PsCsg *csg, PsCsgNode index, PsCsgNode root, PsCsgCache *cache,
+                                                 PsCsgStats *stats, uint64_t *unsaved_ns) {
+    const CsgNode *node = &csg->nodes[index];
+    *unsaved_ns = 0;
+    PsArray OF(PsGHPolygon4d *) *result;
+    switch (node->kind) {
+        case CSG_POLYGON:
+            result = ps_array_new(1);
+            ps_array_add(result, ps_ghpolygon4d_new_with_points(node->points, node->length));
+            return result;
+        case CSG_TRANSFORM:
+            result = csg_evaluate(csg, node->lhs, root, cache, stats, unsaved_ns);
+            for (size_t i = 0; i < ps_array_get_length(result); ++i) {
+                ps_ghpolygon4d_foreach(ps_array_get(result, i), csg_transform_point, node->transform);
+            }
+            return result;
+        case CSG_OPERATION: {
+            if (csg_stop(csg)) {
+                return ps_array_new(1);
+            }
+            // Leaves and transforms are plain copies, only operations are worth keeping
+            const CsgEntry *entry = cache ? csg_cache_find(cache, node->hash) : NULL;
+            if (entry) {
+                stats->reused++;
+                return csg_cache_expand(entry);
+            }
+            const uint64_t key = ps_hash64_combine(node->hash, CSG_RESULT_VERSION);
+            if (cache && cache->store.load && (result = cache->store.load(cache->store.userdata, key))) {
+                stats->loaded++;
+                csg_cache_insert(cache, node->hash, result);
+                return result;
+            }
+            uint64_t lhs_ns, rhs_ns;
+            PsArray OF(PsGHPolygon4d *) *lhs = csg_evaluate(csg, node->lhs, root, cache, stats, &lhs_ns);
+            PsArray OF(PsGHPolygon4d *) *rhs = csg_evaluate(csg, node->rhs, root, cache, stats, &rhs_ns);
+            if (csg_stop(csg)) {
+                csg_free_polygons(lhs);
+                csg_free_polygons(rhs);
+                return ps_array_new(1);
+            }
+            const uint64_t start = csg_now();
+            result = csg_clip(lhs, rhs, node->operation, stats);
+            const uint64_t clip_ns = csg_now() - start;
+            csg_record_clip(csg, index, clip_ns);
+            *unsaved_ns = lhs_ns + rhs_ns + clip_ns;
+            stats->evaluated++;
+            if (cache) {
+                csg_cache_insert(cache, node->hash, result);
+                if (cache->store.store && (index == root || csg_worth_storing(result, *unsaved_ns))) {
+                    cache->store.store(cache->store.userdata, key, result);
+                    *unsaved_ns = 0;
+                }
+            }
+            return result;
+        }
+        default:
+            return ps_array_new(1);
+    }
+}
+
+PsArray OF(PsGHPolygon4d *) *ps_csg_evaluate(PsCsg *csg, PsCsgNode node, PsCsgCache *cache, PsCsgStats *stats) {
+    PS_TRACE_BEGIN(zone, "csg/evaluate");
+    PsCsgStats local_stats;
+    stats = stats ? stats : &local_stats;
+    *stats = (PsCsgStats) {0};
+    csg->evaluation++;
+    csg->stopped = false;
+    uint64_t unsaved_ns;
+    PsArray OF(PsGHPolygon4d *) *result = csg_evaluate(csg, node, node, cache, stats, &unsaved_ns);
+    if (csg->stopped) {
+        csg_free_polygons(result);
+        result = NULL;
+    }
+    PS_TRACE_END(zone);
+    return result;
+}
+
+/*
+ * An operation the last evaluation didn't clip came from a cache, and nothing
+ * under it was evaluated, so the walk only goes where something was.
+ */
+size_t ps_csg_count_rebuilt(PsCsg *csg, PsCsgNode node, uint64_t *ns) {
+    const uint32_t visit = ++csg->visit;
+    size_t count = 0, stack_length = 0, stack_capacity = 64;
+    uint64_t total_ns = 0;
+    PsCsgNode *stack = malloc(sizeof(PsCsgNode) * stack_capacity);
+    stack[stack_length++] = node;
+    while (stack_length > 0) {
+        CsgNode *current = &csg->nodes[stack[--stack_length]];
+        if (current->visit == visit) {
+            continue;
+        }
+        current->visit = visit;
+        if (current->kind == CSG_OPERATION) {
+            if (current->evaluation != csg->evaluation) {
+                continue;
+            }
+            count++;
+            total_ns += current->clip_ns;
+        }
+        if (stack_length + 2 > stack_capacity) {
+            stack_capacity *= 2;
+            stack = realloc(stack, sizeof(PsCsgNode) * stack_capacity);
+        }
+        if (current->kind == CSG_OPERATION || current->kind == CSG_TRANSFORM) {
+            stack[stack_length++] = current->lhs;
+        }
+        if (current->kind == CSG_OPERATION) {
+            stack[stack_length++] = current->rhs;
+        }
+    }
+    free(stack);
+    if (ns) {
+        *ns = total_ns;
+    }
+    return count;
+}
@@ -0,0 +1,28 @@
+#include <picoscad/cg/ghclipping4d.h>
+#include <picoscad/sys/trace.h>
+
+#include <time.h>
+
+#include "../kernel/kernels.h"
+
+#define GH_POLYGON PsGHPolygon4d
+#define GH_POINT Ps4d
+#define GH_SCALAR double
+#define GH_HIT PsKernelHit4d
+#define GH_FUNCTION(name) ps_ghpolygon4d_##name
+#define GH_TRACE_NAME(phase) "clip4d/" phase
+#define GH_X ps_4d_x
+#define GH_Y ps_4d_y
+#define GH_ADD ps_4d_add
+#define GH_SUB ps_4d_sub
+#define GH_MUL ps_4d_mul
+#define GH_SPLAT ps_4d_splat
+#define GH_CONTAINS(kernels, points, length, point) (kernels)->polygon4d_contains(points, length, point)
+#define GH_SEGMENT_INTERSECTIONS(kernels, p1, p2, points, length, hits) \
+    (kernels)->segment4d_intersections(p1, p2, points, length, hits)
+
+#include "ghclipping.inc"
+
+void ps_ghpolygon4d_add(PsGHPolygon4d *poly, const Ps4d *point) {
+    ghpolygon_push(poly, *point);
+}
@@ -0,0 +1,128 @@
+#ifndef PS_CG_GRAPH_H_
+#define PS_CG_GRAPH_H_
+
+#include <picoscad/cg/csg.h>
+
+/*
+ * What the sequential evaluator in csg.c and the parallel one in parallel.c
+ * share: the graph, the cache, and the steps of evaluating a node.
+ */
+
+// Mixed into the keys results are stored under; bump it whenever evaluation changes what a node produces
+#define CSG_RESULT_VERSION 1
+
+// Rough cost of storing a result: a file created and renamed, then its bytes written
+#define CSG_STORE_FIXED_NS 50000
+#define CSG_STORE_BYTES_PER_NS 1
+
+typedef enum CsgKind {
+    CSG_EMPTY,
+    CSG_POLYGON,
+    CSG_TRANSFORM,
+    CSG_OPERATION
+} CsgKind;
+
+typedef struct CsgNode {
+    uint64_t hash;
+    CsgKind kind;
+    PsGHOperation operation;
+    PsCsgNode lhs;
+    PsCsgNode rhs;
+    // Owned by the node once interned, from aligned_alloc
+    Ps4d *points;
+    size_t length;
+    PsMat4d *transform;
+    // Time spent clipping the node in evaluation number evaluation, see csg_record_clip
+    uint32_t evaluation;
+    uint64_t clip_ns;
+    // Marks nodes already counted by ps_csg_count_rebuilt
+    uint32_t visit;
+} CsgNode;
+
+struct PsCsg {
+    CsgNode *nodes;
+    size_t node_count;
+    size_t node_capacity;
+    // Bumped by every evaluation, so clip times left by earlier ones read as nothing
+    uint32_t evaluation;
+    uint32_t visit;
+    // See ps_csg_set_cancel; stopped is set once the sequential evaluator sees it return true
+    bool (*cancelled)(void *userdata);
+    void *cancelled_userdata;
+    bool stopped;
+    // Open addressing on the node hash, a slot holds node index + 1
+    uint32_t *table;
+    size_t table_size;
+};
+
+typedef struct CsgEntry CsgEntry;
+
+// One evaluated result, flattened: polygon i is lengths[i] points, back to back in points
+struct CsgEntry {
+    uint64_t hash;
+    CsgEntry *chain;
+    CsgEntry *newer;
+    CsgEntry *older;
+    size_t bytes;
+    Ps4d *points;
+    size_t polygon_count;
+    uint32_t lengths[];
+};
+
+struct PsCsgCache {
+    CsgEntry **buckets;
+    size_t bucket_count;
+    CsgEntry *newest;
+    CsgEntry *oldest;
+    size_t entry_count;
+    size_t bytes;
+    size_t budget;
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    PsCsgStore store;
+};
+
+CsgEntry *csg_cache_find(PsCsgCache *cache, uint64_t hash);
+
+/**
+ * Copies polygons into the cache, evicting the oldest results to stay in budget
+ */
+void csg_cache_insert(PsCsgCache *cache, uint64_t hash, PsArray OF(PsGHPolygon4d *) *polygons);
+PsArray OF(PsGHPolygon4d *) *csg_cache_expand(const CsgEntry *entry);
+
+void csg_free_polygons(PsArray OF(PsGHPolygon4d *) *polygons);
+PsArray OF(PsGHPolygon4d *) *csg_dup_polygons(PsArray OF(PsGHPolygon4d *) *polygons);
+
+/**
+ * A ps_ghpolygon4d_foreach callback, userdata is the PsMat4d
+ */
+bool csg_transform_point(Ps4d *point, void *userdata);
+
+/**
+ * Folds every polygon of rhs into lhs with operation, consuming both
+ */
+PsArray OF(PsGHPolygon4d *) *csg_clip(PsArray OF(PsGHPolygon4d *) *lhs, PsArray OF(PsGHPolygon4d *) *rhs,
+                                      PsGHOperation operation, PsCsgStats *stats);
+
+/**
+ * Monotonic nanoseconds
+ */
+uint64_t csg_now();
+
+/**
+ * Notes that the current evaluation spent ns clipping node
+ */
+void csg_record_clip(PsCsg *csg, PsCsgNode node, uint64_t ns);
+
+/**
+ * Asks the callback set by ps_csg_set_cancel, false without one
+ */
+bool csg_cancelled(PsCsg *csg);
+
+/**
+ * True once the clipping a result saves outweighs the cost of storing it
+ */
+bool csg_worth_storing(PsArray OF(PsGHPolygon4d *) *result, uint64_t unsaved_ns);
+
+#endif // PS_CG_GRAPH_H_
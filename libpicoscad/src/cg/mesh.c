@@ -0,0 +1,22 @@
+#include <picoscad/cg/mesh.h>
+
+#include <stdlib.h>
+
+PsMesh *ps_mesh_new() {
+    return ps_mesh_new_with_arrays(NULL, 0, NULL, 0);
+}
+
+PsMesh *ps_mesh_new_with_arrays(Ps4f *vertices, size_t vertex_count, uint32_t *indices, size_t triangle_count) {
+    PsMesh *mesh = malloc(sizeof(PsMesh));
+    mesh->vertices = vertices;
+    mesh->indices = indices;
+    mesh->vertex_count = vertex_count;
+    mesh->triangle_count = triangle_count;
+    return mesh;
+}
+
+void ps_mesh_free(PsMesh *mesh) {
+    free(mesh->vertices);
+    free(mesh->indices);
+    free(mesh);
+}
@@ -0,0 +1,436 @@
+#include "graph.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include <picoscad/data/hash.h>
+#include <picoscad/sys/cpu.h>
+#include <picoscad/sys/trace.h>
+
+/*
+ * The graph is planned up front: every node reachable from the root that the
+ * cache can't answer becomes a task, counting the inputs it still waits for
+ * and listing the tasks that wait for it. Tasks with nothing to wait for,
+ * leaves and cached results, are handed out in the order the sequential
+ * evaluator reaches them. A finished task gives its result to each waiting
+ * task (copies to all but the last) and pushes the ones it made ready onto
+ * its worker's deque; the worker takes them back newest first, idle workers
+ * steal them oldest first.
+ */
+
+// Default cap on results waiting for a sibling, per thread
+#define PARALLEL_LIVE_PER_THREAD 4
+
+typedef struct ParallelTask {
+    PsCsgNode node;
+    atomic_uint pending;
+    // Clipping time of inputs nobody stored, see csg_worth_storing
+    _Atomic uint64_t unsaved_ns;
+    PsArray OF(PsGHPolygon4d *) *inputs[2];
+    // Set when planning found the result in the cache
+    PsArray OF(PsGHPolygon4d *) *result;
+    // The tasks waiting for this one, in links
+    uint32_t first_link;
+    uint32_t link_count;
+} ParallelTask;
+
+typedef struct ParallelLink {
+    uint32_t child;
+    uint32_t parent;
+    // Which input of parent the child's result goes to
+    uint32_t slot;
+} ParallelLink;
+
+typedef struct ParallelDeque {
+    pthread_mutex_t lock;
+    uint32_t *tasks;
+    // Thieves take from head, the owner pushes and pops at tail
+    size_t head;
+    size_t tail;
+    size_t capacity;
+} ParallelDeque;
+
+typedef struct Parallel Parallel;
+
+typedef struct ParallelWorker {
+    Parallel *parallel;
+    size_t index;
+    ParallelDeque deque;
+    PsCsgStats stats;
+    pthread_t thread;
+} ParallelWorker;
+
+struct Parallel {
+    PsCsg *csg;
+    PsCsgNode root;
+    PsCsgCache *cache;
+    pthread_mutex_t cache_lock;
+    PsCsgStats plan_stats;
+
+    ParallelTask *tasks;
+    size_t task_count;
+    size_t task_capacity;
+    // Task index + 1 of each planned node, 0 for the rest
+    uint32_t *node_tasks;
+    ParallelLink *links;
+    size_t link_count;
+    size_t link_capacity;
+    uint32_t *ready;
+    size_t ready_count;
+    size_t ready_capacity;
+
+    ParallelWorker *workers;
+    size_t worker_count;
+    size_t max_live;
+    // Results handed to a task that hasn't run yet
+    atomic_size_t live;
+    atomic_size_t running;
+    // Bumped whenever there may be something new to do, so idle workers don't miss it
+    atomic_uint epoch;
+    atomic_size_t idle;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    // Under lock
+    size_t next_ready;
+    bool done;
+    // Set once the graph's cancel callback returned true, the remaining tasks then drain without clipping
+    atomic_bool stopped;
+
+    PsArray OF(PsGHPolygon4d *) *output;
+};
+
+static void parallel_add_ready(Parallel *parallel, uint32_t task) {
+    if (parallel->ready_count == parallel->ready_capacity) {
+        parallel->ready_capacity = parallel->ready_capacity ? parallel->ready_capacity * 2 : 64;
+        parallel->ready = realloc(parallel->ready, sizeof(uint32_t) * parallel->ready_capacity);
+    }
+    parallel->ready[parallel->ready_count++] = task;
+}
+
+static void parallel_add_link(Parallel *parallel, uint32_t child, uint32_t parent, uint32_t slot) {
+    if (parallel->link_count == parallel->link_capacity) {
+        parallel->link_capacity = parallel->link_capacity ? parallel->link_capacity * 2 : 64;
+        parallel->links = realloc(parallel->links, sizeof(ParallelLink) * parallel->link_capacity);
+    }
+    parallel->links[parallel->link_count++] = (ParallelLink) {child, parent, slot};
+}
+
+// Looks the node up in the cache as the sequential evaluator would, and plans what it has to compute
+static uint32_t parallel_plan(Parallel *parallel, PsCsgNode index) {
+    if (parallel->node_tasks[index]) {
+        return parallel->node_tasks[index] - 1;
+    }
+    if (parallel->task_count == parallel->task_capacity) {
+        parallel->task_capacity = parallel->task_capacity ? parallel->task_capacity * 2 : 64;
+        parallel->tasks = realloc(parallel->tasks, sizeof(ParallelTask) * parallel->task_capacity);
+    }
+    const uint32_t task = (uint32_t) parallel->task_count++;
+    parallel->node_tasks[index] = task + 1;
+    ParallelTask *planned = &parallel->tasks[task];
+    planned->node = index;
+    planned->inputs[0] = planned->inputs[1] = NULL;
+    planned->result = NULL;
+    atomic_init(&planned->unsaved_ns, 0);
+
+    const CsgNode *node = &parallel->csg->nodes[index];
+    PsCsgCache *cache = parallel->cache;
+    PsArray OF(PsGHPolygon4d *) *result = NULL;
+    if (node->kind == CSG_OPERATION && cache) {
+        const CsgEntry *entry = csg_cache_find(cache, node->hash);
+        const uint64_t key = ps_hash64_combine(node->hash, CSG_RESULT_VERSION);
+        if (entry) {
+            result = csg_cache_expand(entry);
+            parallel->plan_stats.reused++;
+        } else if (cache->store.load && (result = cache->store.load(cache->store.userdata, key))) {
+            parallel->plan_stats.loaded++;
+            csg_cache_insert(cache, node->hash, result);
+        }
+    }
+    if (result || (node->kind != CSG_TRANSFORM && node->kind != CSG_OPERATION)) {
+        parallel->tasks[task].result = result;
+        atomic_init(&parallel->tasks[task].pending, 0);
+        parallel_add_ready(parallel, task);
+        return task;
+    }
+    // Planning the children may move tasks
+    atomic_init(&planned->pending, node->kind == CSG_OPERATION ? 2 : 1);
+    const PsCsgNode lhs = node->lhs, rhs = node->rhs;
+    const CsgKind kind = node->kind;
+    parallel_add_link(parallel, parallel_plan(parallel, lhs), task, 0);
+    if (kind == CSG_OPERATION) {
+        parallel_add_link(parallel, parallel_plan(parallel, rhs), task, 1);
+    }
+    return task;
+}
+
+// Groups the links by child, so each task finds the tasks waiting for it
+static void parallel_index_links(Parallel *parallel) {
+    for (size_t i = 0; i < parallel->task_count; ++i) {
+        parallel->tasks[i].link_count = 0;
+    }
+    for (size_t i = 0; i < parallel->link_count; ++i) {
+        parallel->tasks[parallel->links[i].child].link_count++;
+    }
+    uint32_t first = 0;
+    for (size_t i = 0; i < parallel->task_count; ++i) {
+        parallel->tasks[i].first_link = first;
+        first += parallel->tasks[i].link_count;
+        parallel->tasks[i].link_count = 0;
+    }
+    ParallelLink *sorted = malloc(sizeof(ParallelLink) * (parallel->link_count ? parallel->link_count : 1));
+    for (size_t i = 0; i < parallel->link_count; ++i) {
+        ParallelTask *child = &parallel->tasks[parallel->links[i].child];
+        sorted[child->first_link + child->link_count++] = parallel->links[i];
+    }
+    free(parallel->links);
+    parallel->links = sorted;
+}
+
+static void parallel_deque_push(ParallelDeque *deque, uint32_t task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->capacity) {
+        deque->capacity = deque->capacity ? deque->capacity * 2 : 16;
+        deque->tasks = realloc(deque->tasks, sizeof(uint32_t) * deque->capacity);
+    }
+    deque->tasks[deque->tail++] = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static bool parallel_deque_pop(ParallelDeque *deque, uint32_t *task) {
+    pthread_mutex_lock(&deque->lock);
+    const bool found = deque->tail > deque->head;
+    if (found) {
+        *task = deque->tasks[--deque->tail];
+        if (deque->tail == deque->head) {
+            deque->head = deque->tail = 0;
+        }
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool parallel_deque_steal(ParallelDeque *deque, uint32_t *task) {
+    pthread_mutex_lock(&deque->lock);
+    const bool found = deque->tail > deque->head;
+    if (found) {
+        *task = deque->tasks[deque->head++];
+        if (deque->head == deque->tail) {
+            deque->head = deque->tail = 0;
+        }
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static void parallel_notify(Parallel *parallel) {
+    atomic_fetch_add(&parallel->epoch, 1);
+    if (atomic_load(&parallel->idle) > 0) {
+        pthread_mutex_lock(&parallel->lock);
+        pthread_cond_broadcast(&parallel->wake);
+        pthread_mutex_unlock(&parallel->lock);
+    }
+}
+
+static void parallel_deliver(ParallelWorker *worker, ParallelTask *task, PsArray OF(PsGHPolygon4d *) *result,
+                             uint64_t unsaved_ns) {
+    Parallel *parallel = worker->parallel;
+    if (task->link_count == 0) {
+        pthread_mutex_lock(&parallel->lock);
+        parallel->output = result;
+        parallel->done = true;
+        pthread_cond_broadcast(&parallel->wake);
+        pthread_mutex_unlock(&parallel->lock);
+        return;
+    }
+    bool pushed = false;
+    for (uint32_t i = 0; i < task->link_count; ++i) {
+        const ParallelLink *link = &parallel->links[task->first_link + i];
+        ParallelTask *parent = &parallel->tasks[link->parent];
+        parent->inputs[link->slot] = i + 1 < task->link_count ? csg_dup_polygons(result) : result;
+        atomic_fetch_add(&parent->unsaved_ns, unsaved_ns);
+        atomic_fetch_add(&parallel->live, 1);
+        if (atomic_fetch_sub(&parent->pending, 1) == 1) {
+            parallel_deque_push(&worker->deque, link->parent);
+            pushed = true;
+        }
+    }
+    if (pushed) {
+        parallel_notify(parallel);
+    }
+}
+
+static bool parallel_stop(Parallel *parallel) {
+    if (!atomic_load(&parallel->stopped) && csg_cancelled(parallel->csg)) {
+        atomic_store(&parallel->stopped, true);
+    }
+    return atomic_load(&parallel->stopped);
+}
+
+static void parallel_run(ParallelWorker *worker, uint32_t index) {
+    Parallel *parallel = worker->parallel;
+    ParallelTask *task = &parallel->tasks[index];
+    const CsgNode *node = &parallel->csg->nodes[task->node];
+    PsArray OF(PsGHPolygon4d *) *result = task->result;
+    uint64_t unsaved_ns = atomic_load(&task->unsaved_ns);
+    if (result) {
+        unsaved_ns = 0;
+    } else if (node->kind == CSG_POLYGON) {
+        result = ps_array_new(1);
+        ps_array_add(result, ps_ghpolygon4d_new_with_points(node->points, node->length));
+    } else if (node->kind == CSG_TRANSFORM) {
+        result = task->inputs[0];
+        atomic_fetch_sub(&parallel->live, 1);
+        for (size_t i = 0; i < ps_array_get_length(result); ++i) {
+            ps_ghpolygon4d_foreach(ps_array_get(result, i), csg_transform_point, node->transform);
+        }
+    } else if (node->kind == CSG_OPERATION && parallel_stop(parallel)) {
+        atomic_fetch_sub(&parallel->live, 2);
+        csg_free_polygons(task->inputs[0]);
+        csg_free_polygons(task->inputs[1]);
+        result = ps_array_new(1);
+    } else if (node->kind == CSG_OPERATION) {
+        atomic_fetch_sub(&parallel->live, 2);
+        const uint64_t start = csg_now();
+        result = csg_clip(task->inputs[0], task->inputs[1], node->operation, &worker->stats);
+        // Each node is one task, nobody else writes its timing
+        const uint64_t clip_ns = csg_now() - start;
+        csg_record_clip(parallel->csg, task->node, clip_ns);
+        unsaved_ns += clip_ns;
+        worker->stats.evaluated++;
+        PsCsgCache *cache = parallel->cache;
+        if (cache) {
+            pthread_mutex_lock(&parallel->cache_lock);
+            csg_cache_insert(cache, node->hash, result);
+            pthread_mutex_unlock(&parallel->cache_lock);
+            if (cache->store.store && (task->node == parallel->root || csg_worth_storing(result, unsaved_ns))) {
+                const uint64_t key = ps_hash64_combine(node->hash, CSG_RESULT_VERSION);
+                cache->store.store(cache->store.userdata, key, result);
+                unsaved_ns = 0;
+            }
+        }
+    } else {
+        result = ps_array_new(1);
+    }
+    parallel_deliver(worker, task, result, unsaved_ns);
+}
+
+// Own deque, then the others', then a new leaf if not too many results are waiting. The task counts as
+// running until the caller finishes it; false once the root is done.
+static bool parallel_next(ParallelWorker *worker, uint32_t *task) {
+    Parallel *parallel = worker->parallel;
+    for (;;) {
+        const unsigned epoch = atomic_load(&parallel->epoch);
+        bool found = parallel_deque_pop(&worker->deque, task);
+        for (size_t i = 1; !found && i < parallel->worker_count; ++i) {
+            found = parallel_deque_steal(&parallel->workers[(worker->index + i) % parallel->worker_count].deque, task);
+        }
+        if (found) {
+            atomic_fetch_add(&parallel->running, 1);
+            return true;
+        }
+        pthread_mutex_lock(&parallel->lock);
+        if (parallel->done) {
+            pthread_mutex_unlock(&parallel->lock);
+            return false;
+        }
+        // With nothing running, the results waiting can only be consumed by starting more
+        if (parallel->next_ready < parallel->ready_count &&
+            (atomic_load(&parallel->live) < parallel->max_live || atomic_load(&parallel->running) == 0)) {
+            *task = parallel->ready[parallel->next_ready++];
+            atomic_fetch_add(&parallel->running, 1);
+            pthread_mutex_unlock(&parallel->lock);
+            return true;
+        }
+        atomic_fetch_add(&parallel->idle, 1);
+        if (atomic_load(&parallel->epoch) == epoch) {
+            pthread_cond_wait(&parallel->wake, &parallel->lock);
+        }
+        atomic_fetch_sub(&parallel->idle, 1);
+        pthread_mutex_unlock(&parallel->lock);
+    }
+}
+
+static void *parallel_work(void *userdata) {
+    ParallelWorker *worker = userdata;
+    Parallel *parallel = worker->parallel;
+    PS_TRACE_BEGIN(zone, "csg/worker");
+    uint32_t task;
+    while (parallel_next(worker, &task)) {
+        parallel_run(worker, task);
+        atomic_fetch_sub(&parallel->running, 1);
+        parallel_notify(parallel);
+    }
+    PS_TRACE_END(zone);
+    return NULL;
+}
+
+PsArray OF(PsGHPolygon4d *) *ps_csg_evaluate_parallel(PsCsg *csg, PsCsgNode node, PsCsgCache *cache, size_t threads,
+                                                      size_t max_live, PsCsgStats *stats) {
+    threads = threads ? threads : ps_cpu_count();
+    if (threads <= 1) {
+        return ps_csg_evaluate(csg, node, cache, stats);
+    }
+    PS_TRACE_BEGIN(zone, "csg/evaluate_parallel");
+    csg->evaluation++;
+    Parallel parallel = {.csg = csg, .root = node, .cache = cache};
+    atomic_init(&parallel.stopped, false);
+    parallel.node_tasks = calloc(csg->node_count, sizeof(uint32_t));
+    parallel_plan(&parallel, node);
+    parallel_index_links(&parallel);
+    free(parallel.node_tasks);
+
+    parallel.worker_count = threads < parallel.task_count ? threads : parallel.task_count;
+    parallel.max_live = max_live ? max_live : PARALLEL_LIVE_PER_THREAD * parallel.worker_count;
+    pthread_mutex_init(&parallel.cache_lock, NULL);
+    pthread_mutex_init(&parallel.lock, NULL);
+    pthread_cond_init(&parallel.wake, NULL);
+    parallel.workers = calloc(parallel.worker_count, sizeof(ParallelWorker));
+    for (size_t i = 0; i < parallel.worker_count; ++i) {
+        parallel.workers[i].parallel = &parallel;
+        parallel.workers[i].index = i;
+        pthread_mutex_init(&parallel.workers[i].deque.lock, NULL);
+    }
+    // A worker that fails to start just leaves its share to the others
+    bool *started = calloc(parallel.worker_count, sizeof(bool));
+    for (size_t i = 1; i < parallel.worker_count; ++i) {
+        started[i] = pthread_create(&parallel.workers[i].thread, NULL, parallel_work, &parallel.workers[i]) == 0;
+    }
+    parallel_work(&parallel.workers[0]);
+
+    // Workers still looking for work steal from every deque
+    for (size_t i = 1; i < parallel.worker_count; ++i) {
+        if (started[i]) {
+            pthread_join(parallel.workers[i].thread, NULL);
+        }
+    }
+    PsCsgStats total = parallel.plan_stats;
+    for (size_t i = 0; i < parallel.worker_count; ++i) {
+        const PsCsgStats *worker = &parallel.workers[i].stats;
+        total.evaluated += worker->evaluated;
+        total.clips += worker->clips;
+        total.intersections += worker->intersections;
+        total.intersect_ns += worker->intersect_ns;
+        total.mark_ns += worker->mark_ns;
+        total.walk_ns += worker->walk_ns;
+        pthread_mutex_destroy(&parallel.workers[i].deque.lock);
+        free(parallel.workers[i].deque.tasks);
+    }
+    if (stats) {
+        *stats = total;
+    }
+    free(started);
+    free(parallel.workers);
+    pthread_cond_destroy(&parallel.wake);
+    pthread_mutex_destroy(&parallel.lock);
+    pthread_mutex_destroy(&parallel.cache_lock);
+    free(parallel.ready);
+    free(parallel.links);
+    free(parallel.tasks);
+    if (atomic_load(&parallel.stopped)) {
+        csg_free_polygons(parallel.output);
+        parallel.output = NULL;
+    }
+    PS_TRACE_END(zone);
+    return parallel.output;
+}
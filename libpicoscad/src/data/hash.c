@@ -0,0 +1,84 @@
+#include <picoscad/data/hash.h>
+
+#include <string.h>
+
+#define HASH_PRIME1 UINT64_C(0x9E3779B185EBCA87)
+#define HASH_PRIME2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define HASH_PRIME3 UINT64_C(0x165667B19E3779F9)
+#define HASH_PRIME4 UINT64_C(0x85EBCA77C2B2AE63)
+#define HASH_PRIME5 UINT64_C(0x27D4EB2F165667C5)
+
+static uint64_t hash_rotl(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+// Unaligned little-endian reads, compilers turn these into single loads
+static uint64_t hash_read64(const unsigned char *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash_read32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t hash_round(uint64_t acc, uint64_t input) {
+    acc += input * HASH_PRIME2;
+    return hash_rotl(acc, 31) * HASH_PRIME1;
+}
+
+static uint64_t hash_merge(uint64_t acc, uint64_t value) {
+    acc ^= hash_round(0, value);
+    return acc * HASH_PRIME1 + HASH_PRIME4;
+}
+
+uint64_t ps_hash64(const void *data, size_t size, uint64_t seed) {
+    const unsigned char *p = data;
+    const unsigned char *end = p + size;
+    uint64_t hash;
+    if (size >= 32) {
+        // Four independent lanes keep the multiplier busy
+        uint64_t v1 = seed + HASH_PRIME1 + HASH_PRIME2;
+        uint64_t v2 = seed + HASH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - HASH_PRIME1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = hash_round(v1, hash_read64(p));
+            v2 = hash_round(v2, hash_read64(p + 8));
+            v3 = hash_round(v3, hash_read64(p + 16));
+            v4 = hash_round(v4, hash_read64(p + 24));
+        }
+        hash = hash_rotl(v1, 1) + hash_rotl(v2, 7) + hash_rotl(v3, 12) + hash_rotl(v4, 18);
+        hash = hash_merge(hash, v1);
+        hash = hash_merge(hash, v2);
+        hash = hash_merge(hash, v3);
+        hash = hash_merge(hash, v4);
+    } else {
+        hash = seed + HASH_PRIME5;
+    }
+    hash += (uint64_t) size;
+
+    for (; p + 8 <= end; p += 8) {
+        hash ^= hash_round(0, hash_read64(p));
+        hash = hash_rotl(hash, 27) * HASH_PRIME1 + HASH_PRIME4;
+    }
+    if (p + 4 <= end) {
+        hash ^= (uint64_t) hash_read32(p) * HASH_PRIME1;
+        hash = hash_rotl(hash, 23) * HASH_PRIME2 + HASH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= *p * HASH_PRIME5;
+        hash = hash_rotl(hash, 11) * HASH_PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
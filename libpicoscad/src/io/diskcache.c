@@ -0,0 +1,266 @@
+#include <picoscad/io/diskcache.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <picoscad/io/geofile.h>
+#include <picoscad/sys/trace.h>
+
+// Temporary files a crashed writer left behind are deleted by the next trim once this old
+#define DISKCACHE_STALE_SECONDS 3600
+
+// Loads and stores may come from several threads, see ps_csg_evaluate_parallel
+struct PsDiskCache {
+    char *directory;
+    // flock is per open file, so it keeps out other processes and trim_lock other threads
+    int lock;
+    pthread_mutex_t trim_lock;
+    uint64_t budget;
+    _Atomic uint64_t bytes;
+    atomic_size_t hits;
+    atomic_size_t misses;
+    atomic_size_t corrupt;
+    atomic_size_t writes;
+    atomic_size_t evictions;
+};
+
+typedef struct DiskcacheFile {
+    struct timespec mtime;
+    uint64_t size;
+    char name[32];
+} DiskcacheFile;
+
+static bool diskcache_path(const PsDiskCache *cache, const char *name, char path[PATH_MAX]) {
+    return snprintf(path, PATH_MAX, "%s/%s", cache->directory, name) < PATH_MAX;
+}
+
+static void diskcache_key_path(const PsDiskCache *cache, uint64_t key, char path[PATH_MAX]) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64 ".psgeo", key);
+    diskcache_path(cache, name, path);
+}
+
+static bool diskcache_mkdirs(char *path) {
+    for (char *slash = strchr(path + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        const bool ok = mkdir(path, 0777) == 0 || errno == EEXIST;
+        *slash = '/';
+        if (!ok) {
+            return false;
+        }
+    }
+    return mkdir(path, 0777) == 0 || errno == EEXIST;
+}
+
+static int diskcache_compare_files(const void *lhs, const void *rhs) {
+    const struct timespec *a = &((const DiskcacheFile *) lhs)->mtime, *b = &((const DiskcacheFile *) rhs)->mtime;
+    return a->tv_sec != b->tv_sec ? (a->tv_sec > b->tv_sec) - (a->tv_sec < b->tv_sec)
+                                  : (a->tv_nsec > b->tv_nsec) - (a->tv_nsec < b->tv_nsec);
+}
+
+// Lists the cache files oldest first and returns their total size; files may vanish under us at any point
+static uint64_t diskcache_scan(PsDiskCache *cache, DiskcacheFile **files, size_t *count) {
+    *files = NULL;
+    *count = 0;
+    DIR *dir = opendir(cache->directory);
+    if (!dir) {
+        return 0;
+    }
+    const time_t now = time(NULL);
+    size_t capacity = 0;
+    uint64_t total = 0;
+    for (struct dirent *dirent; (dirent = readdir(dir));) {
+        const char *name = dirent->d_name;
+        const bool temporary = strstr(name, ".psgeo.tmp.") != NULL;
+        const size_t length = strlen(name);
+        if (!temporary && (length < 6 || strcmp(name + length - 6, ".psgeo") != 0)) {
+            continue;
+        }
+        struct stat st;
+        if (fstatat(dirfd(dir), name, &st, 0) != 0) {
+            continue;
+        }
+        if (temporary) {
+            if (now - st.st_mtime > DISKCACHE_STALE_SECONDS) {
+                unlinkat(dirfd(dir), name, 0);
+            } else {
+                total += (uint64_t) st.st_size;
+            }
+            continue;
+        }
+        if (length >= sizeof((*files)->name)) {
+            continue;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            *files = realloc(*files, sizeof(DiskcacheFile) * capacity);
+        }
+        DiskcacheFile *file = &(*files)[(*count)++];
+        file->mtime = st.st_mtim;
+        file->size = (uint64_t) st.st_size;
+        memcpy(file->name, name, length + 1);
+        total += file->size;
+    }
+    closedir(dir);
+    if (*count > 0) {
+        qsort(*files, *count, sizeof(DiskcacheFile), diskcache_compare_files);
+    }
+    return total;
+}
+
+void ps_disk_cache_trim(PsDiskCache *cache) {
+    // Someone else trimming makes this trim redundant
+    if (pthread_mutex_trylock(&cache->trim_lock) != 0) {
+        return;
+    }
+    if (flock(cache->lock, LOCK_EX | LOCK_NB) != 0) {
+        pthread_mutex_unlock(&cache->trim_lock);
+        return;
+    }
+    PS_TRACE_BEGIN(zone, "diskcache/trim");
+    DiskcacheFile *files;
+    size_t count;
+    uint64_t total = diskcache_scan(cache, &files, &count);
+    if (total > cache->budget) {
+        const uint64_t target = cache->budget - cache->budget / 4;
+        char path[PATH_MAX];
+        for (size_t i = 0; i < count && total > target; ++i) {
+            if (diskcache_path(cache, files[i].name, path) && (unlink(path) == 0 || errno == ENOENT)) {
+                total -= files[i].size;
+                cache->evictions++;
+            }
+        }
+    }
+    cache->bytes = total;
+    free(files);
+    flock(cache->lock, LOCK_UN);
+    pthread_mutex_unlock(&cache->trim_lock);
+    PS_TRACE_END(zone);
+}
+
+PsDiskCache *ps_disk_cache_open(const char *directory, uint64_t budget, const char **error) {
+    // Room for the path of a file in the directory
+    if (strlen(directory) + 32 >= PATH_MAX) {
+        *error = "directory path too long";
+        return NULL;
+    }
+    char *copy = strdup(directory);
+    if (!diskcache_mkdirs(copy)) {
+        free(copy);
+        *error = "cannot create directory";
+        return NULL;
+    }
+    PsDiskCache *cache = calloc(1, sizeof(PsDiskCache));
+    cache->directory = copy;
+    cache->budget = budget;
+    char path[PATH_MAX];
+    diskcache_path(cache, "lock", path);
+    cache->lock = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (cache->lock < 0) {
+        free(cache->directory);
+        free(cache);
+        *error = "cannot create lock file";
+        return NULL;
+    }
+    pthread_mutex_init(&cache->trim_lock, NULL);
+    DiskcacheFile *files;
+    size_t count;
+    cache->bytes = diskcache_scan(cache, &files, &count);
+    free(files);
+    if (cache->bytes > cache->budget) {
+        ps_disk_cache_trim(cache);
+    }
+    return cache;
+}
+
+void ps_disk_cache_close(PsDiskCache *cache) {
+    if (cache) {
+        close(cache->lock);
+        pthread_mutex_destroy(&cache->trim_lock);
+        free(cache->directory);
+        free(cache);
+    }
+}
+
+PsArray OF(PsGHPolygon4d *) *ps_disk_cache_load(PsDiskCache *cache, uint64_t key) {
+    PS_TRACE_BEGIN(zone, "diskcache/load");
+    char path[PATH_MAX];
+    diskcache_key_path(cache, key, path);
+    const char *error;
+    PsGeofile *file = ps_geofile_open(path, &error);
+    if (!file) {
+        // Missing, unreadable for now (EMFILE, ENOMEM, EACCES) or unparseable. Only a miss: deleting over a
+        // transient error would lose a good entry, and the store after the miss replaces a broken file
+        cache->misses++;
+        PS_TRACE_END(zone);
+        return NULL;
+    }
+    PsGeofileEntry entry;
+    PsArray OF(PsGHPolygon4d *) *polygons = NULL;
+    if (ps_geofile_find(file, key, &entry) && ps_geofile_verify(&entry)) {
+        polygons = ps_geofile_entry_to_polygons4d(&entry);
+    }
+    ps_geofile_close(file);
+    if (polygons) {
+        // Recently used as far as trimming is concerned
+        utimensat(AT_FDCWD, path, NULL, 0);
+        cache->hits++;
+    } else {
+        // A file that fails the checks would fail them forever, make way for a good one
+        unlink(path);
+        cache->corrupt++;
+        cache->misses++;
+    }
+    PS_TRACE_END(zone);
+    return polygons;
+}
+
+bool ps_disk_cache_store(PsDiskCache *cache, uint64_t key, PsArray OF(PsGHPolygon4d *) *polygons) {
+    PS_TRACE_BEGIN(zone, "diskcache/store");
+    char path[PATH_MAX];
+    diskcache_key_path(cache, key, path);
+    PsGeofileWriter *writer = ps_geofile_writer_new(path);
+    bool ok = writer != NULL;
+    if (writer) {
+        ok = ps_geofile_writer_add_polygons4d(writer, key, polygons);
+        ok = ps_geofile_writer_close(writer) && ok;
+    }
+    struct stat st;
+    if (ok && stat(path, &st) == 0) {
+        cache->writes++;
+        if ((cache->bytes += (uint64_t) st.st_size) > cache->budget) {
+            ps_disk_cache_trim(cache);
+        }
+    }
+    PS_TRACE_END(zone);
+    return ok;
+}
+
+void ps_disk_cache_get_stats(const PsDiskCache *cache, PsDiskCacheStats *stats) {
+    *stats = (PsDiskCacheStats) {cache->hits, cache->misses, cache->corrupt, cache->writes, cache->evictions,
+                                 cache->bytes, cache->budget};
+}
+
+static PsArray OF(PsGHPolygon4d *) *diskcache_load(void *userdata, uint64_t key) {
+    return ps_disk_cache_load(userdata, key);
+}
+
+static void diskcache_store(void *userdata, uint64_t key, PsArray OF(PsGHPolygon4d *) *polygons) {
+    ps_disk_cache_store(userdata, key, polygons);
+}
+
+PsCsgStore ps_disk_cache_get_store(PsDiskCache *cache) {
+    return (PsCsgStore) {diskcache_load, diskcache_store, cache};
+}
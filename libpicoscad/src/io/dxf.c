@@ -0,0 +1,416 @@
+#include <picoscad/io/dxf.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <picoscad/sys/file.h>
+#include <picoscad/sys/trace.h>
+
+#include "flatten.h"
+
+/*
+ * DXF is a flat list of (group code, value) line pairs, so entities are built
+ * up field by field and flattened as soon as the next one starts. Pieces that
+ * don't close on their own are kept until the end of the file and joined where
+ * their endpoints agree to DXF_JOIN_GRID.
+ */
+
+#define DXF_JOIN_GRID 1e-6
+
+typedef enum DxfType {
+    DXF_NONE,
+    DXF_LWPOLYLINE,
+    DXF_CIRCLE,
+    DXF_ARC,
+    DXF_LINE
+} DxfType;
+
+typedef struct DxfVertex {
+    double x;
+    double y;
+    double bulge;
+} DxfVertex;
+
+typedef struct DxfEntity {
+    DxfType type;
+    IoBuffer vertices;
+    long flags;
+    double x, y, x2, y2;
+    double radius;
+    double start, end;
+    double extrusion_z;
+} DxfEntity;
+
+typedef struct DxfPiece {
+    size_t first;
+    size_t length;
+} DxfPiece;
+
+typedef struct DxfEnd {
+    int64_t x;
+    int64_t y;
+    size_t end;
+} DxfEnd;
+
+typedef struct DxfReader {
+    FlattenContour contour;
+    DxfEntity entity;
+    IoBuffer pieces;
+    IoBuffer piece_points;
+    bool failed;
+} DxfReader;
+
+static void dxf_entity_reset(DxfEntity *entity, DxfType type) {
+    entity->type = type;
+    entity->vertices.length = 0;
+    entity->flags = 0;
+    entity->x = entity->y = entity->x2 = entity->y2 = 0.0;
+    entity->radius = entity->start = entity->end = 0.0;
+    entity->extrusion_z = 1.0;
+}
+
+// Bulge is the tangent of a quarter of the arc's angle, positive for counter-clockwise
+static void dxf_bulge(FlattenContour *contour, DxfVertex from, DxfVertex to) {
+    const double dx = to.x - from.x, dy = to.y - from.y, b = from.bulge;
+    const FlattenPoint center = {(from.x + to.x) / 2.0 - dy * (1.0 - b * b) / (4.0 * b),
+                                 (from.y + to.y) / 2.0 + dx * (1.0 - b * b) / (4.0 * b)};
+    const double radius = hypot(dx, dy) * (1.0 + b * b) / (4.0 * fabs(b));
+    flatten_arc(contour, center, radius, radius, 0.0, atan2(from.y - center.y, from.x - center.x), 4.0 * atan(b));
+}
+
+// Entities drawn on the underside (extrusion 0 0 -1) have their x axis mirrored
+static void dxf_apply_extrusion(DxfReader *reader) {
+    if (reader->entity.extrusion_z < 0.0) {
+        FlattenPoint *points = reader->contour.points.data;
+        for (size_t i = 0; i < reader->contour.points.length; ++i) {
+            points[i].x = -points[i].x;
+        }
+    }
+}
+
+// Moves the contour being built into the pieces waiting to be joined
+static void dxf_keep_piece(DxfReader *reader) {
+    const FlattenPoint *points = reader->contour.points.data;
+    const size_t length = reader->contour.points.length;
+    DxfPiece *piece = length >= 2 ? io_buffer_push(&reader->pieces) : NULL;
+    if (length >= 2 && !piece) {
+        reader->failed = true;
+    }
+    if (piece) {
+        *piece = (DxfPiece) {reader->piece_points.length, length};
+        for (size_t i = 0; i < length; ++i) {
+            FlattenPoint *point = io_buffer_push(&reader->piece_points);
+            if (!point) {
+                reader->failed = true;
+                break;
+            }
+            *point = points[i];
+        }
+    }
+    flatten_discard(&reader->contour);
+}
+
+static void dxf_finish_entity(DxfReader *reader) {
+    DxfEntity *entity = &reader->entity;
+    FlattenContour *contour = &reader->contour;
+    switch (entity->type) {
+        case DXF_LWPOLYLINE: {
+            const DxfVertex *vertices = entity->vertices.data;
+            const size_t length = entity->vertices.length;
+            if (length == 0) {
+                break;
+            }
+            const bool closed = (entity->flags & 1) ||
+                                (vertices[0].x == vertices[length - 1].x && vertices[0].y == vertices[length - 1].y);
+            for (size_t i = 0; i < length; ++i) {
+                flatten_point(contour, vertices[i].x, vertices[i].y);
+                // The closing segment can carry a bulge too
+                const bool has_next = i + 1 < length || ((entity->flags & 1) && length > 1);
+                if (has_next && vertices[i].bulge != 0.0) {
+                    dxf_bulge(contour, vertices[i], vertices[(i + 1) % length]);
+                }
+            }
+            dxf_apply_extrusion(reader);
+            if (closed) {
+                flatten_emit(contour);
+            } else {
+                dxf_keep_piece(reader);
+            }
+            break;
+        }
+        case DXF_CIRCLE:
+            if (entity->radius > 0.0) {
+                // The arc's last point is its first, no explicit start point needed
+                flatten_arc(contour, (FlattenPoint) {entity->x, entity->y}, entity->radius, entity->radius, 0.0, 0.0,
+                            FLATTEN_TAU);
+                dxf_apply_extrusion(reader);
+                flatten_emit(contour);
+            }
+            break;
+        case DXF_ARC: {
+            const double start = entity->start * FLATTEN_TAU / 360.0;
+            double sweep = (entity->end - entity->start) * FLATTEN_TAU / 360.0;
+            // Arcs run counter-clockwise from start to end angle
+            while (sweep <= 0.0) {
+                sweep += FLATTEN_TAU;
+            }
+            flatten_point(contour, entity->x + entity->radius * cos(start), entity->y + entity->radius * sin(start));
+            flatten_arc(contour, (FlattenPoint) {entity->x, entity->y}, entity->radius, entity->radius, 0.0, start,
+                        sweep);
+            dxf_apply_extrusion(reader);
+            dxf_keep_piece(reader);
+            break;
+        }
+        case DXF_LINE:
+            flatten_point(contour, entity->x, entity->y);
+            flatten_point(contour, entity->x2, entity->y2);
+            dxf_apply_extrusion(reader);
+            dxf_keep_piece(reader);
+            break;
+        case DXF_NONE:
+            break;
+    }
+    dxf_entity_reset(entity, DXF_NONE);
+}
+
+static void dxf_field(DxfReader *reader, long code, const char *value, const char *end) {
+    DxfEntity *entity = &reader->entity;
+    double number;
+    if (entity->type == DXF_NONE || !io_parse_double(&value, end, &number)) {
+        return;
+    }
+    if (entity->type == DXF_LWPOLYLINE) {
+        DxfVertex *vertices = entity->vertices.data;
+        const size_t length = entity->vertices.length;
+        if (code == 10) {
+            DxfVertex *vertex = io_buffer_push(&entity->vertices);
+            if (!vertex) {
+                reader->failed = true;
+                return;
+            }
+            *vertex = (DxfVertex) {number, 0.0, 0.0};
+        } else if (code == 20 && length > 0) {
+            vertices[length - 1].y = number;
+        } else if (code == 42 && length > 0) {
+            vertices[length - 1].bulge = number;
+        } else if (code == 70) {
+            entity->flags = (long) number;
+        } else if (code == 230) {
+            entity->extrusion_z = number;
+        }
+        return;
+    }
+    switch (code) {
+        case 10:
+            entity->x = number;
+            break;
+        case 20:
+            entity->y = number;
+            break;
+        case 11:
+            entity->x2 = number;
+            break;
+        case 21:
+            entity->y2 = number;
+            break;
+        case 40:
+            entity->radius = number;
+            break;
+        case 50:
+            entity->start = number;
+            break;
+        case 51:
+            entity->end = number;
+            break;
+        case 230:
+            entity->extrusion_z = number;
+            break;
+        default:
+            break;
+    }
+}
+
+static int dxf_compare_ends(const void *lhs, const void *rhs) {
+    const DxfEnd *a = lhs, *b = rhs;
+    if (a->x != b->x) {
+        return a->x < b->x ? -1 : 1;
+    }
+    return (a->y > b->y) - (a->y < b->y);
+}
+
+static void dxf_append_piece(DxfReader *reader, const DxfPiece *piece, bool reversed, bool skip_first) {
+    const FlattenPoint *points = (const FlattenPoint *) reader->piece_points.data + piece->first;
+    for (size_t i = skip_first ? 1 : 0; i < piece->length; ++i) {
+        const FlattenPoint point = points[reversed ? piece->length - 1 - i : i];
+        flatten_point(&reader->contour, point.x, point.y);
+    }
+}
+
+// Pairs up piece ends that meet and walks each chain, emitting those that come back to their start
+static void dxf_join_pieces(DxfReader *reader) {
+    const DxfPiece *pieces = reader->pieces.data;
+    const size_t count = reader->pieces.length;
+    const FlattenPoint *points = reader->piece_points.data;
+    if (count == 0) {
+        return;
+    }
+    // End 2i is the head of piece i, 2i + 1 its tail
+    DxfEnd *ends = malloc(sizeof(DxfEnd) * count * 2);
+    size_t *partners = malloc(sizeof(size_t) * count * 2);
+    bool *used = calloc(count, sizeof(bool));
+    if (!ends || !partners || !used) {
+        reader->failed = true;
+        free(used);
+        free(partners);
+        free(ends);
+        return;
+    }
+    for (size_t i = 0; i < count * 2; ++i) {
+        const FlattenPoint point = points[pieces[i / 2].first + (i % 2 ? pieces[i / 2].length - 1 : 0)];
+        ends[i] = (DxfEnd) {llround(point.x / DXF_JOIN_GRID), llround(point.y / DXF_JOIN_GRID), i};
+        partners[i] = SIZE_MAX;
+    }
+    qsort(ends, count * 2, sizeof(DxfEnd), dxf_compare_ends);
+    for (size_t i = 0; i + 1 < count * 2; ++i) {
+        if (dxf_compare_ends(&ends[i], &ends[i + 1]) == 0) {
+            partners[ends[i].end] = ends[i + 1].end;
+            partners[ends[i + 1].end] = ends[i].end;
+            i++;
+        }
+    }
+
+    for (size_t start = 0; start < count && !reader->contour.stopped; ++start) {
+        if (used[start]) {
+            continue;
+        }
+        used[start] = true;
+        dxf_append_piece(reader, &pieces[start], false, false);
+        size_t exit = start * 2 + 1;
+        bool closed = false;
+        while (partners[exit] != SIZE_MAX) {
+            const size_t entry = partners[exit], piece = entry / 2;
+            if (entry == start * 2) {
+                closed = true;
+                break;
+            }
+            if (used[piece]) {
+                break;
+            }
+            used[piece] = true;
+            // Entering at the tail means walking the piece backwards
+            dxf_append_piece(reader, &pieces[piece], entry % 2 == 1, true);
+            exit = entry ^ 1;
+        }
+        if (closed) {
+            // The last point lands on the first one, only rounding apart
+            if (reader->contour.points.length > 1) {
+                reader->contour.points.length--;
+            }
+            flatten_emit(&reader->contour);
+        } else {
+            flatten_discard(&reader->contour);
+        }
+    }
+    free(used);
+    free(partners);
+    free(ends);
+}
+
+// The value line with surrounding blanks and the line break removed
+static const char *dxf_value_end(const char *value, const char *end) {
+    const char *line_end = memchr(value, '\n', (size_t) (end - value));
+    line_end = line_end ? line_end : end;
+    while (line_end > value && (line_end[-1] == '\r' || line_end[-1] == ' ' || line_end[-1] == '\t')) {
+        line_end--;
+    }
+    return line_end;
+}
+
+static bool dxf_value_is(const char *value, const char *value_end, const char *expected) {
+    const size_t length = strlen(expected);
+    return (size_t) (value_end - value) == length && memcmp(value, expected, length) == 0;
+}
+
+bool ps_dxf_read(const char *path, double tolerance, PsOutlineSink sink, void *userdata, const char **error) {
+    PsMappedFile file;
+    if (!ps_file_map(path, &file)) {
+        *error = strerror(errno);
+        return false;
+    }
+    const char *p = file.data, *end = p + file.size;
+    if (file.size >= 18 && memcmp(p, "AutoCAD Binary DXF", 18) == 0) {
+        ps_file_unmap(&file);
+        *error = "binary DXF is not supported";
+        return false;
+    }
+    PS_TRACE_BEGIN(zone, "dxf/read");
+    DxfReader reader = {0};
+    flatten_init(&reader.contour, tolerance, sink, userdata);
+    io_buffer_init(&reader.entity.vertices, sizeof(DxfVertex));
+    io_buffer_init(&reader.pieces, sizeof(DxfPiece));
+    io_buffer_init(&reader.piece_points, sizeof(FlattenPoint));
+    dxf_entity_reset(&reader.entity, DXF_NONE);
+
+    bool ok = true, in_entities = false, section_name = false;
+    while (p < end && !reader.contour.stopped) {
+        long code;
+        const char *cursor = p;
+        if (!io_parse_long(&cursor, end, &code)) {
+            // Tolerate blank lines, usually trailing ones
+            const char *blank = io_skip_blanks(p, end);
+            if (blank == end || *blank == '\r' || *blank == '\n') {
+                p = io_next_line(p, end);
+                continue;
+            }
+            *error = "malformed group code";
+            ok = false;
+            break;
+        }
+        const char *value = io_skip_blanks(io_next_line(cursor, end), end);
+        const char *value_end = dxf_value_end(value, end);
+        p = io_next_line(value, end);
+
+        if (code == 0) {
+            dxf_finish_entity(&reader);
+            if (dxf_value_is(value, value_end, "SECTION")) {
+                section_name = true;
+            } else if (dxf_value_is(value, value_end, "ENDSEC")) {
+                in_entities = false;
+            } else if (dxf_value_is(value, value_end, "EOF")) {
+                break;
+            } else if (in_entities) {
+                const DxfType type = dxf_value_is(value, value_end, "LWPOLYLINE") ? DXF_LWPOLYLINE
+                                     : dxf_value_is(value, value_end, "CIRCLE") ? DXF_CIRCLE
+                                     : dxf_value_is(value, value_end, "ARC") ? DXF_ARC
+                                     : dxf_value_is(value, value_end, "LINE") ? DXF_LINE
+                                     : DXF_NONE;
+                dxf_entity_reset(&reader.entity, type);
+            }
+        } else if (code == 2 && section_name) {
+            in_entities = dxf_value_is(value, value_end, "ENTITIES");
+            section_name = false;
+        } else {
+            dxf_field(&reader, code, value, value_end);
+        }
+        if (reader.failed || reader.contour.failed) {
+            break;
+        }
+    }
+    dxf_finish_entity(&reader);
+    if (ok && !reader.contour.stopped) {
+        dxf_join_pieces(&reader);
+    }
+    if (ok && (reader.failed || reader.contour.failed)) {
+        *error = "out of memory";
+        ok = false;
+    }
+    io_buffer_destroy(&reader.piece_points);
+    io_buffer_destroy(&reader.pieces);
+    io_buffer_destroy(&reader.entity.vertices);
+    flatten_destroy(&reader.contour);
+    PS_TRACE_END(zone);
+    ps_file_unmap(&file);
+    return ok;
+}
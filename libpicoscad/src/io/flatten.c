@@ -0,0 +1,145 @@
+#include "flatten.h"
+
+#include <picoscad/cg/arc.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+static size_t flatten_clamp_segments(double segments) {
+    if (!(segments >= 1.0)) {
+        return 1;
+    }
+    return segments > PS_ARC_MAX_SEGMENTS ? PS_ARC_MAX_SEGMENTS : (size_t) ceil(segments);
+}
+
+bool ps_outline_collect(PsGHPolygon *contour, void *userdata) {
+    ps_array_add(userdata, contour);
+    return true;
+}
+
+void flatten_init(FlattenContour *contour, double tolerance, PsOutlineSink sink, void *userdata) {
+    io_buffer_init(&contour->points, sizeof(FlattenPoint));
+    io_buffer_init(&contour->emit, sizeof(Ps4f));
+    contour->tolerance = contour->emit_tolerance = tolerance > 1e-9 ? tolerance : 1e-9;
+    contour->transform = FLATTEN_IDENTITY;
+    contour->sink = sink;
+    contour->userdata = userdata;
+    contour->stopped = false;
+    contour->failed = false;
+}
+
+void flatten_destroy(FlattenContour *contour) {
+    io_buffer_destroy(&contour->points);
+    io_buffer_destroy(&contour->emit);
+}
+
+void flatten_set_transform(FlattenContour *contour, FlattenTransform transform) {
+    // The largest singular value of the linear part, the most any length is stretched
+    const double sum = transform.a * transform.a + transform.b * transform.b + transform.c * transform.c +
+                       transform.d * transform.d;
+    const double det = transform.a * transform.d - transform.b * transform.c;
+    const double stretch = sqrt((sum + sqrt(fmax(0.0, sum * sum - 4.0 * det * det))) / 2.0);
+    contour->transform = transform;
+    contour->tolerance = stretch > 0.0 ? contour->emit_tolerance / stretch : contour->emit_tolerance;
+    if (!(contour->tolerance > 1e-9)) {
+        contour->tolerance = 1e-9;
+    }
+}
+
+FlattenTransform flatten_compose(FlattenTransform parent, FlattenTransform child) {
+    return (FlattenTransform) {
+            parent.a * child.a + parent.c * child.b,
+            parent.b * child.a + parent.d * child.b,
+            parent.a * child.c + parent.c * child.d,
+            parent.b * child.c + parent.d * child.d,
+            parent.a * child.e + parent.c * child.f + parent.e,
+            parent.b * child.e + parent.d * child.f + parent.f
+    };
+}
+
+void flatten_point(FlattenContour *contour, double x, double y) {
+    const FlattenPoint *points = contour->points.data;
+    const size_t length = contour->points.length;
+    if (length > 0 && points[length - 1].x == x && points[length - 1].y == y) {
+        return;
+    }
+    FlattenPoint *point = io_buffer_push(&contour->points);
+    if (!point) {
+        contour->failed = true;
+        return;
+    }
+    *point = (FlattenPoint) {x, y};
+}
+
+bool flatten_emit(FlattenContour *contour) {
+    const FlattenPoint *points = contour->points.data;
+    size_t length = contour->points.length;
+    if (length > 1 && points[0].x == points[length - 1].x && points[0].y == points[length - 1].y) {
+        length--;
+    }
+    if (length >= 3 && !contour->stopped && !contour->failed) {
+        const FlattenTransform t = contour->transform;
+        contour->emit.length = 0;
+        for (size_t i = 0; i < length; ++i) {
+            Ps4f *point = io_buffer_push(&contour->emit);
+            if (!point) {
+                contour->failed = true;
+                break;
+            }
+            const double x = points[i].x, y = points[i].y;
+            *point = ps_4f((float) (t.a * x + t.c * y + t.e), (float) (t.b * x + t.d * y + t.f), 0.0f, 1.0f);
+        }
+        if (!contour->failed) {
+            PsGHPolygon *poly = ps_ghpolygon_new_with_points(contour->emit.data, length);
+            contour->stopped = !contour->sink(poly, contour->userdata);
+        }
+    }
+    contour->points.length = 0;
+    return !contour->stopped && !contour->failed;
+}
+
+void flatten_discard(FlattenContour *contour) {
+    contour->points.length = 0;
+}
+
+static double flatten_distance(double x, double y) {
+    return sqrt(x * x + y * y);
+}
+
+void flatten_quadratic(FlattenContour *contour, FlattenPoint p0, FlattenPoint p1, FlattenPoint p2) {
+    // The second derivative is the constant 2 (p0 - 2 p1 + p2), n chords stray at most |B''| / (8 n^2)
+    const double dd = flatten_distance(p0.x - 2.0 * p1.x + p2.x, p0.y - 2.0 * p1.y + p2.y);
+    const size_t n = flatten_clamp_segments(sqrt(dd / (4.0 * contour->tolerance)));
+    for (size_t i = 1; i <= n; ++i) {
+        const double t = (double) i / n, u = 1.0 - t;
+        flatten_point(contour, u * u * p0.x + 2.0 * u * t * p1.x + t * t * p2.x,
+                      u * u * p0.y + 2.0 * u * t * p1.y + t * t * p2.y);
+    }
+}
+
+void flatten_cubic(FlattenContour *contour, FlattenPoint p0, FlattenPoint p1, FlattenPoint p2, FlattenPoint p3) {
+    // |B''| is at most 6 times the larger of the two control polygon second differences
+    const double dd = fmax(flatten_distance(p0.x - 2.0 * p1.x + p2.x, p0.y - 2.0 * p1.y + p2.y),
+                           flatten_distance(p1.x - 2.0 * p2.x + p3.x, p1.y - 2.0 * p2.y + p3.y));
+    const size_t n = flatten_clamp_segments(sqrt(0.75 * dd / contour->tolerance));
+    for (size_t i = 1; i <= n; ++i) {
+        const double t = (double) i / n, u = 1.0 - t;
+        const double a = u * u * u, b = 3.0 * u * u * t, c = 3.0 * u * t * t, d = t * t * t;
+        flatten_point(contour, a * p0.x + b * p1.x + c * p2.x + d * p3.x, a * p0.y + b * p1.y + c * p2.y + d * p3.y);
+    }
+}
+
+void flatten_arc(FlattenContour *contour, FlattenPoint center, double rx, double ry, double rotation, double start,
+                 double sweep) {
+    const size_t n = ps_arc_segments(fmax(fabs(rx), fabs(ry)), sweep, contour->tolerance);
+    const double step = sweep / n;
+    // Points 1 to n, the start point is already in
+    Ps4d points[64];
+    for (size_t first = 1; first <= n; first += 64) {
+        const size_t count = n - first + 1 < 64 ? n - first + 1 : 64;
+        ps_ellipse_points4d(center.x, center.y, rx, ry, rotation, start + step * first, step, count, points);
+        for (size_t i = 0; i < count; ++i) {
+            flatten_point(contour, ps_4d_x(points[i]), ps_4d_y(points[i]));
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef PS_IO_FLATTEN_H_
+#define PS_IO_FLATTEN_H_
+
+#include <picoscad/io/outline.h>
+
+#include "text.h"
+
+/*
+ * Builds contours for the 2D importers. Points are kept in double precision
+ * until the contour is emitted; the buffers are reused from one contour to the
+ * next, so memory follows the largest contour rather than the file.
+ *
+ * The curve functions append the points after the start point, which is
+ * expected to be the last point added already.
+ */
+
+#define FLATTEN_TAU 6.283185307179586
+
+typedef struct FlattenPoint {
+    double x;
+    double y;
+} FlattenPoint;
+
+/**
+ * x' = a x + c y + e, y' = b x + d y + f, the order SVG's matrix() lists them in
+ */
+typedef struct FlattenTransform {
+    double a, b, c, d, e, f;
+} FlattenTransform;
+
+#define FLATTEN_IDENTITY ((FlattenTransform) {1.0, 0.0, 0.0, 1.0, 0.0, 0.0})
+
+typedef struct FlattenContour {
+    IoBuffer points;
+    IoBuffer emit;
+    // In the units of the points added, set by flatten_set_transform
+    double tolerance;
+    // The tolerance given to flatten_init, in the units of the points emitted
+    double emit_tolerance;
+    // Applied when a contour is emitted
+    FlattenTransform transform;
+    PsOutlineSink sink;
+    void *userdata;
+    bool stopped;
+    bool failed;
+} FlattenContour;
+
+void flatten_init(FlattenContour *contour, double tolerance, PsOutlineSink sink, void *userdata);
+void flatten_destroy(FlattenContour *contour);
+
+/**
+ * The transform to apply from the next emitted contour on. The tolerance is
+ * scaled down by how much it stretches, so curves still stay within tolerance
+ * once transformed.
+ */
+void flatten_set_transform(FlattenContour *contour, FlattenTransform transform);
+
+/**
+ * parent applied after child
+ */
+FlattenTransform flatten_compose(FlattenTransform parent, FlattenTransform child);
+
+/**
+ * Appends a point, dropping exact repeats of the last one
+ */
+void flatten_point(FlattenContour *contour, double x, double y);
+
+/**
+ * Hands the contour to the sink if it still has 3 points once a closing point
+ * equal to the first is dropped, then starts an empty one. False once the sink
+ * has asked to stop or memory ran out.
+ */
+bool flatten_emit(FlattenContour *contour);
+
+void flatten_discard(FlattenContour *contour);
+
+void flatten_quadratic(FlattenContour *contour, FlattenPoint p0, FlattenPoint p1, FlattenPoint p2);
+void flatten_cubic(FlattenContour *contour, FlattenPoint p0, FlattenPoint p1, FlattenPoint p2, FlattenPoint p3);
+
+/**
+ * The elliptical arc around center with radii rx and ry, rotated by rotation,
+ * from angle start through sweep (radians, positive is counter-clockwise),
+ * with as many chords as ps_arc_segments asks for
+ */
+void flatten_arc(FlattenContour *contour, FlattenPoint center, double rx, double ry, double rotation, double start,
+                 double sweep);
+
+#endif // PS_IO_FLATTEN_H_
@@ -0,0 +1,357 @@
+#include <picoscad/io/geofile.h>
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <picoscad/data/hash.h>
+#include <picoscad/sys/file.h>
+#include <picoscad/sys/trace.h>
+
+#define GEOFILE_ALIGNMENT 64
+#define GEOFILE_BYTE_ORDER UINT32_C(0x01020304)
+
+static const char geofile_magic[8] = {'P', 'S', 'G', 'E', 'O', '\r', '\n', '\032'};
+
+typedef struct GeofileHeader {
+    char magic[8];
+    uint32_t version;
+    // Reads back as 0x04030201 on a machine of the other endianness
+    uint32_t byte_order;
+    uint64_t file_size;
+    uint64_t toc_offset;
+    uint64_t entry_count;
+    uint64_t toc_hash;
+    uint8_t reserved[16];
+} GeofileHeader;
+
+typedef struct GeofileRecord {
+    uint32_t kind;
+    uint32_t precision;
+    uint64_t key;
+    uint64_t hash;
+    uint64_t vertex_offset;
+    uint64_t vertex_count;
+    uint64_t index_offset;
+    uint64_t index_count;
+    uint64_t reserved;
+} GeofileRecord;
+
+_Static_assert(sizeof(GeofileHeader) == GEOFILE_ALIGNMENT, "the header fills one aligned slot");
+_Static_assert(sizeof(GeofileRecord) == GEOFILE_ALIGNMENT, "TOC records fill one aligned slot each");
+
+struct PsGeofile {
+    PsMappedFile map;
+    const GeofileRecord *records;
+    size_t count;
+};
+
+struct PsGeofileWriter {
+    FILE *file;
+    char *path;
+    char *temp_path;
+    uint64_t offset;
+    bool failed;
+    GeofileRecord *records;
+    size_t count;
+    size_t capacity;
+};
+
+static size_t geofile_vertex_size(uint32_t precision) {
+    return precision == PS_GEOFILE_4D ? sizeof(double) * 4 : sizeof(float) * 4;
+}
+
+static uint64_t geofile_hash(const void *vertices, size_t vertices_size, const uint32_t *indices, size_t index_count) {
+    return ps_hash64(indices, sizeof(uint32_t) * index_count, ps_hash64(vertices, vertices_size, 0));
+}
+
+// A block of count elements of size bytes at offset must lie between the header and the TOC
+static bool geofile_block_valid(const GeofileHeader *header, uint64_t offset, uint64_t count, size_t size) {
+    if (count == 0) {
+        return true;
+    }
+    return offset % GEOFILE_ALIGNMENT == 0 && offset >= sizeof(GeofileHeader) && offset <= header->toc_offset &&
+           count <= (header->toc_offset - offset) / size;
+}
+
+static void geofile_entry(const PsGeofile *file, const GeofileRecord *record, PsGeofileEntry *entry) {
+    const unsigned char *data = file->map.data;
+    *entry = (PsGeofileEntry) {
+            .kind = (PsGeofileKind) record->kind,
+            .precision = (PsGeofilePrecision) record->precision,
+            .key = record->key,
+            .hash = record->hash,
+            .vertices = record->vertex_count ? data + record->vertex_offset : NULL,
+            .vertex_count = (size_t) record->vertex_count,
+            .indices = record->index_count ? (const uint32_t *) (data + record->index_offset) : NULL,
+            .index_count = (size_t) record->index_count
+    };
+}
+
+PsGeofile *ps_geofile_open(const char *path, const char **error) {
+    PsMappedFile map;
+    if (!ps_file_map(path, &map)) {
+        *error = strerror(errno);
+        return NULL;
+    }
+    PS_TRACE_BEGIN(zone, "geofile/open");
+    const GeofileHeader *header = map.data;
+    const GeofileRecord *records = NULL;
+    *error = NULL;
+    if (map.size < sizeof(GeofileHeader) || memcmp(header->magic, geofile_magic, sizeof(geofile_magic)) != 0) {
+        *error = "not a picoSCAD geometry file";
+    } else if (header->byte_order != GEOFILE_BYTE_ORDER) {
+        *error = "geometry file has the wrong byte order";
+    } else if (header->version != PS_GEOFILE_VERSION) {
+        *error = "unsupported geometry file version";
+    } else if (header->file_size != map.size || header->toc_offset % GEOFILE_ALIGNMENT != 0 ||
+               header->toc_offset < sizeof(GeofileHeader) || header->toc_offset > map.size ||
+               header->entry_count != (map.size - header->toc_offset) / sizeof(GeofileRecord)) {
+        *error = "truncated geometry file";
+    } else {
+        records = (const GeofileRecord *) ((const unsigned char *) map.data + header->toc_offset);
+        // The TOC is small and everything else trusts it, so it is always hashed
+        if (ps_hash64(records, sizeof(GeofileRecord) * header->entry_count, 0) != header->toc_hash) {
+            *error = "corrupt geometry file TOC";
+        }
+        for (size_t i = 0; !*error && i < header->entry_count; ++i) {
+            const GeofileRecord *record = &records[i];
+            if ((record->kind != PS_GEOFILE_POLYGONS && record->kind != PS_GEOFILE_MESH) ||
+                (record->precision != PS_GEOFILE_4F && record->precision != PS_GEOFILE_4D) ||
+                !geofile_block_valid(header, record->vertex_offset, record->vertex_count,
+                                     geofile_vertex_size(record->precision)) ||
+                !geofile_block_valid(header, record->index_offset, record->index_count, sizeof(uint32_t))) {
+                *error = "corrupt geometry file entry";
+            }
+        }
+    }
+    PS_TRACE_END(zone);
+    if (*error) {
+        ps_file_unmap(&map);
+        return NULL;
+    }
+    PsGeofile *file = malloc(sizeof(PsGeofile));
+    file->map = map;
+    file->records = records;
+    file->count = (size_t) header->entry_count;
+    return file;
+}
+
+void ps_geofile_close(PsGeofile *file) {
+    ps_file_unmap(&file->map);
+    free(file);
+}
+
+size_t ps_geofile_get_entry_count(const PsGeofile *file) {
+    return file->count;
+}
+
+void ps_geofile_get_entry(const PsGeofile *file, size_t index, PsGeofileEntry *entry) {
+    geofile_entry(file, &file->records[index], entry);
+}
+
+bool ps_geofile_find(const PsGeofile *file, uint64_t key, PsGeofileEntry *entry) {
+    size_t low = 0, high = file->count;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (file->records[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == file->count || file->records[low].key != key) {
+        return false;
+    }
+    geofile_entry(file, &file->records[low], entry);
+    return true;
+}
+
+bool ps_geofile_verify(const PsGeofileEntry *entry) {
+    PS_TRACE_BEGIN(zone, "geofile/verify");
+    const uint64_t hash = geofile_hash(entry->vertices, geofile_vertex_size(entry->precision) * entry->vertex_count,
+                                       entry->indices, entry->index_count);
+    PS_TRACE_END(zone);
+    return hash == entry->hash;
+}
+
+PsArray OF(PsGHPolygon4d *) *ps_geofile_entry_to_polygons4d(const PsGeofileEntry *entry) {
+    if (entry->kind != PS_GEOFILE_POLYGONS) {
+        return NULL;
+    }
+    // The counts come from the file, so check they add up before trusting them
+    uint64_t total = 0;
+    for (size_t i = 0; i < entry->index_count; ++i) {
+        total += entry->indices[i];
+    }
+    if (total != entry->vertex_count) {
+        return NULL;
+    }
+    PsArray OF(PsGHPolygon4d *) *polygons = ps_array_new(entry->index_count ? entry->index_count : 1);
+    const float *floats = entry->vertices;
+    const double *doubles = entry->vertices;
+    size_t vertex = 0;
+    for (size_t i = 0; i < entry->index_count; ++i) {
+        PsGHPolygon4d *poly = ps_ghpolygon4d_new();
+        for (uint32_t j = 0; j < entry->indices[i]; ++j, ++vertex) {
+            const Ps4d point = entry->precision == PS_GEOFILE_4D
+                               ? ps_4d(doubles[vertex * 4], doubles[vertex * 4 + 1], doubles[vertex * 4 + 2],
+                                       doubles[vertex * 4 + 3])
+                               : ps_4d(floats[vertex * 4], floats[vertex * 4 + 1], floats[vertex * 4 + 2],
+                                       floats[vertex * 4 + 3]);
+            ps_ghpolygon4d_add(poly, &point);
+        }
+        ps_array_add(polygons, poly);
+    }
+    return polygons;
+}
+
+static void geofile_writer_write(PsGeofileWriter *writer, const void *data, size_t size) {
+    if (!writer->failed && size > 0 && fwrite(data, 1, size, writer->file) != size) {
+        writer->failed = true;
+    }
+    writer->offset += size;
+}
+
+static void geofile_writer_align(PsGeofileWriter *writer) {
+    static const unsigned char zeros[GEOFILE_ALIGNMENT] = {0};
+    geofile_writer_write(writer, zeros, (GEOFILE_ALIGNMENT - writer->offset % GEOFILE_ALIGNMENT) % GEOFILE_ALIGNMENT);
+}
+
+PsGeofileWriter *ps_geofile_writer_new(const char *path) {
+    PsGeofileWriter *writer = calloc(1, sizeof(PsGeofileWriter));
+    const size_t length = strlen(path) + 48;
+    writer->path = strdup(path);
+    writer->temp_path = malloc(length);
+    // Unique per writer, so processes and threads writing the same path don't share a temporary file
+    static atomic_uint serial;
+    snprintf(writer->temp_path, length, "%s.tmp.%ld.%u", path, (long) getpid(), atomic_fetch_add(&serial, 1));
+    writer->file = fopen(writer->temp_path, "wb");
+    if (!writer->file) {
+        free(writer->temp_path);
+        free(writer->path);
+        free(writer);
+        return NULL;
+    }
+    // Filled in by close
+    const GeofileHeader header = {0};
+    geofile_writer_write(writer, &header, sizeof(header));
+    return writer;
+}
+
+bool ps_geofile_writer_add(PsGeofileWriter *writer, const PsGeofileEntry *entry) {
+    if (writer->count == writer->capacity) {
+        const size_t capacity = writer->capacity ? writer->capacity * 2 : 16;
+        GeofileRecord *records = realloc(writer->records, sizeof(GeofileRecord) * capacity);
+        if (!records) {
+            writer->failed = true;
+            return false;
+        }
+        writer->records = records;
+        writer->capacity = capacity;
+    }
+    const size_t vertices_size = geofile_vertex_size(entry->precision) * entry->vertex_count;
+    GeofileRecord *record = &writer->records[writer->count++];
+    *record = (GeofileRecord) {
+            .kind = entry->kind,
+            .precision = entry->precision,
+            .key = entry->key,
+            .hash = geofile_hash(entry->vertices, vertices_size, entry->indices, entry->index_count),
+            .vertex_count = entry->vertex_count,
+            .index_count = entry->index_count
+    };
+    geofile_writer_align(writer);
+    record->vertex_offset = writer->offset;
+    geofile_writer_write(writer, entry->vertices, vertices_size);
+    geofile_writer_align(writer);
+    record->index_offset = writer->offset;
+    geofile_writer_write(writer, entry->indices, sizeof(uint32_t) * entry->index_count);
+    return !writer->failed;
+}
+
+bool ps_geofile_writer_add_mesh(PsGeofileWriter *writer, uint64_t key, const PsMesh *mesh) {
+    const PsGeofileEntry entry = {
+            .kind = PS_GEOFILE_MESH,
+            .precision = PS_GEOFILE_4F,
+            .key = key,
+            .vertices = mesh->vertices,
+            .vertex_count = mesh->vertex_count,
+            .indices = mesh->indices,
+            .index_count = mesh->indices ? mesh->triangle_count * 3 : 0
+    };
+    return ps_geofile_writer_add(writer, &entry);
+}
+
+static bool geofile_copy_point(Ps4d *point, void *userdata) {
+    double **cursor = userdata;
+    memcpy(*cursor, point, sizeof(double) * 4);
+    *cursor += 4;
+    return false;
+}
+
+bool ps_geofile_writer_add_polygons4d(PsGeofileWriter *writer, uint64_t key,
+                                      PsArray OF(PsGHPolygon4d *) *polygons) {
+    const size_t count = ps_array_get_length(polygons);
+    size_t vertex_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        vertex_count += ps_ghpolygon4d_get_size(ps_array_get(polygons, i));
+    }
+    double *vertices = malloc(sizeof(double) * 4 * (vertex_count ? vertex_count : 1));
+    uint32_t *lengths = malloc(sizeof(uint32_t) * (count ? count : 1));
+    double *cursor = vertices;
+    for (size_t i = 0; i < count; ++i) {
+        PsGHPolygon4d *poly = ps_array_get(polygons, i);
+        lengths[i] = (uint32_t) ps_ghpolygon4d_get_size(poly);
+        ps_ghpolygon4d_foreach(poly, geofile_copy_point, &cursor);
+    }
+    const PsGeofileEntry entry = {
+            .kind = PS_GEOFILE_POLYGONS,
+            .precision = PS_GEOFILE_4D,
+            .key = key,
+            .vertices = vertices,
+            .vertex_count = vertex_count,
+            .indices = lengths,
+            .index_count = count
+    };
+    const bool ok = ps_geofile_writer_add(writer, &entry);
+    free(lengths);
+    free(vertices);
+    return ok;
+}
+
+static int geofile_compare_records(const void *lhs, const void *rhs) {
+    const uint64_t a = ((const GeofileRecord *) lhs)->key, b = ((const GeofileRecord *) rhs)->key;
+    return (a > b) - (a < b);
+}
+
+bool ps_geofile_writer_close(PsGeofileWriter *writer) {
+    if (writer->count > 0) {
+        qsort(writer->records, writer->count, sizeof(GeofileRecord), geofile_compare_records);
+    }
+    geofile_writer_align(writer);
+    GeofileHeader header = {
+            .version = PS_GEOFILE_VERSION,
+            .byte_order = GEOFILE_BYTE_ORDER,
+            .toc_offset = writer->offset,
+            .entry_count = writer->count,
+            .toc_hash = ps_hash64(writer->records, sizeof(GeofileRecord) * writer->count, 0)
+    };
+    memcpy(header.magic, geofile_magic, sizeof(geofile_magic));
+    geofile_writer_write(writer, writer->records, sizeof(GeofileRecord) * writer->count);
+    header.file_size = writer->offset;
+    bool ok = !writer->failed && fseek(writer->file, 0, SEEK_SET) == 0 &&
+              fwrite(&header, sizeof(header), 1, writer->file) == 1;
+    ok = fclose(writer->file) == 0 && ok;
+    ok = ok && rename(writer->temp_path, writer->path) == 0;
+    if (!ok) {
+        remove(writer->temp_path);
+    }
+    free(writer->records);
+    free(writer->temp_path);
+    free(writer->path);
+    free(writer);
+    return ok;
+}
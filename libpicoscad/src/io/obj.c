@@ -0,0 +1,200 @@
+#include <picoscad/io/obj.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <picoscad/sys/file.h>
+#include <picoscad/sys/trace.h>
+
+#include "text.h"
+
+/*
+ * Chunks are parsed independently, so a chunk can't know how many vertices came
+ * before it. Absolute indices don't care; relative ones are recorded as fixups
+ * against the chunk's own vertex count and resolved once every chunk is done.
+ */
+
+typedef struct ObjFixup {
+    size_t position;
+    long index;
+} ObjFixup;
+
+typedef struct ObjCorner {
+    long index;
+    bool relative;
+} ObjCorner;
+
+typedef struct ObjChunk {
+    const char *begin;
+    const char *end;
+    IoBuffer vertices;
+    IoBuffer indices;
+    IoBuffer fixups;
+    const char *error;
+} ObjChunk;
+
+static bool obj_emit(ObjChunk *chunk, ObjCorner corner) {
+    uint32_t *index = io_buffer_push(&chunk->indices);
+    if (!index) {
+        chunk->error = "out of memory";
+        return false;
+    }
+    if (!corner.relative) {
+        *index = (uint32_t) corner.index;
+        return true;
+    }
+    ObjFixup *fixup = io_buffer_push(&chunk->fixups);
+    if (!fixup) {
+        chunk->error = "out of memory";
+        return false;
+    }
+    *index = 0;
+    *fixup = (ObjFixup) {chunk->indices.length - 1, corner.index};
+    return true;
+}
+
+static bool obj_parse_face(ObjChunk *chunk, const char *cursor) {
+    const char *end = chunk->end;
+    ObjCorner first = {0}, prev = {0};
+    size_t corners = 0;
+    while (true) {
+        cursor = io_skip_blanks(cursor, end);
+        if (cursor == end || *cursor == '\r' || *cursor == '\n' || *cursor == '#') {
+            break;
+        }
+        long index;
+        if (!io_parse_long(&cursor, end, &index) || index == 0 || index > (long) UINT32_MAX + 1) {
+            chunk->error = "malformed face";
+            return false;
+        }
+        // Skip the texture and normal indices of v/vt/vn
+        while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n') {
+            cursor++;
+        }
+        // -1 is the last vertex before this line
+        const ObjCorner corner = index > 0 ? (ObjCorner) {index - 1, false}
+                                           : (ObjCorner) {(long) chunk->vertices.length + index, true};
+        if (corners == 0) {
+            first = corner;
+        } else if (corners >= 2) {
+            if (!obj_emit(chunk, first) || !obj_emit(chunk, prev) || !obj_emit(chunk, corner)) {
+                return false;
+            }
+        }
+        prev = corner;
+        corners++;
+    }
+    if (corners < 3) {
+        chunk->error = "face with less than 3 vertices";
+        return false;
+    }
+    return true;
+}
+
+static void obj_parse_chunk(size_t index, void *userdata) {
+    ObjChunk *chunk = &((ObjChunk *) userdata)[index];
+    const char *end = chunk->end;
+    for (const char *line = chunk->begin; line < end; line = io_next_line(line, end)) {
+        const char *cursor = io_skip_blanks(line, end);
+        if (io_starts_with(cursor, end, "v")) {
+            cursor += 1;
+            float x, y, z;
+            if (!io_parse_float(&cursor, end, &x) || !io_parse_float(&cursor, end, &y) ||
+                !io_parse_float(&cursor, end, &z)) {
+                chunk->error = "malformed vertex";
+                return;
+            }
+            Ps4f *vertex = io_buffer_push(&chunk->vertices);
+            if (!vertex) {
+                chunk->error = "out of memory";
+                return;
+            }
+            *vertex = ps_4f(x, y, z, 1.0f);
+        } else if (io_starts_with(cursor, end, "f")) {
+            if (!obj_parse_face(chunk, cursor + 1)) {
+                return;
+            }
+        }
+    }
+}
+
+static PsMesh *obj_assemble(ObjChunk *chunks, size_t count, const char **error) {
+    size_t vertex_count = 0, index_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (chunks[i].error) {
+            *error = chunks[i].error;
+            return NULL;
+        }
+        vertex_count += chunks[i].vertices.length;
+        index_count += chunks[i].indices.length;
+    }
+    if (vertex_count > (size_t) UINT32_MAX + 1) {
+        *error = "too many vertices";
+        return NULL;
+    }
+    Ps4f *vertices = vertex_count ? aligned_alloc(16, sizeof(Ps4f) * vertex_count) : NULL;
+    uint32_t *indices = malloc(sizeof(uint32_t) * (index_count ? index_count : 1));
+    if ((vertex_count && !vertices) || !indices) {
+        free(vertices);
+        free(indices);
+        *error = "out of memory";
+        return NULL;
+    }
+    size_t vertex_offset = 0, index_offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        ObjChunk *chunk = &chunks[i];
+        memcpy(vertices + vertex_offset, chunk->vertices.data, sizeof(Ps4f) * chunk->vertices.length);
+        memcpy(indices + index_offset, chunk->indices.data, sizeof(uint32_t) * chunk->indices.length);
+        const ObjFixup *fixups = chunk->fixups.data;
+        for (size_t j = 0; j < chunk->fixups.length; ++j) {
+            const long index = (long) vertex_offset + fixups[j].index;
+            // Out of range either way, the check below catches it
+            indices[index_offset + fixups[j].position] = index < 0 ? UINT32_MAX : (uint32_t) index;
+        }
+        vertex_offset += chunk->vertices.length;
+        index_offset += chunk->indices.length;
+    }
+    for (size_t i = 0; i < index_count; ++i) {
+        if (indices[i] >= vertex_count) {
+            free(vertices);
+            free(indices);
+            *error = "face index out of range";
+            return NULL;
+        }
+    }
+    return ps_mesh_new_with_arrays(vertices, vertex_count, indices, index_count / 3);
+}
+
+PsMesh *ps_obj_read(const char *path, const char **error) {
+    PsMappedFile file;
+    if (!ps_file_map(path, &file)) {
+        *error = strerror(errno);
+        return NULL;
+    }
+    PS_TRACE_BEGIN(zone, "obj/read");
+    const size_t max_chunks = io_chunk_count(file.size);
+    const char **bounds = malloc(sizeof(const char *) * (max_chunks + 1));
+    const size_t count = io_split_lines(file.data, file.size, max_chunks, bounds);
+    ObjChunk *chunks = calloc(count ? count : 1, sizeof(ObjChunk));
+    for (size_t i = 0; i < count; ++i) {
+        chunks[i].begin = bounds[i];
+        chunks[i].end = bounds[i + 1];
+        io_buffer_init(&chunks[i].vertices, sizeof(Ps4f));
+        io_buffer_init(&chunks[i].indices, sizeof(uint32_t));
+        io_buffer_init(&chunks[i].fixups, sizeof(ObjFixup));
+    }
+    free(bounds);
+    io_parallel(count, obj_parse_chunk, chunks);
+
+    PsMesh *mesh = obj_assemble(chunks, count, error);
+    for (size_t i = 0; i < count; ++i) {
+        io_buffer_destroy(&chunks[i].vertices);
+        io_buffer_destroy(&chunks[i].indices);
+        io_buffer_destroy(&chunks[i].fixups);
+    }
+    free(chunks);
+    PS_TRACE_END(zone);
+    ps_file_unmap(&file);
+    return mesh;
+}
@@ -0,0 +1,330 @@
+#include <picoscad/io/stl.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <picoscad/sys/file.h>
+#include <picoscad/sys/trace.h>
+
+#include "text.h"
+#include "../kernel/kernels.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "binary STL is little-endian, records are copied straight from memory"
+#endif
+
+#define STL_BUFFER_SIZE (1 << 20)
+#define STL_HEADER_SIZE 80
+#define STL_RECORD_SIZE 50
+// A facet in ASCII is 7 lines of at most 3 %.9g floats
+#define STL_ASCII_FACET_MAX 512
+
+struct PsStlWriter {
+    int fd;
+    PsStlFormat format;
+    bool failed;
+    uint64_t triangles;
+    size_t used;
+    char name[STL_HEADER_SIZE];
+    unsigned char buffer[STL_BUFFER_SIZE];
+};
+
+static bool stl_write_all(int fd, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= (size_t) written;
+    }
+    return true;
+}
+
+static bool stl_flush(PsStlWriter *writer) {
+    if (writer->used > 0 && !writer->failed) {
+        PS_TRACE_BEGIN(zone, "stl/flush");
+        writer->failed = !stl_write_all(writer->fd, writer->buffer, writer->used);
+        PS_TRACE_END(zone);
+    }
+    writer->used = 0;
+    return !writer->failed;
+}
+
+static Ps4f stl_normal(Ps4f a, Ps4f b, Ps4f c) {
+    const Ps4f normal = ps_4f_cross(ps_4f_sub(b, a), ps_4f_sub(c, a));
+    const Ps4f square_length = ps_4f_dot3(normal, normal);
+    // Degenerate triangles get a zero normal rather than NaNs
+    if (!(ps_4f_x(square_length) > 0.0f)) {
+        return ps_4f_zero();
+    }
+    return ps_4f_mul(normal, ps_4f_rsqrt(square_length));
+}
+
+static void stl_write_binary(PsStlWriter *writer, Ps4f a, Ps4f b, Ps4f c) {
+    const Ps4f normal = stl_normal(a, b, c);
+    // Pack normal, a, b, c into 12 floats: nx ny nz ax | ay az bx by | bz cx cy cz
+    const Ps4f nz_ax = ps_4f_shuffle(normal, a, PS_SWIZZLE_XXZZ);
+    const Ps4f bz_cx = ps_4f_shuffle(b, c, PS_SWIZZLE_XXZZ);
+    _Alignas(Ps4f) float packed[12];
+    ps_4f_store(ps_4f_shuffle(normal, nz_ax, PS_SWIZZLE_ZXYX), &packed[0]);
+    ps_4f_store(ps_4f_shuffle(a, b, PS_SWIZZLE_YXZY), &packed[4]);
+    ps_4f_store(ps_4f_shuffle(bz_cx, c, PS_SWIZZLE_ZYZX), &packed[8]);
+    unsigned char *record = writer->buffer + writer->used;
+    memcpy(record, packed, sizeof(packed));
+    // Attribute byte count, always 0
+    record[48] = 0;
+    record[49] = 0;
+    writer->used += STL_RECORD_SIZE;
+}
+
+static void stl_write_ascii(PsStlWriter *writer, Ps4f a, Ps4f b, Ps4f c) {
+    const Ps4f normal = stl_normal(a, b, c);
+    int length = snprintf((char *) writer->buffer + writer->used, STL_BUFFER_SIZE - writer->used,
+                          "facet normal %.9g %.9g %.9g\n"
+                          " outer loop\n"
+                          "  vertex %.9g %.9g %.9g\n"
+                          "  vertex %.9g %.9g %.9g\n"
+                          "  vertex %.9g %.9g %.9g\n"
+                          " endloop\n"
+                          "endfacet\n",
+                          ps_4f_x(normal), ps_4f_y(normal), ps_4f_z(normal),
+                          ps_4f_x(a), ps_4f_y(a), ps_4f_z(a),
+                          ps_4f_x(b), ps_4f_y(b), ps_4f_z(b),
+                          ps_4f_x(c), ps_4f_y(c), ps_4f_z(c));
+    writer->used += (size_t) length;
+}
+
+static bool stl_write_triangle(PsStlWriter *writer, Ps4f a, Ps4f b, Ps4f c) {
+    if (writer->format == PS_STL_BINARY) {
+        if (writer->used + STL_RECORD_SIZE > STL_BUFFER_SIZE && !stl_flush(writer)) {
+            return false;
+        }
+        stl_write_binary(writer, a, b, c);
+    } else {
+        if (writer->used + STL_ASCII_FACET_MAX > STL_BUFFER_SIZE && !stl_flush(writer)) {
+            return false;
+        }
+        stl_write_ascii(writer, a, b, c);
+    }
+    writer->triangles++;
+    return true;
+}
+
+PsStlWriter *ps_stl_writer_new(int fd, PsStlFormat format, const char *name, uint32_t triangle_count) {
+    PsStlWriter *writer = malloc(sizeof(PsStlWriter));
+    if (!writer) {
+        return NULL;
+    }
+    writer->fd = fd;
+    writer->format = format;
+    writer->failed = false;
+    writer->triangles = 0;
+    writer->used = 0;
+    memset(writer->name, 0, sizeof(writer->name));
+    strncpy(writer->name, name ? name : "picoscad", sizeof(writer->name) - 1);
+    if (format == PS_STL_BINARY) {
+        // Binary headers must not start with "solid", readers would take the file for ASCII
+        memcpy(writer->buffer, writer->name, STL_HEADER_SIZE);
+        if (strncmp(writer->name, "solid", 5) == 0) {
+            writer->buffer[0] = '_';
+        }
+        memcpy(writer->buffer + STL_HEADER_SIZE, &triangle_count, sizeof(triangle_count));
+        writer->used = STL_HEADER_SIZE + sizeof(triangle_count);
+    } else {
+        writer->used = (size_t) snprintf((char *) writer->buffer, STL_BUFFER_SIZE, "solid %s\n", writer->name);
+    }
+    return writer;
+}
+
+bool ps_stl_writer_add(PsStlWriter *writer, const Ps4f *corners, size_t triangles) {
+    PS_TRACE_BEGIN(zone, "stl/add");
+    for (size_t i = 0; i < triangles && !writer->failed; ++i) {
+        stl_write_triangle(writer, corners[i * 3], corners[i * 3 + 1], corners[i * 3 + 2]);
+    }
+    PS_TRACE_END(zone);
+    return !writer->failed;
+}
+
+bool ps_stl_writer_add_indexed(PsStlWriter *writer, const Ps4f *vertices, const uint32_t *indices,
+                               size_t triangles) {
+    PS_TRACE_BEGIN(zone, "stl/add");
+    for (size_t i = 0; i < triangles && !writer->failed; ++i) {
+        stl_write_triangle(writer, vertices[indices[i * 3]], vertices[indices[i * 3 + 1]],
+                           vertices[indices[i * 3 + 2]]);
+    }
+    PS_TRACE_END(zone);
+    return !writer->failed;
+}
+
+bool ps_stl_writer_close(PsStlWriter *writer) {
+    if (writer->format == PS_STL_ASCII) {
+        if (writer->used + sizeof(writer->name) + 16 > STL_BUFFER_SIZE) {
+            stl_flush(writer);
+        }
+        writer->used += (size_t) snprintf((char *) writer->buffer + writer->used, STL_BUFFER_SIZE - writer->used,
+                                          "endsolid %s\n", writer->name);
+    }
+    bool ok = stl_flush(writer);
+    if (ok && writer->format == PS_STL_BINARY) {
+        if (writer->triangles > UINT32_MAX) {
+            ok = false;
+        } else {
+            // Patch the count when fd can seek, pipes and O_APPEND fds keep the one given up front
+            const uint32_t count = (uint32_t) writer->triangles;
+            const off_t size = (off_t) (STL_HEADER_SIZE + sizeof(count) + writer->triangles * STL_RECORD_SIZE);
+            const off_t end = lseek(writer->fd, 0, SEEK_CUR);
+            const int flags = fcntl(writer->fd, F_GETFL);
+            if (end >= size && flags >= 0 && !(flags & O_APPEND)) {
+                ok = pwrite(writer->fd, &count, sizeof(count), end - size + STL_HEADER_SIZE) == (ssize_t) sizeof(count);
+            }
+        }
+    }
+    free(writer);
+    return ok;
+}
+
+typedef struct StlBinaryRead {
+    const unsigned char *records;
+    size_t count;
+    size_t chunks;
+    Ps4f *vertices;
+} StlBinaryRead;
+
+static void stl_decode_chunk(size_t index, void *userdata) {
+    StlBinaryRead *read = userdata;
+    const size_t begin = read->count * index / read->chunks, end = read->count * (index + 1) / read->chunks;
+    ps_kernels()->stl_decode(read->records + begin * STL_RECORD_SIZE, end - begin, read->vertices + begin * 3);
+}
+
+static PsMesh *stl_read_binary(const unsigned char *data, size_t count, const char **error) {
+    Ps4f *vertices = NULL;
+    if (count > 0) {
+        vertices = aligned_alloc(16, sizeof(Ps4f) * 3 * count);
+        if (!vertices) {
+            *error = "out of memory";
+            return NULL;
+        }
+    }
+    StlBinaryRead read = {data + STL_HEADER_SIZE + sizeof(uint32_t), count,
+                          io_chunk_count(count * STL_RECORD_SIZE), vertices};
+    io_parallel(read.chunks, stl_decode_chunk, &read);
+    return ps_mesh_new_with_arrays(vertices, count * 3, NULL, count);
+}
+
+typedef struct StlChunk {
+    const char *begin;
+    const char *end;
+    IoBuffer vertices;
+    const char *error;
+} StlChunk;
+
+static void stl_parse_chunk(size_t index, void *userdata) {
+    StlChunk *chunk = &((StlChunk *) userdata)[index];
+    const char *end = chunk->end;
+    // Only the corners matter, facet normals are recomputed from the winding anyway
+    for (const char *line = chunk->begin; line < end; line = io_next_line(line, end)) {
+        const char *cursor = io_skip_blanks(line, end);
+        if (!io_starts_with(cursor, end, "vertex")) {
+            continue;
+        }
+        cursor += 6;
+        float x, y, z;
+        if (!io_parse_float(&cursor, end, &x) || !io_parse_float(&cursor, end, &y) ||
+            !io_parse_float(&cursor, end, &z)) {
+            chunk->error = "malformed vertex";
+            return;
+        }
+        Ps4f *vertex = io_buffer_push(&chunk->vertices);
+        if (!vertex) {
+            chunk->error = "out of memory";
+            return;
+        }
+        *vertex = ps_4f(x, y, z, 1.0f);
+    }
+}
+
+static PsMesh *stl_read_ascii(const char *data, size_t size, const char **error) {
+    const size_t max_chunks = io_chunk_count(size);
+    const char **bounds = malloc(sizeof(const char *) * (max_chunks + 1));
+    const size_t count = io_split_lines(data, size, max_chunks, bounds);
+    StlChunk *chunks = calloc(count, sizeof(StlChunk));
+    for (size_t i = 0; i < count; ++i) {
+        chunks[i].begin = bounds[i];
+        chunks[i].end = bounds[i + 1];
+        io_buffer_init(&chunks[i].vertices, sizeof(Ps4f));
+    }
+    free(bounds);
+    io_parallel(count, stl_parse_chunk, chunks);
+
+    size_t vertex_count = 0;
+    *error = NULL;
+    for (size_t i = 0; i < count; ++i) {
+        vertex_count += chunks[i].vertices.length;
+        if (!*error) {
+            *error = chunks[i].error;
+        }
+    }
+    if (!*error && vertex_count % 3 != 0) {
+        *error = "facet without 3 vertices";
+    }
+    Ps4f *vertices = NULL;
+    if (!*error && vertex_count > 0) {
+        vertices = aligned_alloc(16, sizeof(Ps4f) * vertex_count);
+        if (!vertices) {
+            *error = "out of memory";
+        }
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (vertices) {
+            memcpy(vertices + offset, chunks[i].vertices.data, sizeof(Ps4f) * chunks[i].vertices.length);
+            offset += chunks[i].vertices.length;
+        }
+        io_buffer_destroy(&chunks[i].vertices);
+    }
+    free(chunks);
+    if (*error) {
+        return NULL;
+    }
+    return ps_mesh_new_with_arrays(vertices, vertex_count, NULL, vertex_count / 3);
+}
+
+PsMesh *ps_stl_read(const char *path, const char **error) {
+    PsMappedFile file;
+    if (!ps_file_map(path, &file)) {
+        *error = strerror(errno);
+        return NULL;
+    }
+    PS_TRACE_BEGIN(zone, "stl/read");
+    PsMesh *mesh = NULL;
+    const unsigned char *data = file.data;
+    uint32_t count = 0;
+    if (file.size >= STL_HEADER_SIZE + sizeof(count)) {
+        memcpy(&count, data + STL_HEADER_SIZE, sizeof(count));
+    }
+    const uint64_t binary_size = STL_HEADER_SIZE + sizeof(count) + (uint64_t) count * STL_RECORD_SIZE;
+    // Some binary exporters start the header with "solid" too, a size that matches the count settles it
+    const bool solid = file.size >= 5 && memcmp(data, "solid", 5) == 0;
+    if (file.size >= STL_HEADER_SIZE + sizeof(count) && file.size == binary_size) {
+        mesh = stl_read_binary(data, count, error);
+    } else if (solid) {
+        mesh = stl_read_ascii(file.data, file.size, error);
+    } else if (file.size >= STL_HEADER_SIZE + sizeof(count) && file.size > binary_size) {
+        // Trailing bytes after the last record
+        mesh = stl_read_binary(data, count, error);
+    } else {
+        *error = file.size < binary_size ? "truncated binary STL" : "not an STL file";
+    }
+    PS_TRACE_END(zone);
+    ps_file_unmap(&file);
+    return mesh;
+}
@@ -0,0 +1,540 @@
+#include <picoscad/io/svg.h>
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include <picoscad/sys/file.h>
+#include <picoscad/sys/trace.h>
+
+#include "flatten.h"
+
+/*
+ * A single forward scan over the tags: everything but the handful of shape
+ * elements is skipped, and their attributes are parsed in place from the
+ * mapping. There is no tree: the only state kept across tags is a stack with
+ * the transform of each open element, so nesting affects transforms but
+ * styles are not seen.
+ */
+
+typedef struct SvgRange {
+    const char *begin;
+    const char *end;
+} SvgRange;
+
+typedef struct SvgAttributes {
+    SvgRange d, points, x, y, width, height, cx, cy, r, rx, ry, transform;
+    // Written as <name/>, so it has no content and no closing tag
+    bool closed;
+} SvgAttributes;
+
+static bool svg_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool svg_is_name(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == ':' || c == '_' ||
+           c == '-' || c == '.';
+}
+
+static const char *svg_skip_separators(const char *p, const char *end) {
+    while (p < end && (svg_is_space(*p) || *p == ',')) {
+        p++;
+    }
+    return p;
+}
+
+static bool svg_number(const char **p, const char *end, double *out) {
+    *p = svg_skip_separators(*p, end);
+    return io_parse_double(p, end, out);
+}
+
+// Arc flags may be written without separators, as in "a1 1 0 10 2 2"
+static bool svg_flag(const char **p, const char *end, bool *out) {
+    *p = svg_skip_separators(*p, end);
+    if (*p == end || (**p != '0' && **p != '1')) {
+        return false;
+    }
+    *out = *(*p)++ == '1';
+    return true;
+}
+
+// Lengths like "10mm" or "50%" keep their number, units are not converted
+static double svg_length(SvgRange range, double fallback) {
+    double value;
+    const char *p = range.begin;
+    return range.begin && svg_number(&p, range.end, &value) ? value : fallback;
+}
+
+// Only fails when out of memory, the caller checks whether the sink asked to stop
+static bool svg_emit(FlattenContour *contour, const char **error) {
+    if (!flatten_emit(contour) && contour->failed) {
+        *error = "out of memory";
+        return false;
+    }
+    return true;
+}
+
+static FlattenPoint svg_reflect(FlattenPoint control, FlattenPoint about) {
+    return (FlattenPoint) {2.0 * about.x - control.x, 2.0 * about.y - control.y};
+}
+
+// Endpoint to center conversion, SVG 1.1 appendix F.6.5
+static void svg_arc(FlattenContour *contour, FlattenPoint p0, double rx, double ry, double degrees, bool large,
+                    bool sweep, FlattenPoint p1) {
+    rx = fabs(rx);
+    ry = fabs(ry);
+    if (rx == 0.0 || ry == 0.0) {
+        flatten_point(contour, p1.x, p1.y);
+        return;
+    }
+    if (p0.x == p1.x && p0.y == p1.y) {
+        return;
+    }
+    const double phi = degrees * FLATTEN_TAU / 360.0, cos_phi = cos(phi), sin_phi = sin(phi);
+    const double dx = (p0.x - p1.x) / 2.0, dy = (p0.y - p1.y) / 2.0;
+    const double x1 = cos_phi * dx + sin_phi * dy, y1 = -sin_phi * dx + cos_phi * dy;
+    // Radii too small to span the endpoints are scaled up until they just do
+    const double lambda = x1 * x1 / (rx * rx) + y1 * y1 / (ry * ry);
+    if (lambda > 1.0) {
+        rx *= sqrt(lambda);
+        ry *= sqrt(lambda);
+    }
+    const double numerator = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+    const double denominator = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+    double coefficient = sqrt(fmax(0.0, numerator / denominator));
+    if (large == sweep) {
+        coefficient = -coefficient;
+    }
+    const double cx1 = coefficient * rx * y1 / ry, cy1 = -coefficient * ry * x1 / rx;
+    const FlattenPoint center = {cos_phi * cx1 - sin_phi * cy1 + (p0.x + p1.x) / 2.0,
+                                 sin_phi * cx1 + cos_phi * cy1 + (p0.y + p1.y) / 2.0};
+    const double start = atan2((y1 - cy1) / ry, (x1 - cx1) / rx);
+    double delta = atan2((-y1 - cy1) / ry, (-x1 - cx1) / rx) - start;
+    if (!sweep && delta > 0.0) {
+        delta -= FLATTEN_TAU;
+    } else if (sweep && delta < 0.0) {
+        delta += FLATTEN_TAU;
+    }
+    flatten_arc(contour, center, rx, ry, phi, start, delta);
+}
+
+static bool svg_path(FlattenContour *contour, SvgRange d, const char **error) {
+    const char *p = d.begin, *end = d.end;
+    FlattenPoint current = {0.0, 0.0}, start = {0.0, 0.0}, control = {0.0, 0.0};
+    char command = 0, previous = 0;
+    while (true) {
+        p = svg_skip_separators(p, end);
+        if (p == end) {
+            break;
+        }
+        if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')) {
+            command = *p++;
+        } else if (!command) {
+            *error = "malformed path data";
+            return false;
+        }
+        const char executed = command;
+        const bool relative = command >= 'a';
+        const double ox = relative ? current.x : 0.0, oy = relative ? current.y : 0.0;
+        double v[7];
+        bool large, sweep;
+        bool ok = true;
+        switch (command | 0x20) {
+            case 'm':
+                ok = svg_number(&p, end, &v[0]) && svg_number(&p, end, &v[1]);
+                if (ok) {
+                    if (!svg_emit(contour, error)) {
+                        return false;
+                    }
+                    current = start = (FlattenPoint) {ox + v[0], oy + v[1]};
+                    flatten_point(contour, current.x, current.y);
+                    // Further pairs are implicit lineto commands
+                    command = relative ? 'l' : 'L';
+                }
+                break;
+            case 'l':
+                ok = svg_number(&p, end, &v[0]) && svg_number(&p, end, &v[1]);
+                current = (FlattenPoint) {ox + v[0], oy + v[1]};
+                break;
+            case 'h':
+                ok = svg_number(&p, end, &v[0]);
+                current.x = ox + v[0];
+                break;
+            case 'v':
+                ok = svg_number(&p, end, &v[0]);
+                current.y = oy + v[0];
+                break;
+            case 'c':
+            case 's': {
+                const bool smooth = (command | 0x20) == 's';
+                FlattenPoint p1 = current;
+                if (smooth) {
+                    if ((previous | 0x20) == 'c' || (previous | 0x20) == 's') {
+                        p1 = svg_reflect(control, current);
+                    }
+                } else {
+                    ok = svg_number(&p, end, &v[0]) && svg_number(&p, end, &v[1]);
+                    p1 = (FlattenPoint) {ox + v[0], oy + v[1]};
+                }
+                ok = ok && svg_number(&p, end, &v[2]) && svg_number(&p, end, &v[3]) && svg_number(&p, end, &v[4]) &&
+                     svg_number(&p, end, &v[5]);
+                if (ok) {
+                    const FlattenPoint p2 = {ox + v[2], oy + v[3]}, p3 = {ox + v[4], oy + v[5]};
+                    flatten_cubic(contour, current, p1, p2, p3);
+                    control = p2;
+                    current = p3;
+                }
+                break;
+            }
+            case 'q':
+            case 't': {
+                const bool smooth = (command | 0x20) == 't';
+                FlattenPoint p1 = current;
+                if (smooth) {
+                    if ((previous | 0x20) == 'q' || (previous | 0x20) == 't') {
+                        p1 = svg_reflect(control, current);
+                    }
+                } else {
+                    ok = svg_number(&p, end, &v[0]) && svg_number(&p, end, &v[1]);
+                    p1 = (FlattenPoint) {ox + v[0], oy + v[1]};
+                }
+                ok = ok && svg_number(&p, end, &v[2]) && svg_number(&p, end, &v[3]);
+                if (ok) {
+                    const FlattenPoint p2 = {ox + v[2], oy + v[3]};
+                    flatten_quadratic(contour, current, p1, p2);
+                    control = p1;
+                    current = p2;
+                }
+                break;
+            }
+            case 'a':
+                ok = svg_number(&p, end, &v[0]) && svg_number(&p, end, &v[1]) && svg_number(&p, end, &v[2]) &&
+                     svg_flag(&p, end, &large) && svg_flag(&p, end, &sweep) && svg_number(&p, end, &v[3]) &&
+                     svg_number(&p, end, &v[4]);
+                if (ok) {
+                    const FlattenPoint p1 = {ox + v[3], oy + v[4]};
+                    svg_arc(contour, current, v[0], v[1], v[2], large, sweep, p1);
+                    current = p1;
+                }
+                break;
+            case 'z':
+                if (!svg_emit(contour, error)) {
+                    return false;
+                }
+                // Drawing on without a moveto starts a new subpath at the same point
+                current = start;
+                flatten_point(contour, current.x, current.y);
+                // Z takes no arguments, a number after it is an error
+                command = 0;
+                break;
+            default:
+                *error = "unsupported path command";
+                return false;
+        }
+        if (!ok) {
+            *error = "malformed path data";
+            return false;
+        }
+        if ((executed | 0x20) == 'l' || (executed | 0x20) == 'h' || (executed | 0x20) == 'v') {
+            flatten_point(contour, current.x, current.y);
+        }
+        previous = executed;
+    }
+    return svg_emit(contour, error);
+}
+
+static bool svg_points(FlattenContour *contour, SvgRange points, const char **error) {
+    const char *p = points.begin, *end = points.end;
+    while (svg_skip_separators(p, end) < end) {
+        double x, y;
+        if (!svg_number(&p, end, &x) || !svg_number(&p, end, &y)) {
+            *error = "malformed points";
+            return false;
+        }
+        flatten_point(contour, x, y);
+    }
+    return svg_emit(contour, error);
+}
+
+static bool svg_rect(FlattenContour *contour, const SvgAttributes *attributes, const char **error) {
+    const double x = svg_length(attributes->x, 0.0), y = svg_length(attributes->y, 0.0);
+    const double width = svg_length(attributes->width, 0.0), height = svg_length(attributes->height, 0.0);
+    if (width <= 0.0 || height <= 0.0) {
+        return true;
+    }
+    // A missing corner radius takes the other one, both are clamped to half the side
+    double rx = svg_length(attributes->rx, -1.0), ry = svg_length(attributes->ry, -1.0);
+    rx = rx < 0.0 ? (ry < 0.0 ? 0.0 : ry) : rx;
+    ry = ry < 0.0 ? rx : ry;
+    rx = fmin(rx, width / 2.0);
+    ry = fmin(ry, height / 2.0);
+    const FlattenPoint corners[4] = {
+            {x + width - rx, y + ry},
+            {x + width - rx, y + height - ry},
+            {x + rx, y + height - ry},
+            {x + rx, y + ry}
+    };
+    // Each corner starts with the straight edge leading into it, the last arc ends where the first edge starts
+    for (size_t i = 0; i < 4; ++i) {
+        const double angle = FLATTEN_TAU / 4.0 * ((double) i - 1.0);
+        flatten_point(contour, corners[i].x + rx * cos(angle), corners[i].y + ry * sin(angle));
+        if (rx > 0.0 && ry > 0.0) {
+            flatten_arc(contour, corners[i], rx, ry, 0.0, angle, FLATTEN_TAU / 4.0);
+        }
+    }
+    return svg_emit(contour, error);
+}
+
+static bool svg_ellipse(FlattenContour *contour, const SvgAttributes *attributes, bool circle, const char **error) {
+    const FlattenPoint center = {svg_length(attributes->cx, 0.0), svg_length(attributes->cy, 0.0)};
+    const double rx = svg_length(circle ? attributes->r : attributes->rx, 0.0);
+    const double ry = svg_length(circle ? attributes->r : attributes->ry, 0.0);
+    if (rx <= 0.0 || ry <= 0.0) {
+        return true;
+    }
+    // The arc's last point is its first, no explicit start point needed
+    flatten_arc(contour, center, rx, ry, 0.0, 0.0, FLATTEN_TAU);
+    return svg_emit(contour, error);
+}
+
+static bool svg_name_is(const char *name, size_t length, const char *expected) {
+    return strlen(expected) == length && memcmp(name, expected, length) == 0;
+}
+
+// The functions of a transform list in order, each applied after those right of it
+static bool svg_transform(SvgRange range, FlattenTransform *out) {
+    const char *p = range.begin, *end = range.end;
+    FlattenTransform transform = FLATTEN_IDENTITY;
+    while ((p = svg_skip_separators(p, end)) < end) {
+        const char *name = p;
+        while (p < end && ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z'))) {
+            p++;
+        }
+        const size_t length = (size_t) (p - name);
+        while (p < end && svg_is_space(*p)) {
+            p++;
+        }
+        if (p == end || *p != '(') {
+            return false;
+        }
+        p++;
+        double v[6];
+        size_t count = 0;
+        while ((p = svg_skip_separators(p, end)) < end && *p != ')') {
+            if (count == 6 || !svg_number(&p, end, &v[count])) {
+                return false;
+            }
+            count++;
+        }
+        if (p == end) {
+            return false;
+        }
+        p++;
+        FlattenTransform t;
+        if (svg_name_is(name, length, "matrix") && count == 6) {
+            t = (FlattenTransform) {v[0], v[1], v[2], v[3], v[4], v[5]};
+        } else if (svg_name_is(name, length, "translate") && (count == 1 || count == 2)) {
+            t = (FlattenTransform) {1.0, 0.0, 0.0, 1.0, v[0], count == 2 ? v[1] : 0.0};
+        } else if (svg_name_is(name, length, "scale") && (count == 1 || count == 2)) {
+            t = (FlattenTransform) {v[0], 0.0, 0.0, count == 2 ? v[1] : v[0], 0.0, 0.0};
+        } else if (svg_name_is(name, length, "rotate") && (count == 1 || count == 3)) {
+            const double angle = v[0] * FLATTEN_TAU / 360.0, c = cos(angle), s = sin(angle);
+            const double cx = count == 3 ? v[1] : 0.0, cy = count == 3 ? v[2] : 0.0;
+            // Rotates about (cx, cy): translate(cx, cy) rotate(a) translate(-cx, -cy)
+            t = (FlattenTransform) {c, s, -s, c, cx - c * cx + s * cy, cy - s * cx - c * cy};
+        } else if (svg_name_is(name, length, "skewX") && count == 1) {
+            t = (FlattenTransform) {1.0, 0.0, tan(v[0] * FLATTEN_TAU / 360.0), 1.0, 0.0, 0.0};
+        } else if (svg_name_is(name, length, "skewY") && count == 1) {
+            t = (FlattenTransform) {1.0, tan(v[0] * FLATTEN_TAU / 360.0), 0.0, 1.0, 0.0, 0.0};
+        } else {
+            return false;
+        }
+        transform = flatten_compose(transform, t);
+    }
+    *out = transform;
+    return true;
+}
+
+static const char *svg_find(const char *p, const char *end, const char *needle) {
+    const size_t length = strlen(needle);
+    for (; p + length <= end; ++p) {
+        p = memchr(p, needle[0], (size_t) (end - p));
+        if (!p || p + length > end) {
+            return NULL;
+        }
+        if (memcmp(p, needle, length) == 0) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Reads attributes up to the end of the tag, returns the position after '>' or NULL if unterminated
+static const char *svg_attributes(const char *p, const char *end, SvgAttributes *attributes) {
+    *attributes = (SvgAttributes) {0};
+    while (true) {
+        while (p < end && svg_is_space(*p)) {
+            p++;
+        }
+        if (p == end) {
+            return NULL;
+        }
+        if (*p == '>') {
+            attributes->closed = p[-1] == '/';
+            return p + 1;
+        }
+        if (*p == '/') {
+            p++;
+            continue;
+        }
+        const char *name = p;
+        while (p < end && svg_is_name(*p)) {
+            p++;
+        }
+        const size_t length = (size_t) (p - name);
+        while (p < end && svg_is_space(*p)) {
+            p++;
+        }
+        if (length == 0 || p == end || *p != '=') {
+            // Not an attribute, skip a character so malformed markup can't stall the scan
+            p = length == 0 ? p + 1 : p;
+            continue;
+        }
+        p++;
+        while (p < end && svg_is_space(*p)) {
+            p++;
+        }
+        if (p == end || (*p != '"' && *p != '\'')) {
+            continue;
+        }
+        const char *value = p + 1;
+        const char *close = memchr(value, *p, (size_t) (end - value));
+        if (!close) {
+            return NULL;
+        }
+        p = close + 1;
+        static const struct {
+            const char *name;
+            size_t offset;
+        } known[] = {
+                {"d", offsetof(SvgAttributes, d)},
+                {"points", offsetof(SvgAttributes, points)},
+                {"x", offsetof(SvgAttributes, x)},
+                {"y", offsetof(SvgAttributes, y)},
+                {"width", offsetof(SvgAttributes, width)},
+                {"height", offsetof(SvgAttributes, height)},
+                {"cx", offsetof(SvgAttributes, cx)},
+                {"cy", offsetof(SvgAttributes, cy)},
+                {"r", offsetof(SvgAttributes, r)},
+                {"rx", offsetof(SvgAttributes, rx)},
+                {"ry", offsetof(SvgAttributes, ry)},
+                {"transform", offsetof(SvgAttributes, transform)},
+        };
+        for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); ++i) {
+            if (svg_name_is(name, length, known[i].name)) {
+                *(SvgRange *) ((char *) attributes + known[i].offset) = (SvgRange) {value, close};
+                break;
+            }
+        }
+    }
+}
+
+bool ps_svg_read(const char *path, double tolerance, PsOutlineSink sink, void *userdata, const char **error) {
+    PsMappedFile file;
+    if (!ps_file_map(path, &file)) {
+        *error = strerror(errno);
+        return false;
+    }
+    PS_TRACE_BEGIN(zone, "svg/read");
+    FlattenContour contour;
+    flatten_init(&contour, tolerance, sink, userdata);
+    // The transforms of the open elements, the outermost turns SVG's y-down into y-up
+    IoBuffer transforms;
+    io_buffer_init(&transforms, sizeof(FlattenTransform));
+    FlattenTransform *root = io_buffer_push(&transforms);
+    if (root) {
+        *root = (FlattenTransform) {1.0, 0.0, 0.0, -1.0, 0.0, 0.0};
+    }
+    const char *p = file.data, *end = p + file.size;
+    bool ok = root != NULL;
+    if (!ok) {
+        *error = "out of memory";
+    }
+    while (ok && !contour.stopped && p && (p = memchr(p, '<', (size_t) (end - p)))) {
+        p++;
+        const char *close = NULL;
+        if (end - p >= 3 && memcmp(p, "!--", 3) == 0) {
+            close = svg_find(p + 3, end, "-->");
+        } else if (end - p >= 8 && memcmp(p, "![CDATA[", 8) == 0) {
+            close = svg_find(p + 8, end, "]]>");
+        } else if (p < end && (*p == '!' || *p == '?' || *p == '/')) {
+            // A closing tag ends the innermost open element, stray ones can't pop the root
+            if (*p == '/' && transforms.length > 1) {
+                transforms.length--;
+            }
+            close = memchr(p, '>', (size_t) (end - p));
+        } else {
+            const char *name = p;
+            while (p < end && svg_is_name(*p)) {
+                p++;
+            }
+            size_t length = (size_t) (p - name);
+            // Namespaced documents write svg:path
+            if (length > 4 && memcmp(name, "svg:", 4) == 0) {
+                name += 4;
+                length -= 4;
+            }
+            SvgAttributes attributes;
+            p = svg_attributes(p, end, &attributes);
+            FlattenTransform transform = ((const FlattenTransform *) transforms.data)[transforms.length - 1];
+            FlattenTransform own;
+            if (!p) {
+                *error = "unterminated tag";
+                ok = false;
+                continue;
+            }
+            if (attributes.transform.begin) {
+                if (!svg_transform(attributes.transform, &own)) {
+                    *error = "malformed transform";
+                    ok = false;
+                    continue;
+                }
+                transform = flatten_compose(transform, own);
+            }
+            if (!attributes.closed) {
+                FlattenTransform *pushed = io_buffer_push(&transforms);
+                if (!pushed) {
+                    *error = "out of memory";
+                    ok = false;
+                    continue;
+                }
+                *pushed = transform;
+            }
+            flatten_set_transform(&contour, transform);
+            if (svg_name_is(name, length, "path") && attributes.d.begin) {
+                ok = svg_path(&contour, attributes.d, error);
+            } else if ((svg_name_is(name, length, "polygon") || svg_name_is(name, length, "polyline")) &&
+                       attributes.points.begin) {
+                ok = svg_points(&contour, attributes.points, error);
+            } else if (svg_name_is(name, length, "rect")) {
+                ok = svg_rect(&contour, &attributes, error);
+            } else if (svg_name_is(name, length, "circle") || svg_name_is(name, length, "ellipse")) {
+                ok = svg_ellipse(&contour, &attributes, svg_name_is(name, length, "circle"), error);
+            }
+            // A failed shape may leave points behind
+            flatten_discard(&contour);
+            continue;
+        }
+        if (!close) {
+            *error = "unterminated markup";
+            ok = false;
+        }
+        p = close;
+    }
+    flatten_destroy(&contour);
+    io_buffer_destroy(&transforms);
+    PS_TRACE_END(zone);
+    ps_file_unmap(&file);
+    return ok;
+}
@@ -0,0 +1,232 @@
+#include "text.h"
+
+#include <picoscad/sys/cpu.h>
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const double io_pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static bool io_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+const char *io_skip_blanks(const char *cursor, const char *end) {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) {
+        cursor++;
+    }
+    return cursor;
+}
+
+const char *io_next_line(const char *cursor, const char *end) {
+    const char *newline = memchr(cursor, '\n', (size_t) (end - cursor));
+    return newline ? newline + 1 : end;
+}
+
+bool io_starts_with(const char *cursor, const char *end, const char *word) {
+    const size_t length = strlen(word);
+    if ((size_t) (end - cursor) < length || memcmp(cursor, word, length) != 0) {
+        return false;
+    }
+    cursor += length;
+    return cursor == end || *cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n';
+}
+
+bool io_parse_double(const char **cursor, const char *end, double *out) {
+    const char *p = io_skip_blanks(*cursor, end);
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for (; p < end && io_is_digit(*p); ++p, any = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && io_is_digit(*p); ++p, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (!any) {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        bool negative_exponent = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            negative_exponent = *e == '-';
+            e++;
+        }
+        // Without digits the 'e' isn't part of the number
+        if (e < end && io_is_digit(*e)) {
+            int value = 0;
+            for (; e < end && io_is_digit(*e); ++e) {
+                if (value < 100000) {
+                    value = value * 10 + (*e - '0');
+                }
+            }
+            exponent += negative_exponent ? -value : value;
+            p = e;
+        }
+    }
+
+    double value;
+    if (mantissa == 0) {
+        value = 0.0;
+    } else if (exponent >= -22 && exponent <= 22 && mantissa <= (UINT64_C(1) << 53)) {
+        // Both operands are exact doubles, so this is a single rounding
+        value = exponent < 0 ? (double) mantissa / io_pow10[-exponent] : (double) mantissa * io_pow10[exponent];
+    } else {
+        // strtod needs the number terminated, the rare one too long for the stack goes on the heap
+        char buffer[64];
+        const size_t length = (size_t) (p - start);
+        char *text = length < sizeof(buffer) ? buffer : malloc(length + 1);
+        if (!text) {
+            return false;
+        }
+        memcpy(text, start, length);
+        text[length] = '\0';
+        value = strtod(text, NULL);
+        negative = false;
+        if (text != buffer) {
+            free(text);
+        }
+    }
+    *out = negative ? -value : value;
+    *cursor = p;
+    return true;
+}
+
+bool io_parse_float(const char **cursor, const char *end, float *out) {
+    double value;
+    if (!io_parse_double(cursor, end, &value)) {
+        return false;
+    }
+    *out = (float) value;
+    return true;
+}
+
+bool io_parse_long(const char **cursor, const char *end, long *out) {
+    const char *p = io_skip_blanks(*cursor, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    if (p == end || !io_is_digit(*p)) {
+        return false;
+    }
+    long value = 0;
+    for (; p < end && io_is_digit(*p); ++p) {
+        if (value > (LONG_MAX - 9) / 10) {
+            return false;
+        }
+        value = value * 10 + (*p - '0');
+    }
+    *out = negative ? -value : value;
+    *cursor = p;
+    return true;
+}
+
+size_t io_split_lines(const char *data, size_t size, size_t max_chunks, const char **bounds) {
+    const char *end = data + size;
+    size_t count = 0;
+    bounds[0] = data;
+    for (size_t i = 1; i <= max_chunks; ++i) {
+        const char *split = i == max_chunks ? end : io_next_line(data + size / max_chunks * i, end);
+        if (split > bounds[count]) {
+            bounds[++count] = split;
+        }
+    }
+    return count;
+}
+
+#define IO_CHUNK_MIN_SIZE ((size_t) 4 << 20)
+
+size_t io_chunk_count(size_t size) {
+    const size_t count = size / IO_CHUNK_MIN_SIZE;
+    const size_t cpus = ps_cpu_count();
+    return count == 0 ? 1 : count < cpus ? count : cpus;
+}
+
+typedef struct IoTask {
+    void (*fn)(size_t index, void *userdata);
+    void *userdata;
+    size_t index;
+} IoTask;
+
+static void *io_task_run(void *arg) {
+    IoTask *task = arg;
+    task->fn(task->index, task->userdata);
+    return NULL;
+}
+
+void io_parallel(size_t count, void (*fn)(size_t index, void *userdata), void *userdata) {
+    if (count == 0) {
+        return;
+    }
+    pthread_t *threads = malloc(sizeof(pthread_t) * count);
+    IoTask *tasks = malloc(sizeof(IoTask) * count);
+    bool *started = calloc(count, sizeof(bool));
+    for (size_t i = 1; i < count; ++i) {
+        tasks[i] = (IoTask) {fn, userdata, i};
+        started[i] = pthread_create(&threads[i], NULL, io_task_run, &tasks[i]) == 0;
+    }
+    fn(0, userdata);
+    for (size_t i = 1; i < count; ++i) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            // Out of threads, do it here instead
+            fn(i, userdata);
+        }
+    }
+    free(started);
+    free(tasks);
+    free(threads);
+}
+
+void io_buffer_init(IoBuffer *buffer, size_t element_size) {
+    *buffer = (IoBuffer) {NULL, 0, 0, element_size};
+}
+
+void io_buffer_destroy(IoBuffer *buffer) {
+    free(buffer->data);
+    io_buffer_init(buffer, buffer->element_size);
+}
+
+void *io_buffer_push(IoBuffer *buffer) {
+    if (buffer->length == buffer->capacity) {
+        const size_t capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+        // Aligned for any element, Ps4d included, which realloc doesn't promise
+        void *data = aligned_alloc(IO_BUFFER_ALIGNMENT, capacity * buffer->element_size);
+        if (!data) {
+            return NULL;
+        }
+        if (buffer->length) {
+            memcpy(data, buffer->data, buffer->length * buffer->element_size);
+        }
+        free(buffer->data);
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return (char *) buffer->data + buffer->length++ * buffer->element_size;
+}
@@ -0,0 +1,72 @@
+#ifndef PS_IO_TEXT_H_
+#define PS_IO_TEXT_H_
+
+#include <picoscad/porting.h>
+
+/*
+ * Helpers for the text importers. Everything works on [cursor, end) ranges of
+ * a mapped file and never reads at or past end, there is no NUL terminator.
+ */
+
+const char *io_skip_blanks(const char *cursor, const char *end);
+
+/**
+ * The start of the line after the one cursor is on, or end
+ */
+const char *io_next_line(const char *cursor, const char *end);
+
+/**
+ * True if cursor starts with word followed by a blank, a line break or end
+ */
+bool io_starts_with(const char *cursor, const char *end, const char *word);
+
+/**
+ * Decimal float with optional sign, fraction and exponent after any blanks.
+ * Exact for up to 19 significant digits and exponents within +-22, which is
+ * all exporters write; anything else goes through strtod.
+ */
+bool io_parse_double(const char **cursor, const char *end, double *out);
+bool io_parse_float(const char **cursor, const char *end, float *out);
+bool io_parse_long(const char **cursor, const char *end, long *out);
+
+/**
+ * Splits data into at most max_chunks ranges of whole lines; bounds gets count
+ * + 1 entries and the count is returned
+ */
+size_t io_split_lines(const char *data, size_t size, size_t max_chunks, const char **bounds);
+
+/**
+ * How many threads to split size bytes of input over: one per CPU, but never
+ * less than a few MB each since the split and the final concatenation cost
+ * more than parsing small files
+ */
+size_t io_chunk_count(size_t size);
+
+/**
+ * Calls fn(index, userdata) for every index below count, each on its own thread
+ * but the first, which runs on the caller's
+ */
+void io_parallel(size_t count, void (*fn)(size_t index, void *userdata), void *userdata);
+
+/**
+ * A growable array of fixed-size elements. data is aligned for any element,
+ * Ps4d and structs holding it included.
+ */
+#define IO_BUFFER_ALIGNMENT 64
+
+typedef struct IoBuffer {
+    void *data;
+    size_t length;
+    size_t capacity;
+    size_t element_size;
+} IoBuffer;
+
+void io_buffer_init(IoBuffer *buffer, size_t element_size);
+void io_buffer_destroy(IoBuffer *buffer);
+
+/**
+ * Room for one more element, NULL when out of memory
+ */
+void *io_buffer_push(IoBuffer *buffer);
+
+#endif // PS_IO_TEXT_H_
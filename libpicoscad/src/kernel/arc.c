@@ -0,0 +1,70 @@
+#include "kernels.h"
+
+#include <math.h>
+
+#ifdef __AVX__
+#include <immintrin.h>
+
+#ifdef __FMA__
+#define MADD(a, b, c) _mm256_fmadd_pd((a), (b), (c))
+#define MSUB(a, b, c) _mm256_fmsub_pd((a), (b), (c))
+#else
+#define MADD(a, b, c) _mm256_add_pd(_mm256_mul_pd((a), (b)), (c))
+#define MSUB(a, b, c) _mm256_sub_pd(_mm256_mul_pd((a), (b)), (c))
+#endif
+#endif
+
+// Points between exact sin and cos seeds, each rotation step adds up to about an ulp of drift
+#define ARC_BLOCK 64
+
+void PS_KERNEL(kernel_ellipse_points4d)(const PsKernelEllipse *ellipse, size_t count, Ps4d *out) {
+    double *dst = (double *) out;
+    size_t i = 0;
+#ifdef __AVX__
+    // Lane j holds the angle of point i + j and turns by four steps per iteration
+    const __m256d cx = _mm256_set1_pd(ellipse->cx), cy = _mm256_set1_pd(ellipse->cy);
+    const __m256d ax = _mm256_set1_pd(ellipse->ax), ay = _mm256_set1_pd(ellipse->ay);
+    const __m256d bx = _mm256_set1_pd(ellipse->bx), by = _mm256_set1_pd(ellipse->by);
+    const __m256d c4 = _mm256_set1_pd(cos(4.0 * ellipse->step)), s4 = _mm256_set1_pd(sin(4.0 * ellipse->step));
+    const __m256d zw = _mm256_setr_pd(0.0, 1.0, 0.0, 1.0);
+    while (i + 4 <= count) {
+        double seed_c[4], seed_s[4];
+        for (size_t j = 0; j < 4; ++j) {
+            const double angle = ellipse->start + (double) (i + j) * ellipse->step;
+            seed_c[j] = cos(angle);
+            seed_s[j] = sin(angle);
+        }
+        __m256d c = _mm256_loadu_pd(seed_c), s = _mm256_loadu_pd(seed_s);
+        const size_t end = i + ARC_BLOCK < count ? i + ARC_BLOCK : count;
+        for (; i + 4 <= end; i += 4) {
+            const __m256d x = MADD(bx, s, MADD(ax, c, cx));
+            const __m256d y = MADD(by, s, MADD(ay, c, cy));
+            // x0 y0 x2 y2 and x1 y1 x3 y3, then each half gets z = 0 and w = 1
+            const __m256d even = _mm256_unpacklo_pd(x, y), odd = _mm256_unpackhi_pd(x, y);
+            _mm256_storeu_pd(dst + i * 4, _mm256_permute2f128_pd(even, zw, 0x20));
+            _mm256_storeu_pd(dst + i * 4 + 4, _mm256_permute2f128_pd(odd, zw, 0x20));
+            _mm256_storeu_pd(dst + i * 4 + 8, _mm256_permute2f128_pd(even, zw, 0x31));
+            _mm256_storeu_pd(dst + i * 4 + 12, _mm256_permute2f128_pd(odd, zw, 0x31));
+            const __m256d next_c = MSUB(c, c4, _mm256_mul_pd(s, s4));
+            s = MADD(s, c4, _mm256_mul_pd(c, s4));
+            c = next_c;
+        }
+    }
+#endif
+    const double c1 = cos(ellipse->step), s1 = sin(ellipse->step);
+    double c = 0.0, s = 0.0;
+    for (size_t k = 0; i < count; ++i, ++k) {
+        if (k % ARC_BLOCK == 0) {
+            const double angle = ellipse->start + (double) i * ellipse->step;
+            c = cos(angle);
+            s = sin(angle);
+        }
+        dst[i * 4] = ellipse->cx + ellipse->ax * c + ellipse->bx * s;
+        dst[i * 4 + 1] = ellipse->cy + ellipse->ay * c + ellipse->by * s;
+        dst[i * 4 + 2] = 0.0;
+        dst[i * 4 + 3] = 1.0;
+        const double next_c = c * c1 - s * s1;
+        s = s * c1 + c * s1;
+        c = next_c;
+    }
+}
@@ -0,0 +1,162 @@
+#include "kernels.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline int winding_edge(float ax, float ay, float bx, float by, float px, float py) {
+    float left = ((bx - ax) * (py - ay)) - ((px - ax) * (by - ay));
+    if (ay <= py) {
+        return (by > py && left > 0.0f) ? 1 : 0;
+    }
+    return (by <= py && left < 0.0f) ? -1 : 0;
+}
+
+static inline bool segment_hit(float p1x, float p1y, float d1x, float d1y, float ax, float ay, float bx, float by,
+                               float *alpha, float *edge_alpha) {
+    float d2x = bx - ax, d2y = by - ay;
+    float denominator = (d2y * d1x) - (d2x * d1y);
+    if (denominator == 0.0f) {
+        return false;
+    }
+    float d3x = p1x - ax, d3y = p1y - ay;
+    float t = ((d2x * d3y) - (d2y * d3x)) / denominator;
+    float s = ((d1x * d3y) - (d1y * d3x)) / denominator;
+    // Touching an end point is degenerate and not reported
+    if (t > 0.0f && t < 1.0f && s > 0.0f && s < 1.0f) {
+        *alpha = t;
+        *edge_alpha = s;
+        return true;
+    }
+    return false;
+}
+
+#if defined(__AVX__)
+#define WIDTH 8
+
+// Loads the x and y of 8 points, lane order is 0 2 4 6 1 3 5 7
+static inline void load_xy(const Ps4f *points, __m256 *x, __m256 *y) {
+    const float *src = (const float *) points;
+    const __m256 t0 = _mm256_unpacklo_ps(_mm256_loadu_ps(src), _mm256_loadu_ps(src + 8));
+    const __m256 t1 = _mm256_unpacklo_ps(_mm256_loadu_ps(src + 16), _mm256_loadu_ps(src + 24));
+    *x = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    *y = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// Lane holding point k
+static const int lanes[WIDTH] = {0, 4, 1, 5, 2, 6, 3, 7};
+
+typedef __m256 Vec;
+#define V_SPLAT(f) _mm256_set1_ps(f)
+#define V_SUB(a, b) _mm256_sub_ps((a), (b))
+#define V_MUL(a, b) _mm256_mul_ps((a), (b))
+#define V_DIV(a, b) _mm256_div_ps((a), (b))
+#define V_AND(a, b) _mm256_and_ps((a), (b))
+#define V_ANDNOT(a, b) _mm256_andnot_ps((a), (b))
+#define V_LE(a, b) _mm256_cmp_ps((a), (b), _CMP_LE_OQ)
+#define V_LT(a, b) _mm256_cmp_ps((a), (b), _CMP_LT_OQ)
+#define V_NEQ(a, b) _mm256_cmp_ps((a), (b), _CMP_NEQ_OQ)
+#define V_MASK(a) _mm256_movemask_ps(a)
+#define V_STORE(p, a) _mm256_storeu_ps((p), (a))
+#elif defined(__SSE2__)
+#define WIDTH 4
+
+static inline void load_xy(const Ps4f *points, __m128 *x, __m128 *y) {
+    __m128 p0 = points[0], p1 = points[1], p2 = points[2], p3 = points[3];
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    *x = p0;
+    *y = p1;
+}
+
+static const int lanes[WIDTH] = {0, 1, 2, 3};
+
+typedef __m128 Vec;
+#define V_SPLAT(f) _mm_set1_ps(f)
+#define V_SUB(a, b) _mm_sub_ps((a), (b))
+#define V_MUL(a, b) _mm_mul_ps((a), (b))
+#define V_DIV(a, b) _mm_div_ps((a), (b))
+#define V_AND(a, b) _mm_and_ps((a), (b))
+#define V_ANDNOT(a, b) _mm_andnot_ps((a), (b))
+#define V_LE(a, b) _mm_cmple_ps((a), (b))
+#define V_LT(a, b) _mm_cmplt_ps((a), (b))
+#define V_NEQ(a, b) _mm_cmpneq_ps((a), (b))
+#define V_MASK(a) _mm_movemask_ps(a)
+#define V_STORE(p, a) _mm_storeu_ps((p), (a))
+#endif
+
+bool PS_KERNEL(kernel_polygon_contains)(const Ps4f *points, size_t length, Ps4f point) {
+    const float px = ps_4f_x(point), py = ps_4f_y(point);
+    int winding = 0;
+    size_t i = 0;
+#ifdef WIDTH
+    const Vec vpx = V_SPLAT(px), vpy = V_SPLAT(py), zero = V_SPLAT(0.0f);
+    // Edge i + WIDTH - 1 ends on point i + WIDTH, the closing edge is left to the tail
+    for (; i + WIDTH < length; i += WIDTH) {
+        Vec ax, ay, bx, by;
+        load_xy(points + i, &ax, &ay);
+        load_xy(points + i + 1, &bx, &by);
+        const Vec left = V_SUB(V_MUL(V_SUB(bx, ax), V_SUB(vpy, ay)), V_MUL(V_SUB(vpx, ax), V_SUB(by, ay)));
+        const Vec a_below = V_LE(ay, vpy);
+        const Vec b_below = V_LE(by, vpy);
+        const Vec up = V_AND(V_ANDNOT(b_below, a_below), V_LT(zero, left));
+        const Vec down = V_AND(V_ANDNOT(a_below, b_below), V_LT(left, zero));
+        winding += __builtin_popcount(V_MASK(up)) - __builtin_popcount(V_MASK(down));
+    }
+#endif
+    for (; i < length; ++i) {
+        Ps4f a = points[i], b = points[(i + 1) % length];
+        winding += winding_edge(ps_4f_x(a), ps_4f_y(a), ps_4f_x(b), ps_4f_y(b), px, py);
+    }
+    return winding != 0;
+}
+
+size_t PS_KERNEL(kernel_segment_intersections)(Ps4f p1, Ps4f p2, const Ps4f *points, size_t length,
+                                               PsKernelHit *hits) {
+    const float p1x = ps_4f_x(p1), p1y = ps_4f_y(p1);
+    const float d1x = ps_4f_x(p2) - p1x, d1y = ps_4f_y(p2) - p1y;
+    size_t count = 0;
+    size_t i = 0;
+#ifdef WIDTH
+    const Vec vp1x = V_SPLAT(p1x), vp1y = V_SPLAT(p1y), vd1x = V_SPLAT(d1x), vd1y = V_SPLAT(d1y);
+    const Vec zero = V_SPLAT(0.0f), one = V_SPLAT(1.0f);
+    for (; i + WIDTH < length; i += WIDTH) {
+        Vec ax, ay, bx, by;
+        load_xy(points + i, &ax, &ay);
+        load_xy(points + i + 1, &bx, &by);
+        const Vec d2x = V_SUB(bx, ax), d2y = V_SUB(by, ay);
+        const Vec denominator = V_SUB(V_MUL(d2y, vd1x), V_MUL(d2x, vd1y));
+        const Vec d3x = V_SUB(vp1x, ax), d3y = V_SUB(vp1y, ay);
+        const Vec t = V_DIV(V_SUB(V_MUL(d2x, d3y), V_MUL(d2y, d3x)), denominator);
+        const Vec s = V_DIV(V_SUB(V_MUL(vd1x, d3y), V_MUL(vd1y, d3x)), denominator);
+        const Vec inside = V_AND(V_AND(V_LT(zero, t), V_LT(t, one)), V_AND(V_LT(zero, s), V_LT(s, one)));
+        const int mask = V_MASK(V_AND(inside, V_NEQ(denominator, zero)));
+        if (mask) {
+            float ts[WIDTH], ss[WIDTH];
+            V_STORE(ts, t);
+            V_STORE(ss, s);
+            for (size_t k = 0; k < WIDTH; ++k) {
+                const int lane = lanes[k];
+                if (mask & (1 << lane)) {
+                    hits[count].index = i + k;
+                    hits[count].alpha = ts[lane];
+                    hits[count].edge_alpha = ss[lane];
+                    count++;
+                }
+            }
+        }
+    }
+#endif
+    for (; i < length; ++i) {
+        Ps4f a = points[i], b = points[(i + 1) % length];
+        float alpha, edge_alpha;
+        if (segment_hit(p1x, p1y, d1x, d1y, ps_4f_x(a), ps_4f_y(a), ps_4f_x(b), ps_4f_y(b), &alpha, &edge_alpha)) {
+            hits[count].index = i;
+            hits[count].alpha = alpha;
+            hits[count].edge_alpha = edge_alpha;
+            count++;
+        }
+    }
+    return count;
+}
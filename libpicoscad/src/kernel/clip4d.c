@@ -0,0 +1,130 @@
+#include "kernels.h"
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+// Reads through double pointers since Ps4d may be under-aligned for this variant's backend
+#define X(p) (((const double *) (p))[0])
+#define Y(p) (((const double *) (p))[1])
+
+static inline int winding_edge(double ax, double ay, double bx, double by, double px, double py) {
+    double left = ((bx - ax) * (py - ay)) - ((px - ax) * (by - ay));
+    if (ay <= py) {
+        return (by > py && left > 0.0) ? 1 : 0;
+    }
+    return (by <= py && left < 0.0) ? -1 : 0;
+}
+
+static inline bool segment_hit(double p1x, double p1y, double d1x, double d1y,
+                               double ax, double ay, double bx, double by,
+                               double *alpha, double *edge_alpha) {
+    double d2x = bx - ax, d2y = by - ay;
+    double denominator = (d2y * d1x) - (d2x * d1y);
+    if (denominator == 0.0) {
+        return false;
+    }
+    double d3x = p1x - ax, d3y = p1y - ay;
+    double t = ((d2x * d3y) - (d2y * d3x)) / denominator;
+    double s = ((d1x * d3y) - (d1y * d3x)) / denominator;
+    // Touching an end point is degenerate and not reported
+    if (t > 0.0 && t < 1.0 && s > 0.0 && s < 1.0) {
+        *alpha = t;
+        *edge_alpha = s;
+        return true;
+    }
+    return false;
+}
+
+#ifdef __AVX__
+// Loads the x and y of 4 points in order
+static inline void load_xy(const Ps4d *points, __m256d *x, __m256d *y) {
+    const double *src = (const double *) points;
+    const __m256d p0 = _mm256_loadu_pd(src), p1 = _mm256_loadu_pd(src + 4);
+    const __m256d p2 = _mm256_loadu_pd(src + 8), p3 = _mm256_loadu_pd(src + 12);
+    const __m256d t0 = _mm256_unpacklo_pd(p0, p1);
+    const __m256d t1 = _mm256_unpackhi_pd(p0, p1);
+    const __m256d t2 = _mm256_unpacklo_pd(p2, p3);
+    const __m256d t3 = _mm256_unpackhi_pd(p2, p3);
+    *x = _mm256_permute2f128_pd(t0, t2, 0x20);
+    *y = _mm256_permute2f128_pd(t1, t3, 0x20);
+}
+#endif
+
+bool PS_KERNEL(kernel_polygon4d_contains)(const Ps4d *points, size_t length, const Ps4d *point) {
+    const double px = X(point), py = Y(point);
+    int winding = 0;
+    size_t i = 0;
+#ifdef __AVX__
+    const __m256d vpx = _mm256_set1_pd(px), vpy = _mm256_set1_pd(py), zero = _mm256_setzero_pd();
+    for (; i + 4 < length; i += 4) {
+        __m256d ax, ay, bx, by;
+        load_xy(points + i, &ax, &ay);
+        load_xy(points + i + 1, &bx, &by);
+        const __m256d left = _mm256_sub_pd(_mm256_mul_pd(_mm256_sub_pd(bx, ax), _mm256_sub_pd(vpy, ay)),
+                                           _mm256_mul_pd(_mm256_sub_pd(vpx, ax), _mm256_sub_pd(by, ay)));
+        const __m256d a_below = _mm256_cmp_pd(ay, vpy, _CMP_LE_OQ);
+        const __m256d b_below = _mm256_cmp_pd(by, vpy, _CMP_LE_OQ);
+        const __m256d up = _mm256_and_pd(_mm256_andnot_pd(b_below, a_below), _mm256_cmp_pd(zero, left, _CMP_LT_OQ));
+        const __m256d down = _mm256_and_pd(_mm256_andnot_pd(a_below, b_below), _mm256_cmp_pd(left, zero, _CMP_LT_OQ));
+        winding += __builtin_popcount(_mm256_movemask_pd(up)) - __builtin_popcount(_mm256_movemask_pd(down));
+    }
+#endif
+    for (; i < length; ++i) {
+        const Ps4d *a = &points[i], *b = &points[(i + 1) % length];
+        winding += winding_edge(X(a), Y(a), X(b), Y(b), px, py);
+    }
+    return winding != 0;
+}
+
+size_t PS_KERNEL(kernel_segment4d_intersections)(const Ps4d *p1, const Ps4d *p2, const Ps4d *points, size_t length,
+                                                 PsKernelHit4d *hits) {
+    const double p1x = X(p1), p1y = Y(p1);
+    const double d1x = X(p2) - p1x, d1y = Y(p2) - p1y;
+    size_t count = 0;
+    size_t i = 0;
+#ifdef __AVX__
+    const __m256d vp1x = _mm256_set1_pd(p1x), vp1y = _mm256_set1_pd(p1y);
+    const __m256d vd1x = _mm256_set1_pd(d1x), vd1y = _mm256_set1_pd(d1y);
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+    for (; i + 4 < length; i += 4) {
+        __m256d ax, ay, bx, by;
+        load_xy(points + i, &ax, &ay);
+        load_xy(points + i + 1, &bx, &by);
+        const __m256d d2x = _mm256_sub_pd(bx, ax), d2y = _mm256_sub_pd(by, ay);
+        const __m256d denominator = _mm256_sub_pd(_mm256_mul_pd(d2y, vd1x), _mm256_mul_pd(d2x, vd1y));
+        const __m256d d3x = _mm256_sub_pd(vp1x, ax), d3y = _mm256_sub_pd(vp1y, ay);
+        const __m256d t = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(d2x, d3y), _mm256_mul_pd(d2y, d3x)), denominator);
+        const __m256d s = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(vd1x, d3y), _mm256_mul_pd(vd1y, d3x)),
+                                        denominator);
+        const __m256d inside = _mm256_and_pd(
+                _mm256_and_pd(_mm256_cmp_pd(zero, t, _CMP_LT_OQ), _mm256_cmp_pd(t, one, _CMP_LT_OQ)),
+                _mm256_and_pd(_mm256_cmp_pd(zero, s, _CMP_LT_OQ), _mm256_cmp_pd(s, one, _CMP_LT_OQ)));
+        const int mask = _mm256_movemask_pd(_mm256_and_pd(inside, _mm256_cmp_pd(denominator, zero, _CMP_NEQ_OQ)));
+        if (mask) {
+            double ts[4], ss[4];
+            _mm256_storeu_pd(ts, t);
+            _mm256_storeu_pd(ss, s);
+            for (size_t k = 0; k < 4; ++k) {
+                if (mask & (1 << k)) {
+                    hits[count].index = i + k;
+                    hits[count].alpha = ts[k];
+                    hits[count].edge_alpha = ss[k];
+                    count++;
+                }
+            }
+        }
+    }
+#endif
+    for (; i < length; ++i) {
+        const Ps4d *a = &points[i], *b = &points[(i + 1) % length];
+        double alpha, edge_alpha;
+        if (segment_hit(p1x, p1y, d1x, d1y, X(a), Y(a), X(b), Y(b), &alpha, &edge_alpha)) {
+            hits[count].index = i;
+            hits[count].alpha = alpha;
+            hits[count].edge_alpha = edge_alpha;
+            count++;
+        }
+    }
+    return count;
+}
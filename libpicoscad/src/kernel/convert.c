@@ -0,0 +1,69 @@
+#include "kernels.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void PS_KERNEL(kernel_convert_4d_4f)(const Ps4d *in, Ps4f *out, size_t length) {
+    const double *src = (const double *) in;
+    float *dst = (float *) out;
+    size_t i = 0;
+#ifdef __AVX512F__
+    for (; i + 8 <= length; i += 8) {
+        _mm256_storeu_ps(dst + i * 4, _mm512_cvtpd_ps(_mm512_loadu_pd(src + i * 4)));
+        _mm256_storeu_ps(dst + i * 4 + 8, _mm512_cvtpd_ps(_mm512_loadu_pd(src + i * 4 + 8)));
+        _mm256_storeu_ps(dst + i * 4 + 16, _mm512_cvtpd_ps(_mm512_loadu_pd(src + i * 4 + 16)));
+        _mm256_storeu_ps(dst + i * 4 + 24, _mm512_cvtpd_ps(_mm512_loadu_pd(src + i * 4 + 24)));
+    }
+#endif
+#if defined(__AVX__)
+    for (; i + 4 <= length; i += 4) {
+        _mm_storeu_ps(dst + i * 4, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i * 4)));
+        _mm_storeu_ps(dst + i * 4 + 4, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i * 4 + 4)));
+        _mm_storeu_ps(dst + i * 4 + 8, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i * 4 + 8)));
+        _mm_storeu_ps(dst + i * 4 + 12, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i * 4 + 12)));
+    }
+    for (; i < length; ++i) {
+        _mm_storeu_ps(dst + i * 4, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i * 4)));
+    }
+#elif defined(__SSE2__)
+    for (; i < length; ++i) {
+        const __m128 xy = _mm_cvtpd_ps(_mm_loadu_pd(src + i * 4));
+        const __m128 zw = _mm_cvtpd_ps(_mm_loadu_pd(src + i * 4 + 2));
+        _mm_storeu_ps(dst + i * 4, _mm_movelh_ps(xy, zw));
+    }
+#else
+    for (; i < length * 4; ++i) {
+        dst[i] = (float) src[i];
+    }
+#endif
+}
+
+void PS_KERNEL(kernel_convert_4f_4d)(const Ps4f *in, Ps4d *out, size_t length) {
+    const float *src = (const float *) in;
+    double *dst = (double *) out;
+    size_t i = 0;
+#ifdef __AVX512F__
+    for (; i + 4 <= length; i += 4) {
+        _mm512_storeu_pd(dst + i * 4, _mm512_cvtps_pd(_mm256_loadu_ps(src + i * 4)));
+        _mm512_storeu_pd(dst + i * 4 + 8, _mm512_cvtps_pd(_mm256_loadu_ps(src + i * 4 + 8)));
+    }
+#endif
+#if defined(__AVX__)
+    for (; i < length; ++i) {
+        _mm256_storeu_pd(dst + i * 4, _mm256_cvtps_pd(_mm_loadu_ps(src + i * 4)));
+    }
+#elif defined(__SSE2__)
+    for (; i < length; ++i) {
+        const __m128 v = _mm_loadu_ps(src + i * 4);
+        _mm_storeu_pd(dst + i * 4, _mm_cvtps_pd(v));
+        _mm_storeu_pd(dst + i * 4 + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+#else
+    for (; i < length * 4; ++i) {
+        dst[i] = src[i];
+    }
+#endif
+}
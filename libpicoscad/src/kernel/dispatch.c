@@ -0,0 +1,40 @@
+#include "kernels.h"
+
+#include <stdatomic.h>
+
+#include <picoscad/sys/cpu.h>
+
+static _Atomic(const PsKernels *) kernels;
+
+static const PsKernels *kernels_resolve() {
+    // Fall back to the best variant that was built into this library
+    switch (ps_cpu_get_isa()) {
+        case PS_CPU_ISA_AVX512:
+#ifdef PS_HAVE_KERNELS_AVX512
+            return &ps_kernels_avx512;
+#endif
+            // fall through
+        case PS_CPU_ISA_AVX2:
+#ifdef PS_HAVE_KERNELS_AVX2
+            return &ps_kernels_avx2;
+#endif
+            // fall through
+        case PS_CPU_ISA_AVX:
+#ifdef PS_HAVE_KERNELS_AVX
+            return &ps_kernels_avx;
+#endif
+            // fall through
+        case PS_CPU_ISA_GENERIC:
+        default:
+            return &ps_kernels_generic;
+    }
+}
+
+const PsKernels *ps_kernels() {
+    const PsKernels *resolved = atomic_load_explicit(&kernels, memory_order_acquire);
+    if (!resolved) {
+        resolved = kernels_resolve();
+        atomic_store_explicit(&kernels, resolved, memory_order_release);
+    }
+    return resolved;
+}
@@ -0,0 +1,104 @@
+#ifndef PS_KERNEL_KERNELS_H_
+#define PS_KERNEL_KERNELS_H_
+
+#include <picoscad/math/mat4f.h>
+#include <picoscad/math/mat4d.h>
+
+/*
+ * Hot loops that are built once per instruction set (see CMakeLists.txt) and
+ * picked at runtime by ps_kernels() according to ps_cpu_get_isa().
+ *
+ * The 4d kernels mirror the 4f ones in double precision.
+ *
+ * Every variant sees its own Ps4d backend, so kernels only take Ps4d and PsMat4d
+ * through pointers and must not assume more than 8 byte alignment for them.
+ */
+
+PS_EXTERN_BEGIN
+
+/**
+ * An intersection with edge index of a polygon, alpha runs along the tested
+ * segment and edge_alpha along the edge
+ */
+typedef struct PsKernelHit {
+    size_t index;
+    float alpha;
+    float edge_alpha;
+} PsKernelHit;
+
+typedef struct PsKernelHit4d {
+    size_t index;
+    double alpha;
+    double edge_alpha;
+} PsKernelHit4d;
+
+/**
+ * Point i of an ellipse is center + a cos(t) + b sin(t) at t = start + i * step,
+ * a and b being its radii along its turned axes
+ */
+typedef struct PsKernelEllipse {
+    double cx, cy;
+    double ax, ay;
+    double bx, by;
+    double start, step;
+} PsKernelEllipse;
+
+typedef struct PsKernels {
+    void (*mat4f_transform_points)(const PsMat4f *m4f, const Ps4f *in, Ps4f *out, size_t length);
+    void (*mat4d_transform_points)(const PsMat4d *m4d, const Ps4d *in, Ps4d *out, size_t length);
+    /**
+     * Non-zero winding test of point against the closed polygon points in the xy plane
+     */
+    bool (*polygon_contains)(const Ps4f *points, size_t length, Ps4f point);
+    /**
+     * Proper (non-degenerate) intersections in the xy plane of the segment p1-p2
+     * with the edges of the closed polygon points; writes at most length hits in
+     * edge order and returns their count
+     */
+    size_t (*segment_intersections)(Ps4f p1, Ps4f p2, const Ps4f *points, size_t length, PsKernelHit *hits);
+    bool (*polygon4d_contains)(const Ps4d *points, size_t length, const Ps4d *point);
+    size_t (*segment4d_intersections)(const Ps4d *p1, const Ps4d *p2, const Ps4d *points, size_t length,
+                                      PsKernelHit4d *hits);
+    void (*convert_4d_4f)(const Ps4d *in, Ps4f *out, size_t length);
+    void (*convert_4f_4d)(const Ps4f *in, Ps4d *out, size_t length);
+    /**
+     * Corners of count binary STL records (50 bytes each, little endian, any
+     * alignment) into 3 * count aligned vertices with w = 1, normals are dropped
+     */
+    void (*stl_decode)(const void *records, size_t count, Ps4f *vertices);
+    /**
+     * count points of ellipse with z = 0 and w = 1
+     */
+    void (*ellipse_points4d)(const PsKernelEllipse *ellipse, size_t count, Ps4d *out);
+} PsKernels;
+
+const PsKernels *ps_kernels();
+
+#ifdef PS_KERNEL_ISA
+#define _PS_KERNEL_CAT2(name, isa) name##_##isa
+#define _PS_KERNEL_CAT(name, isa) _PS_KERNEL_CAT2(name, isa)
+// Gives each variant's symbols a suffix so they can be linked side by side
+#define PS_KERNEL(name) _PS_KERNEL_CAT(name, PS_KERNEL_ISA)
+
+void PS_KERNEL(kernel_mat4f_transform_points)(const PsMat4f *m4f, const Ps4f *in, Ps4f *out, size_t length);
+void PS_KERNEL(kernel_mat4d_transform_points)(const PsMat4d *m4d, const Ps4d *in, Ps4d *out, size_t length);
+bool PS_KERNEL(kernel_polygon_contains)(const Ps4f *points, size_t length, Ps4f point);
+size_t PS_KERNEL(kernel_segment_intersections)(Ps4f p1, Ps4f p2, const Ps4f *points, size_t length,
+                                               PsKernelHit *hits);
+bool PS_KERNEL(kernel_polygon4d_contains)(const Ps4d *points, size_t length, const Ps4d *point);
+size_t PS_KERNEL(kernel_segment4d_intersections)(const Ps4d *p1, const Ps4d *p2, const Ps4d *points, size_t length,
+                                                 PsKernelHit4d *hits);
+void PS_KERNEL(kernel_convert_4d_4f)(const Ps4d *in, Ps4f *out, size_t length);
+void PS_KERNEL(kernel_convert_4f_4d)(const Ps4f *in, Ps4d *out, size_t length);
+void PS_KERNEL(kernel_stl_decode)(const void *records, size_t count, Ps4f *vertices);
+void PS_KERNEL(kernel_ellipse_points4d)(const PsKernelEllipse *ellipse, size_t count, Ps4d *out);
+#endif
+
+extern const PsKernels ps_kernels_generic;
+extern const PsKernels ps_kernels_avx;
+extern const PsKernels ps_kernels_avx2;
+extern const PsKernels ps_kernels_avx512;
+
+PS_EXTERN_END
+
+#endif // PS_KERNEL_KERNELS_H_
@@ -0,0 +1,37 @@
+#include "kernels.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// normal, 3 corners of 3 floats, attribute byte count
+#define STL_RECORD_SIZE 50
+
+void PS_KERNEL(kernel_stl_decode)(const void *records, size_t count, Ps4f *vertices) {
+    const unsigned char *record = records;
+    float *dst = (float *) vertices;
+#if defined(__SSE2__)
+    const __m128 xyz_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 w_one = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    for (size_t i = 0; i < count; ++i, record += STL_RECORD_SIZE, dst += 12) {
+        const float *corners = (const float *) (record + 12);
+        const __m128 c0 = _mm_loadu_ps(corners);
+        const __m128 c1 = _mm_loadu_ps(corners + 3);
+        // Loading from corners + 6 would read past the last record, start one float early and shift down
+        const __m128 c2_early = _mm_loadu_ps(corners + 5);
+        const __m128 c2 = _mm_shuffle_ps(c2_early, c2_early, _MM_SHUFFLE(3, 3, 2, 1));
+        _mm_store_ps(dst, _mm_or_ps(_mm_and_ps(c0, xyz_mask), w_one));
+        _mm_store_ps(dst + 4, _mm_or_ps(_mm_and_ps(c1, xyz_mask), w_one));
+        _mm_store_ps(dst + 8, _mm_or_ps(_mm_and_ps(c2, xyz_mask), w_one));
+    }
+#else
+    for (size_t i = 0; i < count; ++i, record += STL_RECORD_SIZE) {
+        for (size_t j = 0; j < 3; ++j, dst += 4) {
+            memcpy(dst, record + 12 + j * 12, sizeof(float) * 3);
+            dst[3] = 1.0f;
+        }
+    }
+#endif
+}
@@ -0,0 +1,14 @@
+#include "kernels.h"
+
+const PsKernels PS_KERNEL(ps_kernels) = {
+        .mat4f_transform_points = PS_KERNEL(kernel_mat4f_transform_points),
+        .mat4d_transform_points = PS_KERNEL(kernel_mat4d_transform_points),
+        .polygon_contains = PS_KERNEL(kernel_polygon_contains),
+        .segment_intersections = PS_KERNEL(kernel_segment_intersections),
+        .polygon4d_contains = PS_KERNEL(kernel_polygon4d_contains),
+        .segment4d_intersections = PS_KERNEL(kernel_segment4d_intersections),
+        .convert_4d_4f = PS_KERNEL(kernel_convert_4d_4f),
+        .convert_4f_4d = PS_KERNEL(kernel_convert_4f_4d),
+        .stl_decode = PS_KERNEL(kernel_stl_decode),
+        .ellipse_points4d = PS_KERNEL(kernel_ellipse_points4d)
+};
@@ -0,0 +1,113 @@
+#include "kernels.h"
+
+#ifdef __AVX__
+#include <immintrin.h>
+
+#ifdef __FMA__
+#define MADD(a, b, c) _mm256_fmadd_ps((a), (b), (c))
+#else
+#define MADD(a, b, c) _mm256_add_ps(_mm256_mul_ps((a), (b)), (c))
+#endif
+
+// Each 256-bit register holds two points, so the splats stay inside their 128-bit lane
+static inline __m256 transform2(__m256 x, __m256 y, __m256 z, __m256 w, __m256 points) {
+    return MADD(x, _mm256_permute_ps(points, PS_SWIZZLE_XXXX),
+                MADD(y, _mm256_permute_ps(points, PS_SWIZZLE_YYYY),
+                     MADD(z, _mm256_permute_ps(points, PS_SWIZZLE_ZZZZ),
+                          _mm256_mul_ps(w, _mm256_permute_ps(points, PS_SWIZZLE_WWWW)))));
+}
+#endif
+
+#ifdef __AVX512F__
+// Same as transform2 with four points per register
+static inline __m512 transform4(__m512 x, __m512 y, __m512 z, __m512 w, __m512 points) {
+    return _mm512_fmadd_ps(x, _mm512_permute_ps(points, PS_SWIZZLE_XXXX),
+                           _mm512_fmadd_ps(y, _mm512_permute_ps(points, PS_SWIZZLE_YYYY),
+                                           _mm512_fmadd_ps(z, _mm512_permute_ps(points, PS_SWIZZLE_ZZZZ),
+                                                           _mm512_mul_ps(w, _mm512_permute_ps(points,
+                                                                                              PS_SWIZZLE_WWWW)))));
+}
+#endif
+
+void PS_KERNEL(kernel_mat4f_transform_points)(const PsMat4f *m4f, const Ps4f *in, Ps4f *out, size_t length) {
+    size_t i = 0;
+#ifdef __AVX512F__
+    const __m512 x4 = _mm512_broadcast_f32x4(m4f->x);
+    const __m512 y4 = _mm512_broadcast_f32x4(m4f->y);
+    const __m512 z4 = _mm512_broadcast_f32x4(m4f->z);
+    const __m512 w4 = _mm512_broadcast_f32x4(m4f->w);
+    for (; i + 16 <= length; i += 16) {
+        const float *src = (const float *) (in + i);
+        float *dst = (float *) (out + i);
+        const __m512 p0 = _mm512_loadu_ps(src);
+        const __m512 p1 = _mm512_loadu_ps(src + 16);
+        const __m512 p2 = _mm512_loadu_ps(src + 32);
+        const __m512 p3 = _mm512_loadu_ps(src + 48);
+        _mm512_storeu_ps(dst, transform4(x4, y4, z4, w4, p0));
+        _mm512_storeu_ps(dst + 16, transform4(x4, y4, z4, w4, p1));
+        _mm512_storeu_ps(dst + 32, transform4(x4, y4, z4, w4, p2));
+        _mm512_storeu_ps(dst + 48, transform4(x4, y4, z4, w4, p3));
+    }
+#endif
+#ifdef __AVX__
+    const __m256 x = _mm256_broadcast_ps(&m4f->x);
+    const __m256 y = _mm256_broadcast_ps(&m4f->y);
+    const __m256 z = _mm256_broadcast_ps(&m4f->z);
+    const __m256 w = _mm256_broadcast_ps(&m4f->w);
+    for (; i + 8 <= length; i += 8) {
+        const float *src = (const float *) (in + i);
+        float *dst = (float *) (out + i);
+        const __m256 p0 = _mm256_loadu_ps(src);
+        const __m256 p1 = _mm256_loadu_ps(src + 8);
+        const __m256 p2 = _mm256_loadu_ps(src + 16);
+        const __m256 p3 = _mm256_loadu_ps(src + 24);
+        _mm256_storeu_ps(dst, transform2(x, y, z, w, p0));
+        _mm256_storeu_ps(dst + 8, transform2(x, y, z, w, p1));
+        _mm256_storeu_ps(dst + 16, transform2(x, y, z, w, p2));
+        _mm256_storeu_ps(dst + 24, transform2(x, y, z, w, p3));
+    }
+#endif
+    for (; i < length; ++i) {
+        ps_mat4f_4f_mul(m4f, &in[i], &out[i]);
+    }
+}
+
+#ifdef __AVX__
+// The caller may hold Ps4d in the 8 byte aligned scalar layout, so stay unaligned
+#define LOAD4D(p) _mm256_loadu_pd((const double *) (p))
+
+void PS_KERNEL(kernel_mat4d_transform_points)(const PsMat4d *m4d, const Ps4d *in, Ps4d *out, size_t length) {
+    PsMat4d m;
+    m.x = LOAD4D(&m4d->x);
+    m.y = LOAD4D(&m4d->y);
+    m.z = LOAD4D(&m4d->z);
+    m.w = LOAD4D(&m4d->w);
+    size_t i = 0;
+    // Ps4d already fills a whole register, unroll to keep the multipliers busy
+    for (; i + 4 <= length; i += 4) {
+        const Ps4d p0 = LOAD4D(&in[i]), p1 = LOAD4D(&in[i + 1]), p2 = LOAD4D(&in[i + 2]), p3 = LOAD4D(&in[i + 3]);
+        Ps4d r0, r1, r2, r3;
+        ps_mat4d_4d_mul(&m, &p0, &r0);
+        ps_mat4d_4d_mul(&m, &p1, &r1);
+        ps_mat4d_4d_mul(&m, &p2, &r2);
+        ps_mat4d_4d_mul(&m, &p3, &r3);
+        _mm256_storeu_pd((double *) &out[i], r0);
+        _mm256_storeu_pd((double *) &out[i + 1], r1);
+        _mm256_storeu_pd((double *) &out[i + 2], r2);
+        _mm256_storeu_pd((double *) &out[i + 3], r3);
+    }
+    for (; i < length; ++i) {
+        const Ps4d p = LOAD4D(&in[i]);
+        Ps4d r;
+        ps_mat4d_4d_mul(&m, &p, &r);
+        _mm256_storeu_pd((double *) &out[i], r);
+    }
+}
+#else
+void PS_KERNEL(kernel_mat4d_transform_points)(const PsMat4d *m4d, const Ps4d *in, Ps4d *out, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        const Ps4d p = in[i];
+        ps_mat4d_4d_mul(m4d, &p, &out[i]);
+    }
+}
+#endif
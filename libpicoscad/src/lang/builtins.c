@@ -0,0 +1,844 @@
+#include "program.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCAD_CHUNK_SIZE (256 * 1024)
+// OpenSCAD's GRID_FINE, radii below it get the minimum of 3 segments
+#define SCAD_GRID_FINE 0.00000095367431640625
+
+struct ScadChunk {
+    char *data;
+    size_t size;
+};
+
+void scad_arena_init(ScadArena *arena) {
+    *arena = (ScadArena) {0};
+}
+
+void scad_arena_destroy(ScadArena *arena) {
+    for (size_t i = 0; i < arena->chunk_count; ++i) {
+        free(arena->chunks[i].data);
+    }
+    free(arena->chunks);
+}
+
+void *scad_arena_alloc(ScadArena *arena, size_t size) {
+    size = (size + 15) & ~(size_t) 15;
+    if (arena->chunk_count && arena->offset + size <= arena->chunks[arena->current].size) {
+        void *data = arena->chunks[arena->current].data + arena->offset;
+        arena->offset += size;
+        return data;
+    }
+    // Chunks past current are free since the last release
+    for (size_t i = arena->chunk_count ? arena->current + 1 : 0; i < arena->chunk_count; ++i) {
+        if (arena->chunks[i].size >= size) {
+            arena->current = i;
+            arena->offset = size;
+            return arena->chunks[i].data;
+        }
+    }
+    struct ScadChunk *chunks = realloc(arena->chunks, sizeof(struct ScadChunk) * (arena->chunk_count + 1));
+    const size_t chunk_size = size > SCAD_CHUNK_SIZE ? size : SCAD_CHUNK_SIZE;
+    char *data = chunks ? malloc(chunk_size) : NULL;
+    if (chunks) {
+        arena->chunks = chunks;
+    }
+    if (!data) {
+        arena->failed = true;
+        return NULL;
+    }
+    arena->chunks[arena->chunk_count] = (struct ScadChunk) {data, chunk_size};
+    arena->current = arena->chunk_count++;
+    arena->offset = size;
+    return data;
+}
+
+ScadValue scad_arena_mark(const ScadArena *arena) {
+    return (ScadValue) {.type = SCAD_MARK, .length = (uint32_t) arena->current, .offset = arena->offset};
+}
+
+void scad_arena_release(ScadArena *arena, ScadValue mark) {
+    arena->current = mark.length;
+    arena->offset = mark.offset;
+}
+
+ScadValue *scad_vector_new(ScadArena *arena, size_t capacity) {
+    // The capacity lives in a header slot in front of the items
+    ScadValue *header = scad_arena_alloc(arena, sizeof(ScadValue) * (capacity + 1));
+    if (!header) {
+        return NULL;
+    }
+    header->length = (uint32_t) capacity;
+    return header + 1;
+}
+
+ScadValue *scad_vector_push(ScadArena *arena, ScadValue *vector) {
+    const size_t capacity = vector->items[-1].length;
+    if (vector->length == capacity) {
+        ScadValue *items = scad_vector_new(arena, capacity ? capacity * 2 : 4);
+        if (!items) {
+            return NULL;
+        }
+        memcpy(items, vector->items, sizeof(ScadValue) * vector->length);
+        vector->items = items;
+    }
+    return &vector->items[vector->length++];
+}
+
+static ScadValue scad_vector(ScadValue *items, size_t length) {
+    return items ? (ScadValue) {.type = SCAD_VECTOR, .length = (uint32_t) length, .items = items} : scad_undef();
+}
+
+size_t scad_range_count(const double *range) {
+    const double begin = range[0], step = range[1], end = range[2];
+    if (step == 0.0 || !isfinite(begin) || !isfinite(step) || !isfinite(end)) {
+        return 0;
+    }
+    // The slack keeps [0 : 0.1 : 1] at 11 steps despite the rounding of 0.1
+    const double steps = (end - begin) / step;
+    return steps < -1e-9 ? 0 : (size_t) floor(steps + 1e-9) + 1;
+}
+
+bool scad_truthy(const ScadValue *value) {
+    switch (value->type) {
+        case SCAD_BOOL:
+            return value->boolean;
+        case SCAD_NUMBER:
+            return value->number != 0.0;
+        case SCAD_STRING:
+        case SCAD_VECTOR:
+            return value->length > 0;
+        case SCAD_RANGE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool scad_equals(const ScadValue *lhs, const ScadValue *rhs) {
+    if (lhs->type != rhs->type) {
+        return (lhs->type == SCAD_UNDEF || lhs->type == SCAD_MISSING) &&
+               (rhs->type == SCAD_UNDEF || rhs->type == SCAD_MISSING);
+    }
+    switch (lhs->type) {
+        case SCAD_BOOL:
+            return lhs->boolean == rhs->boolean;
+        case SCAD_NUMBER:
+            return lhs->number == rhs->number;
+        case SCAD_STRING:
+            return lhs->length == rhs->length && memcmp(lhs->string, rhs->string, lhs->length) == 0;
+        case SCAD_VECTOR:
+            if (lhs->length != rhs->length) {
+                return false;
+            }
+            for (size_t i = 0; i < lhs->length; ++i) {
+                if (!scad_equals(&lhs->items[i], &rhs->items[i])) {
+                    return false;
+                }
+            }
+            return true;
+        case SCAD_RANGE:
+            return memcmp(lhs->range, rhs->range, sizeof(double) * 3) == 0;
+        default:
+            return true;
+    }
+}
+
+ScadValue scad_compare(ScadOp op, const ScadValue *lhs, const ScadValue *rhs) {
+    if (op == SCAD_OP_EQ || op == SCAD_OP_NE) {
+        return scad_bool(scad_equals(lhs, rhs) == (op == SCAD_OP_EQ));
+    }
+    int order;
+    if ((lhs->type == SCAD_NUMBER || lhs->type == SCAD_BOOL) && (rhs->type == SCAD_NUMBER || rhs->type == SCAD_BOOL)) {
+        const double a = lhs->type == SCAD_NUMBER ? lhs->number : lhs->boolean;
+        const double b = rhs->type == SCAD_NUMBER ? rhs->number : rhs->boolean;
+        if (a != a || b != b) {
+            return scad_bool(false);
+        }
+        order = (a > b) - (a < b);
+    } else if (lhs->type == SCAD_STRING && rhs->type == SCAD_STRING) {
+        const size_t length = lhs->length < rhs->length ? lhs->length : rhs->length;
+        order = memcmp(lhs->string, rhs->string, length);
+        order = order ? order : (lhs->length > rhs->length) - (lhs->length < rhs->length);
+    } else {
+        return scad_undef();
+    }
+    return scad_bool(op == SCAD_OP_LT ? order < 0 : order <= 0);
+}
+
+static bool scad_is_matrix(const ScadValue *value) {
+    return value->type == SCAD_VECTOR && value->length > 0 && value->items[0].type == SCAD_VECTOR;
+}
+
+static ScadValue scad_dot(const ScadValue *lhs, const ScadValue *rhs) {
+    if (lhs->length != rhs->length) {
+        return scad_undef();
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < lhs->length; ++i) {
+        if (lhs->items[i].type != SCAD_NUMBER || rhs->items[i].type != SCAD_NUMBER) {
+            return scad_undef();
+        }
+        sum += lhs->items[i].number * rhs->items[i].number;
+    }
+    return scad_number(sum);
+}
+
+// Vector times matrix, the matrix * anything cases go through here one row at a time
+static ScadValue scad_multiply_vectors(ScadArena *arena, const ScadValue *lhs, const ScadValue *rhs) {
+    if (scad_is_matrix(lhs)) {
+        ScadValue *items = scad_vector_new(arena, lhs->length);
+        for (size_t i = 0; items && i < lhs->length; ++i) {
+            items[i] = lhs->items[i].type == SCAD_VECTOR ? scad_multiply_vectors(arena, &lhs->items[i], rhs)
+                                                         : scad_undef();
+        }
+        return scad_vector(items, lhs->length);
+    }
+    if (!scad_is_matrix(rhs)) {
+        return scad_dot(lhs, rhs);
+    }
+    if (lhs->length != rhs->length) {
+        return scad_undef();
+    }
+    const size_t columns = rhs->items[0].length;
+    ScadValue *items = scad_vector_new(arena, columns);
+    for (size_t j = 0; items && j < columns; ++j) {
+        double sum = 0.0;
+        for (size_t i = 0; i < lhs->length; ++i) {
+            const ScadValue *row = &rhs->items[i];
+            if (lhs->items[i].type != SCAD_NUMBER || row->type != SCAD_VECTOR || row->length != columns ||
+                row->items[j].type != SCAD_NUMBER) {
+                return scad_undef();
+            }
+            sum += lhs->items[i].number * row->items[j].number;
+        }
+        items[j] = scad_number(sum);
+    }
+    return scad_vector(items, columns);
+}
+
+ScadValue scad_arithmetic(ScadArena *arena, ScadOp op, const ScadValue *lhs, const ScadValue *rhs) {
+    if (op == SCAD_OP_NEG) {
+        if (lhs->type == SCAD_NUMBER) {
+            return scad_number(-lhs->number);
+        } else if (lhs->type != SCAD_VECTOR) {
+            return scad_undef();
+        }
+        ScadValue *items = scad_vector_new(arena, lhs->length);
+        for (size_t i = 0; items && i < lhs->length; ++i) {
+            items[i] = scad_arithmetic(arena, op, &lhs->items[i], NULL);
+        }
+        return scad_vector(items, lhs->length);
+    }
+    if (lhs->type == SCAD_NUMBER && rhs->type == SCAD_NUMBER) {
+        const double a = lhs->number, b = rhs->number;
+        switch (op) {
+            case SCAD_OP_ADD:
+                return scad_number(a + b);
+            case SCAD_OP_SUB:
+                return scad_number(a - b);
+            case SCAD_OP_MUL:
+                return scad_number(a * b);
+            case SCAD_OP_DIV:
+                return scad_number(a / b);
+            case SCAD_OP_MOD:
+                // fmod is slow even for small quotients, loop counters are integers
+                if (a == (int32_t) a && b == (int32_t) b && b != 0.0 && a != 0.0) {
+                    const int64_t r = (int64_t) a % (int64_t) b;
+                    return scad_number(r == 0 && a < 0.0 ? -0.0 : (double) r);
+                }
+                return scad_number(fmod(a, b));
+            case SCAD_OP_POW:
+                return scad_number(pow(a, b));
+            default:
+                return scad_undef();
+        }
+    }
+    const bool lhs_vector = lhs->type == SCAD_VECTOR, rhs_vector = rhs->type == SCAD_VECTOR;
+    if (lhs_vector && rhs_vector) {
+        if (op == SCAD_OP_MUL) {
+            return scad_multiply_vectors(arena, lhs, rhs);
+        } else if ((op != SCAD_OP_ADD && op != SCAD_OP_SUB) || lhs->length != rhs->length) {
+            return scad_undef();
+        }
+        ScadValue *items = scad_vector_new(arena, lhs->length);
+        for (size_t i = 0; items && i < lhs->length; ++i) {
+            items[i] = scad_arithmetic(arena, op, &lhs->items[i], &rhs->items[i]);
+        }
+        return scad_vector(items, lhs->length);
+    }
+    // Scaling a vector, element by element
+    if ((lhs_vector && rhs->type == SCAD_NUMBER && (op == SCAD_OP_MUL || op == SCAD_OP_DIV)) ||
+        (rhs_vector && lhs->type == SCAD_NUMBER && op == SCAD_OP_MUL)) {
+        const ScadValue *vector = lhs_vector ? lhs : rhs;
+        ScadValue *items = scad_vector_new(arena, vector->length);
+        for (size_t i = 0; items && i < vector->length; ++i) {
+            items[i] = lhs_vector ? scad_arithmetic(arena, op, &lhs->items[i], rhs)
+                                  : scad_arithmetic(arena, op, lhs, &rhs->items[i]);
+        }
+        return scad_vector(items, vector->length);
+    }
+    return scad_undef();
+}
+
+ScadValue scad_index(const ScadValue *value, double index) {
+    if (!(index >= 0.0)) {
+        return scad_undef();
+    }
+    const size_t i = (size_t) index;
+    switch (value->type) {
+        case SCAD_VECTOR:
+            return i < value->length ? value->items[i] : scad_undef();
+        case SCAD_STRING:
+            return i < value->length ? (ScadValue) {.type = SCAD_STRING, .length = 1, .string = value->string + i}
+                                     : scad_undef();
+        case SCAD_RANGE:
+            return i < 3 ? scad_number(value->range[i]) : scad_undef();
+        default:
+            return scad_undef();
+    }
+}
+
+static bool scad_append(IoBuffer *out, const char *text, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        char *c = io_buffer_push(out);
+        if (!c) {
+            return false;
+        }
+        *c = text[i];
+    }
+    return true;
+}
+
+static bool scad_append_number(IoBuffer *out, double number) {
+    char text[32];
+    // OpenSCAD prints six significant digits, no negative zero and no sign on nan
+    const int length = snprintf(text, sizeof(text), "%g", number == 0.0 || isnan(number) ? fabs(number) : number);
+    return scad_append(out, text, (size_t) length);
+}
+
+bool scad_format(const ScadValue *value, bool quote, IoBuffer *out) {
+    switch (value->type) {
+        case SCAD_BOOL:
+            return value->boolean ? scad_append(out, "true", 4) : scad_append(out, "false", 5);
+        case SCAD_NUMBER:
+            return scad_append_number(out, value->number);
+        case SCAD_STRING:
+            return !quote ? scad_append(out, value->string, value->length)
+                          : scad_append(out, "\"", 1) && scad_append(out, value->string, value->length) &&
+                            scad_append(out, "\"", 1);
+        case SCAD_VECTOR:
+            if (!scad_append(out, "[", 1)) {
+                return false;
+            }
+            for (size_t i = 0; i < value->length; ++i) {
+                if ((i && !scad_append(out, ", ", 2)) || !scad_format(&value->items[i], true, out)) {
+                    return false;
+                }
+            }
+            return scad_append(out, "]", 1);
+        case SCAD_RANGE:
+            return scad_append(out, "[", 1) && scad_append_number(out, value->range[0]) &&
+                   scad_append(out, " : ", 3) && scad_append_number(out, value->range[1]) &&
+                   scad_append(out, " : ", 3) && scad_append_number(out, value->range[2]) &&
+                   scad_append(out, "]", 1);
+        default:
+            return scad_append(out, "undef", 5);
+    }
+}
+
+enum {
+    SCAD_FUNCTION_SIN,
+    SCAD_FUNCTION_COS,
+    SCAD_FUNCTION_TAN,
+    SCAD_FUNCTION_ASIN,
+    SCAD_FUNCTION_ACOS,
+    SCAD_FUNCTION_ATAN,
+    SCAD_FUNCTION_ATAN2,
+    SCAD_FUNCTION_ABS,
+    SCAD_FUNCTION_SIGN,
+    SCAD_FUNCTION_SQRT,
+    SCAD_FUNCTION_POW,
+    SCAD_FUNCTION_EXP,
+    SCAD_FUNCTION_LN,
+    SCAD_FUNCTION_LOG,
+    SCAD_FUNCTION_FLOOR,
+    SCAD_FUNCTION_CEIL,
+    SCAD_FUNCTION_ROUND,
+    SCAD_FUNCTION_MIN,
+    SCAD_FUNCTION_MAX,
+    SCAD_FUNCTION_LEN,
+    SCAD_FUNCTION_NORM,
+    SCAD_FUNCTION_CROSS,
+    SCAD_FUNCTION_CONCAT,
+    SCAD_FUNCTION_IS_UNDEF,
+    SCAD_FUNCTION_IS_NUM,
+    SCAD_FUNCTION_IS_BOOL,
+    SCAD_FUNCTION_IS_LIST,
+    SCAD_FUNCTION_IS_STRING
+};
+
+const ScadBuiltin scad_builtin_functions[] = {
+        [SCAD_FUNCTION_SIN] = {"sin", {"x"}, 1},
+        [SCAD_FUNCTION_COS] = {"cos", {"x"}, 1},
+        [SCAD_FUNCTION_TAN] = {"tan", {"x"}, 1},
+        [SCAD_FUNCTION_ASIN] = {"asin", {"x"}, 1},
+        [SCAD_FUNCTION_ACOS] = {"acos", {"x"}, 1},
+        [SCAD_FUNCTION_ATAN] = {"atan", {"x"}, 1},
+        [SCAD_FUNCTION_ATAN2] = {"atan2", {"y", "x"}, 2},
+        [SCAD_FUNCTION_ABS] = {"abs", {"x"}, 1},
+        [SCAD_FUNCTION_SIGN] = {"sign", {"x"}, 1},
+        [SCAD_FUNCTION_SQRT] = {"sqrt", {"x"}, 1},
+        [SCAD_FUNCTION_POW] = {"pow", {"base", "exponent"}, 2},
+        [SCAD_FUNCTION_EXP] = {"exp", {"x"}, 1},
+        [SCAD_FUNCTION_LN] = {"ln", {"x"}, 1},
+        [SCAD_FUNCTION_LOG] = {"log", {"b", "x"}, 2},
+        [SCAD_FUNCTION_FLOOR] = {"floor", {"x"}, 1},
+        [SCAD_FUNCTION_CEIL] = {"ceil", {"x"}, 1},
+        [SCAD_FUNCTION_ROUND] = {"round", {"x"}, 1},
+        [SCAD_FUNCTION_MIN] = {"min", {NULL}, 0, true},
+        [SCAD_FUNCTION_MAX] = {"max", {NULL}, 0, true},
+        [SCAD_FUNCTION_LEN] = {"len", {"x"}, 1},
+        [SCAD_FUNCTION_NORM] = {"norm", {"v"}, 1},
+        [SCAD_FUNCTION_CROSS] = {"cross", {"u", "v"}, 2},
+        [SCAD_FUNCTION_CONCAT] = {"concat", {NULL}, 0, true},
+        [SCAD_FUNCTION_IS_UNDEF] = {"is_undef", {"x"}, 1},
+        [SCAD_FUNCTION_IS_NUM] = {"is_num", {"x"}, 1},
+        [SCAD_FUNCTION_IS_BOOL] = {"is_bool", {"x"}, 1},
+        [SCAD_FUNCTION_IS_LIST] = {"is_list", {"x"}, 1},
+        [SCAD_FUNCTION_IS_STRING] = {"is_string", {"x"}, 1},
+};
+const size_t scad_builtin_function_count = sizeof(scad_builtin_functions) / sizeof(scad_builtin_functions[0]);
+
+#define SCAD_DEGREES (180.0 / M_PI)
+
+// Exact at the multiples of 30 degrees where the result is rational, like OpenSCAD
+static double scad_sin_degrees(double degrees) {
+    if (!isfinite(degrees)) {
+        return NAN;
+    }
+    double x = fmod(degrees, 360.0);
+    x += x < 0.0 ? 360.0 : 0.0;
+    const bool negative = x >= 180.0;
+    x -= negative ? 180.0 : 0.0;
+    x = x > 90.0 ? 180.0 - x : x;
+    const double sin_x = x == 0.0 ? 0.0 : x == 30.0 ? 0.5 : x == 90.0 ? 1.0 : sin(x / SCAD_DEGREES);
+    return negative ? -sin_x : sin_x;
+}
+
+static double scad_cos_degrees(double degrees) {
+    return scad_sin_degrees(degrees + 90.0);
+}
+
+static ScadValue scad_min_max(const ScadValue *args, size_t count, bool max) {
+    // min(v) looks inside v, min(a, b, ...) compares the arguments
+    if (count == 1 && args[0].type == SCAD_VECTOR) {
+        count = args[0].length;
+        args = args[0].items;
+    }
+    if (count == 0) {
+        return scad_undef();
+    }
+    double best = max ? -INFINITY : INFINITY;
+    for (size_t i = 0; i < count; ++i) {
+        if (args[i].type != SCAD_NUMBER) {
+            return scad_undef();
+        }
+        best = max ? fmax(best, args[i].number) : fmin(best, args[i].number);
+    }
+    return scad_number(best);
+}
+
+ScadValue scad_call_builtin(ScadArena *arena, int id, const ScadValue *args, int count) {
+    const double x = args[0].type == SCAD_NUMBER ? args[0].number : NAN;
+    const bool number = args[0].type == SCAD_NUMBER;
+    switch (id) {
+        case SCAD_FUNCTION_SIN:
+            return number ? scad_number(scad_sin_degrees(x)) : scad_undef();
+        case SCAD_FUNCTION_COS:
+            return number ? scad_number(scad_cos_degrees(x)) : scad_undef();
+        case SCAD_FUNCTION_TAN:
+            return number ? scad_number(scad_sin_degrees(x) / scad_cos_degrees(x)) : scad_undef();
+        case SCAD_FUNCTION_ASIN:
+            return number ? scad_number(asin(x) * SCAD_DEGREES) : scad_undef();
+        case SCAD_FUNCTION_ACOS:
+            return number ? scad_number(acos(x) * SCAD_DEGREES) : scad_undef();
+        case SCAD_FUNCTION_ATAN:
+            return number ? scad_number(atan(x) * SCAD_DEGREES) : scad_undef();
+        case SCAD_FUNCTION_ATAN2:
+            return number && args[1].type == SCAD_NUMBER ? scad_number(atan2(x, args[1].number) * SCAD_DEGREES)
+                                                         : scad_undef();
+        case SCAD_FUNCTION_ABS:
+            return number ? scad_number(fabs(x)) : scad_undef();
+        case SCAD_FUNCTION_SIGN:
+            return number ? scad_number((x > 0.0) - (x < 0.0)) : scad_undef();
+        case SCAD_FUNCTION_SQRT:
+            return number ? scad_number(sqrt(x)) : scad_undef();
+        case SCAD_FUNCTION_POW:
+            return number && args[1].type == SCAD_NUMBER ? scad_number(pow(x, args[1].number)) : scad_undef();
+        case SCAD_FUNCTION_EXP:
+            return number ? scad_number(exp(x)) : scad_undef();
+        case SCAD_FUNCTION_LN:
+            return number ? scad_number(log(x)) : scad_undef();
+        case SCAD_FUNCTION_LOG:
+            // log(x) is base 10, log(b, x) base b
+            if (number && args[1].type == SCAD_NUMBER) {
+                return scad_number(log(args[1].number) / log(x));
+            }
+            return number && args[1].type == SCAD_MISSING ? scad_number(log10(x)) : scad_undef();
+        case SCAD_FUNCTION_FLOOR:
+            return number ? scad_number(floor(x)) : scad_undef();
+        case SCAD_FUNCTION_CEIL:
+            return number ? scad_number(ceil(x)) : scad_undef();
+        case SCAD_FUNCTION_ROUND:
+            return number ? scad_number(round(x)) : scad_undef();
+        case SCAD_FUNCTION_MIN:
+        case SCAD_FUNCTION_MAX:
+            return scad_min_max(args, (size_t) count, id == SCAD_FUNCTION_MAX);
+        case SCAD_FUNCTION_LEN:
+            return args[0].type == SCAD_VECTOR || args[0].type == SCAD_STRING ? scad_number(args[0].length)
+                                                                              : scad_undef();
+        case SCAD_FUNCTION_NORM: {
+            if (args[0].type != SCAD_VECTOR) {
+                return scad_undef();
+            }
+            const ScadValue dot = scad_dot(&args[0], &args[0]);
+            return dot.type == SCAD_NUMBER ? scad_number(sqrt(dot.number)) : dot;
+        }
+        case SCAD_FUNCTION_CROSS: {
+            double u[3] = {0.0}, v[3] = {0.0};
+            const ScadValue *vectors[2] = {&args[0], &args[1]};
+            double *out[2] = {u, v};
+            const uint32_t length = args[0].length;
+            for (int k = 0; k < 2; ++k) {
+                if (vectors[k]->type != SCAD_VECTOR || vectors[k]->length != length || length < 2 || length > 3) {
+                    return scad_undef();
+                }
+                for (uint32_t i = 0; i < length; ++i) {
+                    if (vectors[k]->items[i].type != SCAD_NUMBER) {
+                        return scad_undef();
+                    }
+                    out[k][i] = vectors[k]->items[i].number;
+                }
+            }
+            if (length == 2) {
+                return scad_number(u[0] * v[1] - u[1] * v[0]);
+            }
+            ScadValue *items = scad_vector_new(arena, 3);
+            if (items) {
+                items[0] = scad_number(u[1] * v[2] - u[2] * v[1]);
+                items[1] = scad_number(u[2] * v[0] - u[0] * v[2]);
+                items[2] = scad_number(u[0] * v[1] - u[1] * v[0]);
+            }
+            return scad_vector(items, 3);
+        }
+        case SCAD_FUNCTION_CONCAT: {
+            size_t length = 0;
+            for (int i = 0; i < count; ++i) {
+                length += args[i].type == SCAD_VECTOR ? args[i].length : 1;
+            }
+            ScadValue *items = scad_vector_new(arena, length);
+            if (!items) {
+                return scad_undef();
+            }
+            size_t n = 0;
+            for (int i = 0; i < count; ++i) {
+                if (args[i].type == SCAD_VECTOR) {
+                    memcpy(items + n, args[i].items, sizeof(ScadValue) * args[i].length);
+                    n += args[i].length;
+                } else {
+                    items[n++] = args[i];
+                }
+            }
+            return scad_vector(items, length);
+        }
+        case SCAD_FUNCTION_IS_UNDEF:
+            return scad_bool(args[0].type == SCAD_UNDEF || args[0].type == SCAD_MISSING);
+        case SCAD_FUNCTION_IS_NUM:
+            return scad_bool(number && !isnan(x));
+        case SCAD_FUNCTION_IS_BOOL:
+            return scad_bool(args[0].type == SCAD_BOOL);
+        case SCAD_FUNCTION_IS_LIST:
+            return scad_bool(args[0].type == SCAD_VECTOR);
+        case SCAD_FUNCTION_IS_STRING:
+            return scad_bool(args[0].type == SCAD_STRING);
+        default:
+            return scad_undef();
+    }
+}
+
+enum {
+    SCAD_MODULE_SQUARE,
+    SCAD_MODULE_CIRCLE,
+    SCAD_MODULE_POLYGON,
+    SCAD_MODULE_CUBE,
+    SCAD_MODULE_SPHERE,
+    SCAD_MODULE_CYLINDER,
+    SCAD_MODULE_TRANSLATE,
+    SCAD_MODULE_ROTATE,
+    SCAD_MODULE_SCALE,
+    SCAD_MODULE_MIRROR,
+    SCAD_MODULE_MULTMATRIX,
+    SCAD_MODULE_UNION,
+    SCAD_MODULE_DIFFERENCE,
+    SCAD_MODULE_INTERSECTION,
+    SCAD_MODULE_LINEAR_EXTRUDE,
+    SCAD_MODULE_COLOR,
+    SCAD_MODULE_RENDER,
+    SCAD_MODULE_GROUP
+};
+
+const ScadBuiltin scad_builtin_modules[] = {
+        [SCAD_MODULE_SQUARE] = {"square", {"size", "center"}, 2},
+        [SCAD_MODULE_CIRCLE] = {"circle", {"r", "d"}, 2},
+        [SCAD_MODULE_POLYGON] = {"polygon", {"points", "paths", "convexity"}, 3},
+        [SCAD_MODULE_CUBE] = {"cube", {"size", "center"}, 2},
+        [SCAD_MODULE_SPHERE] = {"sphere", {"r", "d"}, 2},
+        [SCAD_MODULE_CYLINDER] = {"cylinder", {"h", "r1", "r2", "center", "r", "d", "d1", "d2"}, 8},
+        [SCAD_MODULE_TRANSLATE] = {"translate", {"v"}, 1},
+        [SCAD_MODULE_ROTATE] = {"rotate", {"a", "v"}, 2},
+        [SCAD_MODULE_SCALE] = {"scale", {"v"}, 1},
+        [SCAD_MODULE_MIRROR] = {"mirror", {"v"}, 1},
+        [SCAD_MODULE_MULTMATRIX] = {"multmatrix", {"m"}, 1},
+        [SCAD_MODULE_UNION] = {"union", {NULL}, 0},
+        [SCAD_MODULE_DIFFERENCE] = {"difference", {NULL}, 0},
+        [SCAD_MODULE_INTERSECTION] = {"intersection", {NULL}, 0},
+        [SCAD_MODULE_LINEAR_EXTRUDE] = {"linear_extrude", {"height", "center", "convexity", "twist", "slices",
+                                                           "scale"}, 6},
+        [SCAD_MODULE_COLOR] = {"color", {"c", "alpha"}, 2},
+        [SCAD_MODULE_RENDER] = {"render", {"convexity"}, 1},
+        [SCAD_MODULE_GROUP] = {"group", {NULL}, 0},
+};
+const size_t scad_builtin_module_count = sizeof(scad_builtin_modules) / sizeof(scad_builtin_modules[0]);
+
+static double scad_number_or(const ScadValue *value, double fallback) {
+    return value->type == SCAD_NUMBER ? value->number : fallback;
+}
+
+// Up to three numbers from a vector, or a number repeated; false for anything else
+static bool scad_vector3(const ScadValue *value, double fallback, double out[3]) {
+    out[0] = out[1] = out[2] = fallback;
+    if (value->type == SCAD_NUMBER) {
+        out[0] = out[1] = out[2] = value->number;
+        return true;
+    } else if (value->type != SCAD_VECTOR) {
+        return false;
+    }
+    for (size_t i = 0; i < value->length && i < 3; ++i) {
+        out[i] = scad_number_or(&value->items[i], fallback);
+    }
+    return true;
+}
+
+// Transforms are composed as 3x4 rows, which become the columns of the node's PsMat4d
+static void scad_set_transform(PsScadNode *node, double m[3][4]) {
+    node->transform = (PsMat4d) {
+            ps_4d(m[0][0], m[1][0], m[2][0], 0.0),
+            ps_4d(m[0][1], m[1][1], m[2][1], 0.0),
+            ps_4d(m[0][2], m[1][2], m[2][2], 0.0),
+            ps_4d(m[0][3], m[1][3], m[2][3], 1.0)
+    };
+}
+
+static void scad_multiply(double lhs[3][4], double rhs[3][4], double out[3][4]) {
+    double result[3][4];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            result[i][j] = lhs[i][0] * rhs[0][j] + lhs[i][1] * rhs[1][j] + lhs[i][2] * rhs[2][j] +
+                           (j == 3 ? lhs[i][3] : 0.0);
+        }
+    }
+    memcpy(out, result, sizeof(result));
+}
+
+static void scad_rotation(double axis[3], double degrees, double out[3][4]) {
+    const double length = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    const double x = axis[0] / length, y = axis[1] / length, z = axis[2] / length;
+    const double s = scad_sin_degrees(degrees), c = scad_cos_degrees(degrees), t = 1.0 - c;
+    double m[3][4] = {
+            {t * x * x + c, t * x * y - s * z, t * x * z + s * y, 0.0},
+            {t * x * y + s * z, t * y * y + c, t * y * z - s * x, 0.0},
+            {t * x * z - s * y, t * y * z + s * x, t * z * z + c, 0.0},
+    };
+    memcpy(out, m, sizeof(m));
+}
+
+static void scad_rotate(const ScadValue *args, double m[3][4]) {
+    double axis[3];
+    if (args[0].type == SCAD_VECTOR) {
+        // Euler angles, about x first, then y, then z
+        double angles[3], step[3][4];
+        scad_vector3(&args[0], 0.0, angles);
+        for (int i = 0; i < 3; ++i) {
+            double unit[3] = {i == 0, i == 1, i == 2};
+            scad_rotation(unit, angles[i], step);
+            scad_multiply(step, m, m);
+        }
+    } else if (args[0].type == SCAD_NUMBER) {
+        if (!scad_vector3(&args[1], 0.0, axis) || args[1].type != SCAD_VECTOR ||
+            axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] == 0.0) {
+            axis[0] = axis[1] = 0.0;
+            axis[2] = 1.0;
+        }
+        scad_rotation(axis, args[0].number, m);
+    }
+}
+
+static void scad_multmatrix(const ScadValue *matrix, double m[3][4]) {
+    if (matrix->type != SCAD_VECTOR) {
+        return;
+    }
+    for (size_t i = 0; i < 3 && i < matrix->length; ++i) {
+        const ScadValue *row = &matrix->items[i];
+        for (size_t j = 0; row->type == SCAD_VECTOR && j < 4 && j < row->length; ++j) {
+            m[i][j] = scad_number_or(&row->items[j], m[i][j]);
+        }
+    }
+}
+
+static uint32_t scad_fragments(const ScadVm *vm, double radius) {
+    const double fn = scad_number_or(&vm->specials[SCAD_SPECIAL_FN], 0.0);
+    double fa = scad_number_or(&vm->specials[SCAD_SPECIAL_FA], 12.0);
+    double fs = scad_number_or(&vm->specials[SCAD_SPECIAL_FS], 2.0);
+    fa = fa > 0.01 ? fa : 0.01;
+    fs = fs > 0.01 ? fs : 0.01;
+    if (!(radius >= SCAD_GRID_FINE)) {
+        return 3;
+    } else if (fn > 0.0) {
+        return fn >= 3.0 ? (uint32_t) fmin(fn, 1e6) : 3;
+    }
+    return (uint32_t) ceil(fmax(fmin(360.0 / fa, radius * 2.0 * M_PI / fs), 5.0));
+}
+
+// Whether the script asked for a resolution of its own, see PsScadNode.custom_segments
+static bool scad_custom_fragments(const ScadVm *vm) {
+    return scad_number_or(&vm->specials[SCAD_SPECIAL_FN], 0.0) > 0.0 ||
+           scad_number_or(&vm->specials[SCAD_SPECIAL_FA], 12.0) != 12.0 ||
+           scad_number_or(&vm->specials[SCAD_SPECIAL_FS], 2.0) != 2.0;
+}
+
+bool scad_builtin_node(ScadVm *vm, int id, const ScadValue *args, PsScadNode *node) {
+    double m[3][4] = {{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}};
+    double v[3];
+    *node = (PsScadNode) {.kind = PS_SCAD_GROUP, .dims = ps_4d_zero()};
+    switch (id) {
+        case SCAD_MODULE_SQUARE:
+            scad_vector3(&args[0], 1.0, v);
+            node->kind = PS_SCAD_SQUARE;
+            node->dims = ps_4d(v[0], v[1], 0.0, 0.0);
+            node->center = scad_truthy(&args[1]);
+            break;
+        case SCAD_MODULE_CIRCLE:
+        case SCAD_MODULE_SPHERE: {
+            const double r = args[1].type == SCAD_NUMBER ? args[1].number / 2.0 : scad_number_or(&args[0], 1.0);
+            node->kind = id == SCAD_MODULE_CIRCLE ? PS_SCAD_CIRCLE : PS_SCAD_SPHERE;
+            node->dims = ps_4d(r, 0.0, 0.0, 0.0);
+            node->segments = scad_fragments(vm, r);
+            node->custom_segments = scad_custom_fragments(vm);
+            break;
+        }
+        case SCAD_MODULE_POLYGON: {
+            const ScadValue *points = &args[0];
+            node->kind = PS_SCAD_POLYGON;
+            if (points->type != SCAD_VECTOR) {
+                break;
+            }
+            node->first_point = (uint32_t) vm->points.length;
+            for (size_t i = 0; i < points->length; ++i) {
+                const ScadValue *point = &points->items[i];
+                if (point->type != SCAD_VECTOR || point->length < 2 || point->items[0].type != SCAD_NUMBER ||
+                    point->items[1].type != SCAD_NUMBER) {
+                    continue;
+                }
+                Ps4d *out = io_buffer_push(&vm->points);
+                if (!out) {
+                    return false;
+                }
+                *out = ps_4d(point->items[0].number, point->items[1].number, 0.0, 1.0);
+                node->point_count++;
+            }
+            break;
+        }
+        case SCAD_MODULE_CUBE:
+            scad_vector3(&args[0], 1.0, v);
+            node->kind = PS_SCAD_CUBE;
+            node->dims = ps_4d(v[0], v[1], v[2], 0.0);
+            node->center = scad_truthy(&args[1]);
+            break;
+        case SCAD_MODULE_CYLINDER: {
+            // r and d set both radii, r1/r2 and d1/d2 override them
+            double r = 1.0;
+            r = args[4].type == SCAD_NUMBER ? args[4].number : r;
+            r = args[5].type == SCAD_NUMBER ? args[5].number / 2.0 : r;
+            double r1 = scad_number_or(&args[1], r), r2 = scad_number_or(&args[2], r);
+            r1 = args[6].type == SCAD_NUMBER ? args[6].number / 2.0 : r1;
+            r2 = args[7].type == SCAD_NUMBER ? args[7].number / 2.0 : r2;
+            node->kind = PS_SCAD_CYLINDER;
+            node->dims = ps_4d(r1, r2, scad_number_or(&args[0], 1.0), 0.0);
+            node->center = scad_truthy(&args[3]);
+            node->segments = scad_fragments(vm, fmax(r1, r2));
+            node->custom_segments = scad_custom_fragments(vm);
+            break;
+        }
+        case SCAD_MODULE_TRANSLATE:
+            node->kind = PS_SCAD_TRANSFORM;
+            if (args[0].type == SCAD_VECTOR) {
+                scad_vector3(&args[0], 0.0, v);
+                m[0][3] = v[0];
+                m[1][3] = v[1];
+                m[2][3] = v[2];
+            }
+            break;
+        case SCAD_MODULE_ROTATE:
+            node->kind = PS_SCAD_TRANSFORM;
+            scad_rotate(args, m);
+            break;
+        case SCAD_MODULE_SCALE:
+            node->kind = PS_SCAD_TRANSFORM;
+            if (scad_vector3(&args[0], 1.0, v)) {
+                m[0][0] = v[0];
+                m[1][1] = v[1];
+                m[2][2] = v[2];
+            }
+            break;
+        case SCAD_MODULE_MIRROR: {
+            node->kind = PS_SCAD_TRANSFORM;
+            scad_vector3(&args[0], 0.0, v);
+            const double length = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+            if (args[0].type == SCAD_VECTOR && length > 0.0) {
+                // I - 2 n n^T over |n|^2
+                for (int i = 0; i < 3; ++i) {
+                    for (int j = 0; j < 3; ++j) {
+                        m[i][j] -= 2.0 * v[i] * v[j] / length;
+                    }
+                }
+            }
+            break;
+        }
+        case SCAD_MODULE_MULTMATRIX:
+            node->kind = PS_SCAD_TRANSFORM;
+            scad_multmatrix(&args[0], m);
+            break;
+        case SCAD_MODULE_UNION:
+            node->kind = PS_SCAD_UNION;
+            break;
+        case SCAD_MODULE_DIFFERENCE:
+            node->kind = PS_SCAD_DIFFERENCE;
+            break;
+        case SCAD_MODULE_INTERSECTION:
+            node->kind = PS_SCAD_INTERSECTION;
+            break;
+        case SCAD_MODULE_LINEAR_EXTRUDE:
+            node->kind = PS_SCAD_LINEAR_EXTRUDE;
+            node->dims = ps_4d(scad_number_or(&args[0], 100.0), 0.0, 0.0, 0.0);
+            node->center = scad_truthy(&args[1]);
+            break;
+        default:
+            break;
+    }
+    scad_set_transform(node, m);
+    return true;
+}
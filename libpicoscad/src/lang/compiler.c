@@ -0,0 +1,1635 @@
+#include "program.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <picoscad/sys/trace.h>
+
+#include "lexer.h"
+
+/*
+ * A single pass over the tokens straight to bytecode. A pre-scan collects the
+ * top level modules, functions and variables first, so calls and globals can
+ * be resolved before their definition. Registers are allocated like a stack:
+ * locals at the bottom of the frame, temporaries above them.
+ */
+
+typedef struct ScadParam {
+    const ScadToken *name;
+    bool has_default;
+} ScadParam;
+
+typedef struct ScadDeclaration {
+    const ScadToken *name;
+    size_t first_param;
+    size_t param_count;
+    uint32_t proto;
+    bool module;
+} ScadDeclaration;
+
+typedef struct ScadLocal {
+    const ScadToken *name;
+    int reg;
+} ScadLocal;
+
+typedef struct ScadFunction {
+    int freereg;
+    /**
+     * Registers below this hold locals and are never freed as temporaries
+     */
+    int active;
+    int maxreg;
+    size_t first_local;
+    bool module;
+} ScadFunction;
+
+typedef struct ScadBlock {
+    struct ScadBlock *parent;
+    size_t local_count;
+    int freereg;
+    int active;
+    /**
+     * Where the values of the special variables assigned in the block were saved, -1 if not
+     */
+    int saved[SCAD_SETTABLE_SPECIALS];
+} ScadBlock;
+
+typedef enum ScadExpKind {
+    SCAD_EXP_CONSTANT,
+    SCAD_EXP_REGISTER
+} ScadExpKind;
+
+/**
+ * A compiled expression: a constant not yet loaded anywhere, or a register
+ */
+typedef struct ScadExp {
+    ScadExpKind kind;
+    int reg;
+    ScadValue value;
+} ScadExp;
+
+typedef struct ScadSignature {
+    const ScadParam *params;
+    const ScadBuiltin *builtin;
+    size_t count;
+} ScadSignature;
+
+/**
+ * The $ arguments of a call, set for its duration and restored after it
+ */
+typedef struct ScadCallSpecials {
+    int count;
+    int special[SCAD_SETTABLE_SPECIALS];
+    int saved[SCAD_SETTABLE_SPECIALS];
+} ScadCallSpecials;
+
+typedef struct ScadCompiler {
+    ScadToken *tokens;
+    size_t token_count;
+    size_t pos;
+    IoBuffer code;
+    IoBuffer locations;
+    IoBuffer constants;
+    IoBuffer protos;
+    IoBuffer params;
+    IoBuffer declarations;
+    IoBuffer globals;
+    IoBuffer locals;
+    IoBuffer strings;
+    uint32_t *number_table;
+    size_t number_table_size;
+    ScadFunction *function;
+    ScadBlock *block;
+    ScadBlock *main_block;
+    ScadToken eof;
+    PsScadError *error;
+    bool failed;
+    // Stands in for buffer elements once out of memory, so emitting needs no checks
+    ScadValue scratch[4];
+} ScadCompiler;
+
+static void scad_error(ScadCompiler *c, const ScadToken *at, const char *format, ...) {
+    if (c->failed) {
+        return;
+    }
+    c->failed = true;
+    c->error->line = at->line;
+    c->error->column = at->column;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(c->error->message, sizeof(c->error->message), format, args);
+    va_end(args);
+}
+
+static void *scad_push(ScadCompiler *c, IoBuffer *buffer) {
+    void *element = io_buffer_push(buffer);
+    if (!element) {
+        scad_error(c, &c->eof, "out of memory");
+        return c->scratch;
+    }
+    return element;
+}
+
+static bool scad_same_name(const ScadToken *lhs, const ScadToken *rhs) {
+    return lhs->length == rhs->length && memcmp(lhs->start, rhs->start, lhs->length) == 0;
+}
+
+// Tokens, errors turn the rest of the input into EOF so every loop ends
+
+static const ScadToken *scad_peek(ScadCompiler *c) {
+    return c->failed ? &c->eof : &c->tokens[c->pos];
+}
+
+static int scad_peek_type(ScadCompiler *c, size_t ahead) {
+    if (c->failed) {
+        return SCAD_TOKEN_EOF;
+    }
+    const size_t pos = c->pos + ahead;
+    return pos < c->token_count ? c->tokens[pos].type : SCAD_TOKEN_EOF;
+}
+
+static const ScadToken *scad_advance(ScadCompiler *c) {
+    const ScadToken *token = scad_peek(c);
+    if (token->type != SCAD_TOKEN_EOF) {
+        c->pos++;
+    }
+    return token;
+}
+
+static bool scad_accept(ScadCompiler *c, int type) {
+    if (scad_peek_type(c, 0) == type) {
+        scad_advance(c);
+        return true;
+    }
+    return false;
+}
+
+static const ScadToken *scad_expect(ScadCompiler *c, int type, const char *what) {
+    const ScadToken *token = scad_peek(c);
+    if (token->type != type) {
+        if (token->type == SCAD_TOKEN_EOF) {
+            scad_error(c, token, "expected %s at the end of the input", what);
+        } else {
+            scad_error(c, token, "expected %s before '%.*s'", what, (int) token->length, token->start);
+        }
+        return &c->eof;
+    }
+    return scad_advance(c);
+}
+
+// Emitting
+
+static size_t scad_emit(ScadCompiler *c, ScadInstruction instruction) {
+    const ScadToken *at = c->pos ? &c->tokens[c->pos - 1] : &c->tokens[0];
+    *(ScadInstruction *) scad_push(c, &c->code) = instruction;
+    *(ScadLocation *) scad_push(c, &c->locations) = (ScadLocation) {at->line, at->column};
+    return c->code.length - 1;
+}
+
+static size_t scad_here(const ScadCompiler *c) {
+    return c->code.length;
+}
+
+static ScadInstruction *scad_instruction(ScadCompiler *c, size_t index) {
+    return index < c->code.length ? (ScadInstruction *) c->code.data + index : (ScadInstruction *) c->scratch;
+}
+
+static size_t scad_emit_jump(ScadCompiler *c, ScadOp op, int reg) {
+    return scad_emit(c, SCAD_ABX(op, reg, 0));
+}
+
+static void scad_patch(ScadCompiler *c, size_t jump, size_t target) {
+    const long offset = (long) target - (long) (jump + 1);
+    if (offset < -32768 || offset > 32767) {
+        scad_error(c, &c->tokens[c->pos ? c->pos - 1 : 0], "block too large");
+        return;
+    }
+    ScadInstruction *instruction = scad_instruction(c, jump);
+    *instruction = (*instruction & 0xffff) | (ScadInstruction) (offset + 32768) << 16;
+}
+
+// Registers
+
+static int scad_reserve(ScadCompiler *c, int count) {
+    ScadFunction *f = c->function;
+    const int reg = f->freereg;
+    if (reg + count > SCAD_MAX_REGISTERS) {
+        scad_error(c, scad_peek(c), "expression too complex, out of registers");
+        return 0;
+    }
+    f->freereg += count;
+    f->maxreg = f->freereg > f->maxreg ? f->freereg : f->maxreg;
+    return reg;
+}
+
+static size_t scad_constant(ScadCompiler *c, ScadValue value) {
+    // Numbers are interned through an open addressing table on their bits
+    uint64_t bits = 0;
+    if (value.type == SCAD_NUMBER) {
+        memcpy(&bits, &value.number, sizeof(bits));
+        if (c->constants.length * 2 >= c->number_table_size) {
+            const size_t size = c->number_table_size ? c->number_table_size * 2 : 256;
+            uint32_t *table = calloc(size, sizeof(uint32_t));
+            if (!table) {
+                scad_error(c, &c->eof, "out of memory");
+                return 0;
+            }
+            const ScadValue *constants = c->constants.data;
+            for (size_t i = 0; i < c->constants.length; ++i) {
+                if (constants[i].type != SCAD_NUMBER) {
+                    continue;
+                }
+                uint64_t key;
+                memcpy(&key, &constants[i].number, sizeof(key));
+                size_t slot = (key * 0x9e3779b97f4a7c15ull) >> 32 & (size - 1);
+                while (table[slot]) {
+                    slot = (slot + 1) & (size - 1);
+                }
+                table[slot] = (uint32_t) i + 1;
+            }
+            free(c->number_table);
+            c->number_table = table;
+            c->number_table_size = size;
+        }
+        size_t slot = (bits * 0x9e3779b97f4a7c15ull) >> 32 & (c->number_table_size - 1);
+        for (; c->number_table[slot]; slot = (slot + 1) & (c->number_table_size - 1)) {
+            const ScadValue *constant = (const ScadValue *) c->constants.data + c->number_table[slot] - 1;
+            uint64_t key;
+            memcpy(&key, &constant->number, sizeof(key));
+            if (key == bits) {
+                return c->number_table[slot] - 1;
+            }
+        }
+        c->number_table[slot] = (uint32_t) c->constants.length + 1;
+    }
+    if (c->constants.length > SCAD_MAX_BX) {
+        scad_error(c, scad_peek(c), "too many constants");
+        return 0;
+    }
+    *(ScadValue *) scad_push(c, &c->constants) = value;
+    return c->constants.length - 1;
+}
+
+static void scad_load_constant(ScadCompiler *c, const ScadValue *value, int reg) {
+    switch (value->type) {
+        case SCAD_BOOL:
+            scad_emit(c, SCAD_ABC(SCAD_OP_LOADBOOL, reg, value->boolean, 0));
+            break;
+        case SCAD_NUMBER:
+            if (value->number == floor(value->number) && value->number >= -32768.0 && value->number <= 32767.0 &&
+                !(value->number == 0.0 && signbit(value->number))) {
+                scad_emit(c, SCAD_ABX(SCAD_OP_LOADINT, reg, (int) value->number + 32768));
+            } else {
+                scad_emit(c, SCAD_ABX(SCAD_OP_LOADK, reg, scad_constant(c, *value)));
+            }
+            break;
+        case SCAD_STRING:
+            scad_emit(c, SCAD_ABX(SCAD_OP_LOADK, reg, scad_constant(c, *value)));
+            break;
+        default:
+            scad_emit(c, SCAD_ABC(SCAD_OP_LOADNIL, reg, 0, 0));
+            break;
+    }
+}
+
+static void scad_exp_to_reg(ScadCompiler *c, ScadExp *e, int reg) {
+    if (e->kind == SCAD_EXP_CONSTANT) {
+        scad_load_constant(c, &e->value, reg);
+    } else if (e->reg != reg) {
+        scad_emit(c, SCAD_ABC(SCAD_OP_MOVE, reg, e->reg, 0));
+    }
+    e->kind = SCAD_EXP_REGISTER;
+    e->reg = reg;
+}
+
+static void scad_exp_free(ScadCompiler *c, const ScadExp *e) {
+    ScadFunction *f = c->function;
+    if (e->kind == SCAD_EXP_REGISTER && e->reg >= f->active && e->reg == f->freereg - 1) {
+        f->freereg--;
+    }
+}
+
+static int scad_exp_to_any(ScadCompiler *c, ScadExp *e) {
+    if (e->kind != SCAD_EXP_REGISTER) {
+        scad_exp_to_reg(c, e, scad_reserve(c, 1));
+    }
+    return e->reg;
+}
+
+// Frees e and moves it into the next free register
+static int scad_exp_to_next(ScadCompiler *c, ScadExp *e) {
+    scad_exp_free(c, e);
+    scad_exp_to_reg(c, e, scad_reserve(c, 1));
+    return e->reg;
+}
+
+// Frees e and moves it into reg, which must already be reserved
+static void scad_exp_into(ScadCompiler *c, ScadExp *e, int reg) {
+    scad_exp_free(c, e);
+    scad_exp_to_reg(c, e, reg);
+}
+
+static void scad_exp_constant(ScadExp *e, ScadValue value) {
+    *e = (ScadExp) {SCAD_EXP_CONSTANT, 0, value};
+}
+
+static void scad_exp_register(ScadExp *e, int reg) {
+    *e = (ScadExp) {SCAD_EXP_REGISTER, reg};
+}
+
+// Scopes
+
+static void scad_block_enter(ScadCompiler *c, ScadBlock *block) {
+    *block = (ScadBlock) {c->block, c->locals.length, c->function->freereg, c->function->active};
+    for (int i = 0; i < SCAD_SETTABLE_SPECIALS; ++i) {
+        block->saved[i] = -1;
+    }
+    c->block = block;
+}
+
+static void scad_block_leave(ScadCompiler *c) {
+    ScadBlock *block = c->block;
+    for (int i = 0; i < SCAD_SETTABLE_SPECIALS; ++i) {
+        if (block->saved[i] >= 0) {
+            scad_emit(c, SCAD_ABC(SCAD_OP_SPECIAL_SET, i, block->saved[i], 0));
+        }
+    }
+    c->locals.length = block->local_count;
+    c->function->freereg = block->freereg;
+    c->function->active = block->active;
+    c->block = block->parent;
+}
+
+// Binds name to the value of e in the current block, reusing e's register when it is a fresh temporary
+static void scad_declare(ScadCompiler *c, const ScadToken *name, ScadExp *e) {
+    ScadFunction *f = c->function;
+    if (e->kind != SCAD_EXP_REGISTER || e->reg < f->active || e->reg != f->freereg - 1) {
+        scad_exp_to_reg(c, e, scad_reserve(c, 1));
+    }
+    f->active = f->freereg;
+    *(ScadLocal *) scad_push(c, &c->locals) = (ScadLocal) {name, e->reg};
+}
+
+static void scad_declare_register(ScadCompiler *c, const ScadToken *name, int reg) {
+    c->function->active = c->function->freereg;
+    *(ScadLocal *) scad_push(c, &c->locals) = (ScadLocal) {name, reg};
+}
+
+static const ScadLocal *scad_find_local(ScadCompiler *c, const ScadToken *name, size_t from) {
+    const ScadLocal *locals = c->locals.data;
+    for (size_t i = c->locals.length; i > from; --i) {
+        if (scad_same_name(locals[i - 1].name, name)) {
+            return &locals[i - 1];
+        }
+    }
+    return NULL;
+}
+
+static int scad_find_global(ScadCompiler *c, const ScadToken *name) {
+    const ScadToken **globals = c->globals.data;
+    for (size_t i = 0; i < c->globals.length; ++i) {
+        if (scad_same_name(globals[i], name)) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+static const ScadDeclaration *scad_find_declaration(ScadCompiler *c, const ScadToken *name, bool module) {
+    const ScadDeclaration *declarations = c->declarations.data;
+    for (size_t i = 0; i < c->declarations.length; ++i) {
+        if (declarations[i].module == module && scad_same_name(declarations[i].name, name)) {
+            return &declarations[i];
+        }
+    }
+    return NULL;
+}
+
+static int scad_find_builtin(const ScadBuiltin *builtins, size_t count, const ScadToken *name) {
+    for (size_t i = 0; i < count; ++i) {
+        if (scad_token_is(name, builtins[i].name)) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+static int scad_find_special(const ScadToken *name) {
+    static const char *names[SCAD_SPECIAL_COUNT] = {
+            [SCAD_SPECIAL_FN] = "$fn",
+            [SCAD_SPECIAL_FA] = "$fa",
+            [SCAD_SPECIAL_FS] = "$fs",
+            [SCAD_SPECIAL_T] = "$t",
+            [SCAD_SPECIAL_CHILDREN] = "$children",
+    };
+    for (int i = 0; i < SCAD_SPECIAL_COUNT; ++i) {
+        if (scad_token_is(name, names[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static const char *scad_string(ScadCompiler *c, const char *text, size_t length, bool escapes, uint32_t *out_length) {
+    char *string = malloc(length + 1);
+    if (!string) {
+        scad_error(c, &c->eof, "out of memory");
+        *out_length = 0;
+        return "";
+    }
+    *(char **) scad_push(c, &c->strings) = string;
+    size_t n = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (!escapes || text[i] != '\\' || i + 1 == length) {
+            string[n++] = text[i];
+            continue;
+        }
+        switch (text[++i]) {
+            case 'n':
+                string[n++] = '\n';
+                break;
+            case 't':
+                string[n++] = '\t';
+                break;
+            case 'r':
+                string[n++] = '\r';
+                break;
+            default:
+                string[n++] = text[i];
+                break;
+        }
+    }
+    string[n] = '\0';
+    *out_length = (uint32_t) n;
+    return string;
+}
+
+static ScadValue scad_string_value(ScadCompiler *c, const char *text, size_t length, bool escapes) {
+    ScadValue value = {.type = SCAD_STRING};
+    value.string = scad_string(c, text, length, escapes, &value.length);
+    return value;
+}
+
+// Expressions
+
+static void scad_expression(ScadCompiler *c, ScadExp *e);
+static void scad_element(ScadCompiler *c, int vector, bool *generated);
+static uint32_t scad_children_statements(ScadCompiler *c, bool guarded);
+
+static bool scad_is_named_argument(ScadCompiler *c) {
+    return scad_peek_type(c, 0) == SCAD_TOKEN_IDENTIFIER && scad_peek_type(c, 1) == '=';
+}
+
+static int scad_signature_find(const ScadSignature *signature, const ScadToken *name) {
+    for (size_t i = 0; i < signature->count; ++i) {
+        if (signature->params ? scad_same_name(signature->params[i].name, name)
+                              : scad_token_is(name, signature->builtin->params[i])) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Parses "(...)" into consecutive registers from the returned base: one per
+ * parameter, or one per argument for variadic builtins. Absent parameters are
+ * MISSING when they have a default (builtins handle their own) and undef
+ * otherwise. $ arguments are set right away, scad_restore_specials undoes them.
+ */
+static int scad_arguments(ScadCompiler *c, const ScadSignature *signature, ScadCallSpecials *specials, int *count) {
+    scad_expect(c, '(', "'('");
+    const bool variadic = signature->builtin && signature->builtin->variadic;
+    const int base = scad_reserve(c, variadic ? 0 : (int) signature->count);
+    bool filled[SCAD_MAX_REGISTERS] = {false};
+    int positional = 0;
+    specials->count = 0;
+    if (scad_peek_type(c, 0) != ')') {
+        do {
+            if (scad_peek_type(c, 0) == ')') {
+                break;
+            }
+            const ScadToken *name = scad_is_named_argument(c) ? scad_advance(c) : NULL;
+            ScadExp e;
+            if (name && variadic) {
+                scad_error(c, name, "%s() takes no named arguments", signature->builtin->name);
+                break;
+            } else if (name && name->start[0] == '$') {
+                scad_advance(c);
+                const int special = scad_find_special(name);
+                if (special >= 0 && special < SCAD_SETTABLE_SPECIALS && specials->count < SCAD_SETTABLE_SPECIALS) {
+                    const int saved = scad_reserve(c, 1);
+                    scad_emit(c, SCAD_ABC(SCAD_OP_SPECIAL_GET, saved, special, 0));
+                    scad_expression(c, &e);
+                    scad_emit(c, SCAD_ABC(SCAD_OP_SPECIAL_SET, special, scad_exp_to_any(c, &e), 0));
+                    scad_exp_free(c, &e);
+                    specials->special[specials->count] = special;
+                    specials->saved[specials->count++] = saved;
+                } else {
+                    // Other $ variables are accepted and ignored, like unknown parameters
+                    scad_expression(c, &e);
+                    scad_exp_free(c, &e);
+                }
+                continue;
+            }
+            int slot = -1;
+            if (name) {
+                scad_advance(c);
+                slot = scad_signature_find(signature, name);
+            } else if (variadic) {
+                slot = scad_reserve(c, 1) - base;
+            } else if (positional < (int) signature->count) {
+                slot = positional++;
+            }
+            scad_expression(c, &e);
+            if (slot < 0) {
+                scad_exp_free(c, &e);
+            } else {
+                scad_exp_into(c, &e, base + slot);
+                filled[slot] = true;
+            }
+        } while (scad_accept(c, ','));
+    }
+    scad_expect(c, ')', "')'");
+    *count = variadic ? c->function->freereg - base : (int) signature->count;
+    for (int i = 0; !variadic && i < (int) signature->count; ++i) {
+        if (!filled[i]) {
+            const bool missing = !signature->params || signature->params[i].has_default;
+            scad_emit(c, SCAD_ABC(missing ? SCAD_OP_LOADMISSING : SCAD_OP_LOADNIL, base + i, 0, 0));
+        }
+    }
+    return base;
+}
+
+static void scad_restore_specials(ScadCompiler *c, const ScadCallSpecials *specials) {
+    for (int i = specials->count; i > 0; --i) {
+        scad_emit(c, SCAD_ABC(SCAD_OP_SPECIAL_SET, specials->special[i - 1], specials->saved[i - 1], 0));
+    }
+}
+
+static ScadSignature scad_declaration_signature(ScadCompiler *c, const ScadDeclaration *declaration) {
+    return (ScadSignature) {(const ScadParam *) c->params.data + declaration->first_param, NULL,
+                            declaration->param_count};
+}
+
+static void scad_call(ScadCompiler *c, const ScadToken *name, ScadExp *e) {
+    const ScadDeclaration *declaration = scad_find_declaration(c, name, false);
+    const int builtin = declaration ? -1 : scad_find_builtin(scad_builtin_functions, scad_builtin_function_count,
+                                                             name);
+    if (!declaration && builtin < 0) {
+        scad_error(c, name, "unknown function %.*s", (int) name->length, name->start);
+        return;
+    }
+    ScadSignature signature = declaration ? scad_declaration_signature(c, declaration)
+                                          : (ScadSignature) {NULL, &scad_builtin_functions[builtin],
+                                                             scad_builtin_functions[builtin].param_count};
+    ScadCallSpecials specials;
+    int count;
+    const int base = scad_arguments(c, &signature, &specials, &count);
+    if (declaration) {
+        scad_emit(c, SCAD_ABX(SCAD_OP_CALL, base, declaration->proto));
+    } else {
+        scad_emit(c, SCAD_ABC(SCAD_OP_BUILTIN, base, builtin, count));
+    }
+    scad_restore_specials(c, &specials);
+    c->function->freereg = base;
+    scad_exp_register(e, scad_reserve(c, 1));
+}
+
+static void scad_variable(ScadCompiler *c, const ScadToken *name, ScadExp *e) {
+    if (name->start[0] == '$') {
+        const int special = scad_find_special(name);
+        if (special == SCAD_SPECIAL_T) {
+            scad_exp_constant(e, scad_number(0.0));
+        } else if (special >= 0) {
+            scad_exp_register(e, scad_reserve(c, 1));
+            scad_emit(c, SCAD_ABC(SCAD_OP_SPECIAL_GET, e->reg, special, 0));
+        } else {
+            scad_exp_constant(e, scad_undef());
+        }
+        return;
+    }
+    const ScadLocal *local = scad_find_local(c, name, c->function->first_local);
+    const int global = local ? -1 : scad_find_global(c, name);
+    if (local) {
+        scad_exp_register(e, local->reg);
+    } else if (global >= 0) {
+        scad_exp_register(e, scad_reserve(c, 1));
+        scad_emit(c, SCAD_ABX(SCAD_OP_GETGLOBAL, e->reg, global));
+    } else {
+        // Like OpenSCAD, unknown variables are undef
+        scad_exp_constant(e, scad_undef());
+    }
+}
+
+// Sets a special variable until the end of the block, saving its value the first time
+static void scad_assign_special(ScadCompiler *c, const ScadToken *name, ScadExp *e) {
+    const int special = scad_find_special(name);
+    if (special < 0 || special >= SCAD_SETTABLE_SPECIALS) {
+        scad_error(c, name, "cannot assign %.*s", (int) name->length, name->start);
+        return;
+    }
+    const int reg = scad_exp_to_any(c, e);
+    if (c->block->saved[special] < 0) {
+        const int saved = scad_reserve(c, 1);
+        scad_declare_register(c, &c->eof, saved);
+        c->block->saved[special] = saved;
+        scad_emit(c, SCAD_ABC(SCAD_OP_SPECIAL_GET, saved, special, 0));
+    }
+    scad_emit(c, SCAD_ABC(SCAD_OP_SPECIAL_SET, special, reg, 0));
+    scad_exp_free(c, e);
+}
+
+// "name = value, ..." up to the closing parenthesis, each visible to the next
+static void scad_bindings(ScadCompiler *c) {
+    if (scad_peek_type(c, 0) != ')') {
+        do {
+            if (scad_peek_type(c, 0) == ')') {
+                break;
+            }
+            const ScadToken *name = scad_expect(c, SCAD_TOKEN_IDENTIFIER, "a name");
+            scad_expect(c, '=', "'='");
+            ScadExp e;
+            scad_expression(c, &e);
+            if (name->type == SCAD_TOKEN_IDENTIFIER && name->start[0] == '$') {
+                scad_assign_special(c, name, &e);
+            } else {
+                scad_declare(c, name, &e);
+            }
+        } while (scad_accept(c, ','));
+    }
+    scad_expect(c, ')', "')'");
+}
+
+static void scad_let(ScadCompiler *c, ScadExp *e) {
+    scad_expect(c, '(', "'('");
+    const int result = scad_reserve(c, 1);
+    ScadBlock block;
+    scad_block_enter(c, &block);
+    scad_bindings(c);
+    ScadExp body;
+    scad_expression(c, &body);
+    scad_exp_into(c, &body, result);
+    scad_block_leave(c);
+    scad_exp_register(e, result);
+}
+
+/**
+ * The bindings of a for after its '(' and then the body, once per combination:
+ * a statement, or an element pushed to vector in a list comprehension.
+ * Statement loops release what an iteration allocated at its end.
+ */
+static void scad_for(ScadCompiler *c, bool statement, int vector, bool *generated) {
+    const ScadToken *name = scad_expect(c, SCAD_TOKEN_IDENTIFIER, "a loop variable");
+    scad_expect(c, '=', "'='");
+    ScadBlock block;
+    scad_block_enter(c, &block);
+    ScadExp collection;
+    scad_expression(c, &collection);
+    scad_exp_free(c, &collection);
+    const int base = scad_reserve(c, 4);
+    scad_exp_to_reg(c, &collection, base);
+    scad_declare_register(c, name, base + 3);
+    const int mark = statement ? scad_reserve(c, 1) : 0;
+    c->function->active = c->function->freereg;
+    const size_t prep = scad_emit_jump(c, SCAD_OP_FOR_PREP, base);
+    const size_t body = scad_here(c);
+    if (statement) {
+        scad_emit(c, SCAD_ABC(SCAD_OP_ARENA_MARK, mark, 0, 0));
+    }
+    if (scad_accept(c, ',')) {
+        scad_for(c, statement, vector, generated);
+    } else {
+        scad_expect(c, ')', "')'");
+        if (statement) {
+            scad_children_statements(c, false);
+        } else {
+            scad_element(c, vector, generated);
+        }
+    }
+    if (statement) {
+        scad_emit(c, SCAD_ABC(SCAD_OP_ARENA_RELEASE, mark, 0, 0));
+    }
+    scad_patch(c, prep, scad_here(c));
+    scad_patch(c, scad_emit_jump(c, SCAD_OP_FOR_LOOP, base), body);
+    scad_block_leave(c);
+}
+
+// One element of a vector literal, a generator pushes any number of them
+static void scad_element(ScadCompiler *c, int vector, bool *generated) {
+    if (scad_accept(c, SCAD_TOKEN_FOR)) {
+        *generated = true;
+        scad_expect(c, '(', "'('");
+        scad_for(c, false, vector, generated);
+    } else if (scad_accept(c, SCAD_TOKEN_IF)) {
+        *generated = true;
+        scad_expect(c, '(', "'('");
+        ScadExp condition;
+        scad_expression(c, &condition);
+        scad_expect(c, ')', "')'");
+        const int reg = scad_exp_to_any(c, &condition);
+        scad_exp_free(c, &condition);
+        const size_t skip = scad_emit_jump(c, SCAD_OP_JMPIFNOT, reg);
+        scad_element(c, vector, generated);
+        if (scad_accept(c, SCAD_TOKEN_ELSE)) {
+            const size_t end = scad_emit_jump(c, SCAD_OP_JMP, 0);
+            scad_patch(c, skip, scad_here(c));
+            scad_element(c, vector, generated);
+            scad_patch(c, end, scad_here(c));
+        } else {
+            scad_patch(c, skip, scad_here(c));
+        }
+    } else if (scad_peek_type(c, 0) == SCAD_TOKEN_IDENTIFIER && scad_token_is(scad_peek(c), "let") &&
+               scad_peek_type(c, 1) == '(') {
+        *generated = true;
+        scad_advance(c);
+        scad_advance(c);
+        ScadBlock block;
+        scad_block_enter(c, &block);
+        scad_bindings(c);
+        scad_element(c, vector, generated);
+        scad_block_leave(c);
+    } else {
+        ScadExp e;
+        scad_expression(c, &e);
+        scad_emit(c, SCAD_ABC(SCAD_OP_VECTOR_PUSH, vector, scad_exp_to_any(c, &e), 0));
+        scad_exp_free(c, &e);
+    }
+}
+
+// After the '[': a range or a vector, possibly a list comprehension
+static void scad_vector(ScadCompiler *c, ScadExp *e) {
+    const int vector = scad_reserve(c, 1);
+    scad_exp_register(e, vector);
+    bool generated = false;
+    if (scad_accept(c, ']')) {
+        scad_emit(c, SCAD_ABC(SCAD_OP_VECTOR_NEW, vector, 0, 0));
+        return;
+    }
+    const int first = scad_peek_type(c, 0);
+    const bool generator = first == SCAD_TOKEN_FOR || first == SCAD_TOKEN_IF ||
+                           (first == SCAD_TOKEN_IDENTIFIER && scad_token_is(scad_peek(c), "let") &&
+                            scad_peek_type(c, 1) == '(');
+    size_t create;
+    if (generator) {
+        create = scad_emit(c, SCAD_ABC(SCAD_OP_VECTOR_NEW, vector, 0, 0));
+        scad_element(c, vector, &generated);
+    } else {
+        ScadExp item;
+        scad_expression(c, &item);
+        if (scad_accept(c, ':')) {
+            // [begin : end] or [begin : step : end], built from three consecutive registers
+            scad_exp_to_next(c, &item);
+            ScadExp second, third;
+            scad_expression(c, &second);
+            const int step = scad_exp_to_next(c, &second);
+            if (scad_accept(c, ':')) {
+                scad_expression(c, &third);
+                scad_exp_to_next(c, &third);
+            } else {
+                const int end = scad_reserve(c, 1);
+                scad_emit(c, SCAD_ABC(SCAD_OP_MOVE, end, step, 0));
+                scad_emit(c, SCAD_ABX(SCAD_OP_LOADINT, step, 1 + 32768));
+            }
+            scad_expect(c, ']', "']'");
+            scad_emit(c, SCAD_ABC(SCAD_OP_RANGE, vector, vector + 1, 0));
+            c->function->freereg = vector + 1;
+            return;
+        }
+        const int reg = scad_exp_to_any(c, &item);
+        create = scad_emit(c, SCAD_ABC(SCAD_OP_VECTOR_NEW, vector, 0, 0));
+        scad_emit(c, SCAD_ABC(SCAD_OP_VECTOR_PUSH, vector, reg, 0));
+        scad_exp_free(c, &item);
+    }
+    size_t count = 1;
+    while (scad_accept(c, ',')) {
+        if (scad_peek_type(c, 0) == ']') {
+            break;
+        }
+        scad_element(c, vector, &generated);
+        count++;
+    }
+    scad_expect(c, ']', "']'");
+    // The exact size is known without generators, so the pushes never grow the vector
+    if (!generator && !generated) {
+        ScadInstruction *instruction = scad_instruction(c, create);
+        *instruction = SCAD_ABC(SCAD_OP_VECTOR_NEW, vector, count < 255 ? count : 255, 0);
+    }
+}
+
+static void scad_primary(ScadCompiler *c, ScadExp *e) {
+    const ScadToken *token = scad_advance(c);
+    switch (token->type) {
+        case SCAD_TOKEN_NUMBER:
+            scad_exp_constant(e, scad_number(token->number));
+            break;
+        case SCAD_TOKEN_STRING:
+            scad_exp_constant(e, scad_string_value(c, token->start + 1, token->length - 2, true));
+            break;
+        case SCAD_TOKEN_TRUE:
+        case SCAD_TOKEN_FALSE:
+            scad_exp_constant(e, scad_bool(token->type == SCAD_TOKEN_TRUE));
+            break;
+        case SCAD_TOKEN_UNDEF:
+            scad_exp_constant(e, scad_undef());
+            break;
+        case '(':
+            scad_expression(c, e);
+            scad_expect(c, ')', "')'");
+            break;
+        case '[':
+            scad_vector(c, e);
+            break;
+        case SCAD_TOKEN_IDENTIFIER:
+            if (scad_peek_type(c, 0) == '(' && scad_token_is(token, "let")) {
+                scad_let(c, e);
+            } else if (scad_peek_type(c, 0) == '(') {
+                scad_call(c, token, e);
+            } else {
+                scad_variable(c, token, e);
+            }
+            break;
+        case SCAD_TOKEN_EOF:
+            scad_error(c, token, "expected an expression at the end of the input");
+            scad_exp_constant(e, scad_undef());
+            break;
+        default:
+            scad_error(c, token, "expected an expression before '%.*s'", (int) token->length, token->start);
+            scad_exp_constant(e, scad_undef());
+            break;
+    }
+}
+
+static void scad_postfix(ScadCompiler *c, ScadExp *e) {
+    scad_primary(c, e);
+    while (true) {
+        if (scad_accept(c, '[')) {
+            ScadExp index;
+            scad_expression(c, &index);
+            scad_expect(c, ']', "']'");
+            const int object = scad_exp_to_any(c, e);
+            if (index.kind == SCAD_EXP_CONSTANT && index.value.type == SCAD_NUMBER && index.value.number >= 0.0 &&
+                index.value.number < 256.0) {
+                scad_exp_free(c, e);
+                scad_exp_register(e, scad_reserve(c, 1));
+                scad_emit(c, SCAD_ABC(SCAD_OP_INDEXK, e->reg, object, (int) index.value.number));
+                continue;
+            }
+            const int key = scad_exp_to_any(c, &index);
+            scad_exp_free(c, key > object ? &index : e);
+            scad_exp_free(c, key > object ? e : &index);
+            scad_exp_register(e, scad_reserve(c, 1));
+            scad_emit(c, SCAD_ABC(SCAD_OP_INDEX, e->reg, object, key));
+        } else if (scad_accept(c, '.')) {
+            const ScadToken *member = scad_expect(c, SCAD_TOKEN_IDENTIFIER, "x, y or z");
+            const int index = scad_token_is(member, "x") ? 0 : scad_token_is(member, "y") ? 1
+                                                              : scad_token_is(member, "z") ? 2 : -1;
+            if (index < 0) {
+                scad_error(c, member, "expected x, y or z after '.'");
+            }
+            const int object = scad_exp_to_any(c, e);
+            scad_exp_free(c, e);
+            scad_exp_register(e, scad_reserve(c, 1));
+            scad_emit(c, SCAD_ABC(SCAD_OP_INDEXK, e->reg, object, index));
+        } else if (scad_peek_type(c, 0) == '(') {
+            scad_error(c, scad_peek(c), "only named functions can be called");
+        } else {
+            return;
+        }
+    }
+}
+
+static void scad_unary(ScadCompiler *c, ScadExp *e);
+
+// Two constants fold with the same code the VM runs, anything else becomes one instruction
+static void scad_binary_op(ScadCompiler *c, ScadOp op, ScadExp *lhs, ScadExp *rhs) {
+    if (lhs->kind == SCAD_EXP_CONSTANT && rhs->kind == SCAD_EXP_CONSTANT) {
+        const bool arithmetic = op != SCAD_OP_EQ && op != SCAD_OP_NE && op != SCAD_OP_LT && op != SCAD_OP_LE;
+        if (!arithmetic || (lhs->value.type == SCAD_NUMBER && rhs->value.type == SCAD_NUMBER)) {
+            const ScadValue value = arithmetic ? scad_arithmetic(NULL, op, &lhs->value, &rhs->value)
+                                               : scad_compare(op, &lhs->value, &rhs->value);
+            scad_exp_constant(lhs, value);
+            return;
+        }
+    }
+    const int a = scad_exp_to_any(c, lhs);
+    const int b = scad_exp_to_any(c, rhs);
+    scad_exp_free(c, b > a ? rhs : lhs);
+    scad_exp_free(c, b > a ? lhs : rhs);
+    scad_exp_register(lhs, scad_reserve(c, 1));
+    scad_emit(c, SCAD_ABC(op, lhs->reg, a, b));
+}
+
+// The exponent binds tighter than unary minus on its left but takes one on its right
+static void scad_power(ScadCompiler *c, ScadExp *e) {
+    scad_postfix(c, e);
+    if (scad_accept(c, '^')) {
+        ScadExp exponent;
+        scad_unary(c, &exponent);
+        scad_binary_op(c, SCAD_OP_POW, e, &exponent);
+    }
+}
+
+static void scad_unary(ScadCompiler *c, ScadExp *e) {
+    const int type = scad_peek_type(c, 0);
+    if (type != '-' && type != '+' && type != '!') {
+        scad_power(c, e);
+        return;
+    }
+    scad_advance(c);
+    scad_unary(c, e);
+    if (type == '+') {
+        return;
+    } else if (e->kind == SCAD_EXP_CONSTANT && (type == '!' || e->value.type == SCAD_NUMBER)) {
+        scad_exp_constant(e, type == '!' ? scad_bool(!scad_truthy(&e->value)) : scad_number(-e->value.number));
+        return;
+    }
+    const int reg = scad_exp_to_any(c, e);
+    scad_exp_free(c, e);
+    scad_exp_register(e, scad_reserve(c, 1));
+    scad_emit(c, SCAD_ABC(type == '!' ? SCAD_OP_NOT : SCAD_OP_NEG, e->reg, reg, 0));
+}
+
+static int scad_precedence(int type, ScadOp *op, bool *swap) {
+    *swap = false;
+    switch (type) {
+        case SCAD_TOKEN_OR:
+            return 1;
+        case SCAD_TOKEN_AND:
+            return 2;
+        case SCAD_TOKEN_EQ:
+            *op = SCAD_OP_EQ;
+            return 3;
+        case SCAD_TOKEN_NE:
+            *op = SCAD_OP_NE;
+            return 3;
+        case '<':
+            *op = SCAD_OP_LT;
+            return 4;
+        case SCAD_TOKEN_LE:
+            *op = SCAD_OP_LE;
+            return 4;
+        case '>':
+            *op = SCAD_OP_LT;
+            *swap = true;
+            return 4;
+        case SCAD_TOKEN_GE:
+            *op = SCAD_OP_LE;
+            *swap = true;
+            return 4;
+        case '+':
+            *op = SCAD_OP_ADD;
+            return 5;
+        case '-':
+            *op = SCAD_OP_SUB;
+            return 5;
+        case '*':
+            *op = SCAD_OP_MUL;
+            return 6;
+        case '/':
+            *op = SCAD_OP_DIV;
+            return 6;
+        case '%':
+            *op = SCAD_OP_MOD;
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+static void scad_binary(ScadCompiler *c, ScadExp *e, int min_precedence) {
+    scad_unary(c, e);
+    ScadOp op = SCAD_OP_ADD;
+    bool swap;
+    int precedence;
+    while ((precedence = scad_precedence(scad_peek_type(c, 0), &op, &swap)) >= min_precedence && precedence) {
+        const int type = scad_advance(c)->type;
+        if (type == SCAD_TOKEN_AND || type == SCAD_TOKEN_OR) {
+            // Short circuit into one register, converted to a bool on both paths
+            scad_exp_free(c, e);
+            const int reg = scad_reserve(c, 1);
+            scad_exp_to_reg(c, e, reg);
+            scad_emit(c, SCAD_ABC(SCAD_OP_TRUTH, reg, reg, 0));
+            const size_t skip = scad_emit_jump(c, type == SCAD_TOKEN_AND ? SCAD_OP_JMPIFNOT : SCAD_OP_JMPIF, reg);
+            ScadExp rhs;
+            scad_binary(c, &rhs, precedence + 1);
+            scad_exp_into(c, &rhs, reg);
+            scad_emit(c, SCAD_ABC(SCAD_OP_TRUTH, reg, reg, 0));
+            scad_patch(c, skip, scad_here(c));
+            continue;
+        }
+        ScadExp rhs;
+        scad_binary(c, &rhs, precedence + 1);
+        if (swap) {
+            // a > b is b < a; both are evaluated already, so the order of effects is kept
+            ScadExp lhs = *e;
+            *e = rhs;
+            rhs = lhs;
+        }
+        scad_binary_op(c, op, e, &rhs);
+    }
+}
+
+static void scad_expression(ScadCompiler *c, ScadExp *e) {
+    scad_binary(c, e, 1);
+    if (!scad_accept(c, '?')) {
+        return;
+    }
+    const int condition = scad_exp_to_any(c, e);
+    scad_exp_free(c, e);
+    const int reg = scad_reserve(c, 1);
+    const size_t otherwise = scad_emit_jump(c, SCAD_OP_JMPIFNOT, condition);
+    ScadExp branch;
+    scad_expression(c, &branch);
+    scad_exp_into(c, &branch, reg);
+    const size_t end = scad_emit_jump(c, SCAD_OP_JMP, 0);
+    scad_patch(c, otherwise, scad_here(c));
+    scad_expect(c, ':', "':'");
+    scad_expression(c, &branch);
+    scad_exp_into(c, &branch, reg);
+    scad_patch(c, end, scad_here(c));
+    scad_exp_register(e, reg);
+}
+
+// Statements
+
+static void scad_statement(ScadCompiler *c);
+
+static bool scad_is_instantiation(ScadCompiler *c) {
+    const int type = scad_peek_type(c, 0);
+    return (type == SCAD_TOKEN_IDENTIFIER && scad_peek_type(c, 1) != '=') || type == SCAD_TOKEN_IF ||
+           type == SCAD_TOKEN_FOR || type == '*' || type == '!' || type == '#' || type == '%';
+}
+
+// Guarded statements only run when children() selects them, or all of them
+static uint32_t scad_child_statement(ScadCompiler *c, bool guarded, uint32_t index) {
+    if (!scad_is_instantiation(c)) {
+        scad_statement(c);
+        return 0;
+    } else if (!guarded) {
+        scad_statement(c);
+        return 1;
+    }
+    if (index > SCAD_MAX_BX) {
+        scad_error(c, scad_peek(c), "too many children");
+    }
+    scad_emit(c, SCAD_ABX(SCAD_OP_CHILD, 0, index & SCAD_MAX_BX));
+    const size_t skip = scad_emit_jump(c, SCAD_OP_JMP, 0);
+    scad_statement(c);
+    scad_patch(c, skip, scad_here(c));
+    return 1;
+}
+
+/**
+ * What follows a module instantiation, an if or a for: ';', one statement or
+ * a block, in a scope of its own. Returns how many children it instantiates.
+ */
+static uint32_t scad_children_statements(ScadCompiler *c, bool guarded) {
+    if (scad_accept(c, ';')) {
+        return 0;
+    }
+    ScadBlock block;
+    scad_block_enter(c, &block);
+    uint32_t count = 0;
+    if (scad_accept(c, '{')) {
+        while (scad_peek_type(c, 0) != '}' && scad_peek_type(c, 0) != SCAD_TOKEN_EOF) {
+            count += scad_child_statement(c, guarded, count);
+        }
+        scad_expect(c, '}', "'}'");
+    } else {
+        count = scad_child_statement(c, guarded, 0);
+    }
+    scad_block_leave(c);
+    return count;
+}
+
+static void scad_assignment(ScadCompiler *c) {
+    const ScadToken *name = scad_advance(c);
+    scad_advance(c);
+    ScadExp e;
+    scad_expression(c, &e);
+    int global;
+    if (name->start[0] == '$') {
+        scad_assign_special(c, name, &e);
+    } else if (c->block == c->main_block && (global = scad_find_global(c, name)) >= 0) {
+        scad_emit(c, SCAD_ABX(SCAD_OP_SETGLOBAL, scad_exp_to_any(c, &e), global));
+        scad_exp_free(c, &e);
+    } else {
+        // A name assigned again in the same block keeps its register, anything else shadows
+        const ScadLocal *local = scad_find_local(c, name, c->block->local_count);
+        if (local) {
+            scad_exp_into(c, &e, local->reg);
+        } else {
+            scad_declare(c, name, &e);
+        }
+    }
+    scad_expect(c, ';', "';'");
+}
+
+static void scad_if(ScadCompiler *c) {
+    scad_expect(c, '(', "'('");
+    ScadExp condition;
+    scad_expression(c, &condition);
+    scad_expect(c, ')', "')'");
+    const int reg = scad_exp_to_any(c, &condition);
+    scad_exp_free(c, &condition);
+    const size_t skip = scad_emit_jump(c, SCAD_OP_JMPIFNOT, reg);
+    scad_children_statements(c, false);
+    if (scad_accept(c, SCAD_TOKEN_ELSE)) {
+        const size_t end = scad_emit_jump(c, SCAD_OP_JMP, 0);
+        scad_patch(c, skip, scad_here(c));
+        scad_children_statements(c, false);
+        scad_patch(c, end, scad_here(c));
+    } else {
+        scad_patch(c, skip, scad_here(c));
+    }
+}
+
+static void scad_echo(ScadCompiler *c) {
+    scad_expect(c, '(', "'('");
+    const int base = c->function->freereg;
+    int pairs = 0;
+    if (scad_peek_type(c, 0) != ')') {
+        do {
+            if (scad_peek_type(c, 0) == ')') {
+                break;
+            }
+            const int reg = scad_reserve(c, 2);
+            if (scad_is_named_argument(c)) {
+                const ScadToken *name = scad_advance(c);
+                scad_advance(c);
+                const ScadValue label = scad_string_value(c, name->start, name->length, false);
+                scad_load_constant(c, &label, reg);
+            } else {
+                scad_emit(c, SCAD_ABC(SCAD_OP_LOADNIL, reg, 0, 0));
+            }
+            ScadExp e;
+            scad_expression(c, &e);
+            scad_exp_into(c, &e, reg + 1);
+            pairs++;
+        } while (scad_accept(c, ','));
+    }
+    scad_expect(c, ')', "')'");
+    scad_emit(c, SCAD_ABC(SCAD_OP_ECHO, base, pairs, 0));
+    c->function->freereg = base;
+}
+
+static void scad_children(ScadCompiler *c) {
+    scad_expect(c, '(', "'('");
+    ScadExp index;
+    int reg = SCAD_NO_REGISTER;
+    if (scad_peek_type(c, 0) != ')') {
+        scad_expression(c, &index);
+        reg = scad_exp_to_any(c, &index);
+    }
+    scad_expect(c, ')', "')'");
+    scad_expect(c, ';', "';'");
+    // Outside of a module there are no children
+    if (c->function->module) {
+        scad_emit(c, SCAD_ABC(SCAD_OP_CHILDREN, reg, 0, 0));
+    }
+    if (reg != SCAD_NO_REGISTER) {
+        scad_exp_free(c, &index);
+    }
+}
+
+static void scad_module_call(ScadCompiler *c, const ScadDeclaration *declaration) {
+    const ScadSignature signature = scad_declaration_signature(c, declaration);
+    ScadCallSpecials specials;
+    int count;
+    const int base = scad_arguments(c, &signature, &specials, &count);
+    scad_emit(c, SCAD_ABX(SCAD_OP_MCALL, base, declaration->proto));
+    // The child block is compiled right here, in the caller's frame, and run by children()
+    const size_t block = scad_emit(c, UINT32_MAX);
+    if (!scad_accept(c, ';')) {
+        const size_t skip = scad_emit_jump(c, SCAD_OP_JMP, 0);
+        *scad_instruction(c, block) = (ScadInstruction) scad_here(c);
+        const size_t header = scad_emit(c, SCAD_ABX(SCAD_OP_BLOCK, 0, 0));
+        const uint32_t children = scad_children_statements(c, true);
+        scad_emit(c, SCAD_ABC(SCAD_OP_BLOCK_END, 0, 0, 0));
+        *scad_instruction(c, header) = SCAD_ABX(SCAD_OP_BLOCK, 0, children & SCAD_MAX_BX);
+        scad_patch(c, skip, scad_here(c));
+    }
+    scad_restore_specials(c, &specials);
+    c->function->freereg = base;
+}
+
+static void scad_node(ScadCompiler *c, int builtin) {
+    const ScadSignature signature = {NULL, &scad_builtin_modules[builtin], scad_builtin_modules[builtin].param_count};
+    ScadCallSpecials specials;
+    int count;
+    const int base = scad_arguments(c, &signature, &specials, &count);
+    scad_emit(c, SCAD_ABC(SCAD_OP_NODE, base, builtin, 0));
+    // $ arguments stay set for the children, like in OpenSCAD
+    if (!specials.count) {
+        c->function->freereg = base;
+    }
+    scad_children_statements(c, false);
+    scad_emit(c, SCAD_ABC(SCAD_OP_NODE_END, 0, 0, 0));
+    scad_restore_specials(c, &specials);
+    c->function->freereg = base;
+}
+
+static void scad_instantiation(ScadCompiler *c) {
+    const ScadToken *name = scad_advance(c);
+    if (scad_token_is(name, "children")) {
+        scad_children(c);
+        return;
+    } else if (scad_token_is(name, "echo")) {
+        scad_echo(c);
+        scad_children_statements(c, false);
+        return;
+    } else if (scad_token_is(name, "let")) {
+        scad_expect(c, '(', "'('");
+        ScadBlock block;
+        scad_block_enter(c, &block);
+        scad_bindings(c);
+        scad_children_statements(c, false);
+        scad_block_leave(c);
+        return;
+    }
+    const ScadDeclaration *declaration = scad_find_declaration(c, name, true);
+    const int builtin = declaration ? -1 : scad_find_builtin(scad_builtin_modules, scad_builtin_module_count, name);
+    if (declaration) {
+        scad_module_call(c, declaration);
+    } else if (builtin >= 0) {
+        scad_node(c, builtin);
+    } else {
+        scad_error(c, name, "unknown module %.*s", (int) name->length, name->start);
+    }
+}
+
+// The parameters from the '(', as the first locals of the frame; defaults are applied when the argument is missing
+static int scad_parameters(ScadCompiler *c, size_t count) {
+    scad_reserve(c, (int) count);
+    scad_expect(c, '(', "'('");
+    size_t index = 0;
+    if (scad_peek_type(c, 0) != ')') {
+        do {
+            if (scad_peek_type(c, 0) == ')') {
+                break;
+            }
+            const ScadToken *name = scad_expect(c, SCAD_TOKEN_IDENTIFIER, "a parameter name");
+            if (index == count) {
+                scad_error(c, name, "malformed parameter list");
+                break;
+            }
+            const int reg = (int) index++;
+            scad_declare_register(c, name, reg);
+            if (scad_accept(c, '=')) {
+                const size_t skip = scad_emit_jump(c, SCAD_OP_JMPIFPRESENT, reg);
+                ScadExp e;
+                scad_expression(c, &e);
+                scad_exp_into(c, &e, reg);
+                scad_patch(c, skip, scad_here(c));
+            }
+        } while (scad_accept(c, ','));
+    }
+    scad_expect(c, ')', "')'");
+    return (int) count;
+}
+
+static size_t scad_scan_parameters(ScadCompiler *c, size_t open, bool record);
+
+static void scad_definition(ScadCompiler *c, bool module) {
+    const ScadToken *keyword = scad_advance(c);
+    const ScadToken *name = scad_expect(c, SCAD_TOKEN_IDENTIFIER, module ? "a module name" : "a function name");
+    if (c->block != c->main_block) {
+        scad_error(c, keyword, "%s definitions must be at the top level", module ? "module" : "function");
+        return;
+    }
+    const ScadDeclaration *declaration = scad_find_declaration(c, name, module);
+    if (!declaration) {
+        scad_error(c, name, "expected '(' after %.*s", (int) name->length, name->start);
+        return;
+    }
+    const size_t skip = scad_emit_jump(c, SCAD_OP_JMP, 0);
+    ScadFunction *outer = c->function;
+    ScadBlock *outer_block = c->block;
+    ScadFunction function = {.first_local = c->locals.length, .module = module};
+    c->function = &function;
+    c->block = NULL;
+    ScadBlock block;
+    scad_block_enter(c, &block);
+    const uint32_t address = (uint32_t) scad_here(c);
+    // A redefinition is compiled against its own parameter list, only the last one is ever called
+    const int count = scad_parameters(c, scad_scan_parameters(c, c->pos, false));
+    if (module) {
+        scad_statement(c);
+        scad_block_leave(c);
+        scad_emit(c, SCAD_ABC(SCAD_OP_MRETURN, 0, 0, 0));
+    } else {
+        scad_expect(c, '=', "'='");
+        ScadExp e;
+        scad_expression(c, &e);
+        scad_emit(c, SCAD_ABC(SCAD_OP_RETURN, scad_exp_to_any(c, &e), 0, 0));
+        scad_expect(c, ';', "';'");
+        scad_block_leave(c);
+    }
+    ScadProto *proto = (ScadProto *) c->protos.data + declaration->proto;
+    proto->address = address;
+    proto->param_count = (uint16_t) count;
+    proto->frame_size = (uint16_t) function.maxreg;
+    c->function = outer;
+    c->block = outer_block;
+    scad_patch(c, skip, scad_here(c));
+}
+
+static void scad_statement(ScadCompiler *c) {
+    const int type = scad_peek_type(c, 0);
+    switch (type) {
+        case ';':
+            scad_advance(c);
+            break;
+        case '{': {
+            scad_advance(c);
+            ScadBlock block;
+            scad_block_enter(c, &block);
+            while (scad_peek_type(c, 0) != '}' && scad_peek_type(c, 0) != SCAD_TOKEN_EOF) {
+                scad_statement(c);
+            }
+            scad_expect(c, '}', "'}'");
+            scad_block_leave(c);
+            break;
+        }
+        case SCAD_TOKEN_MODULE:
+        case SCAD_TOKEN_FUNCTION:
+            scad_definition(c, type == SCAD_TOKEN_MODULE);
+            break;
+        case SCAD_TOKEN_IF:
+            scad_advance(c);
+            scad_if(c);
+            break;
+        case SCAD_TOKEN_FOR:
+            scad_advance(c);
+            scad_expect(c, '(', "'('");
+            scad_for(c, true, 0, NULL);
+            break;
+        case '*': {
+            // Disabled, compiled but jumped over
+            scad_advance(c);
+            const size_t skip = scad_emit_jump(c, SCAD_OP_JMP, 0);
+            scad_statement(c);
+            scad_patch(c, skip, scad_here(c));
+            break;
+        }
+        case '!':
+        case '#':
+        case '%':
+            scad_advance(c);
+            scad_statement(c);
+            break;
+        case SCAD_TOKEN_IDENTIFIER:
+            if (scad_peek_type(c, 1) == '=') {
+                scad_assignment(c);
+            } else {
+                scad_instantiation(c);
+            }
+            break;
+        default: {
+            const ScadToken *token = scad_peek(c);
+            if (token->type == SCAD_TOKEN_EOF) {
+                scad_error(c, token, "expected a statement at the end of the input");
+            } else {
+                scad_error(c, token, "expected a statement before '%.*s'", (int) token->length, token->start);
+            }
+            break;
+        }
+    }
+}
+
+// Pre-scan
+
+// Counts the parameter names in the list opening at open, recording them for calls if asked
+static size_t scad_scan_parameters(ScadCompiler *c, size_t open, bool record) {
+    const ScadToken *tokens = c->tokens;
+    size_t count = 0;
+    int depth = 0;
+    bool expect_name = true;
+    for (size_t i = open; i < c->token_count && tokens[i].type != SCAD_TOKEN_EOF; ++i) {
+        const int type = tokens[i].type;
+        if (type == '(' || type == '[' || type == '{') {
+            depth++;
+        } else if (type == ')' || type == ']' || type == '}') {
+            if (--depth == 0) {
+                break;
+            }
+        } else if (depth == 1 && type == ',') {
+            expect_name = true;
+            continue;
+        }
+        if (depth == 1 && expect_name && type == SCAD_TOKEN_IDENTIFIER) {
+            if (record) {
+                *(ScadParam *) scad_push(c, &c->params) = (ScadParam) {&tokens[i], tokens[i + 1].type == '='};
+            }
+            count++;
+        }
+        expect_name = type == '(' && depth == 1;
+    }
+    return count;
+}
+
+static void scad_prescan(ScadCompiler *c) {
+    const ScadToken *tokens = c->tokens;
+    int depth = 0;
+    for (size_t i = 0; tokens[i].type != SCAD_TOKEN_EOF; ++i) {
+        const int type = tokens[i].type;
+        if (type == '(' || type == '[' || type == '{') {
+            depth++;
+        } else if (type == ')' || type == ']' || type == '}') {
+            depth--;
+        }
+        if (depth != 0) {
+            continue;
+        }
+        if ((type == SCAD_TOKEN_MODULE || type == SCAD_TOKEN_FUNCTION) &&
+            tokens[i + 1].type == SCAD_TOKEN_IDENTIFIER && tokens[i + 2].type == '(') {
+            const bool module = type == SCAD_TOKEN_MODULE;
+            ScadDeclaration *declaration = (ScadDeclaration *) scad_find_declaration(c, &tokens[i + 1], module);
+            if (!declaration) {
+                ScadProto *proto = scad_push(c, &c->protos);
+                uint32_t length;
+                *proto = (ScadProto) {(char *) scad_string(c, tokens[i + 1].start, tokens[i + 1].length, false,
+                                                           &length), UINT32_MAX, 0, 0, module};
+                // The name belongs to the string list like the string constants
+                declaration = scad_push(c, &c->declarations);
+                *declaration = (ScadDeclaration) {&tokens[i + 1], 0, 0, (uint32_t) c->protos.length - 1, module};
+            }
+            declaration->first_param = c->params.length;
+            declaration->param_count = scad_scan_parameters(c, i + 2, true);
+        } else if (type == SCAD_TOKEN_IDENTIFIER && tokens[i + 1].type == '=' && tokens[i].start[0] != '$' &&
+                   (i == 0 || tokens[i - 1].type == ';' || tokens[i - 1].type == '}') &&
+                   scad_find_global(c, &tokens[i]) < 0) {
+            *(const ScadToken **) scad_push(c, &c->globals) = &tokens[i];
+        }
+    }
+}
+
+PsScadProgram *ps_scad_compile(const char *source, size_t length, PsScadError *error) {
+    PS_TRACE_BEGIN(zone, "scad/compile");
+    *error = (PsScadError) {0};
+    ScadCompiler c = {.error = error};
+    IoBuffer tokens;
+    io_buffer_init(&tokens, sizeof(ScadToken));
+    IoBuffer *buffers[] = {&c.code, &c.locations, &c.constants, &c.protos, &c.params, &c.declarations, &c.globals,
+                           &c.locals, &c.strings};
+    const size_t sizes[] = {sizeof(ScadInstruction), sizeof(ScadLocation), sizeof(ScadValue), sizeof(ScadProto),
+                            sizeof(ScadParam), sizeof(ScadDeclaration), sizeof(ScadToken *), sizeof(ScadLocal),
+                            sizeof(char *)};
+    for (size_t i = 0; i < sizeof(buffers) / sizeof(buffers[0]); ++i) {
+        io_buffer_init(buffers[i], sizes[i]);
+    }
+
+    ScadLexer lexer;
+    scad_lexer_init(&lexer, source, length);
+    while (true) {
+        ScadToken token = scad_lexer_next(&lexer);
+        ScadToken *slot = io_buffer_push(&tokens);
+        if (token.type == SCAD_TOKEN_ERROR || !slot) {
+            c.eof = (ScadToken) {SCAD_TOKEN_EOF, "", 0, 0.0, token.line, token.column};
+            scad_error(&c, &c.eof, "%.*s", slot ? (int) token.length : 13, slot ? token.start : "out of memory");
+            break;
+        }
+        *slot = token;
+        if (token.type == SCAD_TOKEN_EOF) {
+            c.eof = token;
+            c.eof.start = "";
+            break;
+        }
+    }
+    c.tokens = tokens.data;
+    c.token_count = tokens.length;
+
+    ScadFunction main = {0};
+    if (!c.failed) {
+        scad_prescan(&c);
+        c.function = &main;
+        ScadBlock block;
+        scad_block_enter(&c, &block);
+        c.main_block = &block;
+        while (scad_peek_type(&c, 0) != SCAD_TOKEN_EOF) {
+            scad_statement(&c);
+        }
+        scad_emit(&c, SCAD_ABC(SCAD_OP_HALT, 0, 0, 0));
+    }
+
+    PsScadProgram *program = c.failed ? NULL : calloc(1, sizeof(PsScadProgram));
+    char **globals = program ? calloc(c.globals.length + 1, sizeof(char *)) : NULL;
+    if (program && globals) {
+        const ScadToken **names = c.globals.data;
+        for (size_t i = 0; i < c.globals.length; ++i) {
+            uint32_t name_length;
+            globals[i] = (char *) scad_string(&c, names[i]->start, names[i]->length, false, &name_length);
+        }
+    }
+    if (program && globals && !c.failed) {
+        *program = (PsScadProgram) {c.code.data, c.locations.data, c.code.length, c.constants.data,
+                                    c.constants.length, c.protos.data, c.protos.length, globals, c.globals.length,
+                                    c.strings.data, c.strings.length, (uint16_t) main.maxreg};
+        c.code.data = c.locations.data = c.constants.data = c.protos.data = c.strings.data = NULL;
+    } else {
+        if (program) {
+            scad_error(&c, &c.eof, "out of memory");
+        }
+        free(globals);
+        free(program);
+        program = NULL;
+        for (size_t i = 0; i < c.strings.length; ++i) {
+            free(((char **) c.strings.data)[i]);
+        }
+    }
+    for (size_t i = 0; i < sizeof(buffers) / sizeof(buffers[0]); ++i) {
+        io_buffer_destroy(buffers[i]);
+    }
+    io_buffer_destroy(&tokens);
+    free(c.number_table);
+    PS_TRACE_END(zone);
+    return program;
+}
+
+void ps_scad_program_free(PsScadProgram *program) {
+    for (size_t i = 0; i < program->string_count; ++i) {
+        free(program->strings[i]);
+    }
+    free(program->strings);
+    free(program->globals);
+    free(program->protos);
+    free(program->constants);
+    free(program->locations);
+    free(program->code);
+    free(program);
+}
+
+#define SCAD_OP_NAME(name) #name,
+static const char *scad_op_names[] = {SCAD_OPS(SCAD_OP_NAME)};
+#undef SCAD_OP_NAME
+
+void ps_scad_program_dump(const PsScadProgram *program, FILE *file) {
+    fprintf(file, "main: %u registers, %zu constants, %zu globals\n", program->frame_size, program->constant_count,
+            program->global_count);
+    for (size_t pc = 0; pc < program->code_length; ++pc) {
+        for (size_t p = 0; p < program->proto_count; ++p) {
+            const ScadProto *proto = &program->protos[p];
+            if (proto->address == pc) {
+                fprintf(file, "%s %s: %u parameters, %u registers\n", proto->module ? "module" : "function",
+                        proto->name, proto->param_count, proto->frame_size);
+            }
+        }
+        const ScadInstruction i = program->code[pc];
+        const ScadOp op = SCAD_OP(i);
+        fprintf(file, "%6zu %5d  %-14s", pc, program->locations[pc].line, op < SCAD_OP_COUNT ? scad_op_names[op] : "?");
+        switch (op) {
+            case SCAD_OP_LOADK: {
+                const ScadValue *constant = &program->constants[SCAD_BX(i)];
+                if (constant->type == SCAD_NUMBER) {
+                    fprintf(file, "r%d = %.17g", SCAD_A(i), constant->number);
+                } else {
+                    fprintf(file, "r%d = \"%.*s\"", SCAD_A(i), (int) constant->length, constant->string);
+                }
+                break;
+            }
+            case SCAD_OP_LOADINT:
+                fprintf(file, "r%d = %d", SCAD_A(i), SCAD_SBX(i));
+                break;
+            case SCAD_OP_JMP:
+                fprintf(file, "-> %zu", pc + 1 + SCAD_SBX(i));
+                break;
+            case SCAD_OP_JMPIF:
+            case SCAD_OP_JMPIFNOT:
+            case SCAD_OP_JMPIFPRESENT:
+            case SCAD_OP_FOR_PREP:
+            case SCAD_OP_FOR_LOOP:
+                fprintf(file, "r%d -> %zu", SCAD_A(i), pc + 1 + SCAD_SBX(i));
+                break;
+            case SCAD_OP_GETGLOBAL:
+            case SCAD_OP_SETGLOBAL:
+                fprintf(file, "r%d %s", SCAD_A(i), program->globals[SCAD_BX(i)]);
+                break;
+            case SCAD_OP_CALL:
+                fprintf(file, "r%d %s", SCAD_A(i), program->protos[SCAD_BX(i)].name);
+                break;
+            case SCAD_OP_MCALL:
+                fprintf(file, "r%d %s", SCAD_A(i), program->protos[SCAD_BX(i)].name);
+                if (++pc < program->code_length && program->code[pc] != UINT32_MAX) {
+                    fprintf(file, " children at %u", program->code[pc]);
+                }
+                break;
+            case SCAD_OP_BLOCK:
+            case SCAD_OP_CHILD:
+                fprintf(file, "%d", SCAD_BX(i));
+                break;
+            case SCAD_OP_BUILTIN:
+                fprintf(file, "r%d %s/%d", SCAD_A(i), scad_builtin_functions[SCAD_B(i)].name, SCAD_C(i));
+                break;
+            case SCAD_OP_NODE:
+                fprintf(file, "r%d %s", SCAD_A(i), scad_builtin_modules[SCAD_B(i)].name);
+                break;
+            default:
+                fprintf(file, "%d %d %d", SCAD_A(i), SCAD_B(i), SCAD_C(i));
+                break;
+        }
+        fputc('\n', file);
+    }
+}
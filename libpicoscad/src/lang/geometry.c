@@ -0,0 +1,105 @@
+#include <picoscad/lang/scad.h>
+
+#include <picoscad/cg/arc.h>
+
+typedef struct ScadConversion {
+    const PsScadResult *result;
+    double tolerance;
+    PsCsg *csg;
+    size_t skipped;
+} ScadConversion;
+
+static PsCsgNode scad_to_csg(ScadConversion *conversion, size_t index, double scale);
+
+// Children combined with operation as OpenSCAD applies them, see ps_csg_fold
+static PsCsgNode scad_children_to_csg(ScadConversion *conversion, size_t index, PsGHOperation operation,
+                                      double scale) {
+    const PsScadNode *nodes = conversion->result->nodes;
+    const size_t end = index + nodes[index].size;
+    size_t count = 0;
+    for (size_t child = index + 1; child < end; child += nodes[child].size) {
+        count++;
+    }
+    PsCsgNode *children = malloc(sizeof(PsCsgNode) * (count ? count : 1));
+    count = 0;
+    for (size_t child = index + 1; child < end; child += nodes[child].size) {
+        children[count++] = scad_to_csg(conversion, child, scale);
+    }
+    const PsCsgNode node = ps_csg_fold(conversion->csg, operation, children, count);
+    free(children);
+    return node;
+}
+
+// The most a transform stretches a length in the xy plane, the largest singular value of its 2x2 part
+static double scad_transform_scale(const PsMat4d *m4d) {
+    const double a = ps_4d_x(m4d->x), b = ps_4d_x(m4d->y), c = ps_4d_y(m4d->x), d = ps_4d_y(m4d->y);
+    const double sum = a * a + b * b + c * c + d * d, det = a * d - b * c;
+    return sqrt(0.5 * (sum + sqrt(fmax(sum * sum - 4.0 * det * det, 0.0))));
+}
+
+static PsCsgNode scad_to_csg(ScadConversion *conversion, size_t index, double scale) {
+    const PsScadNode *node = &conversion->result->nodes[index];
+    const double x = ps_4d_x(node->dims), y = ps_4d_y(node->dims);
+    switch (node->kind) {
+        case PS_SCAD_GROUP:
+        case PS_SCAD_UNION:
+            return scad_children_to_csg(conversion, index, PS_GH_UNION, scale);
+        case PS_SCAD_DIFFERENCE:
+            return scad_children_to_csg(conversion, index, PS_GH_DIFF, scale);
+        case PS_SCAD_INTERSECTION:
+            return scad_children_to_csg(conversion, index, PS_GH_INTERSECT, scale);
+        case PS_SCAD_TRANSFORM:
+            return ps_csg_transform(conversion->csg, &node->transform,
+                                    scad_children_to_csg(conversion, index, PS_GH_UNION,
+                                                         scale * scad_transform_scale(&node->transform)));
+        case PS_SCAD_SQUARE: {
+            const double x0 = node->center ? -x * 0.5 : 0.0, y0 = node->center ? -y * 0.5 : 0.0;
+            const Ps4d points[4] = {
+                    ps_4d(x0, y0, 0.0, 1.0),
+                    ps_4d(x0 + x, y0, 0.0, 1.0),
+                    ps_4d(x0 + x, y0 + y, 0.0, 1.0),
+                    ps_4d(x0, y0 + y, 0.0, 1.0),
+            };
+            return x > 0.0 && y > 0.0 ? ps_csg_polygon(conversion->csg, points, 4) : ps_csg_empty(conversion->csg);
+        }
+        case PS_SCAD_CIRCLE: {
+            // The tolerance applies to the circle as output, after the transforms above it
+            size_t length = node->segments;
+            if (conversion->tolerance > 0.0) {
+                const size_t needed = ps_arc_segments(x * scale, 6.283185307179586, conversion->tolerance);
+                length = node->custom_segments && length < needed ? length : needed;
+            }
+            Ps4d *points = aligned_alloc(_Alignof(Ps4d), sizeof(Ps4d) * (length ? length : 1));
+            ps_ellipse_points4d(0.0, 0.0, x, x, 0.0, 0.0, 6.283185307179586 / (double) length, length, points);
+            const PsCsgNode circle = x > 0.0 ? ps_csg_polygon(conversion->csg, points, length)
+                                             : ps_csg_empty(conversion->csg);
+            free(points);
+            return circle;
+        }
+        case PS_SCAD_POLYGON:
+            return ps_csg_polygon(conversion->csg, conversion->result->points + node->first_point, node->point_count);
+        default:
+            conversion->skipped++;
+            return ps_csg_empty(conversion->csg);
+    }
+}
+
+PsCsgNode ps_scad_result_to_csg(const PsScadResult *result, double tolerance, PsCsg *csg, size_t *skipped) {
+    if (!result->node_count) {
+        if (skipped) {
+            *skipped = 0;
+        }
+        return ps_csg_empty(csg);
+    }
+    return ps_scad_node_to_csg(result, 0, tolerance, csg, skipped);
+}
+
+PsCsgNode ps_scad_node_to_csg(const PsScadResult *result, size_t index, double tolerance, PsCsg *csg,
+                              size_t *skipped) {
+    ScadConversion conversion = {result, tolerance, csg, 0};
+    const PsCsgNode node = scad_to_csg(&conversion, index, 1.0);
+    if (skipped) {
+        *skipped = conversion.skipped;
+    }
+    return node;
+}
@@ -0,0 +1,146 @@
+#include "lexer.h"
+
+#include <string.h>
+
+#include "../io/text.h"
+
+static const struct {
+    const char *text;
+    int type;
+} scad_keywords[] = {
+        {"module", SCAD_TOKEN_MODULE},
+        {"function", SCAD_TOKEN_FUNCTION},
+        {"if", SCAD_TOKEN_IF},
+        {"else", SCAD_TOKEN_ELSE},
+        {"for", SCAD_TOKEN_FOR},
+        {"true", SCAD_TOKEN_TRUE},
+        {"false", SCAD_TOKEN_FALSE},
+        {"undef", SCAD_TOKEN_UNDEF},
+};
+
+void scad_lexer_init(ScadLexer *lexer, const char *source, size_t length) {
+    lexer->cursor = source;
+    lexer->end = source + length;
+    lexer->line_start = source;
+    lexer->line = 1;
+}
+
+bool scad_token_is(const ScadToken *token, const char *text) {
+    return token->length == strlen(text) && memcmp(token->start, text, token->length) == 0;
+}
+
+static bool scad_is_identifier(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$';
+}
+
+static ScadToken scad_error(ScadLexer *lexer, const char *message) {
+    return (ScadToken) {SCAD_TOKEN_ERROR, message, strlen(message), 0.0, lexer->line,
+                        (int) (lexer->cursor - lexer->line_start) + 1};
+}
+
+// Skips blanks and comments, false on an unterminated block comment
+static bool scad_skip(ScadLexer *lexer) {
+    const char *p = lexer->cursor, *end = lexer->end;
+    while (p < end) {
+        if (*p == '\n') {
+            lexer->line++;
+            lexer->line_start = ++p;
+        } else if (*p == ' ' || *p == '\t' || *p == '\r') {
+            p++;
+        } else if (*p == '/' && p + 1 < end && p[1] == '/') {
+            while (p < end && *p != '\n') {
+                p++;
+            }
+        } else if (*p == '/' && p + 1 < end && p[1] == '*') {
+            for (p += 2; p < end && !(*p == '*' && p + 1 < end && p[1] == '/'); ++p) {
+                if (*p == '\n') {
+                    lexer->line++;
+                    lexer->line_start = p + 1;
+                }
+            }
+            if (p == end) {
+                lexer->cursor = p;
+                return false;
+            }
+            p += 2;
+        } else {
+            break;
+        }
+    }
+    lexer->cursor = p;
+    return true;
+}
+
+ScadToken scad_lexer_next(ScadLexer *lexer) {
+    if (!scad_skip(lexer)) {
+        return scad_error(lexer, "unterminated comment");
+    }
+    const char *p = lexer->cursor, *end = lexer->end;
+    ScadToken token = {SCAD_TOKEN_EOF, p, 0, 0.0, lexer->line, (int) (p - lexer->line_start) + 1};
+    if (p == end) {
+        return token;
+    }
+    const char c = *p;
+    if ((c >= '0' && c <= '9') || (c == '.' && p + 1 < end && p[1] >= '0' && p[1] <= '9')) {
+        token.type = SCAD_TOKEN_NUMBER;
+        if (!io_parse_double(&p, end, &token.number)) {
+            return scad_error(lexer, "malformed number");
+        }
+    } else if (scad_is_identifier(c)) {
+        while (p < end && scad_is_identifier(*p)) {
+            p++;
+        }
+        token.type = SCAD_TOKEN_IDENTIFIER;
+        token.length = (size_t) (p - token.start);
+        for (size_t i = 0; i < sizeof(scad_keywords) / sizeof(scad_keywords[0]); ++i) {
+            if (scad_token_is(&token, scad_keywords[i].text)) {
+                token.type = scad_keywords[i].type;
+                break;
+            }
+        }
+    } else if (c == '"') {
+        // The escapes are resolved when the string becomes a constant
+        for (p++; p < end && *p != '"'; ++p) {
+            if (*p == '\\' && p + 1 < end) {
+                p++;
+            } else if (*p == '\n') {
+                break;
+            }
+        }
+        if (p == end || *p != '"') {
+            return scad_error(lexer, "unterminated string");
+        }
+        p++;
+        token.type = SCAD_TOKEN_STRING;
+    } else {
+        static const struct {
+            char text[3];
+            int type;
+        } pairs[] = {
+                {"<=", SCAD_TOKEN_LE},
+                {">=", SCAD_TOKEN_GE},
+                {"==", SCAD_TOKEN_EQ},
+                {"!=", SCAD_TOKEN_NE},
+                {"&&", SCAD_TOKEN_AND},
+                {"||", SCAD_TOKEN_OR},
+        };
+        token.type = 0;
+        for (size_t i = 0; p + 1 < end && i < sizeof(pairs) / sizeof(pairs[0]); ++i) {
+            if (p[0] == pairs[i].text[0] && p[1] == pairs[i].text[1]) {
+                token.type = pairs[i].type;
+                p += 2;
+                break;
+            }
+        }
+        if (!token.type) {
+            if (!strchr("()[]{},;=:?.+-*/%!<>#^", c)) {
+                return scad_error(lexer, "unexpected character");
+            }
+            token.type = c;
+            p++;
+        }
+    }
+    token.length = (size_t) (p - token.start);
+    lexer->cursor = p;
+    return token;
+}
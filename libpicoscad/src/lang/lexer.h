@@ -0,0 +1,56 @@
+#ifndef PS_LANG_LEXER_H_
+#define PS_LANG_LEXER_H_
+
+#include <picoscad/porting.h>
+
+/**
+ * Punctuation is its own character, everything else starts at 256
+ */
+enum {
+    SCAD_TOKEN_EOF = 256,
+    SCAD_TOKEN_ERROR,
+    SCAD_TOKEN_NUMBER,
+    SCAD_TOKEN_STRING,
+    SCAD_TOKEN_IDENTIFIER,
+    SCAD_TOKEN_MODULE,
+    SCAD_TOKEN_FUNCTION,
+    SCAD_TOKEN_IF,
+    SCAD_TOKEN_ELSE,
+    SCAD_TOKEN_FOR,
+    SCAD_TOKEN_TRUE,
+    SCAD_TOKEN_FALSE,
+    SCAD_TOKEN_UNDEF,
+    SCAD_TOKEN_LE,
+    SCAD_TOKEN_GE,
+    SCAD_TOKEN_EQ,
+    SCAD_TOKEN_NE,
+    SCAD_TOKEN_AND,
+    SCAD_TOKEN_OR
+};
+
+typedef struct ScadToken {
+    int type;
+    const char *start;
+    size_t length;
+    double number;
+    int line;
+    int column;
+} ScadToken;
+
+typedef struct ScadLexer {
+    const char *cursor;
+    const char *end;
+    const char *line_start;
+    int line;
+} ScadLexer;
+
+void scad_lexer_init(ScadLexer *lexer, const char *source, size_t length);
+
+/**
+ * The next token; errors come back as SCAD_TOKEN_ERROR with the message in start
+ */
+ScadToken scad_lexer_next(ScadLexer *lexer);
+
+bool scad_token_is(const ScadToken *token, const char *text);
+
+#endif // PS_LANG_LEXER_H_
@@ -0,0 +1,272 @@
+#ifndef PS_LANG_PROGRAM_H_
+#define PS_LANG_PROGRAM_H_
+
+#include <picoscad/lang/scad.h>
+
+#include "../io/text.h"
+
+/*
+ * What the compiler, the VM and the builtins share. Instructions are 32 bits:
+ * the opcode in the low byte, then A, then either B and C or the 16-bit Bx.
+ * Jumps are relative to the instruction after them, sBx = Bx - 32768.
+ */
+
+typedef uint32_t ScadInstruction;
+
+#define SCAD_OP(i) ((ScadOp) ((i) & 0xff))
+#define SCAD_A(i) ((int) (((i) >> 8) & 0xff))
+#define SCAD_B(i) ((int) (((i) >> 16) & 0xff))
+#define SCAD_C(i) ((int) ((i) >> 24))
+#define SCAD_BX(i) ((int) ((i) >> 16))
+#define SCAD_SBX(i) (SCAD_BX(i) - 32768)
+
+#define SCAD_ABC(op, a, b, c) ((ScadInstruction) (op) | (ScadInstruction) (a) << 8 | (ScadInstruction) (b) << 16 | \
+                               (ScadInstruction) (c) << 24)
+#define SCAD_ABX(op, a, bx) ((ScadInstruction) (op) | (ScadInstruction) (a) << 8 | (ScadInstruction) (bx) << 16)
+
+#define SCAD_MAX_REGISTERS 255
+#define SCAD_MAX_BX 0xffff
+#define SCAD_NO_REGISTER 255
+
+#define SCAD_OPS(X) \
+    X(MOVE)          /* R[A] = R[B] */ \
+    X(LOADK)         /* R[A] = K[Bx] */ \
+    X(LOADINT)       /* R[A] = sBx */ \
+    X(LOADBOOL)      /* R[A] = B != 0 */ \
+    X(LOADNIL)       /* R[A] = undef */ \
+    X(LOADMISSING)   /* R[A] = no argument */ \
+    X(ADD)           /* R[A] = R[B] + R[C] */ \
+    X(SUB) \
+    X(MUL) \
+    X(DIV) \
+    X(MOD) \
+    X(POW) \
+    X(EQ) \
+    X(NE) \
+    X(LT) \
+    X(LE) \
+    X(NEG)           /* R[A] = -R[B] */ \
+    X(NOT)           /* R[A] = !R[B] */ \
+    X(TRUTH)         /* R[A] = R[B] as a bool */ \
+    X(JMP)           /* pc += sBx */ \
+    X(JMPIF)         /* if R[A] then pc += sBx */ \
+    X(JMPIFNOT) \
+    X(JMPIFPRESENT)  /* if R[A] is an argument then pc += sBx */ \
+    X(INDEX)         /* R[A] = R[B][R[C]] */ \
+    X(INDEXK)        /* R[A] = R[B][C] */ \
+    X(VECTOR_NEW)    /* R[A] = [] with room for B */ \
+    X(VECTOR_PUSH)   /* R[A] += [R[B]] */ \
+    X(RANGE)         /* R[A] = [R[B] : R[B + 1] : R[B + 2]] */ \
+    X(FOR_PREP)      /* R[A] collection, R[A + 1] index, R[A + 2] count; pc += sBx */ \
+    X(FOR_LOOP)      /* if R[A + 1] < R[A + 2] then R[A + 3] = next, pc += sBx */ \
+    X(GETGLOBAL)     /* R[A] = G[Bx] */ \
+    X(SETGLOBAL)     /* G[Bx] = R[A] */ \
+    X(SPECIAL_GET)   /* R[A] = $[B] */ \
+    X(SPECIAL_SET)   /* $[A] = R[B] */ \
+    X(CALL)          /* R[A] = function Bx(R[A]...) */ \
+    X(RETURN)        /* return R[A] */ \
+    X(MCALL)         /* module Bx(R[A]...), the next word is the child block or UINT32_MAX */ \
+    X(MRETURN) \
+    X(BLOCK)         /* child block header, Bx children */ \
+    X(CHILD)         /* run the next word (a jump) unless child Bx is selected */ \
+    X(BLOCK_END) \
+    X(CHILDREN)      /* children(R[A]), all of them if A is SCAD_NO_REGISTER */ \
+    X(BUILTIN)       /* R[A] = builtin function B(R[A]...R[A + C - 1]) */ \
+    X(NODE)          /* opens builtin module B with R[A]... */ \
+    X(NODE_END) \
+    X(ECHO)          /* B (name, value) pairs from R[A] */ \
+    X(ARENA_MARK)    /* R[A] = arena top */ \
+    X(ARENA_RELEASE) /* arena top = R[A] */ \
+    X(HALT)
+
+#define SCAD_OP_ENUM(name) SCAD_OP_##name,
+typedef enum ScadOp {
+    SCAD_OPS(SCAD_OP_ENUM)
+    SCAD_OP_COUNT
+} ScadOp;
+#undef SCAD_OP_ENUM
+
+typedef enum ScadType {
+    SCAD_UNDEF,
+    /**
+     * An argument that was not passed, only ever in parameter registers
+     */
+    SCAD_MISSING,
+    SCAD_BOOL,
+    SCAD_NUMBER,
+    SCAD_STRING,
+    SCAD_VECTOR,
+    SCAD_RANGE,
+    /**
+     * An arena position saved by ARENA_MARK
+     */
+    SCAD_MARK
+} ScadType;
+
+/**
+ * 16 bytes. Strings are not NUL terminated, vectors and ranges live in the
+ * arena of the run (or the constants of the program) and are never mutated
+ * once built.
+ */
+typedef struct ScadValue {
+    uint32_t type;
+    uint32_t length;
+    union {
+        bool boolean;
+        double number;
+        const char *string;
+        struct ScadValue *items;
+        const double *range;
+        size_t offset;
+    };
+} ScadValue;
+
+typedef enum ScadSpecial {
+    SCAD_SPECIAL_FN,
+    SCAD_SPECIAL_FA,
+    SCAD_SPECIAL_FS,
+    SCAD_SPECIAL_T,
+    /**
+     * Read only, from the module being instantiated
+     */
+    SCAD_SPECIAL_CHILDREN,
+    SCAD_SPECIAL_COUNT
+} ScadSpecial;
+
+#define SCAD_SETTABLE_SPECIALS SCAD_SPECIAL_CHILDREN
+
+PS_INLINE ScadValue scad_undef() {
+    return (ScadValue) {.type = SCAD_UNDEF};
+}
+
+PS_INLINE ScadValue scad_bool(bool boolean) {
+    return (ScadValue) {.type = SCAD_BOOL, .boolean = boolean};
+}
+
+PS_INLINE ScadValue scad_number(double number) {
+    return (ScadValue) {.type = SCAD_NUMBER, .number = number};
+}
+
+typedef struct ScadLocation {
+    int line;
+    int column;
+} ScadLocation;
+
+typedef struct ScadProto {
+    char *name;
+    uint32_t address;
+    uint16_t param_count;
+    uint16_t frame_size;
+    bool module;
+} ScadProto;
+
+struct PsScadProgram {
+    ScadInstruction *code;
+    ScadLocation *locations;
+    size_t code_length;
+    ScadValue *constants;
+    size_t constant_count;
+    ScadProto *protos;
+    size_t proto_count;
+    char **globals;
+    size_t global_count;
+    char **strings;
+    size_t string_count;
+    uint16_t frame_size;
+};
+
+/**
+ * Bump allocator for the values of one run; mark and release bound the memory
+ * of loops to one iteration
+ */
+typedef struct ScadArena {
+    struct ScadChunk *chunks;
+    size_t chunk_count;
+    size_t current;
+    size_t offset;
+    bool failed;
+} ScadArena;
+
+void scad_arena_init(ScadArena *arena);
+void scad_arena_destroy(ScadArena *arena);
+void *scad_arena_alloc(ScadArena *arena, size_t size);
+ScadValue scad_arena_mark(const ScadArena *arena);
+void scad_arena_release(ScadArena *arena, ScadValue mark);
+
+typedef struct ScadBuiltin {
+    const char *name;
+    const char *params[8];
+    uint8_t param_count;
+    /**
+     * Takes any number of positional arguments and no named ones
+     */
+    bool variadic;
+} ScadBuiltin;
+
+extern const ScadBuiltin scad_builtin_functions[];
+extern const size_t scad_builtin_function_count;
+extern const ScadBuiltin scad_builtin_modules[];
+extern const size_t scad_builtin_module_count;
+
+typedef struct ScadRecord ScadRecord;
+
+/**
+ * The state of one run
+ */
+typedef struct ScadVm {
+    const PsScadProgram *program;
+    ScadValue *stack;
+    size_t stack_size;
+    ScadRecord *records;
+    size_t record_count;
+    size_t record_capacity;
+    ScadValue *globals;
+    ScadValue specials[SCAD_SPECIAL_COUNT];
+    ScadArena arena;
+    IoBuffer nodes;
+    IoBuffer points;
+    IoBuffer open_nodes;
+    IoBuffer echo;
+    PsScadError *error;
+} ScadVm;
+
+/*
+ * Value semantics and the builtins, in builtins.c. Anything that allocates
+ * returns undef when the arena is out of memory and sets arena->failed.
+ */
+
+ScadValue *scad_vector_new(ScadArena *arena, size_t capacity);
+
+/**
+ * Room for one more item at the end of vector, which must have been built by scad_vector_new
+ */
+ScadValue *scad_vector_push(ScadArena *arena, ScadValue *vector);
+
+size_t scad_range_count(const double *range);
+bool scad_truthy(const ScadValue *value);
+bool scad_equals(const ScadValue *lhs, const ScadValue *rhs);
+
+/**
+ * ADD, SUB, MUL, DIV, MOD, POW and NEG (which ignores rhs) on any values
+ */
+ScadValue scad_arithmetic(ScadArena *arena, ScadOp op, const ScadValue *lhs, const ScadValue *rhs);
+
+/**
+ * EQ, NE, LT and LE on any values
+ */
+ScadValue scad_compare(ScadOp op, const ScadValue *lhs, const ScadValue *rhs);
+ScadValue scad_index(const ScadValue *value, double index);
+
+/**
+ * Appends value the way echo() prints it, strings in quotes if quote is set
+ */
+bool scad_format(const ScadValue *value, bool quote, IoBuffer *out);
+
+ScadValue scad_call_builtin(ScadArena *arena, int id, const ScadValue *args, int count);
+
+/**
+ * Fills node from the arguments of builtin module id; polygon points go to vm->points
+ */
+bool scad_builtin_node(ScadVm *vm, int id, const ScadValue *args, PsScadNode *node);
+
+#endif // PS_LANG_PROGRAM_H_
@@ -0,0 +1,502 @@
+#include "program.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <picoscad/sys/trace.h>
+
+// Calls nested deeper than this are taken for runaway recursion
+#define SCAD_MAX_DEPTH 10000
+#define SCAD_MAX_STACK (16 * 1024 * 1024)
+// Keeps node indices in uint32_t and a runaway loop from eating all memory
+#define SCAD_MAX_NODES (16 * 1024 * 1024)
+
+/**
+ * A function call, a module instantiation or a child block being run.
+ * context is the module instantiation whose children children() runs.
+ */
+struct ScadRecord {
+    uint32_t return_pc;
+    uint32_t base;
+    uint32_t top;
+    int32_t context;
+    /**
+     * Functions: where the result goes, relative to the stack
+     */
+    uint32_t result;
+    /**
+     * Modules: the child block and the frame and context it runs in
+     */
+    uint32_t block;
+    uint32_t block_base;
+    int32_t block_context;
+    uint32_t child_count;
+    /**
+     * Child blocks: the child children() selected, -1 for all
+     */
+    int32_t selector;
+    ScadValue mark;
+};
+
+static bool scad_fail(ScadVm *vm, size_t pc, const char *message) {
+    const ScadLocation *location = &vm->program->locations[pc];
+    vm->error->line = location->line;
+    vm->error->column = location->column;
+    snprintf(vm->error->message, sizeof(vm->error->message), "%s", message);
+    return false;
+}
+
+static bool scad_reserve_stack(ScadVm *vm, size_t size) {
+    if (size <= vm->stack_size) {
+        return true;
+    } else if (size > SCAD_MAX_STACK) {
+        return false;
+    }
+    const size_t stack_size = size > vm->stack_size * 2 ? size : vm->stack_size * 2;
+    ScadValue *stack = realloc(vm->stack, sizeof(ScadValue) * stack_size);
+    if (!stack) {
+        return false;
+    }
+    // Registers are always written before they are read, but keep the garbage well defined
+    memset(stack + vm->stack_size, 0, sizeof(ScadValue) * (stack_size - vm->stack_size));
+    vm->stack = stack;
+    vm->stack_size = stack_size;
+    return true;
+}
+
+static ScadRecord *scad_push_record(ScadVm *vm) {
+    if (vm->record_count == vm->record_capacity) {
+        if (vm->record_count >= SCAD_MAX_DEPTH) {
+            return NULL;
+        }
+        const size_t capacity = vm->record_capacity ? vm->record_capacity * 2 : 64;
+        ScadRecord *records = realloc(vm->records, sizeof(ScadRecord) * capacity);
+        if (!records) {
+            return NULL;
+        }
+        vm->records = records;
+        vm->record_capacity = capacity;
+    }
+    return &vm->records[vm->record_count++];
+}
+
+static bool scad_open_node(ScadVm *vm, const PsScadNode *node, int line) {
+    if (vm->nodes.length >= SCAD_MAX_NODES) {
+        return false;
+    }
+    PsScadNode *slot = io_buffer_push(&vm->nodes);
+    uint32_t *open = slot ? io_buffer_push(&vm->open_nodes) : NULL;
+    if (!open) {
+        return false;
+    }
+    *slot = *node;
+    slot->line = (uint32_t) line;
+    *open = (uint32_t) vm->nodes.length - 1;
+    return true;
+}
+
+static void scad_close_node(ScadVm *vm) {
+    const uint32_t index = ((uint32_t *) vm->open_nodes.data)[--vm->open_nodes.length];
+    ((PsScadNode *) vm->nodes.data)[index].size = (uint32_t) vm->nodes.length - index;
+}
+
+static bool scad_echo(ScadVm *vm, const ScadValue *pairs, int count) {
+    bool ok = scad_format(&(ScadValue) {.type = SCAD_STRING, .length = 6, .string = "ECHO: "}, false, &vm->echo);
+    for (int i = 0; i < count; ++i) {
+        if (i) {
+            ok = ok && scad_format(&(ScadValue) {.type = SCAD_STRING, .length = 2, .string = ", "}, false, &vm->echo);
+        }
+        if (pairs[2 * i].type == SCAD_STRING) {
+            ok = ok && scad_format(&pairs[2 * i], false, &vm->echo) &&
+                 scad_format(&(ScadValue) {.type = SCAD_STRING, .length = 3, .string = " = "}, false, &vm->echo);
+        }
+        ok = ok && scad_format(&pairs[2 * i + 1], true, &vm->echo);
+    }
+    return ok && scad_format(&(ScadValue) {.type = SCAD_STRING, .length = 1, .string = "\n"}, false, &vm->echo);
+}
+
+static size_t scad_iteration_count(const ScadValue *collection) {
+    switch (collection->type) {
+        case SCAD_VECTOR:
+        case SCAD_STRING:
+            return collection->length;
+        case SCAD_RANGE:
+            return scad_range_count(collection->range);
+        case SCAD_UNDEF:
+        case SCAD_MISSING:
+            return 0;
+        default:
+            // for (i = 5) runs once with i = 5
+            return 1;
+    }
+}
+
+static bool scad_execute(ScadVm *vm) {
+    const PsScadProgram *program = vm->program;
+    const ScadInstruction *code = program->code;
+    size_t pc = 0;
+    uint32_t base = 0, top = program->frame_size;
+    int32_t context = -1;
+    if (!scad_reserve_stack(vm, top + 1)) {
+        return scad_fail(vm, 0, "out of memory");
+    }
+    ScadValue *r = vm->stack;
+    PsScadNode root = {.kind = PS_SCAD_GROUP, .dims = ps_4d_zero()};
+    ps_mat4d_identity(&root.transform);
+    if (!scad_open_node(vm, &root, 0)) {
+        return scad_fail(vm, 0, "out of memory");
+    }
+
+    while (true) {
+        const ScadInstruction i = code[pc++];
+        const int a = SCAD_A(i);
+        switch (SCAD_OP(i)) {
+            case SCAD_OP_MOVE:
+                r[a] = r[SCAD_B(i)];
+                break;
+            case SCAD_OP_LOADK:
+                r[a] = program->constants[SCAD_BX(i)];
+                break;
+            case SCAD_OP_LOADINT:
+                r[a] = scad_number(SCAD_SBX(i));
+                break;
+            case SCAD_OP_LOADBOOL:
+                r[a] = scad_bool(SCAD_B(i) != 0);
+                break;
+            case SCAD_OP_LOADNIL:
+                r[a] = scad_undef();
+                break;
+            case SCAD_OP_LOADMISSING:
+                r[a] = (ScadValue) {.type = SCAD_MISSING};
+                break;
+            case SCAD_OP_ADD:
+            case SCAD_OP_SUB:
+            case SCAD_OP_MUL:
+            case SCAD_OP_DIV: {
+                const ScadValue *lhs = &r[SCAD_B(i)], *rhs = &r[SCAD_C(i)];
+                if (lhs->type == SCAD_NUMBER && rhs->type == SCAD_NUMBER) {
+                    const double x = lhs->number, y = rhs->number;
+                    const ScadOp op = SCAD_OP(i);
+                    r[a] = scad_number(op == SCAD_OP_ADD ? x + y : op == SCAD_OP_SUB ? x - y
+                                                        : op == SCAD_OP_MUL ? x * y : x / y);
+                    break;
+                }
+            }
+            // Fall through
+            case SCAD_OP_MOD:
+            case SCAD_OP_POW:
+                r[a] = scad_arithmetic(&vm->arena, SCAD_OP(i), &r[SCAD_B(i)], &r[SCAD_C(i)]);
+                if (vm->arena.failed) {
+                    return scad_fail(vm, pc - 1, "out of memory");
+                }
+                break;
+            case SCAD_OP_NEG:
+                r[a] = scad_arithmetic(&vm->arena, SCAD_OP_NEG, &r[SCAD_B(i)], NULL);
+                if (vm->arena.failed) {
+                    return scad_fail(vm, pc - 1, "out of memory");
+                }
+                break;
+            case SCAD_OP_EQ:
+            case SCAD_OP_NE:
+            case SCAD_OP_LT:
+            case SCAD_OP_LE: {
+                const ScadValue *lhs = &r[SCAD_B(i)], *rhs = &r[SCAD_C(i)];
+                if (lhs->type == SCAD_NUMBER && rhs->type == SCAD_NUMBER) {
+                    const double x = lhs->number, y = rhs->number;
+                    const ScadOp op = SCAD_OP(i);
+                    r[a] = scad_bool(op == SCAD_OP_EQ ? x == y : op == SCAD_OP_NE ? x != y
+                                                      : op == SCAD_OP_LT ? x < y : x <= y);
+                } else {
+                    r[a] = scad_compare(SCAD_OP(i), lhs, rhs);
+                }
+                break;
+            }
+            case SCAD_OP_NOT:
+                r[a] = scad_bool(!scad_truthy(&r[SCAD_B(i)]));
+                break;
+            case SCAD_OP_TRUTH:
+                r[a] = scad_bool(scad_truthy(&r[SCAD_B(i)]));
+                break;
+            case SCAD_OP_JMP:
+                pc += SCAD_SBX(i);
+                break;
+            case SCAD_OP_JMPIF:
+                if (scad_truthy(&r[a])) {
+                    pc += SCAD_SBX(i);
+                }
+                break;
+            case SCAD_OP_JMPIFNOT:
+                if (!scad_truthy(&r[a])) {
+                    pc += SCAD_SBX(i);
+                }
+                break;
+            case SCAD_OP_JMPIFPRESENT:
+                if (r[a].type != SCAD_MISSING) {
+                    pc += SCAD_SBX(i);
+                }
+                break;
+            case SCAD_OP_INDEX:
+                r[a] = r[SCAD_C(i)].type == SCAD_NUMBER ? scad_index(&r[SCAD_B(i)], r[SCAD_C(i)].number)
+                                                        : scad_undef();
+                break;
+            case SCAD_OP_INDEXK:
+                r[a] = scad_index(&r[SCAD_B(i)], SCAD_C(i));
+                break;
+            case SCAD_OP_VECTOR_NEW: {
+                ScadValue *items = scad_vector_new(&vm->arena, SCAD_B(i) ? (size_t) SCAD_B(i) : 4);
+                if (!items) {
+                    return scad_fail(vm, pc - 1, "out of memory");
+                }
+                r[a] = (ScadValue) {.type = SCAD_VECTOR, .length = 0, .items = items};
+                break;
+            }
+            case SCAD_OP_VECTOR_PUSH: {
+                ScadValue *item = scad_vector_push(&vm->arena, &r[a]);
+                if (!item) {
+                    return scad_fail(vm, pc - 1, "out of memory");
+                }
+                *item = r[SCAD_B(i)];
+                break;
+            }
+            case SCAD_OP_RANGE: {
+                const ScadValue *bounds = &r[SCAD_B(i)];
+                if (bounds[0].type != SCAD_NUMBER || bounds[1].type != SCAD_NUMBER || bounds[2].type != SCAD_NUMBER) {
+                    r[a] = scad_undef();
+                    break;
+                }
+                double *range = scad_arena_alloc(&vm->arena, sizeof(double) * 3);
+                if (!range) {
+                    return scad_fail(vm, pc - 1, "out of memory");
+                }
+                range[0] = bounds[0].number;
+                range[1] = bounds[1].number;
+                range[2] = bounds[2].number;
+                r[a] = (ScadValue) {.type = SCAD_RANGE, .range = range};
+                break;
+            }
+            case SCAD_OP_FOR_PREP:
+                r[a + 1] = scad_number(0.0);
+                r[a + 2] = scad_number((double) scad_iteration_count(&r[a]));
+                pc += SCAD_SBX(i);
+                break;
+            case SCAD_OP_FOR_LOOP: {
+                const double index = r[a + 1].number;
+                if (index >= r[a + 2].number) {
+                    break;
+                }
+                const ScadValue *collection = &r[a];
+                switch (collection->type) {
+                    case SCAD_VECTOR:
+                        r[a + 3] = collection->items[(size_t) index];
+                        break;
+                    case SCAD_STRING:
+                        r[a + 3] = scad_index(collection, index);
+                        break;
+                    case SCAD_RANGE:
+                        r[a + 3] = scad_number(collection->range[0] + index * collection->range[1]);
+                        break;
+                    default:
+                        r[a + 3] = *collection;
+                        break;
+                }
+                r[a + 1].number = index + 1.0;
+                pc += SCAD_SBX(i);
+                break;
+            }
+            case SCAD_OP_GETGLOBAL:
+                r[a] = vm->globals[SCAD_BX(i)];
+                break;
+            case SCAD_OP_SETGLOBAL:
+                vm->globals[SCAD_BX(i)] = r[a];
+                break;
+            case SCAD_OP_SPECIAL_GET:
+                if (SCAD_B(i) == SCAD_SPECIAL_CHILDREN) {
+                    r[a] = scad_number(context >= 0 ? vm->records[context].child_count : 0);
+                } else {
+                    r[a] = vm->specials[SCAD_B(i)];
+                }
+                break;
+            case SCAD_OP_SPECIAL_SET:
+                vm->specials[a] = r[SCAD_B(i)];
+                break;
+            case SCAD_OP_CALL:
+            case SCAD_OP_MCALL: {
+                const bool module = SCAD_OP(i) == SCAD_OP_MCALL;
+                const ScadProto *proto = &program->protos[SCAD_BX(i)];
+                const uint32_t block = module ? code[pc++] : UINT32_MAX;
+                ScadRecord *record = scad_push_record(vm);
+                if (!record) {
+                    return scad_fail(vm, pc - 1 - module, vm->record_count >= SCAD_MAX_DEPTH
+                                                          ? "recursion too deep" : "out of memory");
+                }
+                *record = (ScadRecord) {(uint32_t) pc, base, top, context, base + a, block, base, context,
+                                        block != UINT32_MAX ? (uint32_t) SCAD_BX(code[block]) : 0, -1};
+                if (!scad_reserve_stack(vm, (size_t) top + proto->frame_size + 1)) {
+                    return scad_fail(vm, pc - 1 - module, "stack overflow");
+                }
+                r = vm->stack + base;
+                ScadValue *frame = vm->stack + top;
+                memcpy(frame, &r[a], sizeof(ScadValue) * proto->param_count);
+                if (module) {
+                    PsScadNode group = root;
+                    record->mark = scad_arena_mark(&vm->arena);
+                    if (!scad_open_node(vm, &group, vm->program->locations[pc - 2].line)) {
+                        return scad_fail(vm, pc - 2, "out of memory");
+                    }
+                    context = (int32_t) vm->record_count - 1;
+                }
+                base = top;
+                top += proto->frame_size;
+                pc = proto->address;
+                r = frame;
+                break;
+            }
+            case SCAD_OP_RETURN: {
+                const ScadRecord *record = &vm->records[--vm->record_count];
+                const ScadValue result = r[a];
+                pc = record->return_pc;
+                base = record->base;
+                top = record->top;
+                context = record->context;
+                vm->stack[record->result] = result;
+                r = vm->stack + base;
+                break;
+            }
+            case SCAD_OP_MRETURN: {
+                const ScadRecord *record = &vm->records[--vm->record_count];
+                scad_close_node(vm);
+                scad_arena_release(&vm->arena, record->mark);
+                pc = record->return_pc;
+                base = record->base;
+                top = record->top;
+                context = record->context;
+                r = vm->stack + base;
+                break;
+            }
+            case SCAD_OP_CHILDREN: {
+                if (context < 0 || vm->records[context].block == UINT32_MAX) {
+                    break;
+                }
+                int32_t selector = -1;
+                if (a != SCAD_NO_REGISTER) {
+                    const double index = r[a].type == SCAD_NUMBER ? floor(r[a].number) : -1.0;
+                    if (!(index >= 0.0 && index < vm->records[context].child_count)) {
+                        break;
+                    }
+                    selector = (int32_t) index;
+                }
+                const ScadRecord owner = vm->records[context];
+                ScadRecord *record = scad_push_record(vm);
+                if (!record) {
+                    return scad_fail(vm, pc - 1, vm->record_count >= SCAD_MAX_DEPTH
+                                                 ? "recursion too deep" : "out of memory");
+                }
+                *record = (ScadRecord) {(uint32_t) pc, base, top, context, .selector = selector};
+                base = owner.block_base;
+                context = owner.block_context;
+                pc = owner.block + 1;
+                r = vm->stack + base;
+                break;
+            }
+            case SCAD_OP_BLOCK:
+                break;
+            case SCAD_OP_CHILD: {
+                const int32_t selector = vm->records[vm->record_count - 1].selector;
+                if (selector < 0 || selector == SCAD_BX(i)) {
+                    pc++;
+                }
+                break;
+            }
+            case SCAD_OP_BLOCK_END: {
+                const ScadRecord *record = &vm->records[--vm->record_count];
+                pc = record->return_pc;
+                base = record->base;
+                context = record->context;
+                r = vm->stack + base;
+                break;
+            }
+            case SCAD_OP_BUILTIN:
+                r[a] = scad_call_builtin(&vm->arena, SCAD_B(i), &r[a], SCAD_C(i));
+                if (vm->arena.failed) {
+                    return scad_fail(vm, pc - 1, "out of memory");
+                }
+                break;
+            case SCAD_OP_NODE: {
+                PsScadNode node;
+                if (!scad_builtin_node(vm, SCAD_B(i), &r[a], &node) || !scad_open_node(vm, &node, vm->program->locations[pc - 1].line)) {
+                    return scad_fail(vm, pc - 1, "out of memory");
+                }
+                break;
+            }
+            case SCAD_OP_NODE_END:
+                scad_close_node(vm);
+                break;
+            case SCAD_OP_ECHO:
+                if (!scad_echo(vm, &r[a], SCAD_B(i))) {
+                    return scad_fail(vm, pc - 1, "out of memory");
+                }
+                break;
+            case SCAD_OP_ARENA_MARK:
+                r[a] = scad_arena_mark(&vm->arena);
+                break;
+            case SCAD_OP_ARENA_RELEASE:
+                scad_arena_release(&vm->arena, r[a]);
+                break;
+            case SCAD_OP_HALT:
+                scad_close_node(vm);
+                return true;
+            default:
+                return scad_fail(vm, pc - 1, "invalid instruction");
+        }
+    }
+}
+
+bool ps_scad_run(const PsScadProgram *program, PsScadResult *result, PsScadError *error) {
+    PS_TRACE_BEGIN(zone, "scad/run");
+    *result = (PsScadResult) {0};
+    *error = (PsScadError) {0};
+    ScadVm vm = {.program = program, .error = error};
+    scad_arena_init(&vm.arena);
+    io_buffer_init(&vm.nodes, sizeof(PsScadNode));
+    io_buffer_init(&vm.points, sizeof(Ps4d));
+    io_buffer_init(&vm.open_nodes, sizeof(uint32_t));
+    io_buffer_init(&vm.echo, sizeof(char));
+    vm.specials[SCAD_SPECIAL_FN] = scad_number(0.0);
+    vm.specials[SCAD_SPECIAL_FA] = scad_number(12.0);
+    vm.specials[SCAD_SPECIAL_FS] = scad_number(2.0);
+    vm.specials[SCAD_SPECIAL_T] = scad_number(0.0);
+    vm.globals = calloc(program->global_count + 1, sizeof(ScadValue));
+
+    bool ok = vm.globals && scad_execute(&vm);
+    if (!vm.globals) {
+        snprintf(error->message, sizeof(error->message), "out of memory");
+    }
+    char *terminator = ok ? io_buffer_push(&vm.echo) : NULL;
+    if (terminator) {
+        *terminator = '\0';
+        *result = (PsScadResult) {vm.nodes.data, vm.nodes.length, vm.points.data, vm.points.length, vm.echo.data,
+                                  vm.echo.length - 1};
+        vm.nodes.data = vm.points.data = vm.echo.data = NULL;
+    } else if (ok) {
+        snprintf(error->message, sizeof(error->message), "out of memory");
+        ok = false;
+    }
+    io_buffer_destroy(&vm.nodes);
+    io_buffer_destroy(&vm.points);
+    io_buffer_destroy(&vm.open_nodes);
+    io_buffer_destroy(&vm.echo);
+    scad_arena_destroy(&vm.arena);
+    free(vm.globals);
+    free(vm.records);
+    free(vm.stack);
+    PS_TRACE_END(zone);
+    return ok;
+}
+
+void ps_scad_result_free(PsScadResult *result) {
+    free(result->nodes);
+    free(result->points);
+    free(result->echo);
+    *result = (PsScadResult) {0};
+}
@@ -0,0 +1,17 @@
+#include <picoscad/math/4d.h>
+
+#include <picoscad/sys/trace.h>
+
+#include "../kernel/kernels.h"
+
+void ps_4d_to_4f_array(const Ps4d *in, Ps4f *out, size_t length) {
+    PS_TRACE_BEGIN(zone, "4d/to_4f_array");
+    ps_kernels()->convert_4d_4f(in, out, length);
+    PS_TRACE_END(zone);
+}
+
+void ps_4f_to_4d_array(const Ps4f *in, Ps4d *out, size_t length) {
+    PS_TRACE_BEGIN(zone, "4f/to_4d_array");
+    ps_kernels()->convert_4f_4d(in, out, length);
+    PS_TRACE_END(zone);
+}
@@ -0,0 +1,11 @@
+#include <picoscad/math/mat4d.h>
+
+#include <picoscad/sys/trace.h>
+
+#include "../kernel/kernels.h"
+
+void ps_mat4d_transform_points(const PsMat4d *m4d, const Ps4d *in, Ps4d *out, size_t length) {
+    PS_TRACE_BEGIN(zone, "mat4d/transform_points");
+    ps_kernels()->mat4d_transform_points(m4d, in, out, length);
+    PS_TRACE_END(zone);
+}
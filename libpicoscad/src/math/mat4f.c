@@ -0,0 +1,11 @@
+#include <picoscad/math/mat4f.h>
+
+#include <picoscad/sys/trace.h>
+
+#include "../kernel/kernels.h"
+
+void ps_mat4f_transform_points(const PsMat4f *m4f, const Ps4f *in, Ps4f *out, size_t length) {
+    PS_TRACE_BEGIN(zone, "mat4f/transform_points");
+    ps_kernels()->mat4f_transform_points(m4f, in, out, length);
+    PS_TRACE_END(zone);
+}
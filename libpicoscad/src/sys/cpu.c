@@ -0,0 +1,108 @@
+#include <picoscad/sys/cpu.h>
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+
+// XCR0 bits for the register state the OS saves on context switch
+#define XCR0_SSE_AVX 0x06
+#define XCR0_AVX512 0xE0
+
+static uint64_t xgetbv(uint32_t index) {
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return ((uint64_t) edx << 32) | eax;
+}
+
+static PsCpuIsa cpu_detect() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return PS_CPU_ISA_GENERIC;
+    }
+    // AVX needs both the instructions and an OS that saves the ymm registers
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) {
+        return PS_CPU_ISA_GENERIC;
+    }
+    uint64_t xcr0 = xgetbv(0);
+    if ((xcr0 & XCR0_SSE_AVX) != XCR0_SSE_AVX) {
+        return PS_CPU_ISA_GENERIC;
+    }
+    bool fma = ecx & bit_FMA;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return PS_CPU_ISA_AVX;
+    }
+    if (!(ebx & bit_AVX2) || !fma) {
+        return PS_CPU_ISA_AVX;
+    }
+    if (!(ebx & bit_AVX512F) || (xcr0 & XCR0_AVX512) != XCR0_AVX512) {
+        return PS_CPU_ISA_AVX2;
+    }
+    return PS_CPU_ISA_AVX512;
+}
+#else
+static PsCpuIsa cpu_detect() {
+    return PS_CPU_ISA_GENERIC;
+}
+#endif
+
+static const char *isa_names[] = {
+        [PS_CPU_ISA_GENERIC] = "generic",
+        [PS_CPU_ISA_AVX] = "avx",
+        [PS_CPU_ISA_AVX2] = "avx2",
+        [PS_CPU_ISA_AVX512] = "avx512"
+};
+
+// Both caches hold isa + 1 so zero means unresolved; racing threads compute the same value
+static atomic_int detected_isa;
+static atomic_int selected_isa;
+
+PsCpuIsa ps_cpu_detect_isa() {
+    int isa = atomic_load_explicit(&detected_isa, memory_order_relaxed);
+    if (!isa) {
+        isa = cpu_detect() + 1;
+        atomic_store_explicit(&detected_isa, isa, memory_order_relaxed);
+    }
+    return (PsCpuIsa) (isa - 1);
+}
+
+PsCpuIsa ps_cpu_get_isa() {
+    int isa = atomic_load_explicit(&selected_isa, memory_order_relaxed);
+    if (isa) {
+        return (PsCpuIsa) (isa - 1);
+    }
+    PsCpuIsa detected = ps_cpu_detect_isa();
+    PsCpuIsa selected = detected;
+    const char *env = getenv("PICOSCAD_ISA");
+    if (env && *env) {
+        size_t i = 0;
+        while (i <= PS_CPU_ISA_AVX512 && strcmp(env, isa_names[i]) != 0) {
+            i++;
+        }
+        if (i > PS_CPU_ISA_AVX512) {
+            fprintf(stderr, "picoscad: unknown PICOSCAD_ISA=%s, using %s\n", env, isa_names[detected]);
+        } else if (i > detected) {
+            fprintf(stderr, "picoscad: PICOSCAD_ISA=%s is not supported here, using %s\n", env, isa_names[detected]);
+        } else {
+            selected = (PsCpuIsa) i;
+        }
+    }
+    atomic_store_explicit(&selected_isa, selected + 1, memory_order_relaxed);
+    return selected;
+}
+
+const char *ps_cpu_isa_name(PsCpuIsa isa) {
+    if (isa > PS_CPU_ISA_AVX512) {
+        return "unknown";
+    }
+    return isa_names[isa];
+}
+
+size_t ps_cpu_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t) count : 1;
+}
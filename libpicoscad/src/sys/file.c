@@ -0,0 +1,44 @@
+#include <picoscad/sys/file.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool ps_file_map(const char *path, PsMappedFile *file) {
+    *file = (PsMappedFile) {NULL, 0};
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        return false;
+    }
+    if (st.st_size > 0) {
+        void *data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            errno = error;
+            return false;
+        }
+        // Importers sweep the file front to back, let the kernel read ahead aggressively
+        madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+        *file = (PsMappedFile) {data, (size_t) st.st_size};
+    }
+    // The mapping keeps the file alive on its own
+    close(fd);
+    return true;
+}
+
+void ps_file_unmap(PsMappedFile *file) {
+    if (file->data) {
+        munmap((void *) file->data, file->size);
+    }
+    *file = (PsMappedFile) {NULL, 0};
+}
@@ -0,0 +1,157 @@
+#include <picoscad/sys/trace.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct TraceEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+} TraceEvent;
+
+typedef struct TraceRing TraceRing;
+
+struct TraceRing {
+    TraceRing *next;
+    const char *thread_name;
+    unsigned int thread_id;
+    // Cleared when the owning thread exits, the next new thread takes the ring over
+    atomic_bool in_use;
+    // Total events ever recorded, the newest is at (head - 1) % PS_TRACE_RING_SIZE
+    atomic_size_t head;
+    TraceEvent events[PS_TRACE_RING_SIZE];
+};
+
+atomic_bool _ps_trace_enabled;
+
+// Rings are pushed once and never freed, a thread that exits hands its ring to the next new thread, so workers
+// started over and over reuse the same few rings
+static _Atomic(TraceRing *) rings;
+static atomic_uint ring_count;
+static _Thread_local TraceRing *thread_ring;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static void trace_ring_release(void *data) {
+    TraceRing *ring = data;
+    thread_ring = NULL;
+    atomic_store_explicit(&ring->in_use, false, memory_order_release);
+}
+
+static void trace_ring_key_create() {
+    pthread_key_create(&ring_key, trace_ring_release);
+}
+
+static TraceRing *trace_ring_claim() {
+    for (TraceRing *ring = atomic_load(&rings); ring; ring = ring->next) {
+        bool in_use = false;
+        if (!atomic_load_explicit(&ring->in_use, memory_order_relaxed) &&
+            atomic_compare_exchange_strong_explicit(&ring->in_use, &in_use, true, memory_order_acquire,
+                                                    memory_order_relaxed)) {
+            return ring;
+        }
+    }
+    TraceRing *ring = calloc(1, sizeof(TraceRing));
+    if (!ring) {
+        return NULL;
+    }
+    ring->thread_id = atomic_fetch_add(&ring_count, 1) + 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->in_use, true);
+    TraceRing *next = atomic_load(&rings);
+    do {
+        ring->next = next;
+    } while (!atomic_compare_exchange_weak(&rings, &next, ring));
+    return ring;
+}
+
+static TraceRing *trace_ring() {
+    TraceRing *ring = thread_ring;
+    if (ring) {
+        return ring;
+    }
+    pthread_once(&ring_key_once, trace_ring_key_create);
+    ring = trace_ring_claim();
+    if (!ring) {
+        return NULL;
+    }
+    pthread_setspecific(ring_key, ring);
+    thread_ring = ring;
+    return ring;
+}
+
+uint64_t _ps_trace_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+void _ps_trace_record(const char *name, uint64_t start, uint64_t end) {
+    TraceRing *ring = trace_ring();
+    if (!ring) {
+        return;
+    }
+    // Only this thread writes the ring, the release publishes the event to ps_trace_write
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ring->events[head % PS_TRACE_RING_SIZE] = (TraceEvent) {name, start, end};
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void ps_trace_start() {
+    atomic_store_explicit(&_ps_trace_enabled, true, memory_order_relaxed);
+}
+
+void ps_trace_stop() {
+    atomic_store_explicit(&_ps_trace_enabled, false, memory_order_relaxed);
+}
+
+void ps_trace_thread_name(const char *name) {
+    TraceRing *ring = trace_ring();
+    if (ring) {
+        ring->thread_name = name;
+    }
+}
+
+// Writes text as a JSON string, quotes included
+static void trace_write_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const unsigned char *c = (const unsigned char *) text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool ps_trace_write(FILE *file) {
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first = true;
+    for (TraceRing *ring = atomic_load(&rings); ring; ring = ring->next) {
+        if (ring->thread_name) {
+            fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                    first ? "" : ",", ring->thread_id);
+            trace_write_string(file, ring->thread_name);
+            fprintf(file, "}}");
+            first = false;
+        }
+        const size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        const size_t begin = head > PS_TRACE_RING_SIZE ? head - PS_TRACE_RING_SIZE : 0;
+        for (size_t i = begin; i < head; ++i) {
+            const TraceEvent *event = &ring->events[i % PS_TRACE_RING_SIZE];
+            // Chrome wants microseconds, keep the nanoseconds as decimals
+            fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+            trace_write_string(file, event->name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", ring->thread_id,
+                    event->start / 1e3, (event->end - event->start) / 1e3);
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return !ferror(file);
+}
@@ -0,0 +1,241 @@
+#include "batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <picoscad/sys/cpu.h>
+#include <picoscad/sys/trace.h>
+
+#include "job.h"
+#include "watch.h"
+
+typedef struct BatchOptions {
+    const char *operation;
+    const char *input;
+    const char *output;
+    const char *timings;
+    const char *trace;
+    const char *tolerance;
+    const char *cache;
+    const char *threads;
+    bool watch;
+} BatchOptions;
+
+static double batch_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void batch_usage(const char *argv0) {
+    fprintf(stderr, "usage: %s --headless [--op union|diff|intersect] [--input FILE] [--output FILE]\n"
+                    "       [--timings FILE] [--trace FILE] [--tolerance UNITS] [--cache DIR]\n"
+                    "       [--threads N] [--watch]\n"
+                    "Without --input the demo triangles are evaluated, without --output the\n"
+                    "result goes to stdout. Files ending in .psgeo are read and written as\n"
+                    "picoSCAD geometry files; .svg and .dxf inputs are imported with curves\n"
+                    "flattened to within --tolerance (default 0.01); the 2D part of .scad\n"
+                    "inputs is evaluated and --op ignored, with circles that set no $fn, $fa\n"
+                    "or $fs kept within --tolerance too. --cache keeps operation results in\n"
+                    "DIR for later runs. Evaluation runs on N threads, by default one per CPU.\n"
+                    "Timings are JSON, traces Chrome trace JSON. --watch evaluates a .scad\n"
+                    "input again each time it is saved and reports the parts rebuilt.\n", argv0);
+}
+
+static bool batch_parse(int argc, char **argv, BatchOptions *options) {
+    *options = (BatchOptions) {"union", NULL, NULL, NULL, NULL, "0.01", NULL, "0", false};
+    for (int i = 1; i < argc; ++i) {
+        const char **value = NULL;
+        if (strcmp(argv[i], "--headless") == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            options->watch = true;
+            continue;
+        } else if (strcmp(argv[i], "--op") == 0) {
+            value = &options->operation;
+        } else if (strcmp(argv[i], "--input") == 0) {
+            value = &options->input;
+        } else if (strcmp(argv[i], "--output") == 0) {
+            value = &options->output;
+        } else if (strcmp(argv[i], "--timings") == 0) {
+            value = &options->timings;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            value = &options->trace;
+        } else if (strcmp(argv[i], "--tolerance") == 0) {
+            value = &options->tolerance;
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            value = &options->cache;
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            value = &options->threads;
+        }
+        if (!value || i + 1 >= argc) {
+            return false;
+        }
+        *value = argv[++i];
+    }
+    return true;
+}
+
+static bool batch_write_timings(const char *path, const Job *job, const JobStats *stats, double load_seconds,
+                                double write_seconds) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "{\"isa\":\"%s\",\"threads\":%zu,\"input_polygons\":%zu,\"csg_nodes\":%zu,\"evaluated\":%zu,"
+                  "\"reused\":%zu,\"loaded\":%zu,\"clips\":%zu,\"intersections\":%zu,"
+                  "\"output_polygons\":%zu,\"output_vertices\":%zu,"
+                  "\"load_ms\":%.3f,\"evaluate_ms\":%.3f,\"write_ms\":%.3f}\n",
+            ps_cpu_isa_name(ps_cpu_get_isa()), job->threads ? job->threads : ps_cpu_count(),
+            ps_array_get_length(job->polygons), job->csg ? ps_csg_get_node_count(job->csg) : 0, stats->evaluated,
+            stats->reused, stats->loaded, stats->clips, stats->intersections, stats->output_polygons,
+            stats->output_vertices, load_seconds * 1e3, stats->evaluate_seconds * 1e3, write_seconds * 1e3);
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+static bool batch_write_trace(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    bool ok = ps_trace_write(file);
+    return fclose(file) == 0 && ok;
+}
+
+// Evaluates the job and writes the result and timings
+static bool batch_evaluate(Job *job, const BatchOptions *options, double load_seconds) {
+    JobStats stats;
+    PsArray OF(PsGHPolygon4d *) *result = job_evaluate(job, &stats);
+
+    const double start = batch_now();
+    bool ok;
+    if (options->output && job_is_geofile(options->output)) {
+        ok = job_write_geofile(result, options->output);
+    } else {
+        FILE *output = options->output ? fopen(options->output, "w") : stdout;
+        ok = output && job_write(result, output);
+        if (options->output && output) {
+            ok = fclose(output) == 0 && ok;
+        }
+    }
+    const double write_seconds = batch_now() - start;
+    if (!ok) {
+        fprintf(stderr, "failed to write %s\n", options->output ? options->output : "the result");
+    }
+    if (options->watch) {
+        fprintf(stderr, "%s: read in %.3f ms; ", options->input, load_seconds * 1e3);
+        job_write_rebuilt(job, &stats, stderr);
+    }
+
+    if (options->timings && !batch_write_timings(options->timings, job, &stats, load_seconds, write_seconds)) {
+        fprintf(stderr, "failed to write %s\n", options->timings);
+        ok = false;
+    }
+    job_free_polygons(result);
+    return ok;
+}
+
+// Reads and evaluates the input again whenever it is saved, for as long as it can be watched
+static void batch_watch(Job *job, const BatchOptions *options) {
+    const char *error;
+    Watch *watch = watch_new(options->input, &error);
+    if (!watch) {
+        fprintf(stderr, "%s: %s\n", options->input, error);
+        return;
+    }
+    while (watch_wait(watch, -1)) {
+        const double start = batch_now();
+        // A broken save keeps the last good model
+        if (!job_read_scad(job, options->input, strtod(options->tolerance, NULL), &error)) {
+            fprintf(stderr, "%s: %s\n", options->input, error);
+            continue;
+        }
+        batch_evaluate(job, options, batch_now() - start);
+    }
+    watch_free(watch);
+}
+
+int batch_main(int argc, char **argv) {
+    BatchOptions options;
+    PsGHOperation operation;
+    if (!batch_parse(argc, argv, &options) || !job_parse_operation(options.operation, &operation) ||
+        (options.watch && !(options.input && job_is_scad(options.input)))) {
+        batch_usage(argv[0]);
+        return 2;
+    }
+    if (options.trace) {
+        ps_trace_start();
+    }
+
+    const double start = batch_now();
+    Job *job;
+    if (options.input && job_is_geofile(options.input)) {
+        job = job_new(operation);
+        const char *error;
+        if (!job_read_geofile(job, options.input, &error)) {
+            fprintf(stderr, "%s: %s\n", options.input, error);
+            job_free(job);
+            return 1;
+        }
+    } else if (options.input && job_is_scad(options.input)) {
+        job = job_new(operation);
+        const char *error;
+        if (!job_read_scad(job, options.input, strtod(options.tolerance, NULL), &error)) {
+            fprintf(stderr, "%s: %s\n", options.input, error);
+            job_free(job);
+            return 1;
+        }
+    } else if (options.input && job_is_outline(options.input)) {
+        job = job_new(operation);
+        const char *error;
+        if (!job_read_outline(job, options.input, strtod(options.tolerance, NULL), &error)) {
+            fprintf(stderr, "%s: %s\n", options.input, error);
+            job_free(job);
+            return 1;
+        }
+    } else if (options.input) {
+        FILE *file = fopen(options.input, "r");
+        if (!file) {
+            perror(options.input);
+            return 1;
+        }
+        job = job_new(operation);
+        const char *error;
+        bool ok = job_read(job, file, &error);
+        fclose(file);
+        if (!ok) {
+            fprintf(stderr, "%s: %s\n", options.input, error);
+            job_free(job);
+            return 1;
+        }
+    } else {
+        job = job_new_demo();
+        job->operation = operation;
+    }
+    job->threads = (size_t) strtoul(options.threads, NULL, 10);
+    if (options.cache) {
+        const char *error;
+        if (!job_open_disk_cache(job, options.cache, &error)) {
+            fprintf(stderr, "%s: %s\n", options.cache, error);
+            job_free(job);
+            return 1;
+        }
+    }
+    bool ok = batch_evaluate(job, &options, batch_now() - start);
+    if (options.watch) {
+        batch_watch(job, &options);
+        ok = false;
+    }
+    if (options.trace) {
+        ps_trace_stop();
+        if (!batch_write_trace(options.trace)) {
+            fprintf(stderr, "failed to write %s\n", options.trace);
+            ok = false;
+        }
+    }
+
+    job_free(job);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+#ifndef PICOSCAD_BATCH_H_
+#define PICOSCAD_BATCH_H_
+
+/**
+ * Headless mode: loads polygons, evaluates them and writes the result and
+ * timings to files without touching GLFW or GL. Takes the full command line,
+ * --headless included, and returns the process exit code.
+ */
+int batch_main(int argc, char **argv);
+
+#endif // PICOSCAD_BATCH_H_
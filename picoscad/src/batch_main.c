@@ -0,0 +1,6 @@
+#include "batch.h"
+
+// picoscad-batch: the headless mode on its own, without GLFW, GLEW or GL linked in
+int main(int argc, char **argv) {
+    return batch_main(argc, argv);
+}
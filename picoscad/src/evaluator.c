@@ -0,0 +1,198 @@
+#include "evaluator.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <picoscad/sys/trace.h>
+
+// The published slot index shares an atomic with a flag telling whether the reader has seen it
+#define EVALUATOR_SLOT_MASK 3u
+#define EVALUATOR_FRESH 4u
+
+struct Evaluator {
+    Job *job;
+    const char *path;
+    double tolerance;
+    void (*ready)(void *userdata);
+    void *ready_userdata;
+
+    EvaluatorResult slots[3];
+    // The slot the thread fills and the one the reader holds, each only touched by its owner
+    unsigned back;
+    unsigned front;
+    // The slot in between, with EVALUATOR_FRESH once a result lands in it
+    atomic_uint middle;
+
+    // Bumped by every request, an evaluation started for an older one is stale
+    atomic_uint requested;
+    // The request being evaluated, only written by the thread
+    unsigned generation;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    // Under lock
+    bool reload;
+    bool stopping;
+    // False if the thread failed to start, requests then run on the caller's
+    bool threaded;
+    pthread_t thread;
+};
+
+static double evaluator_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void evaluator_clear(EvaluatorResult *result) {
+    if (result->model) {
+        job_free_polygons(result->model);
+    }
+    if (result->rebuilt) {
+        job_free_polygons(result->rebuilt);
+    }
+    *result = (EvaluatorResult) {0};
+}
+
+// Called from the evaluation threads
+static bool evaluator_cancelled(void *userdata) {
+    Evaluator *evaluator = userdata;
+    return atomic_load(&evaluator->requested) != evaluator->generation;
+}
+
+// Fills the back slot and publishes it, unless the evaluation was cancelled
+static void evaluator_run(Evaluator *evaluator, bool reload) {
+    Job *job = evaluator->job;
+    EvaluatorResult *result = &evaluator->slots[evaluator->back];
+    evaluator_clear(result);
+    if (reload) {
+        const double start = evaluator_now();
+        const char *error;
+        if (!job_read_scad(job, evaluator->path, evaluator->tolerance, &error)) {
+            fprintf(stderr, "%s: %s\n", evaluator->path, error);
+            return;
+        }
+        result->read_seconds = evaluator_now() - start;
+    }
+    result->reloaded = reload;
+    result->part_count = job->part_count;
+    if (!(result->model = job_evaluate(job, &result->stats))) {
+        return;
+    }
+    result->rebuilt = ps_array_new(16);
+    const double rebuilt_start = evaluator_now();
+    for (size_t i = 0; reload && i < job->part_count; ++i) {
+        if (job->parts[i].changed || job->parts[i].rebuilt) {
+            PsArray OF(PsGHPolygon4d *) *part = job_evaluate_part(job, i);
+            if (!part) {
+                return;
+            }
+            for (size_t j = 0; j < ps_array_get_length(part); ++j) {
+                ps_array_add(result->rebuilt, ps_array_get(part, j));
+            }
+            ps_array_free(part);
+            result->rebuilt_parts++;
+        }
+    }
+    result->rebuilt_seconds = evaluator_now() - rebuilt_start;
+    if (reload) {
+        job_write_rebuilt(job, &result->stats, stderr);
+    }
+    const unsigned previous = atomic_exchange(&evaluator->middle, evaluator->back | EVALUATOR_FRESH);
+    evaluator->back = previous & EVALUATOR_SLOT_MASK;
+    if (evaluator->ready) {
+        evaluator->ready(evaluator->ready_userdata);
+    }
+}
+
+static void *evaluator_work(void *userdata) {
+    Evaluator *evaluator = userdata;
+    unsigned done = 0;
+    pthread_mutex_lock(&evaluator->lock);
+    for (;;) {
+        while (!evaluator->stopping && atomic_load(&evaluator->requested) == done) {
+            pthread_cond_wait(&evaluator->wake, &evaluator->lock);
+        }
+        if (evaluator->stopping) {
+            break;
+        }
+        evaluator->generation = atomic_load(&evaluator->requested);
+        const bool reload = evaluator->reload;
+        evaluator->reload = false;
+        pthread_mutex_unlock(&evaluator->lock);
+
+        PS_TRACE_BEGIN(zone, "evaluator/run");
+        evaluator_run(evaluator, reload);
+        PS_TRACE_END(zone);
+        done = evaluator->generation;
+        pthread_mutex_lock(&evaluator->lock);
+    }
+    pthread_mutex_unlock(&evaluator->lock);
+    return NULL;
+}
+
+Evaluator *evaluator_new(Job *job, const char *path, double tolerance, void (*ready)(void *userdata),
+                         void *userdata) {
+    Evaluator *evaluator = calloc(1, sizeof(Evaluator));
+    evaluator->job = job;
+    evaluator->path = path;
+    evaluator->tolerance = tolerance;
+    evaluator->ready = ready;
+    evaluator->ready_userdata = userdata;
+    evaluator->back = 0;
+    atomic_init(&evaluator->middle, 1);
+    evaluator->front = 2;
+    // Request 1 is the first evaluation, of the job as it was handed over
+    atomic_init(&evaluator->requested, 1);
+    job->cancelled = evaluator_cancelled;
+    job->cancelled_userdata = evaluator;
+    pthread_mutex_init(&evaluator->lock, NULL);
+    pthread_cond_init(&evaluator->wake, NULL);
+    evaluator->threaded = pthread_create(&evaluator->thread, NULL, evaluator_work, evaluator) == 0;
+    if (!evaluator->threaded) {
+        evaluator->generation = 1;
+        evaluator_run(evaluator, false);
+    }
+    return evaluator;
+}
+
+void evaluator_free(Evaluator *evaluator) {
+    pthread_mutex_lock(&evaluator->lock);
+    evaluator->stopping = true;
+    atomic_fetch_add(&evaluator->requested, 1);
+    pthread_cond_signal(&evaluator->wake);
+    pthread_mutex_unlock(&evaluator->lock);
+    if (evaluator->threaded) {
+        pthread_join(evaluator->thread, NULL);
+    }
+    pthread_cond_destroy(&evaluator->wake);
+    pthread_mutex_destroy(&evaluator->lock);
+    for (size_t i = 0; i < 3; ++i) {
+        evaluator_clear(&evaluator->slots[i]);
+    }
+    job_free(evaluator->job);
+    free(evaluator);
+}
+
+void evaluator_reload(Evaluator *evaluator) {
+    if (!evaluator->threaded) {
+        evaluator->generation = atomic_fetch_add(&evaluator->requested, 1) + 1;
+        evaluator_run(evaluator, true);
+        return;
+    }
+    pthread_mutex_lock(&evaluator->lock);
+    evaluator->reload = true;
+    atomic_fetch_add(&evaluator->requested, 1);
+    pthread_cond_signal(&evaluator->wake);
+    pthread_mutex_unlock(&evaluator->lock);
+}
+
+const EvaluatorResult *evaluator_take(Evaluator *evaluator) {
+    if (!(atomic_load(&evaluator->middle) & EVALUATOR_FRESH)) {
+        return NULL;
+    }
+    const unsigned previous = atomic_exchange(&evaluator->middle, evaluator->front);
+    evaluator->front = previous & EVALUATOR_SLOT_MASK;
+    return &evaluator->slots[evaluator->front];
+}
@@ -0,0 +1,64 @@
+#ifndef PICOSCAD_EVALUATOR_H_
+#define PICOSCAD_EVALUATOR_H_
+
+#include "job.h"
+
+/**
+ * Evaluates a job on a thread of its own, so a window drawing the result
+ * never waits for the clipping. Results go through a triple buffer: the
+ * thread fills one slot while the reader holds another, and either hands its
+ * slot over by swapping it with the third in one atomic exchange, so neither
+ * side ever blocks the other. A reload cancels the evaluation still running,
+ * whose result would be stale by the time it was shown.
+ */
+typedef struct Evaluator Evaluator;
+
+/**
+ * One finished evaluation, owned by the evaluator
+ */
+typedef struct EvaluatorResult {
+    PsArray OF(PsGHPolygon4d *) *model;
+    /**
+     * After a reload, the polygons of the parts that changed or were rebuilt
+     */
+    PsArray OF(PsGHPolygon4d *) *rebuilt;
+    size_t rebuilt_parts;
+    size_t part_count;
+    bool reloaded;
+    /**
+     * Reading and converting the file, and evaluating the rebuilt parts on
+     * their own; the evaluation itself is timed in stats
+     */
+    double read_seconds;
+    double rebuilt_seconds;
+    JobStats stats;
+} EvaluatorResult;
+
+/**
+ * Takes ownership of job and starts evaluating it. path names the SCAD file
+ * evaluator_reload reads with tolerance, it is not copied. ready, if not NULL,
+ * is called with userdata from the evaluation thread each time a result can be
+ * taken, so a reader sleeping for events can be woken.
+ */
+Evaluator *evaluator_new(Job *job, const char *path, double tolerance, void (*ready)(void *userdata),
+                         void *userdata);
+
+/**
+ * Cancels what is running, waits for the thread and frees the job
+ */
+void evaluator_free(Evaluator *evaluator);
+
+/**
+ * Reads the file again and evaluates it, cancelling any evaluation still
+ * running. A file that fails to read is reported on stderr and the last good
+ * model stays.
+ */
+void evaluator_reload(Evaluator *evaluator);
+
+/**
+ * The newest result not taken yet, or NULL if there is none. It stays valid
+ * until the next call; only one thread may take.
+ */
+const EvaluatorResult *evaluator_take(Evaluator *evaluator);
+
+#endif // PICOSCAD_EVALUATOR_H_
@@ -0,0 +1,395 @@
+#include "job.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <picoscad/io/dxf.h>
+#include <picoscad/io/geofile.h>
+#include <picoscad/io/svg.h>
+#include <picoscad/lang/scad.h>
+#include <picoscad/sys/file.h>
+#include <picoscad/sys/trace.h>
+
+// Enough for the operations of any model that fits the viewer
+#define JOB_CACHE_BUDGET (256 * 1024 * 1024)
+#define JOB_DISK_CACHE_BUDGET (UINT64_C(1) << 30)
+
+static double job_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+Job *job_new(PsGHOperation operation) {
+    Job *job = malloc(sizeof(Job));
+    job->operation = operation;
+    job->polygons = ps_array_new(2);
+    job->csg = NULL;
+    job->root = 0;
+    job->parts = NULL;
+    job->part_count = 0;
+    job->cache = ps_csg_cache_new(JOB_CACHE_BUDGET);
+    job->disk_cache = NULL;
+    job->threads = 0;
+    job->cancelled = NULL;
+    job->cancelled_userdata = NULL;
+    return job;
+}
+
+void job_free(Job *job) {
+    job_free_polygons(job->polygons);
+    if (job->csg) {
+        ps_csg_free(job->csg);
+    }
+    free(job->parts);
+    ps_csg_cache_free(job->cache);
+    ps_disk_cache_close(job->disk_cache);
+    free(job);
+}
+
+Job *job_new_demo() {
+    Ps4d triangle[3] = {
+            ps_4d(-0.6, -0.4, 0.0, 1.0),
+            ps_4d(0.6, -0.4, 0.0, 1.0),
+            ps_4d(0.0, 0.6, 0.0, 1.0),
+    };
+    Ps4d inner[3] = {
+            ps_4d(-0.3, -0.2, 0.0, 1.0),
+            ps_4d(0.3, -0.2, 0.0, 1.0),
+            ps_4d(0.0, 0.3, 0.0, 1.0),
+    };
+    Job *job = job_new(PS_GH_UNION);
+    ps_array_add(job->polygons, ps_ghpolygon4d_new_with_points(triangle, 3));
+    ps_array_add(job->polygons, ps_ghpolygon4d_new_with_points(inner, 3));
+    return job;
+}
+
+static void job_end_polygon(Job *job, PsGHPolygon4d **poly) {
+    if (*poly) {
+        ps_array_add(job->polygons, *poly);
+        *poly = NULL;
+    }
+}
+
+bool job_read(Job *job, FILE *file, const char **error) {
+    char line[256];
+    PsGHPolygon4d *poly = NULL;
+    while (fgets(line, sizeof(line), file)) {
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        double x, y;
+        char rest;
+        int count = sscanf(line, " %lf %lf %c", &x, &y, &rest);
+        if (count == EOF) {
+            // Blank line, the polygon is done
+            job_end_polygon(job, &poly);
+        } else if (count == 2) {
+            if (!poly) {
+                poly = ps_ghpolygon4d_new();
+            }
+            const Ps4d point = ps_4d(x, y, 0.0, 1.0);
+            ps_ghpolygon4d_add(poly, &point);
+        } else {
+            if (poly) {
+                ps_ghpolygon4d_free(poly);
+            }
+            *error = "expected a line of \"x y\"";
+            return false;
+        }
+    }
+    job_end_polygon(job, &poly);
+    if (ferror(file)) {
+        *error = "read failed";
+        return false;
+    }
+    return true;
+}
+
+static bool job_has_extension(const char *path, const char *extension) {
+    const size_t length = strlen(path), extension_length = strlen(extension);
+    return length >= extension_length && strcasecmp(path + length - extension_length, extension) == 0;
+}
+
+bool job_is_geofile(const char *path) {
+    return job_has_extension(path, ".psgeo");
+}
+
+bool job_read_geofile(Job *job, const char *path, const char **error) {
+    PsGeofile *file = ps_geofile_open(path, error);
+    if (!file) {
+        return false;
+    }
+    bool ok = true;
+    for (size_t i = 0; ok && i < ps_geofile_get_entry_count(file); ++i) {
+        PsGeofileEntry entry;
+        ps_geofile_get_entry(file, i, &entry);
+        if (entry.kind != PS_GEOFILE_POLYGONS) {
+            continue;
+        }
+        PsArray OF(PsGHPolygon4d *) *polygons = ps_geofile_entry_to_polygons4d(&entry);
+        if (!polygons) {
+            *error = "corrupt polygons entry";
+            ok = false;
+            break;
+        }
+        for (size_t j = 0; j < ps_array_get_length(polygons); ++j) {
+            ps_array_add(job->polygons, ps_array_get(polygons, j));
+        }
+        ps_array_free(polygons);
+    }
+    ps_geofile_close(file);
+    return ok;
+}
+
+bool job_is_outline(const char *path) {
+    return job_has_extension(path, ".svg") || job_has_extension(path, ".dxf");
+}
+
+static bool job_add_point(Ps4f *point, void *userdata) {
+    const Ps4d point4d = ps_4d(ps_4f_x(*point), ps_4f_y(*point), 0.0, 1.0);
+    ps_ghpolygon4d_add(userdata, &point4d);
+    return false;
+}
+
+static bool job_add_contour(PsGHPolygon *contour, void *userdata) {
+    Job *job = userdata;
+    PsGHPolygon4d *poly = ps_ghpolygon4d_new();
+    ps_ghpolygon_foreach(contour, job_add_point, poly);
+    ps_ghpolygon_free(contour);
+    ps_array_add(job->polygons, poly);
+    return true;
+}
+
+bool job_read_outline(Job *job, const char *path, double tolerance, const char **error) {
+    if (job_has_extension(path, ".dxf")) {
+        return ps_dxf_read(path, tolerance, job_add_contour, job, error);
+    }
+    return ps_svg_read(path, tolerance, job_add_contour, job, error);
+}
+
+bool job_is_scad(const char *path) {
+    return job_has_extension(path, ".scad");
+}
+
+static int job_compare_hashes(const void *lhs, const void *rhs) {
+    const uint64_t a = *(const uint64_t *) lhs, b = *(const uint64_t *) rhs;
+    return (a > b) - (a < b);
+}
+
+bool job_read_scad(Job *job, const char *path, double tolerance, const char **error) {
+    static char message[sizeof(((PsScadError *) NULL)->message) + 32];
+    PsMappedFile file;
+    if (!ps_file_map(path, &file)) {
+        *error = strerror(errno);
+        return false;
+    }
+    PsScadError scad_error;
+    PsScadResult result;
+    PsScadProgram *program = ps_scad_compile(file.data, file.size, &scad_error);
+    ps_file_unmap(&file);
+    const bool ok = program && ps_scad_run(program, &result, &scad_error);
+    if (program) {
+        ps_scad_program_free(program);
+    }
+    if (!ok) {
+        snprintf(message, sizeof(message), "%d:%d: %s", scad_error.line, scad_error.column, scad_error.message);
+        *error = message;
+        return false;
+    }
+    fputs(result.echo, stderr);
+
+    // The hashes of the parts read before, sorted to look the new ones up
+    uint64_t *old_hashes = malloc(sizeof(uint64_t) * (job->part_count ? job->part_count : 1));
+    for (size_t i = 0; i < job->part_count; ++i) {
+        old_hashes[i] = ps_csg_get_hash(job->csg, job->parts[i].node);
+    }
+    qsort(old_hashes, job->part_count, sizeof(uint64_t), job_compare_hashes);
+
+    // A new graph each time keeps a model edited all day from holding every version; the cache outlives it
+    PsCsg *csg = ps_csg_new();
+    const PsScadNode *nodes = result.nodes;
+    size_t part_count = 0;
+    for (size_t child = 1; child < result.node_count; child += nodes[child].size) {
+        part_count++;
+    }
+    JobPart *parts = malloc(sizeof(JobPart) * (part_count ? part_count : 1));
+    PsCsgNode *part_nodes = malloc(sizeof(PsCsgNode) * (part_count ? part_count : 1));
+    size_t skipped = 0;
+    part_count = 0;
+    for (size_t child = 1; child < result.node_count; child += nodes[child].size) {
+        size_t part_skipped;
+        const PsCsgNode node = ps_scad_node_to_csg(&result, child, tolerance, csg, &part_skipped);
+        const uint64_t hash = ps_csg_get_hash(csg, node);
+        const bool changed = !bsearch(&hash, old_hashes, job->part_count, sizeof(uint64_t), job_compare_hashes);
+        parts[part_count] = (JobPart) {nodes[child].line, node, changed, 0, 0.0};
+        part_nodes[part_count++] = node;
+        skipped += part_skipped;
+    }
+    // The root group is the union of the parts, as ps_scad_result_to_csg builds it
+    const PsCsgNode root = ps_csg_fold(csg, PS_GH_UNION, part_nodes, part_count);
+    free(part_nodes);
+    free(old_hashes);
+    ps_scad_result_free(&result);
+
+    if (job->csg) {
+        ps_csg_free(job->csg);
+    }
+    free(job->parts);
+    job->csg = csg;
+    job->root = root;
+    job->parts = parts;
+    job->part_count = part_count;
+    if (skipped) {
+        fprintf(stderr, "%s: ignored %zu 3D or extruded objects\n", path, skipped);
+    }
+    return true;
+}
+
+static bool job_add_leaf_point(Ps4d *point, void *userdata) {
+    Ps4d **out = userdata;
+    *(*out)++ = *point;
+    return false;
+}
+
+// The polygons combined with the operation, see ps_csg_fold; identical polygons share a leaf
+static PsCsgNode job_fold(Job *job, PsCsg *csg) {
+    const size_t count = ps_array_get_length(job->polygons);
+    PsCsgNode *leaves = malloc(sizeof(PsCsgNode) * (count ? count : 1));
+    for (size_t i = 0; i < count; ++i) {
+        PsGHPolygon4d *poly = ps_array_get(job->polygons, i);
+        const size_t length = ps_ghpolygon4d_get_size(poly);
+        Ps4d *points = aligned_alloc(_Alignof(Ps4d), sizeof(Ps4d) * length);
+        Ps4d *out = points;
+        ps_ghpolygon4d_foreach(poly, job_add_leaf_point, &out);
+        leaves[i] = ps_csg_polygon(csg, points, length);
+        free(points);
+    }
+    const PsCsgNode root = ps_csg_fold(csg, job->operation, leaves, count);
+    free(leaves);
+    return root;
+}
+
+bool job_open_disk_cache(Job *job, const char *directory, const char **error) {
+    PsDiskCache *disk_cache = ps_disk_cache_open(directory, JOB_DISK_CACHE_BUDGET, error);
+    if (!disk_cache) {
+        return false;
+    }
+    ps_disk_cache_close(job->disk_cache);
+    job->disk_cache = disk_cache;
+    const PsCsgStore store = ps_disk_cache_get_store(disk_cache);
+    ps_csg_cache_set_store(job->cache, &store);
+    return true;
+}
+
+PsArray OF(PsGHPolygon4d *) *job_evaluate(Job *job, JobStats *stats) {
+    PS_TRACE_BEGIN(zone, "job/evaluate");
+    const double start = job_now();
+    *stats = (JobStats) {0};
+    PsCsg *csg = job->csg ? job->csg : ps_csg_new();
+    const PsCsgNode root = job->csg ? job->root : job_fold(job, csg);
+    PsCsgStats csg_stats;
+    ps_csg_set_cancel(csg, job->cancelled, job->cancelled_userdata);
+    PsArray OF(PsGHPolygon4d *) *result = ps_csg_evaluate_parallel(csg, root, job->cache, job->threads, 0,
+                                                                   &csg_stats);
+    if (csg != job->csg) {
+        ps_csg_free(csg);
+    }
+    if (!result) {
+        stats->evaluate_seconds = job_now() - start;
+        PS_TRACE_END(zone);
+        return NULL;
+    }
+    for (size_t i = 0; i < job->part_count; ++i) {
+        uint64_t ns;
+        job->parts[i].rebuilt = ps_csg_count_rebuilt(job->csg, job->parts[i].node, &ns);
+        job->parts[i].rebuild_seconds = ns * 1e-9;
+    }
+    stats->evaluated = csg_stats.evaluated;
+    stats->reused = csg_stats.reused;
+    stats->loaded = csg_stats.loaded;
+    stats->clips = csg_stats.clips;
+    stats->intersections = csg_stats.intersections;
+    stats->intersect_seconds = csg_stats.intersect_ns * 1e-9;
+    stats->mark_seconds = csg_stats.mark_ns * 1e-9;
+    stats->walk_seconds = csg_stats.walk_ns * 1e-9;
+    stats->output_polygons = ps_array_get_length(result);
+    for (size_t i = 0; i < stats->output_polygons; ++i) {
+        stats->output_vertices += ps_ghpolygon4d_get_size(ps_array_get(result, i));
+    }
+    stats->evaluate_seconds = job_now() - start;
+    PS_TRACE_END(zone);
+    return result;
+}
+
+PsArray OF(PsGHPolygon4d *) *job_evaluate_part(Job *job, size_t index) {
+    ps_csg_set_cancel(job->csg, job->cancelled, job->cancelled_userdata);
+    return ps_csg_evaluate(job->csg, job->parts[index].node, job->cache, NULL);
+}
+
+static bool job_write_point(Ps4d *point, void *userdata) {
+    return fprintf(userdata, "%.17g %.17g\n", ps_4d_x(*point), ps_4d_y(*point)) < 0;
+}
+
+bool job_write(PsArray OF(PsGHPolygon4d *) *polygons, FILE *file) {
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        if (i > 0) {
+            fputc('\n', file);
+        }
+        if (ps_ghpolygon4d_foreach(ps_array_get(polygons, i), job_write_point, file)) {
+            return false;
+        }
+    }
+    return !ferror(file);
+}
+
+void job_write_rebuilt(const Job *job, const JobStats *stats, FILE *file) {
+    size_t changed = 0;
+    for (size_t i = 0; i < job->part_count; ++i) {
+        changed += job->parts[i].changed;
+    }
+    fprintf(file, "%zu of %zu parts changed, %zu operations clipped in %.3f ms\n", changed, job->part_count,
+            stats->evaluated, stats->evaluate_seconds * 1e3);
+    for (size_t i = 0; i < job->part_count; ++i) {
+        const JobPart *part = &job->parts[i];
+        if (part->rebuilt) {
+            fprintf(file, "  line %u:%s %zu operations in %.3f ms\n", part->line, part->changed ? " changed," : "",
+                    part->rebuilt, part->rebuild_seconds * 1e3);
+        } else if (part->changed) {
+            fprintf(file, "  line %u: changed, nothing clipped\n", part->line);
+        }
+    }
+}
+
+bool job_write_geofile(PsArray OF(PsGHPolygon4d *) *polygons, const char *path) {
+    PsGeofileWriter *writer = ps_geofile_writer_new(path);
+    if (!writer) {
+        return false;
+    }
+    const bool ok = ps_geofile_writer_add_polygons4d(writer, 0, polygons);
+    return ps_geofile_writer_close(writer) && ok;
+}
+
+void job_free_polygons(PsArray OF(PsGHPolygon4d *) *polygons) {
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        ps_ghpolygon4d_free(ps_array_get(polygons, i));
+    }
+    ps_array_free(polygons);
+}
+
+bool job_parse_operation(const char *name, PsGHOperation *operation) {
+    if (strcmp(name, "union") == 0) {
+        *operation = PS_GH_UNION;
+    } else if (strcmp(name, "diff") == 0) {
+        *operation = PS_GH_DIFF;
+    } else if (strcmp(name, "intersect") == 0) {
+        *operation = PS_GH_INTERSECT;
+    } else {
+        return false;
+    }
+    return true;
+}
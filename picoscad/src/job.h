@@ -0,0 +1,176 @@
+#ifndef PICOSCAD_JOB_H_
+#define PICOSCAD_JOB_H_
+
+#include <stdio.h>
+
+#include <picoscad/cg/csg.h>
+#include <picoscad/cg/ghclipping4d.h>
+#include <picoscad/io/diskcache.h>
+
+/**
+ * A top level object of a SCAD model, what the viewer marks as rebuilt
+ */
+typedef struct JobPart {
+    /**
+     * Source line of the statement that made it
+     */
+    uint32_t line;
+    PsCsgNode node;
+    /**
+     * False if the model read before had exactly this part
+     */
+    bool changed;
+    /**
+     * Set by job_evaluate: operations clipped for the part and how long they took
+     */
+    size_t rebuilt;
+    double rebuild_seconds;
+} JobPart;
+
+/**
+ * Polygons folded left to right with one boolean operation, or a model read
+ * from a SCAD file. This is everything the viewer and the headless batch mode
+ * share, none of it touches GL.
+ */
+typedef struct Job {
+    PsGHOperation operation;
+    PsArray OF(PsGHPolygon4d *) *polygons;
+    /**
+     * Set by job_read_scad, evaluated instead of the polygons
+     */
+    PsCsg *csg;
+    PsCsgNode root;
+    JobPart *parts;
+    size_t part_count;
+    /**
+     * Operation results kept for the life of the job, so evaluating again only
+     * clips what changed
+     */
+    PsCsgCache *cache;
+    /**
+     * Set by job_open_disk_cache, behind cache and shared with later runs
+     */
+    PsDiskCache *disk_cache;
+    /**
+     * Threads to evaluate on, 0 (the default) for one per CPU
+     */
+    size_t threads;
+    /**
+     * Asked between operations when set, see ps_csg_set_cancel
+     */
+    bool (*cancelled)(void *userdata);
+    void *cancelled_userdata;
+} Job;
+
+typedef struct JobStats {
+    double evaluate_seconds;
+    /**
+     * Operations clipped, operations whose result came from the cache, and
+     * those loaded from the disk cache
+     */
+    size_t evaluated;
+    size_t reused;
+    size_t loaded;
+    size_t clips;
+    size_t intersections;
+    /**
+     * Time the clips spent in each phase of the boolean, added up over the
+     * threads, see PsGHClipStats
+     */
+    double intersect_seconds;
+    double mark_seconds;
+    double walk_seconds;
+    size_t output_polygons;
+    size_t output_vertices;
+} JobStats;
+
+Job *job_new(PsGHOperation operation);
+void job_free(Job *job);
+
+/**
+ * The two triangles the viewer has always shown
+ */
+Job *job_new_demo();
+
+/**
+ * Reads polygons as lines of "x y", separated by blank lines; # starts a
+ * comment. Returns false and sets error (static storage) on malformed input.
+ */
+bool job_read(Job *job, FILE *file, const char **error);
+
+/**
+ * True if path names a picoSCAD geometry file (.psgeo, see picoscad/io/geofile.h)
+ */
+bool job_is_geofile(const char *path);
+
+/**
+ * Adds the polygons of every polygons entry of a geometry file
+ */
+bool job_read_geofile(Job *job, const char *path, const char **error);
+
+/**
+ * True if path names an SVG or DXF file, by extension
+ */
+bool job_is_outline(const char *path);
+
+/**
+ * Adds every contour of an SVG or DXF file, curves flattened to within tolerance
+ */
+bool job_read_outline(Job *job, const char *path, double tolerance, const char **error);
+
+/**
+ * True if path names an OpenSCAD file, by extension
+ */
+bool job_is_scad(const char *path);
+
+/**
+ * Runs a SCAD file and keeps its 2D part as the model, echo() output goes to
+ * stderr. Errors are "line:column: message". Reading a file again replaces the
+ * model: parts that come out the same are not marked changed, and the caches
+ * hand back everything that wasn't edited, so evaluating after an edit costs
+ * what the edit touched. Circles at the default resolution are made round to
+ * within tolerance, see ps_scad_result_to_csg.
+ */
+bool job_read_scad(Job *job, const char *path, double tolerance, const char **error);
+
+/**
+ * Keeps operation results in directory as well, so later runs and other
+ * processes evaluating the same subtrees load them instead
+ */
+bool job_open_disk_cache(Job *job, const char *directory, const char **error);
+
+/**
+ * Evaluates the SCAD model if there is one, else the polygons folded left to
+ * right with the operation (see ps_csg_fold). The job's polygons are left
+ * untouched. Returns NULL if job->cancelled stopped it, the parts then keep
+ * what they had.
+ */
+PsArray OF(PsGHPolygon4d *) *job_evaluate(Job *job, JobStats *stats);
+
+/**
+ * The polygons of part index alone, from the cache after job_evaluate. NULL if
+ * job->cancelled stopped it.
+ */
+PsArray OF(PsGHPolygon4d *) *job_evaluate_part(Job *job, size_t index);
+
+/**
+ * Writes polygons in the format job_read reads
+ */
+bool job_write(PsArray OF(PsGHPolygon4d *) *polygons, FILE *file);
+
+/**
+ * Writes which parts changed or were rebuilt by the last evaluation and what
+ * each took, one line per part under a summary
+ */
+void job_write_rebuilt(const Job *job, const JobStats *stats, FILE *file);
+
+/**
+ * Writes polygons as a single geometry file entry with key 0, in full precision
+ */
+bool job_write_geofile(PsArray OF(PsGHPolygon4d *) *polygons, const char *path);
+
+void job_free_polygons(PsArray OF(PsGHPolygon4d *) *polygons);
+
+bool job_parse_operation(const char *name, PsGHOperation *operation);
+
+#endif // PICOSCAD_JOB_H_
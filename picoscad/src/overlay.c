@@ -0,0 +1,396 @@
+#include "overlay.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GLFW/glfw3.h>
+
+// Frames kept for the graph and the CSV, about 17 s of continuous drawing at 60 Hz
+#define OVERLAY_HISTORY 1024
+// Timer queries in flight, a frame finding them all still out goes without
+#define OVERLAY_QUERIES 4
+// Frames in the graph, two pixels apart
+#define OVERLAY_GRAPH_FRAMES 120
+// The graph's full height stands for a 30 Hz frame, with a line at 60 Hz
+#define OVERLAY_GRAPH_SECONDS (1.0 / 30.0)
+#define OVERLAY_GRAPH_HEIGHT 60.0f
+// Glyphs are 2 by 2 units, drawn this many pixels to the unit
+#define OVERLAY_GLYPH_SCALE 5.0f
+#define OVERLAY_ADVANCE 13.0f
+#define OVERLAY_LINE_HEIGHT 18.0f
+#define OVERLAY_PADDING 8.0f
+#define OVERLAY_WIDTH 340.0f
+
+typedef struct OverlayFrame {
+    double time;
+    double cpu_seconds;
+    // NAN until the frame's timer query is read, and for good without one
+    double gpu_seconds;
+    size_t uploaded_vertices;
+    size_t draw_calls;
+    bool evaluated;
+    OverlayEvaluation evaluation;
+} OverlayFrame;
+
+typedef struct OverlayQuery {
+    GLuint id;
+    // The frame it times, while pending
+    size_t frame;
+    bool pending;
+} OverlayQuery;
+
+struct Overlay {
+    // Frame n is at frames[n % OVERLAY_HISTORY] for the last OVERLAY_HISTORY of frame_count
+    OverlayFrame *frames;
+    size_t frame_count;
+    // CSV times count from here
+    double start;
+    double frame_start;
+
+    // False without timer queries
+    bool timed;
+    OverlayQuery queries[OVERLAY_QUERIES];
+    // The query timing the frame being drawn, if any
+    OverlayQuery *active;
+
+    // The newest evaluation, pending until a frame ends with it
+    OverlayEvaluation evaluation;
+    bool evaluated;
+    bool evaluation_pending;
+
+    GLuint buffer;
+    Ps4f *vertices;
+    size_t vertex_count;
+    size_t vertex_capacity;
+};
+
+/*
+ * A 16 segment display: the outer edges split in halves, the middle bar split
+ * in two, the vertical through the middle and the four diagonals to the
+ * corners, plus two dots for '.' and ':'. Points are on a 2 by 2 grid, y up.
+ */
+static const float overlay_segments[][4] = {
+        {0, 2, 1, 2}, {1, 2, 2, 2}, {2, 2, 2, 1}, {2, 1, 2, 0}, {2, 0, 1, 0}, {1, 0, 0, 0},
+        {0, 0, 0, 1}, {0, 1, 0, 2}, {0, 1, 1, 1}, {1, 1, 2, 1}, {0, 2, 1, 1}, {1, 2, 1, 1},
+        {2, 2, 1, 1}, {1, 1, 2, 0}, {1, 1, 1, 0}, {1, 1, 0, 0}, {1, 0, 1, 0.3f}, {1, 1.3f, 1, 1.6f},
+};
+
+#define S(i) (1u << (i))
+#define TOP (S(0) | S(1))
+#define RIGHT (S(2) | S(3))
+#define BOTTOM (S(4) | S(5))
+#define LEFT (S(6) | S(7))
+#define MIDDLE (S(8) | S(9))
+#define CENTER (S(11) | S(14))
+
+static const uint32_t overlay_glyphs[128] = {
+        ['0'] = TOP | RIGHT | BOTTOM | LEFT | S(12) | S(15),
+        ['1'] = RIGHT,
+        ['2'] = TOP | S(2) | MIDDLE | S(6) | BOTTOM,
+        ['3'] = TOP | RIGHT | S(9) | BOTTOM,
+        ['4'] = S(7) | MIDDLE | RIGHT,
+        ['5'] = TOP | S(7) | MIDDLE | S(3) | BOTTOM,
+        ['6'] = TOP | LEFT | MIDDLE | S(3) | BOTTOM,
+        ['7'] = TOP | RIGHT,
+        ['8'] = TOP | RIGHT | BOTTOM | LEFT | MIDDLE,
+        ['9'] = TOP | S(7) | MIDDLE | RIGHT | BOTTOM,
+        ['A'] = TOP | RIGHT | LEFT | MIDDLE,
+        ['B'] = TOP | RIGHT | BOTTOM | S(9) | CENTER,
+        ['C'] = TOP | LEFT | BOTTOM,
+        ['D'] = TOP | RIGHT | BOTTOM | CENTER,
+        ['E'] = TOP | LEFT | BOTTOM | S(8),
+        ['F'] = TOP | LEFT | S(8),
+        ['G'] = TOP | LEFT | BOTTOM | S(3) | S(9),
+        ['H'] = LEFT | RIGHT | MIDDLE,
+        ['I'] = TOP | BOTTOM | CENTER,
+        ['J'] = RIGHT | BOTTOM | S(6),
+        ['K'] = LEFT | S(8) | S(12) | S(13),
+        ['L'] = LEFT | BOTTOM,
+        ['M'] = LEFT | RIGHT | S(10) | S(12),
+        ['N'] = LEFT | RIGHT | S(10) | S(13),
+        ['O'] = TOP | RIGHT | BOTTOM | LEFT,
+        ['P'] = TOP | LEFT | MIDDLE | S(2),
+        ['Q'] = TOP | RIGHT | BOTTOM | LEFT | S(13),
+        ['R'] = TOP | LEFT | MIDDLE | S(2) | S(13),
+        ['S'] = TOP | S(7) | MIDDLE | S(3) | BOTTOM,
+        ['T'] = TOP | CENTER,
+        ['U'] = LEFT | RIGHT | BOTTOM,
+        ['V'] = LEFT | S(12) | S(15),
+        ['W'] = LEFT | RIGHT | S(13) | S(15),
+        ['X'] = S(10) | S(12) | S(13) | S(15),
+        ['Y'] = S(10) | S(12) | S(14),
+        ['Z'] = TOP | S(12) | S(15) | BOTTOM,
+        ['-'] = MIDDLE,
+        ['='] = MIDDLE | BOTTOM,
+        ['/'] = S(12) | S(15),
+        ['('] = S(12) | S(13),
+        [')'] = S(10) | S(15),
+        ['.'] = S(16),
+        [':'] = S(16) | S(17),
+};
+
+#undef S
+#undef TOP
+#undef RIGHT
+#undef BOTTOM
+#undef LEFT
+#undef MIDDLE
+#undef CENTER
+
+Overlay *overlay_new() {
+    Overlay *overlay = calloc(1, sizeof(Overlay));
+    overlay->frames = calloc(OVERLAY_HISTORY, sizeof(OverlayFrame));
+    overlay->start = glfwGetTime();
+    overlay->timed = GLEW_ARB_timer_query;
+    for (size_t i = 0; overlay->timed && i < OVERLAY_QUERIES; ++i) {
+        glGenQueries(1, &overlay->queries[i].id);
+    }
+    glGenBuffers(1, &overlay->buffer);
+    return overlay;
+}
+
+void overlay_free(Overlay *overlay) {
+    for (size_t i = 0; overlay->timed && i < OVERLAY_QUERIES; ++i) {
+        glDeleteQueries(1, &overlay->queries[i].id);
+    }
+    glDeleteBuffers(1, &overlay->buffer);
+    free(overlay->vertices);
+    free(overlay->frames);
+    free(overlay);
+}
+
+static OverlayFrame *overlay_get_frame(Overlay *overlay, size_t frame) {
+    return frame < overlay->frame_count && frame + OVERLAY_HISTORY >= overlay->frame_count
+           ? &overlay->frames[frame % OVERLAY_HISTORY] : NULL;
+}
+
+// Reads the timer queries that are done, never waiting for the others
+static void overlay_collect(Overlay *overlay) {
+    for (size_t i = 0; i < OVERLAY_QUERIES; ++i) {
+        OverlayQuery *query = &overlay->queries[i];
+        GLint available = 0;
+        if (query->pending) {
+            glGetQueryObjectiv(query->id, GL_QUERY_RESULT_AVAILABLE, &available);
+        }
+        if (available) {
+            GLuint64 elapsed;
+            glGetQueryObjectui64v(query->id, GL_QUERY_RESULT, &elapsed);
+            OverlayFrame *frame = overlay_get_frame(overlay, query->frame);
+            if (frame) {
+                frame->gpu_seconds = (double) elapsed * 1e-9;
+            }
+            query->pending = false;
+        }
+    }
+}
+
+void overlay_begin_frame(Overlay *overlay, double start_seconds) {
+    overlay->frame_start = start_seconds;
+    overlay->active = NULL;
+    if (!overlay->timed) {
+        return;
+    }
+    overlay_collect(overlay);
+    for (size_t i = 0; i < OVERLAY_QUERIES && !overlay->active; ++i) {
+        if (!overlay->queries[i].pending) {
+            overlay->active = &overlay->queries[i];
+            glBeginQuery(GL_TIME_ELAPSED, overlay->active->id);
+        }
+    }
+}
+
+void overlay_end_frame(Overlay *overlay, const SceneStats *stats) {
+    if (overlay->active) {
+        glEndQuery(GL_TIME_ELAPSED);
+        overlay->active->frame = overlay->frame_count;
+        overlay->active->pending = true;
+        overlay->active = NULL;
+    }
+    OverlayFrame *frame = &overlay->frames[overlay->frame_count++ % OVERLAY_HISTORY];
+    *frame = (OverlayFrame) {
+            .time = overlay->frame_start - overlay->start,
+            .cpu_seconds = glfwGetTime() - overlay->frame_start,
+            .gpu_seconds = NAN,
+            .uploaded_vertices = stats->uploaded_vertices,
+            .draw_calls = stats->draw_calls,
+            .evaluated = overlay->evaluation_pending,
+    };
+    if (overlay->evaluation_pending) {
+        frame->evaluation = overlay->evaluation;
+        overlay->evaluation_pending = false;
+    }
+}
+
+void overlay_set_evaluation(Overlay *overlay, const OverlayEvaluation *evaluation) {
+    overlay->evaluation = *evaluation;
+    overlay->evaluated = overlay->evaluation_pending = true;
+}
+
+static void overlay_add(Overlay *overlay, float x, float y) {
+    if (overlay->vertex_count == overlay->vertex_capacity) {
+        overlay->vertex_capacity = overlay->vertex_capacity ? overlay->vertex_capacity * 2 : 1024;
+        overlay->vertices = realloc(overlay->vertices, sizeof(Ps4f) * overlay->vertex_capacity);
+    }
+    overlay->vertices[overlay->vertex_count++] = ps_4f(x, y, 0.0f, 1.0f);
+}
+
+// Writes a line of text as GL_LINES with its glyphs' bottom left corner at x, y
+static void overlay_print(Overlay *overlay, float x, float y, const char *format, ...) {
+    char text[64];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    for (const char *c = text; *c; ++c, x += OVERLAY_ADVANCE) {
+        const uint32_t glyph = overlay_glyphs[toupper((unsigned char) *c) & 127];
+        for (size_t i = 0; i < sizeof(overlay_segments) / sizeof(overlay_segments[0]); ++i) {
+            if (glyph & (1u << i)) {
+                overlay_add(overlay, x + overlay_segments[i][0] * OVERLAY_GLYPH_SCALE,
+                            y + overlay_segments[i][1] * OVERLAY_GLYPH_SCALE);
+                overlay_add(overlay, x + overlay_segments[i][2] * OVERLAY_GLYPH_SCALE,
+                            y + overlay_segments[i][3] * OVERLAY_GLYPH_SCALE);
+            }
+        }
+    }
+}
+
+// Adds the graph of one of the times as GL_LINES, skipping frames without it
+static void overlay_graph(Overlay *overlay, float x, float y, bool gpu) {
+    const size_t first = overlay->frame_count > OVERLAY_GRAPH_FRAMES ? overlay->frame_count - OVERLAY_GRAPH_FRAMES : 0;
+    float last_x = 0.0f, last_y = NAN;
+    for (size_t i = first; i < overlay->frame_count; ++i) {
+        const OverlayFrame *frame = overlay_get_frame(overlay, i);
+        const double seconds = gpu ? frame->gpu_seconds : frame->cpu_seconds;
+        const float point_x = x + 2.0f * (float) (i - first);
+        const float point_y = isnan(seconds) ? NAN
+                                             : y + OVERLAY_GRAPH_HEIGHT * (float) fmin(seconds / OVERLAY_GRAPH_SECONDS, 1.0);
+        if (!isnan(point_y) && !isnan(last_y)) {
+            overlay_add(overlay, last_x, last_y);
+            overlay_add(overlay, point_x, point_y);
+        }
+        last_x = point_x;
+        last_y = point_y;
+    }
+}
+
+void overlay_draw(Overlay *overlay, int width, int height, GLint pos_location, GLint color_location) {
+    const Ps4f panel_color = ps_4f(0.0f, 0.0f, 0.0f, 0.7f);
+    const Ps4f text_color = ps_4f(1.0f, 1.0f, 1.0f, 1.0f);
+    const Ps4f gpu_color = ps_4f(0.95f, 0.45f, 0.0f, 1.0f);
+    const Ps4f guide_color = ps_4f(0.5f, 0.5f, 0.5f, 1.0f);
+    if (!overlay->frame_count) {
+        return;
+    }
+    const OverlayFrame *frame = overlay_get_frame(overlay, overlay->frame_count - 1);
+    // The newest GPU time known, the last few frames' are still out
+    const OverlayFrame *timed = NULL;
+    for (size_t i = overlay->frame_count; i-- > 0 && i + OVERLAY_QUERIES + 1 >= overlay->frame_count && !timed;) {
+        const OverlayFrame *candidate = overlay_get_frame(overlay, i);
+        timed = candidate && !isnan(candidate->gpu_seconds) ? candidate : NULL;
+    }
+    const size_t line_count = overlay->evaluated ? 12 : 4;
+    const float panel_height = 3.0f * OVERLAY_PADDING + (float) line_count * OVERLAY_LINE_HEIGHT + OVERLAY_GRAPH_HEIGHT;
+    const float top = (float) height, left = 0.0f, panel_width = fminf(OVERLAY_WIDTH, (float) width);
+
+    overlay->vertex_count = 0;
+    overlay_add(overlay, left, top);
+    overlay_add(overlay, left, top - panel_height);
+    overlay_add(overlay, left + panel_width, top);
+    overlay_add(overlay, left + panel_width, top - panel_height);
+
+    // Text and the CPU graph are in one color, then the GPU graph and the 60 Hz guide
+    const size_t text_first = overlay->vertex_count;
+    const float x = left + OVERLAY_PADDING;
+    float y = top - OVERLAY_PADDING;
+    overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "CPU %.2f MS", frame->cpu_seconds * 1e3);
+    if (timed) {
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "GPU %.2f MS", timed->gpu_seconds * 1e3);
+    } else {
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, overlay->timed ? "GPU -" : "GPU NO TIMER");
+    }
+    overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "UPLOADED %zu VERTICES", frame->uploaded_vertices);
+    overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "DRAW CALLS %zu", frame->draw_calls);
+    if (overlay->evaluated) {
+        const OverlayEvaluation *evaluation = &overlay->evaluation;
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "READ %.1f MS", evaluation->read_seconds * 1e3);
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "BOOLEAN %.1f MS",
+                      evaluation->stats.evaluate_seconds * 1e3);
+        // The clipper's phases, indented under the boolean they make up; summed over threads
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "  INTERSECT %.1f MS",
+                      evaluation->stats.intersect_seconds * 1e3);
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "  MARK %.1f MS", evaluation->stats.mark_seconds * 1e3);
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "  WALK %.1f MS", evaluation->stats.walk_seconds * 1e3);
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "REBUILT %.1f MS", evaluation->rebuilt_seconds * 1e3);
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "UPLOAD %.1f MS", evaluation->upload_seconds * 1e3);
+        overlay_print(overlay, x, y -= OVERLAY_LINE_HEIGHT, "OPS %zu CACHED %zu DISK %zu", evaluation->stats.evaluated,
+                      evaluation->stats.reused, evaluation->stats.loaded);
+    }
+    const float graph_y = top - panel_height + OVERLAY_PADDING;
+    overlay_graph(overlay, x, graph_y, false);
+    const size_t gpu_first = overlay->vertex_count;
+    overlay_graph(overlay, x, graph_y, true);
+    const size_t guide_first = overlay->vertex_count;
+    overlay_add(overlay, x, graph_y + 0.5f * OVERLAY_GRAPH_HEIGHT);
+    overlay_add(overlay, x + 2.0f * OVERLAY_GRAPH_FRAMES, graph_y + 0.5f * OVERLAY_GRAPH_HEIGHT);
+
+    glBindBuffer(GL_ARRAY_BUFFER, overlay->buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (sizeof(Ps4f) * overlay->vertex_count), overlay->vertices,
+                 GL_STREAM_DRAW);
+    glVertexAttribPointer((GLuint) pos_location, 4, GL_FLOAT, GL_FALSE, sizeof(Ps4f), NULL);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUniform4fv(color_location, 1, (const GLfloat *) &panel_color);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glUniform4fv(color_location, 1, (const GLfloat *) &text_color);
+    glDrawArrays(GL_LINES, (GLint) text_first, (GLsizei) (gpu_first - text_first));
+    glUniform4fv(color_location, 1, (const GLfloat *) &gpu_color);
+    glDrawArrays(GL_LINES, (GLint) gpu_first, (GLsizei) (guide_first - gpu_first));
+    glUniform4fv(color_location, 1, (const GLfloat *) &guide_color);
+    glDrawArrays(GL_LINES, (GLint) guide_first, 2);
+    glDisable(GL_BLEND);
+}
+
+bool overlay_write_csv(Overlay *overlay, const char *path, const char **error) {
+    if (overlay->timed) {
+        overlay_collect(overlay);
+    }
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        *error = strerror(errno);
+        return false;
+    }
+    fprintf(file, "frame,time_s,cpu_ms,gpu_ms,uploaded_vertices,draw_calls,"
+                  "read_ms,evaluate_ms,intersect_ms,mark_ms,walk_ms,rebuilt_ms,upload_ms,"
+                  "evaluated,reused,loaded,clips\n");
+    const size_t first = overlay->frame_count > OVERLAY_HISTORY ? overlay->frame_count - OVERLAY_HISTORY : 0;
+    for (size_t i = first; i < overlay->frame_count; ++i) {
+        const OverlayFrame *frame = overlay_get_frame(overlay, i);
+        fprintf(file, "%zu,%.6f,%.3f,", i, frame->time, frame->cpu_seconds * 1e3);
+        if (!isnan(frame->gpu_seconds)) {
+            fprintf(file, "%.3f", frame->gpu_seconds * 1e3);
+        }
+        fprintf(file, ",%zu,%zu,", frame->uploaded_vertices, frame->draw_calls);
+        if (frame->evaluated) {
+            const OverlayEvaluation *evaluation = &frame->evaluation;
+            fprintf(file, "%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%zu,%zu,%zu,%zu\n", evaluation->read_seconds * 1e3,
+                    evaluation->stats.evaluate_seconds * 1e3, evaluation->stats.intersect_seconds * 1e3,
+                    evaluation->stats.mark_seconds * 1e3, evaluation->stats.walk_seconds * 1e3,
+                    evaluation->rebuilt_seconds * 1e3,
+                    evaluation->upload_seconds * 1e3, evaluation->stats.evaluated, evaluation->stats.reused,
+                    evaluation->stats.loaded, evaluation->stats.clips);
+        } else {
+            fprintf(file, ",,,,,,,,,,\n");
+        }
+    }
+    const bool failed = ferror(file);
+    if (fclose(file) != 0 || failed) {
+        *error = strerror(errno);
+        return false;
+    }
+    return true;
+}
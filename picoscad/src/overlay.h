@@ -0,0 +1,61 @@
+#ifndef PICOSCAD_OVERLAY_H_
+#define PICOSCAD_OVERLAY_H_
+
+#include <GL/glew.h>
+
+#include "job.h"
+#include "scene.h"
+
+/**
+ * Keeps the timing of the last frames the viewer drew and of the evaluations
+ * it showed, and draws them as a panel over the model: the numbers of the
+ * newest frame and evaluation in a stroked font, and a graph of the frame
+ * times. GPU times come from timer queries, which are read back a few frames
+ * late so the CPU never waits for them; without timer queries they are left
+ * out. The panel's own drawing is not counted.
+ */
+typedef struct Overlay Overlay;
+
+/**
+ * How long the phases of one evaluation took and what it did
+ */
+typedef struct OverlayEvaluation {
+    double read_seconds;
+    double rebuilt_seconds;
+    double upload_seconds;
+    JobStats stats;
+} OverlayEvaluation;
+
+/**
+ * Needs the GL context current, as every call here does
+ */
+Overlay *overlay_new();
+void overlay_free(Overlay *overlay);
+
+/**
+ * Brackets the drawing of a frame whose work started at start_seconds, on
+ * glfwGetTime's clock. overlay_end_frame records it with what stats counted
+ * since they were last reset.
+ */
+void overlay_begin_frame(Overlay *overlay, double start_seconds);
+void overlay_end_frame(Overlay *overlay, const SceneStats *stats);
+
+/**
+ * Records an evaluation with the frame that shows it, the next one to end
+ */
+void overlay_set_evaluation(Overlay *overlay, const OverlayEvaluation *evaluation);
+
+/**
+ * Draws the panel in the top left of a width by height framebuffer with the
+ * bound program, whose transform must map pixels to clip space
+ */
+void overlay_draw(Overlay *overlay, int width, int height, GLint pos_location, GLint color_location);
+
+/**
+ * Writes the frames kept, oldest first, one line each with the evaluation
+ * columns filled on the frames that showed one. On failure returns false and
+ * points error at a static message.
+ */
+bool overlay_write_csv(Overlay *overlay, const char *path, const char **error);
+
+#endif // PICOSCAD_OVERLAY_H_
@@ -1,11 +1,24 @@
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include <picoscad/cg/ghclipping.h>
+#include <picoscad/cg/ghclipping4d.h>
 #include <picoscad/math/mat4f.h>
 
+#include "batch.h"
+#include "evaluator.h"
+#include "job.h"
+#include "overlay.h"
+#include "scene.h"
+#include "watch.h"
+
+// Circles are made round to within this, a fraction of a pixel for models a few hundred units across
+#define VIEWER_TOLERANCE 0.01
+
 static const char* vertex_shader_text =
                 "uniform mat4 m;\n"
                 "uniform mat4 v;\n"
@@ -22,24 +35,161 @@ static const char* fragment_shader_text =
                 "}\n";
 
 
-static bool foreach(Ps4f *point, void *userdata) {
-    printf("(%g %g)\n", ps_4f_x(*point), ps_4f_y(*point));
-    return false;
+// The scene's layers, the parts the last evaluation rebuilt drawn over the model
+#define LAYER_MODEL 0
+#define LAYER_REBUILT 1
+
+// How often a watched file is checked while the window sleeps
+#define VIEWER_WATCH_SECONDS 0.1
+// Zoom per notch of the scroll wheel
+#define VIEWER_ZOOM_STEP 1.1f
+// Where the frame history goes, in the working directory
+#define VIEWER_STATS_PATH "picoscad-stats.csv"
+
+/**
+ * What the window shows beyond the model, changed by the input callbacks.
+ * Frames are only drawn when something made the picture stale, and one after
+ * another only while the model is dragged.
+ */
+typedef struct Viewer {
+    Ps4f cam_pos;
+    float zoom;
+    bool dirty;
+    bool dragging;
+    double cursor_x, cursor_y;
+    // The stats panel is shown, and its history is to be written out
+    bool stats;
+    bool dump_stats;
+} Viewer;
+
+static void viewer_resized(GLFWwindow *window, int width, int height) {
+    Viewer *viewer = glfwGetWindowUserPointer(window);
+    viewer->dirty = true;
+}
+
+static void viewer_refresh(GLFWwindow *window) {
+    Viewer *viewer = glfwGetWindowUserPointer(window);
+    viewer->dirty = true;
+}
+
+static void viewer_button(GLFWwindow *window, int button, int action, int mods) {
+    Viewer *viewer = glfwGetWindowUserPointer(window);
+    if (button == GLFW_MOUSE_BUTTON_LEFT) {
+        viewer->dragging = action == GLFW_PRESS;
+        glfwGetCursorPos(window, &viewer->cursor_x, &viewer->cursor_y);
+    }
+}
+
+// Dragging pans, the model follows the cursor
+static void viewer_cursor(GLFWwindow *window, double x, double y) {
+    Viewer *viewer = glfwGetWindowUserPointer(window);
+    if (!viewer->dragging) {
+        return;
+    }
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+    const float unit = 2.0f / ((float) (height > 0 ? height : 1) * viewer->zoom);
+    viewer->cam_pos = ps_4f_sub(viewer->cam_pos, ps_4f((float) (x - viewer->cursor_x) * unit,
+                                                   (float) (viewer->cursor_y - y) * unit, 0.0f, 0.0f));
+    viewer->cursor_x = x;
+    viewer->cursor_y = y;
+    viewer->dirty = true;
+}
+
+static void viewer_scroll(GLFWwindow *window, double x, double y) {
+    Viewer *viewer = glfwGetWindowUserPointer(window);
+    viewer->zoom *= powf(VIEWER_ZOOM_STEP, (float) y);
+    viewer->dirty = true;
+}
+
+static void viewer_key(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    Viewer *viewer = glfwGetWindowUserPointer(window);
+    // Home puts the camera back on the whole model
+    if (key == GLFW_KEY_HOME && action == GLFW_PRESS) {
+        viewer->cam_pos = ps_4f_zero();
+        viewer->zoom = 1.0f;
+        viewer->dirty = true;
+    } else if (key == GLFW_KEY_S && action == GLFW_PRESS) {
+        viewer->stats = !viewer->stats;
+        viewer->dirty = true;
+    } else if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        viewer->dump_stats = true;
+    }
 }
 
-static bool print_poly(PsGHPolygon *poly, size_t index, void *userdata) {
-    printf("polygon #%zu\n", index);
-    ps_ghpolygon_foreach(poly, foreach, NULL);
-    printf("\n");
-    return false;
+// Called on the evaluation thread, glfwPostEmptyEvent is the one call that may be made from there
+static void viewer_ready(void *userdata) {
+    glfwPostEmptyEvent();
 }
 
-static bool free_poly(PsGHPolygon *poly, size_t index, void *userdata) {
-    ps_ghpolygon_free(poly);
-    return false;
+// Sends a finished evaluation to the scene, only the outlines that changed are uploaded
+static void show(GLFWwindow *window, const char *path, const EvaluatorResult *result, Scene *scene,
+                 Overlay *overlay) {
+    if (!path) {
+        job_write(result->model, stdout);
+    }
+    const double start = glfwGetTime();
+    scene_set_layer(scene, LAYER_MODEL, result->model);
+    scene_set_layer(scene, LAYER_REBUILT, result->rebuilt);
+    overlay_set_evaluation(overlay, &(OverlayEvaluation) {
+            .read_seconds = result->read_seconds,
+            .rebuilt_seconds = result->rebuilt_seconds,
+            .upload_seconds = glfwGetTime() - start,
+            .stats = result->stats,
+    });
+    if (result->reloaded) {
+        char title[512];
+        snprintf(title, sizeof(title), "picoSCAD - %s - %zu of %zu parts rebuilt in %.1f ms", path,
+                 result->rebuilt_parts, result->part_count, result->stats.evaluate_seconds * 1e3);
+        glfwSetWindowTitle(window, title);
+    }
 }
 
 int main(int argc, char **argv) {
+    // Headless runs must not touch GLFW, it fails outright without a display
+    const char *path = NULL;
+    bool watching = false, stats = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            return batch_main(argc, argv);
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            watching = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if ((path && !job_is_scad(path)) || (watching && !path)) {
+        fprintf(stderr, "usage: %s [--watch] [--stats] [FILE.scad]\n"
+                        "       %s --headless ...\n"
+                        "Shows the 2D part of a SCAD file, or the demo triangles without one.\n"
+                        "--watch evaluates the file again each time it is saved and marks the\n"
+                        "parts that were rebuilt. Drag to pan, scroll to zoom, Home to reset.\n"
+                        "--stats shows frame and evaluation times, S toggles them and C writes\n"
+                        "the last frames' to " VIEWER_STATS_PATH ".\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+
+    Job *job;
+    const char *error;
+    if (path) {
+        job = job_new(PS_GH_UNION);
+        if (!job_read_scad(job, path, VIEWER_TOLERANCE, &error)) {
+            fprintf(stderr, "%s: %s\n", path, error);
+            job_free(job);
+            return 1;
+        }
+    } else {
+        job = job_new_demo();
+    }
+    Watch *watch = NULL;
+    if (watching && !(watch = watch_new(path, &error))) {
+        fprintf(stderr, "%s: %s\n", path, error);
+        job_free(job);
+        return 1;
+    }
 
     glfwInit();
 
@@ -53,19 +203,7 @@ int main(int argc, char **argv) {
     glClearColor(0.95f, 0.95f, 0.90f, 1.0f);
     glLineWidth(2.0f);
 
-    Ps4f verticies[3] = {
-            ps_4f(-0.6f, -0.4f, 0.0f, 1.0f),
-            ps_4f(0.6f, -0.4f, 0.0f, 1.0f),
-            ps_4f(0.0f, 0.6f, 0.0f, 1.0f),
-    };
-
-    Ps4f poly2verts[3] = {
-            ps_4f(-0.3f, -0.2f, 0.0f, 1.0f),
-            ps_4f(0.3f, -0.2f, 0.0f, 1.0f),
-            ps_4f(0.0f, 0.3f, 0.0f, 1.0f),
-    };
-
-    GLuint vertex_buffer, vertex_shader, fragment_shader, program;
+    GLuint vertex_shader, fragment_shader, program;
     GLint m_location, v_location, proj_location, pos_location, color_location;
 
     vertex_shader = glCreateShader(GL_VERTEX_SHADER);
@@ -83,27 +221,58 @@ int main(int argc, char **argv) {
     proj_location = glGetUniformLocation(program, "proj");
     color_location = glGetUniformLocation(program, "color");
     pos_location = glGetAttribLocation(program, "pos");
-
-    glGenBuffers(1, &vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verticies), verticies, GL_STATIC_DRAW);
     glEnableVertexAttribArray((GLuint)pos_location);
-    glVertexAttribPointer((GLuint)pos_location, 4, GL_FLOAT, GL_FALSE, sizeof(Ps4f), NULL);
 
-    PsGHPolygon *poly = ps_ghpolygon_new_with_points(verticies, 3);
-    PsGHPolygon *poly2 = ps_ghpolygon_new_with_points(poly2verts, 3);
+    // Evaluation runs beside the loop below, which shows each result as it lands
+    Viewer viewer = {.cam_pos = ps_4f_zero(), .zoom = 1.0f, .dirty = true, .stats = stats};
+    glfwSetWindowUserPointer(window, &viewer);
+    glfwSetFramebufferSizeCallback(window, viewer_resized);
+    glfwSetWindowRefreshCallback(window, viewer_refresh);
+    glfwSetMouseButtonCallback(window, viewer_button);
+    glfwSetCursorPosCallback(window, viewer_cursor);
+    glfwSetScrollCallback(window, viewer_scroll);
+    glfwSetKeyCallback(window, viewer_key);
 
-    PsArray OF(PsGHPolygon *) *array = ps_ghpolygon_union(poly, poly2);
-    ps_ghpolygon_free(poly);
-    ps_ghpolygon_free(poly2);
+    Evaluator *evaluator = evaluator_new(job, path, VIEWER_TOLERANCE, viewer_ready, NULL);
+    Scene *scene = scene_new(2);
+    scene_set_color(scene, LAYER_MODEL, ps_4f(0.0f, 0.0f, 0.0f, 1.0f));
+    scene_set_color(scene, LAYER_REBUILT, ps_4f(0.95f, 0.45f, 0.0f, 1.0f));
+    Overlay *overlay = overlay_new();
 
-    ps_array_foreach(array, (void *)print_poly, NULL);
-    ps_array_foreach(array, (void *)free_poly, NULL);
-
-    Ps4f color = ps_4f(0.0f, 0.0f, 0.0f, 1.0f);
-    Ps4f cam_pos = ps_4f_zero();
     Ps4f cam_angles = ps_4f_zero();
     while (!glfwWindowShouldClose(window)) {
+        // Sleep until there is something to draw, waking for the watch if there is one
+        if (viewer.dirty || viewer.dragging) {
+            glfwPollEvents();
+        } else if (watch) {
+            glfwWaitEventsTimeout(VIEWER_WATCH_SECONDS);
+        } else {
+            glfwWaitEvents();
+        }
+        const double frame_start = glfwGetTime();
+        if (viewer.dump_stats) {
+            if (overlay_write_csv(overlay, VIEWER_STATS_PATH, &error)) {
+                fprintf(stderr, "wrote %s\n", VIEWER_STATS_PATH);
+            } else {
+                fprintf(stderr, "%s: %s\n", VIEWER_STATS_PATH, error);
+            }
+            viewer.dump_stats = false;
+        }
+        if (watch && watch_wait(watch, 0)) {
+            evaluator_reload(evaluator);
+        }
+        const EvaluatorResult *result = evaluator_take(evaluator);
+        if (result) {
+            show(window, path, result, scene, overlay);
+            viewer.dirty = true;
+        }
+        // A drag draws every frame, the swap waiting for vsync paces it
+        if (!viewer.dirty && !viewer.dragging) {
+            continue;
+        }
+        viewer.dirty = false;
+        overlay_begin_frame(overlay, frame_start);
+
         int width, height;
         glfwGetFramebufferSize(window, &width, &height);
         float aspect = width / (float)height;
@@ -111,34 +280,61 @@ int main(int argc, char **argv) {
         glViewport(0, 0, width, height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        PsMat4f m, proj;
-        ps_mat4f_identity(&m);
-        ps_mat4f_ortho(&proj, -aspect, aspect, -1.0f, 1.0f, 1.0f, -1.0f);
+        // Fit the model to the window with a margin
+        const SceneBounds model = scene_get_bounds(scene, LAYER_MODEL);
+        const double extent_x = model.max_x - model.min_x, extent_y = model.max_y - model.min_y;
+        const double fit_x = extent_x > 0.0 ? 2.0 * aspect / extent_x : 1.0;
+        const double fit_y = extent_y > 0.0 ? 2.0 / extent_y : 1.0;
+        const float fit = 0.9f * (float) (fit_x < fit_y ? fit_x : fit_y);
+        PsMat4f m, fit_scale, center, proj;
+        ps_mat4f_scale(&fit_scale, fit, fit, 1.0f);
+        ps_mat4f_translation(&center, (float) (-0.5 * (model.min_x + model.max_x)),
+                             (float) (-0.5 * (model.min_y + model.max_y)), 0.0f);
+        ps_mat4f_mul(&fit_scale, &center, &m);
+        const float half = 1.0f / viewer.zoom;
+        ps_mat4f_ortho(&proj, -aspect * half, aspect * half, -half, half, 1.0f, -1.0f);
 
         PsMat4f rotx, roty, rotz;
         ps_mat4f_rot_x(&rotx, ps_4f_x(cam_angles));
         ps_mat4f_rot_y(&roty, ps_4f_y(cam_angles) - PS_MATH_TAU);
         ps_mat4f_rot_z(&rotz, ps_4f_z(cam_angles));
         PsMat4f trans;
-        ps_mat4f_translation(&trans, -ps_4f_x(cam_pos), -ps_4f_y(cam_pos), -ps_4f_z(cam_pos));
+        ps_mat4f_translation(&trans, -ps_4f_x(viewer.cam_pos), -ps_4f_y(viewer.cam_pos), -ps_4f_z(viewer.cam_pos));
 
         PsMat4f view;
         ps_mat4f_mul(&roty, &rotx, &view);
         ps_mat4f_mul(&view, &rotz, &view);
-        ps_mat4f_mul(&trans, &view, &view);
+        ps_mat4f_mul(&view, &trans, &view);
 
         glUseProgram(program);
         glUniformMatrix4fv(m_location, 1, GL_FALSE, (const GLfloat *)&m);
         glUniformMatrix4fv(v_location, 1, GL_FALSE, (const GLfloat *)&view);
         glUniformMatrix4fv(proj_location, 1, GL_FALSE, (const GLfloat *)&proj);
-        glUniform4fv(color_location, 1, (const GLfloat *)&color);
-        glDrawArrays(GL_LINE_LOOP, 0, 3);
+        scene_draw(scene, pos_location, color_location);
+
+        SceneStats scene_stats;
+        scene_get_stats(scene, &scene_stats);
+        scene_reset_stats(scene);
+        overlay_end_frame(overlay, &scene_stats);
+        if (viewer.stats) {
+            // In pixels, from the bottom left
+            PsMat4f identity, pixels;
+            ps_mat4f_identity(&identity);
+            ps_mat4f_ortho(&pixels, 0.0f, (float) width, 0.0f, (float) height, 1.0f, -1.0f);
+            glUniformMatrix4fv(m_location, 1, GL_FALSE, (const GLfloat *)&identity);
+            glUniformMatrix4fv(v_location, 1, GL_FALSE, (const GLfloat *)&identity);
+            glUniformMatrix4fv(proj_location, 1, GL_FALSE, (const GLfloat *)&pixels);
+            overlay_draw(overlay, width, height, pos_location, color_location);
+        }
 
         glfwSwapBuffers(window);
-        glfwPollEvents();
     }
 
+    overlay_free(overlay);
+    scene_free(scene);
+    watch_free(watch);
+    evaluator_free(evaluator);
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,332 @@
+#include "scene.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <picoscad/data/hash.h>
+
+// Vertices the buffer has room for at first, it doubles from there
+#define SCENE_MIN_CAPACITY 4096
+// Dirty ranges closer than this are uploaded as one, resending the gap is cheaper than another call
+#define SCENE_MERGE_GAP 256
+
+typedef struct SceneLoop {
+    uint64_t hash;
+    GLint first;
+    GLsizei count;
+} SceneLoop;
+
+typedef struct SceneRange {
+    size_t first;
+    size_t count;
+} SceneRange;
+
+typedef struct SceneLayer {
+    SceneLoop *loops;
+    size_t loop_count;
+    // The loops as glMultiDrawArrays takes them
+    GLint *firsts;
+    GLsizei *counts;
+    Ps4f color;
+    SceneBounds bounds;
+} SceneLayer;
+
+struct Scene {
+    GLuint buffer;
+    // What the buffer holds, to compare new loops against and to upload from
+    Ps4f *vertices;
+    size_t capacity;
+    // Nothing at or past end is in use
+    size_t end;
+    // Unused ranges below end, sorted and never touching
+    SceneRange *holes;
+    size_t hole_count;
+    size_t hole_capacity;
+    // Written since the last upload
+    SceneRange *dirty;
+    size_t dirty_count;
+    size_t dirty_capacity;
+    // Set when the buffer outgrew its storage, which is then sent whole
+    bool resized;
+    SceneLayer *layers;
+    size_t layer_count;
+    SceneStats stats;
+};
+
+static const SceneBounds scene_empty_bounds = {-1.0, -1.0, 1.0, 1.0};
+
+Scene *scene_new(size_t layer_count) {
+    Scene *scene = calloc(1, sizeof(Scene));
+    scene->capacity = SCENE_MIN_CAPACITY;
+    scene->vertices = aligned_alloc(_Alignof(Ps4f), sizeof(Ps4f) * scene->capacity);
+    scene->layers = calloc(layer_count, sizeof(SceneLayer));
+    scene->layer_count = layer_count;
+    for (size_t i = 0; i < layer_count; ++i) {
+        scene->layers[i].color = ps_4f(0.0f, 0.0f, 0.0f, 1.0f);
+        scene->layers[i].bounds = scene_empty_bounds;
+    }
+    glGenBuffers(1, &scene->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, scene->buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (sizeof(Ps4f) * scene->capacity), NULL, GL_DYNAMIC_DRAW);
+    return scene;
+}
+
+void scene_free(Scene *scene) {
+    glDeleteBuffers(1, &scene->buffer);
+    for (size_t i = 0; i < scene->layer_count; ++i) {
+        free(scene->layers[i].loops);
+        free(scene->layers[i].firsts);
+        free(scene->layers[i].counts);
+    }
+    free(scene->layers);
+    free(scene->holes);
+    free(scene->dirty);
+    free(scene->vertices);
+    free(scene);
+}
+
+void scene_set_color(Scene *scene, size_t layer, Ps4f color) {
+    scene->layers[layer].color = color;
+}
+
+static void scene_add_range(SceneRange **ranges, size_t *count, size_t *capacity, size_t index, SceneRange range) {
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        *ranges = realloc(*ranges, sizeof(SceneRange) * *capacity);
+    }
+    memmove(*ranges + index + 1, *ranges + index, sizeof(SceneRange) * (*count - index));
+    (*ranges)[index] = range;
+    (*count)++;
+}
+
+static void scene_remove_hole(Scene *scene, size_t index) {
+    memmove(scene->holes + index, scene->holes + index + 1, sizeof(SceneRange) * (scene->hole_count - index - 1));
+    scene->hole_count--;
+}
+
+// First fit among the holes, else off the end
+static size_t scene_allocate(Scene *scene, size_t count) {
+    for (size_t i = 0; i < scene->hole_count; ++i) {
+        SceneRange *hole = &scene->holes[i];
+        if (hole->count >= count) {
+            const size_t first = hole->first;
+            hole->first += count;
+            hole->count -= count;
+            if (!hole->count) {
+                scene_remove_hole(scene, i);
+            }
+            return first;
+        }
+    }
+    if (scene->end + count > scene->capacity) {
+        while (scene->end + count > scene->capacity) {
+            scene->capacity *= 2;
+        }
+        Ps4f *vertices = aligned_alloc(_Alignof(Ps4f), sizeof(Ps4f) * scene->capacity);
+        memcpy(vertices, scene->vertices, sizeof(Ps4f) * scene->end);
+        free(scene->vertices);
+        scene->vertices = vertices;
+        scene->resized = true;
+    }
+    const size_t first = scene->end;
+    scene->end += count;
+    return first;
+}
+
+static void scene_release(Scene *scene, size_t first, size_t count) {
+    size_t index = 0;
+    while (index < scene->hole_count && scene->holes[index].first < first) {
+        index++;
+    }
+    SceneRange range = {first, count};
+    // Merge with the holes right before and after
+    if (index > 0 && scene->holes[index - 1].first + scene->holes[index - 1].count == first) {
+        range.first = scene->holes[index - 1].first;
+        range.count += scene->holes[index - 1].count;
+        scene_remove_hole(scene, --index);
+    }
+    if (index < scene->hole_count && range.first + range.count == scene->holes[index].first) {
+        range.count += scene->holes[index].count;
+        scene_remove_hole(scene, index);
+    }
+    if (range.first + range.count == scene->end) {
+        scene->end = range.first;
+    } else {
+        scene_add_range(&scene->holes, &scene->hole_count, &scene->hole_capacity, index, range);
+    }
+}
+
+static int scene_compare_ranges(const void *lhs, const void *rhs) {
+    const SceneRange *a = lhs, *b = rhs;
+    return a->first < b->first ? -1 : a->first > b->first;
+}
+
+static int scene_compare_loops(const void *lhs, const void *rhs) {
+    const SceneLoop *a = lhs, *b = rhs;
+    return a->hash < b->hash ? -1 : a->hash > b->hash;
+}
+
+static void scene_upload(Scene *scene) {
+    glBindBuffer(GL_ARRAY_BUFFER, scene->buffer);
+    if (scene->resized) {
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (sizeof(Ps4f) * scene->capacity), NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr) (sizeof(Ps4f) * scene->end), scene->vertices);
+        scene->stats.uploaded_vertices += scene->end;
+        scene->resized = false;
+        scene->dirty_count = 0;
+        return;
+    }
+    if (scene->dirty_count) {
+        qsort(scene->dirty, scene->dirty_count, sizeof(SceneRange), scene_compare_ranges);
+    }
+    for (size_t i = 0; i < scene->dirty_count;) {
+        size_t first = scene->dirty[i].first, last = first + scene->dirty[i].count;
+        for (++i; i < scene->dirty_count && scene->dirty[i].first <= last + SCENE_MERGE_GAP; ++i) {
+            const size_t end = scene->dirty[i].first + scene->dirty[i].count;
+            last = end > last ? end : last;
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr) (sizeof(Ps4f) * first), (GLsizeiptr) (sizeof(Ps4f) * (last - first)),
+                        scene->vertices + first);
+        scene->stats.uploaded_vertices += last - first;
+    }
+    scene->dirty_count = 0;
+}
+
+typedef struct SceneStaging {
+    Ps4d *points;
+    size_t length;
+} SceneStaging;
+
+static bool scene_collect(Ps4d *point, void *userdata) {
+    SceneStaging *staging = userdata;
+    staging->points[staging->length++] = *point;
+    return false;
+}
+
+void scene_set_layer(Scene *scene, size_t layer, PsArray OF(PsGHPolygon4d *) *polygons) {
+    SceneLayer *target = &scene->layers[layer];
+    const size_t polygon_count = ps_array_get_length(polygons);
+    size_t total = 0, largest = 0;
+    for (size_t i = 0; i < polygon_count; ++i) {
+        const size_t size = ps_ghpolygon4d_get_size(ps_array_get(polygons, i));
+        total += size;
+        largest = size > largest ? size : largest;
+    }
+
+    // Every new loop in float next to each other, the ones that need a place get copied from here
+    Ps4f *staged = aligned_alloc(_Alignof(Ps4f), sizeof(Ps4f) * (total ? total : 1));
+    SceneStaging staging = {aligned_alloc(_Alignof(Ps4d), sizeof(Ps4d) * (largest ? largest : 1)), 0};
+    SceneLoop *loops = malloc(sizeof(SceneLoop) * (polygon_count ? polygon_count : 1));
+    size_t loop_count = 0, offset = 0;
+    SceneBounds bounds = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+    for (size_t i = 0; i < polygon_count; ++i) {
+        staging.length = 0;
+        ps_ghpolygon4d_foreach(ps_array_get(polygons, i), scene_collect, &staging);
+        if (!staging.length) {
+            continue;
+        }
+        ps_4d_to_4f_array(staging.points, staged + offset, staging.length);
+        for (size_t j = 0; j < staging.length; ++j) {
+            const double x = ps_4d_x(staging.points[j]), y = ps_4d_y(staging.points[j]);
+            bounds.min_x = x < bounds.min_x ? x : bounds.min_x;
+            bounds.max_x = x > bounds.max_x ? x : bounds.max_x;
+            bounds.min_y = y < bounds.min_y ? y : bounds.min_y;
+            bounds.max_y = y > bounds.max_y ? y : bounds.max_y;
+        }
+        // first holds the offset in staged until the loop has a place
+        loops[loop_count++] = (SceneLoop) {ps_hash64(staged + offset, sizeof(Ps4f) * staging.length, 0),
+                                           (GLint) offset, (GLsizei) staging.length};
+        offset += staging.length;
+    }
+    free(staging.points);
+
+    // Each loop the layer had can stay for one new loop with the same vertices
+    if (target->loop_count) {
+        qsort(target->loops, target->loop_count, sizeof(SceneLoop), scene_compare_loops);
+    }
+    bool *kept = calloc(target->loop_count ? target->loop_count : 1, sizeof(bool));
+    bool *placed = calloc(loop_count ? loop_count : 1, sizeof(bool));
+    for (size_t i = 0; i < loop_count; ++i) {
+        size_t low = 0, high = target->loop_count;
+        while (low < high) {
+            const size_t middle = (low + high) / 2;
+            if (target->loops[middle].hash < loops[i].hash) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        for (size_t j = low; j < target->loop_count && target->loops[j].hash == loops[i].hash; ++j) {
+            const SceneLoop *old = &target->loops[j];
+            if (!kept[j] && old->count == loops[i].count &&
+                memcmp(scene->vertices + old->first, staged + loops[i].first, sizeof(Ps4f) * old->count) == 0) {
+                kept[j] = placed[i] = true;
+                loops[i].first = old->first;
+                break;
+            }
+        }
+    }
+    // Freed first so the new loops can move into the room
+    for (size_t j = 0; j < target->loop_count; ++j) {
+        if (!kept[j]) {
+            scene_release(scene, (size_t) target->loops[j].first, (size_t) target->loops[j].count);
+        }
+    }
+    for (size_t i = 0; i < loop_count; ++i) {
+        if (!placed[i]) {
+            const size_t first = scene_allocate(scene, (size_t) loops[i].count);
+            memcpy(scene->vertices + first, staged + loops[i].first, sizeof(Ps4f) * (size_t) loops[i].count);
+            scene_add_range(&scene->dirty, &scene->dirty_count, &scene->dirty_capacity, scene->dirty_count,
+                            (SceneRange) {first, (size_t) loops[i].count});
+            loops[i].first = (GLint) first;
+        }
+    }
+    free(kept);
+    free(placed);
+    free(staged);
+
+    free(target->loops);
+    target->loops = loops;
+    target->loop_count = loop_count;
+    target->firsts = realloc(target->firsts, sizeof(GLint) * (loop_count ? loop_count : 1));
+    target->counts = realloc(target->counts, sizeof(GLsizei) * (loop_count ? loop_count : 1));
+    for (size_t i = 0; i < loop_count; ++i) {
+        target->firsts[i] = loops[i].first;
+        target->counts[i] = loops[i].count;
+    }
+    target->bounds = loop_count ? bounds : scene_empty_bounds;
+    scene_upload(scene);
+}
+
+SceneBounds scene_get_bounds(const Scene *scene, size_t layer) {
+    return scene->layers[layer].bounds;
+}
+
+void scene_draw(Scene *scene, GLint pos_location, GLint color_location) {
+    glBindBuffer(GL_ARRAY_BUFFER, scene->buffer);
+    glVertexAttribPointer((GLuint) pos_location, 4, GL_FLOAT, GL_FALSE, sizeof(Ps4f), NULL);
+    for (size_t i = 0; i < scene->layer_count; ++i) {
+        const SceneLayer *layer = &scene->layers[i];
+        if (layer->loop_count) {
+            glUniform4fv(color_location, 1, (const GLfloat *) &layer->color);
+            glMultiDrawArrays(GL_LINE_LOOP, layer->firsts, layer->counts, (GLsizei) layer->loop_count);
+            scene->stats.draw_calls++;
+        }
+    }
+}
+
+void scene_get_stats(const Scene *scene, SceneStats *stats) {
+    *stats = scene->stats;
+    stats->loop_count = stats->vertex_count = 0;
+    for (size_t i = 0; i < scene->layer_count; ++i) {
+        stats->loop_count += scene->layers[i].loop_count;
+        for (size_t j = 0; j < scene->layers[i].loop_count; ++j) {
+            stats->vertex_count += (size_t) scene->layers[i].counts[j];
+        }
+    }
+}
+
+void scene_reset_stats(Scene *scene) {
+    scene->stats.uploaded_vertices = scene->stats.draw_calls = 0;
+}
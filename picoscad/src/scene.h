@@ -0,0 +1,64 @@
+#ifndef PICOSCAD_SCENE_H_
+#define PICOSCAD_SCENE_H_
+
+#include <GL/glew.h>
+
+#include <picoscad/cg/ghclipping4d.h>
+#include <picoscad/data/array.h>
+#include <picoscad/math/4f.h>
+
+/**
+ * Polygon outlines kept in one vertex buffer for the life of the window, in
+ * layers drawn one over the other in their own color. Setting a layer keeps
+ * every loop it already had in place, so after an edit only the loops that
+ * came out different are uploaded, as the few ranges they landed in. Each
+ * layer is drawn with a single glMultiDrawArrays of line loops.
+ */
+typedef struct Scene Scene;
+
+typedef struct SceneBounds {
+    double min_x, min_y, max_x, max_y;
+} SceneBounds;
+
+typedef struct SceneStats {
+    /**
+     * Vertices sent to the buffer and draw calls made since the last
+     * scene_reset_stats
+     */
+    size_t uploaded_vertices;
+    size_t draw_calls;
+    /**
+     * What the layers hold now
+     */
+    size_t loop_count;
+    size_t vertex_count;
+} SceneStats;
+
+/**
+ * Needs the GL context current, as every call here does
+ */
+Scene *scene_new(size_t layer_count);
+void scene_free(Scene *scene);
+
+void scene_set_color(Scene *scene, size_t layer, Ps4f color);
+
+/**
+ * Makes layer the outlines of polygons, which stay the caller's
+ */
+void scene_set_layer(Scene *scene, size_t layer, PsArray OF(PsGHPolygon4d *) *polygons);
+
+/**
+ * The extent of layer, -1 to 1 both ways while it is empty
+ */
+SceneBounds scene_get_bounds(const Scene *scene, size_t layer);
+
+/**
+ * Draws the layers in order with the bound program, whose pos attribute and
+ * color uniform are at the given locations
+ */
+void scene_draw(Scene *scene, GLint pos_location, GLint color_location);
+
+void scene_get_stats(const Scene *scene, SceneStats *stats);
+void scene_reset_stats(Scene *scene);
+
+#endif // PICOSCAD_SCENE_H_
@@ -0,0 +1,112 @@
+#include "watch.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+
+// Quiet time that ends a burst of events, long enough for an editor to finish saving
+#define WATCH_SETTLE_MS 30
+
+struct Watch {
+    int fd;
+    // The file's name in the watched directory
+    char *name;
+};
+
+Watch *watch_new(const char *path, const char **error) {
+    const char *slash = strrchr(path, '/');
+    const char *name = slash ? slash + 1 : path;
+    if (!*name) {
+        *error = "not a file";
+        return NULL;
+    }
+    char *directory = slash ? strndup(path, slash == path ? 1 : (size_t) (slash - path)) : strdup(".");
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        free(directory);
+        *error = "cannot watch files";
+        return NULL;
+    }
+    // Writes in place end with a close, saves by rename with a move
+    const bool ok = inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) >= 0;
+    free(directory);
+    if (!ok) {
+        close(fd);
+        *error = "cannot watch the file's directory";
+        return NULL;
+    }
+    Watch *watch = malloc(sizeof(Watch));
+    watch->fd = fd;
+    watch->name = strdup(name);
+    return watch;
+}
+
+void watch_free(Watch *watch) {
+    if (watch) {
+        close(watch->fd);
+        free(watch->name);
+        free(watch);
+    }
+}
+
+// Reads the queued events, true if one was about the file
+static bool watch_drain(Watch *watch) {
+    alignas(struct inotify_event) char buffer[4096];
+    bool saved = false;
+    ssize_t length;
+    while ((length = read(watch->fd, buffer, sizeof(buffer))) > 0) {
+        for (const char *p = buffer; p < buffer + length;) {
+            const struct inotify_event *event = (const struct inotify_event *) p;
+            // After an overflow anything may have happened
+            if ((event->mask & IN_Q_OVERFLOW) || (event->len && strcmp(event->name, watch->name) == 0)) {
+                saved = true;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return saved;
+}
+
+static bool watch_poll(const Watch *watch, int timeout_ms) {
+    struct pollfd pollfd = {watch->fd, POLLIN, 0};
+    int ready;
+    while ((ready = poll(&pollfd, 1, timeout_ms)) < 0 && errno == EINTR) {
+    }
+    return ready > 0;
+}
+
+static long long watch_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+bool watch_wait(Watch *watch, int timeout_ms) {
+    // Other files in the directory wake us up too, they use up the timeout without ending the wait
+    const long long deadline = watch_now_ms() + timeout_ms;
+    for (;;) {
+        int remaining = timeout_ms;
+        if (timeout_ms > 0) {
+            const long long left = deadline - watch_now_ms();
+            remaining = left > 0 ? (int) left : 0;
+        }
+        if (!watch_poll(watch, remaining)) {
+            return false;
+        }
+        if (watch_drain(watch)) {
+            break;
+        }
+        if (timeout_ms == 0) {
+            return false;
+        }
+    }
+    while (watch_poll(watch, WATCH_SETTLE_MS)) {
+        watch_drain(watch);
+    }
+    return true;
+}
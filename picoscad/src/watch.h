@@ -0,0 +1,26 @@
+#ifndef PICOSCAD_WATCH_H_
+#define PICOSCAD_WATCH_H_
+
+#include <stdbool.h>
+
+/**
+ * Notices when a file is saved. Its directory is watched rather than the file
+ * itself, since editors often save by writing a new file and renaming it over
+ * the old one, which a watch on the old file would never see.
+ */
+typedef struct Watch Watch;
+
+/**
+ * On failure returns NULL and points error at a static message
+ */
+Watch *watch_new(const char *path, const char **error);
+void watch_free(Watch *watch);
+
+/**
+ * Waits up to timeout_ms (-1 for ever, 0 to just check) for the file to be
+ * saved and returns whether it was. A save usually arrives as a burst of
+ * events, so once one comes this waits for the burst to end.
+ */
+bool watch_wait(Watch *watch, int timeout_ms);
+
+#endif // PICOSCAD_WATCH_H_
@@ -0,0 +1,26 @@
+#ifndef PICOSCAD_TEST_H_
+#define PICOSCAD_TEST_H_
+
+#include <stdio.h>
+
+/*
+ * Checks report where they failed and carry on, main returns test_failures so
+ * one run shows every failure
+ */
+static int test_failures;
+
+/*
+ * Returned by a test that can't run here, such as one built for an instruction
+ * set the CPU lacks; ctest reports it as skipped
+ */
+#define TEST_SKIP 77
+
+#define TEST_CHECK(condition)                                                          \
+    do {                                                                               \
+        if (!(condition)) {                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                           \
+        }                                                                              \
+    } while (0)
+
+#endif // PICOSCAD_TEST_H_
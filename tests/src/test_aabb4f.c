@@ -0,0 +1,64 @@
+#include <picoscad/math/aabb4f.h>
+#include <picoscad/sys/cpu.h>
+
+#include "test.h"
+
+static PsAabb4f unit_box(float x) {
+    return ps_aabb4f(ps_4f(x, 0.0f, 0.0f, 0.0f), ps_4f(x + 1.0f, 1.0f, 1.0f, 0.0f));
+}
+
+static void test_single() {
+    const PsRay4f along_x = ps_ray4f(ps_4f(-5.0f, 0.5f, 0.5f, 1.0f), ps_4f(1.0f, 0.0f, 0.0f, 0.0f), 0.0f, INFINITY);
+    const PsRay4f diagonal = ps_ray4f(ps_4f(-1.0f, -1.0f, -1.0f, 1.0f), ps_4f(1.0f, 1.0f, 1.0f, 0.0f), 0.0f, INFINITY);
+    const PsAabb4f box = unit_box(0.0f);
+    float t_near = -1.0f;
+    TEST_CHECK(ps_aabb4f_ray_intersect(&box, &along_x, &t_near));
+    TEST_CHECK(t_near == 5.0f);
+    TEST_CHECK(ps_aabb4f_ray_intersect(&box, &diagonal, NULL));
+
+    const PsAabb4f behind = unit_box(-10.0f);
+    TEST_CHECK(!ps_aabb4f_ray_intersect(&behind, &along_x, NULL));
+
+    const PsAabb4f empty = ps_aabb4f_empty();
+    TEST_CHECK(ps_aabb4f_is_empty(&empty));
+    TEST_CHECK(!ps_aabb4f_ray_intersect(&empty, &along_x, NULL));
+    TEST_CHECK(!ps_aabb4f_ray_intersect(&empty, &diagonal, NULL));
+
+    // Inverted in one axis only, as an intersection of disjoint boxes is
+    const PsAabb4f a = unit_box(0.0f), b = unit_box(3.0f);
+    const PsAabb4f disjoint = ps_aabb4f_intersection(&a, &b);
+    TEST_CHECK(ps_aabb4f_is_empty(&disjoint));
+    TEST_CHECK(!ps_aabb4f_ray_intersect(&disjoint, &along_x, NULL));
+}
+
+static void test_packet() {
+    const PsRay4f along_x = ps_ray4f(ps_4f(-5.0f, 0.5f, 0.5f, 1.0f), ps_4f(1.0f, 0.0f, 0.0f, 0.0f), 0.0f, INFINITY);
+    // A node with three children, the last lane padded with an empty box
+    const PsAabb4f boxes[4] = {unit_box(0.0f), unit_box(-10.0f), unit_box(4.0f), ps_aabb4f_empty()};
+    const PsAabbPacket4f packet = ps_aabb_packet4f(boxes);
+    Ps4f t_near;
+    const int mask = ps_aabb_packet4f_ray_intersect(&packet, &along_x, &t_near);
+    TEST_CHECK(mask == 0x5);
+    TEST_CHECK(ps_4f_x(t_near) == 5.0f);
+    TEST_CHECK(ps_4f_z(t_near) == 9.0f);
+
+    // The packet agrees with testing the boxes one by one
+    for (size_t i = 0; i < 4; ++i) {
+        TEST_CHECK(ps_aabb4f_ray_intersect(&boxes[i], &along_x, NULL) == ((mask >> i) & 1));
+    }
+
+    const PsAabb4f all_empty[4] = {ps_aabb4f_empty(), ps_aabb4f_empty(), ps_aabb4f_empty(), ps_aabb4f_empty()};
+    const PsAabbPacket4f empty_packet = ps_aabb_packet4f(all_empty);
+    TEST_CHECK(ps_aabb_packet4f_ray_intersect(&empty_packet, &along_x, NULL) == 0);
+}
+
+int main() {
+#ifdef TEST_MATH_ISA
+    if (ps_cpu_detect_isa() < TEST_MATH_ISA) {
+        return TEST_SKIP;
+    }
+#endif
+    test_single();
+    test_packet();
+    return test_failures;
+}
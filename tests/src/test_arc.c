@@ -0,0 +1,103 @@
+#include <float.h>
+#include <math.h>
+
+#include <picoscad/cg/arc.h>
+#include <picoscad/sys/cpu.h>
+
+#include "kernel/kernels.h"
+#include "test.h"
+
+#define TAU 6.283185307179586
+
+static void test_segments() {
+    // The clamp: no tolerance, a tiny one, a huge radius
+    TEST_CHECK(ps_arc_segments(1.0, TAU, 0.0) == PS_ARC_MAX_SEGMENTS);
+    TEST_CHECK(ps_arc_segments(1.0, TAU, 1e-12) == PS_ARC_MAX_SEGMENTS);
+    TEST_CHECK(ps_arc_segments(1e9, TAU, 1e-3) == PS_ARC_MAX_SEGMENTS);
+    TEST_CHECK(ps_arc_segments(-1e9, -TAU, 1e-3) == PS_ARC_MAX_SEGMENTS);
+    // Just under it, a tolerance made for 4000 chords
+    const size_t under = ps_arc_segments(1.0, TAU, 1.0 - cos(TAU / 4000.0 / 2.0));
+    TEST_CHECK(under >= 4000 && under <= 4001);
+
+    // The minimum of one chord per third of a turn, whether the tolerance is loose or swallows the circle
+    const double tolerances[] = {0.5, 0.9, 0.999999, 1.0, 10.0, INFINITY, NAN};
+    for (size_t i = 0; i < sizeof(tolerances) / sizeof(tolerances[0]); ++i) {
+        TEST_CHECK(ps_arc_segments(1.0, TAU, tolerances[i]) == 3);
+        TEST_CHECK(ps_arc_segments(1.0, -TAU, tolerances[i]) == 3);
+        TEST_CHECK(ps_arc_segments(1.0, TAU / 2.0, tolerances[i]) == 2);
+        TEST_CHECK(ps_arc_segments(1.0, TAU / 3.0, tolerances[i]) == 1);
+        TEST_CHECK(ps_arc_segments(1.0, TAU * 0.9, tolerances[i]) == 3);
+        TEST_CHECK(ps_arc_segments(1.0, 0.0, tolerances[i]) == 1);
+    }
+    // Chords end up no further than tolerance from the arc, until the clamp
+    for (double tolerance = 0.3; tolerance > 1e-5; tolerance /= 3.0) {
+        const size_t segments = ps_arc_segments(10.0, TAU, tolerance);
+        TEST_CHECK(10.0 * (1.0 - cos(TAU / (double) segments / 2.0)) <= tolerance * (1.0 + 1e-12));
+    }
+}
+
+// Worst distance of any point from the exact ellipse point, in ulps of the ellipse's extent
+static double ellipse_error(const PsKernels *kernels, const PsKernelEllipse *ellipse, size_t count) {
+    Ps4d *points = aligned_alloc(_Alignof(Ps4d), sizeof(Ps4d) * count);
+    kernels->ellipse_points4d(ellipse, count, points);
+    const double *values = (const double *) points;
+    const double extent = fabs(ellipse->cx) + fabs(ellipse->cy) + fabs(ellipse->ax) + fabs(ellipse->ay) +
+                          fabs(ellipse->bx) + fabs(ellipse->by);
+    double worst = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        const double angle = ellipse->start + (double) i * ellipse->step;
+        const double x = ellipse->cx + ellipse->ax * cos(angle) + ellipse->bx * sin(angle);
+        const double y = ellipse->cy + ellipse->ay * cos(angle) + ellipse->by * sin(angle);
+        const double error = fmax(fabs(values[i * 4] - x), fabs(values[i * 4 + 1] - y)) / (extent * DBL_EPSILON);
+        worst = fmax(worst, error);
+        if (values[i * 4 + 2] != 0.0 || values[i * 4 + 3] != 1.0) {
+            worst = INFINITY;
+        }
+    }
+    free(points);
+    return worst;
+}
+
+static void test_drift() {
+    const PsKernels *variants[3] = {&ps_kernels_generic};
+    size_t variant_count = 1;
+#if defined(__x86_64__) || defined(__i386__)
+    const PsCpuIsa isa = ps_cpu_detect_isa();
+    if (isa >= PS_CPU_ISA_AVX) {
+        variants[variant_count++] = &ps_kernels_avx;
+    }
+    if (isa >= PS_CPU_ISA_AVX2) {
+        variants[variant_count++] = &ps_kernels_avx2;
+    }
+#endif
+    // Runs of many 64 point blocks, with tails that don't fill a block or a register
+    const size_t counts[] = {3, 64, 65, 67, 1001, PS_ARC_MAX_SEGMENTS};
+    const double rotation = 0.3;
+    const PsKernelEllipse ellipses[] = {
+            {5.0, -7.0, 1000.0, 0.0, 0.0, 1000.0, 0.0, 0.0},
+            {0.0, 0.0, 3.0 * cos(rotation), 3.0 * sin(rotation), -sin(rotation), cos(rotation), 1.0, 0.0},
+            {1e3, 1e3, 1.0, 0.0, 0.0, 1.0, -2.0, 0.0},
+    };
+    for (size_t e = 0; e < sizeof(ellipses) / sizeof(ellipses[0]); ++e) {
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+            PsKernelEllipse ellipse = ellipses[e];
+            ellipse.step = (e == 2 ? -TAU : TAU) / (double) counts[c];
+            // The four lane recurrence turns by four steps at a time, it must drift no more than the generic one
+            const double generic_error = ellipse_error(variants[0], &ellipse, counts[c]);
+            for (size_t v = 0; v < variant_count; ++v) {
+                const double error = ellipse_error(variants[v], &ellipse, counts[c]);
+                if (!(error <= 12.0 && error <= generic_error + 2.0)) {
+                    fprintf(stderr, "variant %zu, ellipse %zu, %zu points: %.1f ulps off, generic %.1f\n", v, e,
+                            counts[c], error, generic_error);
+                    test_failures++;
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    test_segments();
+    test_drift();
+    return test_failures;
+}
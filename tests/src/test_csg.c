@@ -0,0 +1,189 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <picoscad/cg/csg.h>
+
+#include "test.h"
+
+static PsCsgNode square(PsCsg *csg, double x, double y, double size) {
+    const Ps4d points[4] = {
+            ps_4d(x, y, 0.0, 1.0), ps_4d(x + size, y, 0.0, 1.0), ps_4d(x + size, y + size, 0.0, 1.0),
+            ps_4d(x, y + size, 0.0, 1.0)
+    };
+    return ps_csg_polygon(csg, points, 4);
+}
+
+static PsCsgNode rotate(PsCsg *csg, double angle, PsCsgNode child) {
+    const double c = cos(angle), s = sin(angle);
+    const PsMat4d m4d = {
+            ps_4d(c, s, 0.0, 0.0), ps_4d(-s, c, 0.0, 0.0), ps_4d(0.0, 0.0, 1.0, 0.0), ps_4d(0.0, 0.0, 0.0, 1.0)
+    };
+    return ps_csg_transform(csg, &m4d, child);
+}
+
+static PsCsgNode translate(PsCsg *csg, double x, double y, PsCsgNode child) {
+    const PsMat4d m4d = {
+            ps_4d(1.0, 0.0, 0.0, 0.0), ps_4d(0.0, 1.0, 0.0, 0.0), ps_4d(0.0, 0.0, 1.0, 0.0), ps_4d(x, y, 0.0, 1.0)
+    };
+    return ps_csg_transform(csg, &m4d, child);
+}
+
+static void free_polygons(PsArray *polygons) {
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        ps_ghpolygon4d_free(ps_array_get(polygons, i));
+    }
+    ps_array_free(polygons);
+}
+
+static bool collect_point(Ps4d *point, void *userdata) {
+    PsArray *points = userdata;
+    double *copy = malloc(sizeof(double) * 2);
+    copy[0] = ps_4d_x(*point);
+    copy[1] = ps_4d_y(*point);
+    ps_array_add(points, copy);
+    return false;
+}
+
+// Same polygons in the same order with bit for bit the same points
+static bool same_polygons(PsArray *a, PsArray *b) {
+    if (!a || !b || ps_array_get_length(a) != ps_array_get_length(b)) {
+        return false;
+    }
+    bool same = true;
+    for (size_t i = 0; same && i < ps_array_get_length(a); ++i) {
+        PsArray *points_a = ps_array_new(16), *points_b = ps_array_new(16);
+        ps_ghpolygon4d_foreach(ps_array_get(a, i), collect_point, points_a);
+        ps_ghpolygon4d_foreach(ps_array_get(b, i), collect_point, points_b);
+        same = ps_array_get_length(points_a) == ps_array_get_length(points_b);
+        for (size_t j = 0; j < ps_array_get_length(points_a); ++j) {
+            same = same && memcmp(ps_array_get(points_a, j), ps_array_get(points_b, j), sizeof(double) * 2) == 0;
+            free(ps_array_get(points_a, j));
+        }
+        for (size_t j = 0; j < ps_array_get_length(points_b); ++j) {
+            free(ps_array_get(points_b, j));
+        }
+        ps_array_free(points_a);
+        ps_array_free(points_b);
+    }
+    return same;
+}
+
+static void test_hash_consing() {
+    PsCsg *csg = ps_csg_new();
+    const PsCsgNode a = square(csg, 0.0, 0.0, 2.0), b = square(csg, 1.0, 1.0, 2.0);
+    const PsCsgNode op = ps_csg_operation(csg, PS_GH_UNION, a, b);
+    const size_t count = ps_csg_get_node_count(csg);
+    // Built again from scratch, every node is found rather than added
+    const PsCsgNode again = ps_csg_operation(csg, PS_GH_UNION, square(csg, 0.0, 0.0, 2.0), square(csg, 1.0, 1.0, 2.0));
+    TEST_CHECK(again == op);
+    TEST_CHECK(ps_csg_get_node_count(csg) == count);
+    TEST_CHECK(ps_csg_get_hash(csg, again) == ps_csg_get_hash(csg, op));
+    TEST_CHECK(ps_csg_operation(csg, PS_GH_DIFF, a, b) != op);
+    // Nested transforms collapse, so both spellings are one node
+    TEST_CHECK(translate(csg, 1.0, 2.0, translate(csg, 3.0, 4.0, op)) == translate(csg, 4.0, 6.0, op));
+
+    // The shared operation is clipped once, its second use comes from the cache
+    const PsCsgNode root = ps_csg_operation(csg, PS_GH_UNION, op,
+                                            ps_csg_operation(csg, PS_GH_INTERSECT, again, square(csg, 0.0, 0.0, 1.5)));
+    PsCsgCache *cache = ps_csg_cache_new(1 << 20);
+    PsCsgStats stats;
+    PsArray *result = ps_csg_evaluate(csg, root, cache, &stats);
+    TEST_CHECK(stats.evaluated == 3 && stats.reused == 1);
+    free_polygons(result);
+    ps_csg_cache_free(cache);
+    ps_csg_free(csg);
+}
+
+static bool evaluated_from_cache(PsCsg *csg, PsCsgNode node, PsCsgCache *cache) {
+    PsCsgStats stats;
+    free_polygons(ps_csg_evaluate(csg, node, cache, &stats));
+    return stats.reused == 1 && stats.evaluated == 0;
+}
+
+static void test_lru() {
+    PsCsg *csg = ps_csg_new();
+    PsCsgNode ops[3];
+    for (size_t i = 0; i < 3; ++i) {
+        const double x = 10.0 * (double) i;
+        ops[i] = ps_csg_operation(csg, PS_GH_UNION, square(csg, x, 0.0, 2.0), square(csg, x + 1.0, 1.0, 2.0));
+    }
+    // The three results are the same shape, so the same size: measure one and leave room for two
+    PsCsgCache *probe = ps_csg_cache_new(1 << 20);
+    free_polygons(ps_csg_evaluate(csg, ops[0], probe, NULL));
+    PsCsgCacheStats stats;
+    ps_csg_cache_get_stats(probe, &stats);
+    ps_csg_cache_free(probe);
+    PsCsgCache *cache = ps_csg_cache_new(stats.bytes * 5 / 2);
+
+    TEST_CHECK(!evaluated_from_cache(csg, ops[0], cache));
+    TEST_CHECK(!evaluated_from_cache(csg, ops[1], cache));
+    // Using 0 again makes 1 the least recently used, so 2 evicts it
+    TEST_CHECK(evaluated_from_cache(csg, ops[0], cache));
+    TEST_CHECK(!evaluated_from_cache(csg, ops[2], cache));
+    ps_csg_cache_get_stats(cache, &stats);
+    TEST_CHECK(stats.entries == 2 && stats.evictions == 1);
+    TEST_CHECK(evaluated_from_cache(csg, ops[0], cache));
+    TEST_CHECK(evaluated_from_cache(csg, ops[2], cache));
+    TEST_CHECK(!evaluated_from_cache(csg, ops[1], cache));
+    ps_csg_cache_free(cache);
+    ps_csg_free(csg);
+}
+
+// Overlapping rotated squares unioned, with holes cut and an intersection on top
+static PsCsgNode build_model(PsCsg *csg) {
+    PsCsgNode parts[12];
+    for (size_t i = 0; i < 12; ++i) {
+        parts[i] = translate(csg, 3.0 * (double) i, 0.0, rotate(csg, 0.1 * (double) i, square(csg, 0.0, 0.0, 4.0)));
+    }
+    const PsCsgNode body = ps_csg_fold(csg, PS_GH_UNION, parts, 12);
+    PsCsgNode cuts[4] = {body};
+    for (size_t i = 1; i < 4; ++i) {
+        cuts[i] = square(csg, 9.0 * (double) i, 1.0, 1.0);
+    }
+    const PsCsgNode holed = ps_csg_fold(csg, PS_GH_DIFF, cuts, 4);
+    return ps_csg_operation(csg, PS_GH_INTERSECT, holed, square(csg, -5.0, -5.0, 30.0));
+}
+
+static void test_parallel() {
+    PsCsg *csg = ps_csg_new();
+    const PsCsgNode root = build_model(csg);
+    PsArray *expected = ps_csg_evaluate(csg, root, NULL, NULL);
+    TEST_CHECK(expected && ps_array_get_length(expected) > 0);
+    // 64 threads is more than there are nodes
+    const size_t threads[] = {1, 2, 3, 64};
+    const size_t max_lives[] = {0, 1, 2};
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+        for (size_t m = 0; m < sizeof(max_lives) / sizeof(max_lives[0]); ++m) {
+            PsCsgStats stats;
+            PsArray *result = ps_csg_evaluate_parallel(csg, root, NULL, threads[t], max_lives[m], &stats);
+            if (!same_polygons(expected, result)) {
+                fprintf(stderr, "%zu threads, max_live %zu: differs from ps_csg_evaluate\n", threads[t],
+                        max_lives[m]);
+                test_failures++;
+            }
+            if (result) {
+                free_polygons(result);
+            }
+        }
+    }
+    // With a cache, cold and then warm
+    PsCsgCache *cache = ps_csg_cache_new(1 << 24);
+    for (size_t pass = 0; pass < 2; ++pass) {
+        PsArray *result = ps_csg_evaluate_parallel(csg, root, cache, 4, 1, NULL);
+        TEST_CHECK(same_polygons(expected, result));
+        if (result) {
+            free_polygons(result);
+        }
+    }
+    ps_csg_cache_free(cache);
+    free_polygons(expected);
+    ps_csg_free(csg);
+}
+
+int main() {
+    test_hash_consing();
+    test_lru();
+    test_parallel();
+    return test_failures;
+}
@@ -0,0 +1,77 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <picoscad/cg/ghclipping4d.h>
+#include <picoscad/io/diskcache.h>
+
+#include "test.h"
+
+#define KEY UINT64_C(0x1234)
+
+static void free_polygons(PsArray *polygons) {
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        ps_ghpolygon4d_free(ps_array_get(polygons, i));
+    }
+    ps_array_free(polygons);
+}
+
+int main() {
+    char directory[] = "/tmp/test_diskcache_XXXXXX";
+    TEST_CHECK(mkdtemp(directory) != NULL);
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%016llx.psgeo", directory, (unsigned long long) KEY);
+    const char *error;
+    PsDiskCache *cache = ps_disk_cache_open(directory, UINT64_C(1) << 20, &error);
+    TEST_CHECK(cache != NULL);
+    if (!cache) {
+        return test_failures;
+    }
+    Ps4d points[3] = {ps_4d(0.0, 0.0, 0.0, 1.0), ps_4d(1.0, 0.0, 0.0, 1.0), ps_4d(0.0, 1.0, 0.0, 1.0)};
+    PsArray *polygons = ps_array_new(1);
+    ps_array_add(polygons, ps_ghpolygon4d_new_with_points(points, 3));
+    TEST_CHECK(ps_disk_cache_store(cache, KEY, polygons));
+    free_polygons(polygons);
+
+    // With no descriptor left the file can't be opened, which says nothing about what is in it
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    const int next = open("/dev/null", O_RDONLY);
+    close(next);
+    const struct rlimit exhausted = {(rlim_t) next, limit.rlim_max};
+    setrlimit(RLIMIT_NOFILE, &exhausted);
+    polygons = ps_disk_cache_load(cache, KEY);
+    setrlimit(RLIMIT_NOFILE, &limit);
+    TEST_CHECK(polygons == NULL);
+    TEST_CHECK(access(path, F_OK) == 0);
+    PsDiskCacheStats stats;
+    ps_disk_cache_get_stats(cache, &stats);
+    TEST_CHECK(stats.misses == 1 && stats.corrupt == 0);
+
+    polygons = ps_disk_cache_load(cache, KEY);
+    TEST_CHECK(polygons != NULL && ps_array_get_length(polygons) == 1);
+    if (polygons) {
+        free_polygons(polygons);
+    }
+
+    // The vertices start right after the 64 byte header, damaging them fails the hash check
+    FILE *file = fopen(path, "r+b");
+    TEST_CHECK(file != NULL);
+    if (file) {
+        fseek(file, 64, SEEK_SET);
+        fputc(0x55, file);
+        fclose(file);
+    }
+    TEST_CHECK(ps_disk_cache_load(cache, KEY) == NULL);
+    TEST_CHECK(access(path, F_OK) != 0);
+    ps_disk_cache_get_stats(cache, &stats);
+    TEST_CHECK(stats.hits == 1 && stats.misses == 2 && stats.corrupt == 1);
+
+    ps_disk_cache_close(cache);
+    snprintf(path, sizeof(path), "%s/lock", directory);
+    unlink(path);
+    rmdir(directory);
+    return test_failures;
+}
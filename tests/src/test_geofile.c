@@ -0,0 +1,204 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <picoscad/io/geofile.h>
+
+#include "test.h"
+
+// Header fields, see GeofileHeader in geofile.c
+#define HEADER_SIZE 64
+#define TOC_HASH_OFFSET 40
+
+static void free_polygons(PsArray *polygons) {
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        ps_ghpolygon4d_free(ps_array_get(polygons, i));
+    }
+    ps_array_free(polygons);
+}
+
+static bool collect_point(Ps4d *point, void *userdata) {
+    double **cursor = userdata;
+    *(*cursor)++ = ps_4d_x(*point);
+    *(*cursor)++ = ps_4d_y(*point);
+    return false;
+}
+
+// The x, y of every point of every polygon back to back, which is what the file round trips
+static size_t flatten_polygons(PsArray *polygons, double *out) {
+    double *cursor = out;
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        ps_ghpolygon4d_foreach(ps_array_get(polygons, i), collect_point, &cursor);
+    }
+    return (size_t) (cursor - out);
+}
+
+static unsigned char *read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *size = (size_t) ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *data = malloc(*size);
+    *size = fread(data, 1, *size, file);
+    fclose(file);
+    return data;
+}
+
+static void write_file(const char *path, const unsigned char *data, size_t size) {
+    FILE *file = fopen(path, "wb");
+    TEST_CHECK(file && fwrite(data, 1, size, file) == size);
+    fclose(file);
+}
+
+static bool open_fails(const char *path, const char *message) {
+    const char *error = NULL;
+    PsGeofile *file = ps_geofile_open(path, &error);
+    if (file) {
+        ps_geofile_close(file);
+        return false;
+    }
+    if (strcmp(error, message) != 0) {
+        fprintf(stderr, "%s: expected \"%s\", got \"%s\"\n", path, message, error);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    char directory[] = "/tmp/test_geofile_XXXXXX";
+    TEST_CHECK(mkdtemp(directory) != NULL);
+    char path[256], corrupt[256];
+    snprintf(path, sizeof(path), "%s/model.psgeo", directory);
+    snprintf(corrupt, sizeof(corrupt), "%s/corrupt.psgeo", directory);
+
+    // Key 1: double polygons, key 2: float polygons through the raw entry, key 3: an indexed mesh
+    Ps4d square[4] = {ps_4d(0.0, 0.0, 0.0, 1.0), ps_4d(1.0, 0.0, 0.0, 1.0), ps_4d(1.0, 1.0, 0.0, 1.0),
+                      ps_4d(0.0, 1.0, 0.0, 1.0)};
+    Ps4d triangle[3] = {ps_4d(0.1, 0.2, 0.0, 1.0), ps_4d(3.0, 0.25, 0.0, 1.0), ps_4d(1.0, 1e9, 0.0, 1.0)};
+    PsArray *polygons = ps_array_new(2);
+    ps_array_add(polygons, ps_ghpolygon4d_new_with_points(square, 4));
+    ps_array_add(polygons, ps_ghpolygon4d_new_with_points(triangle, 3));
+    const float floats[12] = {0.5f, 0.5f, 0.0f, 1.0f, 2.5f, 0.5f, 0.0f, 1.0f, 0.5f, 2.5f, 0.0f, 1.0f};
+    const uint32_t float_counts[1] = {3};
+    const PsGeofileEntry float_entry = {
+            PS_GEOFILE_POLYGONS, PS_GEOFILE_4F, 2, 0, floats, 3, float_counts, 1
+    };
+    Ps4f *vertices = aligned_alloc(16, sizeof(Ps4f) * 4);
+    vertices[0] = ps_4f(0.0f, 0.0f, 0.0f, 1.0f);
+    vertices[1] = ps_4f(1.0f, 0.0f, 0.0f, 1.0f);
+    vertices[2] = ps_4f(0.0f, 1.0f, 0.0f, 1.0f);
+    vertices[3] = ps_4f(0.0f, 0.0f, 1.0f, 1.0f);
+    uint32_t *indices = malloc(sizeof(uint32_t) * 6);
+    memcpy(indices, (uint32_t[6]) {0, 1, 2, 0, 3, 1}, sizeof(uint32_t) * 6);
+    PsMesh *mesh = ps_mesh_new_with_arrays(vertices, 4, indices, 2);
+
+    // Added out of key order, the TOC comes out sorted
+    PsGeofileWriter *writer = ps_geofile_writer_new(path);
+    TEST_CHECK(writer != NULL);
+    TEST_CHECK(ps_geofile_writer_add_mesh(writer, 3, mesh));
+    TEST_CHECK(ps_geofile_writer_add_polygons4d(writer, 1, polygons));
+    TEST_CHECK(ps_geofile_writer_add(writer, &float_entry));
+    TEST_CHECK(access(path, F_OK) != 0);
+    TEST_CHECK(ps_geofile_writer_close(writer));
+
+    const char *error = NULL;
+    PsGeofile *file = ps_geofile_open(path, &error);
+    TEST_CHECK(file != NULL);
+    if (!file) {
+        fprintf(stderr, "%s\n", error);
+        return test_failures;
+    }
+    TEST_CHECK(ps_geofile_get_entry_count(file) == 3);
+    PsGeofileEntry entry;
+    for (size_t i = 0; i < 3; ++i) {
+        ps_geofile_get_entry(file, i, &entry);
+        TEST_CHECK(entry.key == i + 1);
+        TEST_CHECK(ps_geofile_verify(&entry));
+    }
+    TEST_CHECK(!ps_geofile_find(file, 0, &entry));
+    TEST_CHECK(!ps_geofile_find(file, 4, &entry));
+
+    TEST_CHECK(ps_geofile_find(file, 1, &entry));
+    TEST_CHECK(entry.kind == PS_GEOFILE_POLYGONS && entry.precision == PS_GEOFILE_4D);
+    TEST_CHECK(entry.vertex_count == 7 && entry.index_count == 2);
+    PsArray *read = ps_geofile_entry_to_polygons4d(&entry);
+    double expected[14], actual[14];
+    TEST_CHECK(read && ps_array_get_length(read) == 2);
+    TEST_CHECK(flatten_polygons(polygons, expected) == 14 && flatten_polygons(read, actual) == 14);
+    TEST_CHECK(memcmp(expected, actual, sizeof(expected)) == 0);
+    free_polygons(read);
+
+    TEST_CHECK(ps_geofile_find(file, 2, &entry));
+    TEST_CHECK(entry.precision == PS_GEOFILE_4F && entry.vertex_count == 3);
+    TEST_CHECK((uintptr_t) entry.vertices % 64 == 0);
+    read = ps_geofile_entry_to_polygons4d(&entry);
+    TEST_CHECK(read && ps_array_get_length(read) == 1);
+    TEST_CHECK(flatten_polygons(read, actual) == 6);
+    TEST_CHECK(actual[0] == 0.5 && actual[1] == 0.5 && actual[2] == 2.5 && actual[5] == 2.5);
+    free_polygons(read);
+
+    TEST_CHECK(ps_geofile_find(file, 3, &entry));
+    TEST_CHECK(entry.kind == PS_GEOFILE_MESH && entry.vertex_count == 4 && entry.index_count == 6);
+    TEST_CHECK(memcmp(entry.vertices, mesh->vertices, sizeof(Ps4f) * 4) == 0);
+    TEST_CHECK(memcmp(entry.indices, mesh->indices, sizeof(uint32_t) * 6) == 0);
+    ps_geofile_close(file);
+
+    size_t size = 0;
+    unsigned char *data = read_file(path, &size);
+    TEST_CHECK(data != NULL && size % 64 == 0);
+
+    // A flipped vertex byte opens fine, only verify notices and only for its entry
+    for (size_t i = HEADER_SIZE; i < size; ++i) {
+        // The first non-zero byte after the header belongs to the first block
+        if (data[i]) {
+            data[i] ^= 0x40;
+            write_file(corrupt, data, size);
+            data[i] ^= 0x40;
+            break;
+        }
+    }
+    file = ps_geofile_open(corrupt, &error);
+    TEST_CHECK(file != NULL);
+    if (file) {
+        size_t failed = 0;
+        for (size_t i = 0; i < ps_geofile_get_entry_count(file); ++i) {
+            ps_geofile_get_entry(file, i, &entry);
+            failed += !ps_geofile_verify(&entry);
+        }
+        TEST_CHECK(failed == 1);
+        ps_geofile_close(file);
+    }
+
+    // Truncated by one TOC record, and down to less than a header
+    write_file(corrupt, data, size - 64);
+    TEST_CHECK(open_fails(corrupt, "truncated geometry file"));
+    write_file(corrupt, data, 10);
+    TEST_CHECK(open_fails(corrupt, "not a picoSCAD geometry file"));
+
+    // A wrong TOC hash, and a changed TOC record under the right hash
+    data[TOC_HASH_OFFSET] ^= 1;
+    write_file(corrupt, data, size);
+    TEST_CHECK(open_fails(corrupt, "corrupt geometry file TOC"));
+    data[TOC_HASH_OFFSET] ^= 1;
+    data[size - 64 + 8] ^= 1;
+    write_file(corrupt, data, size);
+    TEST_CHECK(open_fails(corrupt, "corrupt geometry file TOC"));
+    data[size - 64 + 8] ^= 1;
+    write_file(corrupt, data, size);
+    TEST_CHECK((file = ps_geofile_open(corrupt, &error)) != NULL);
+    if (file) {
+        ps_geofile_close(file);
+    }
+
+    free(data);
+    ps_mesh_free(mesh);
+    free_polygons(polygons);
+    unlink(corrupt);
+    unlink(path);
+    rmdir(directory);
+    return test_failures;
+}
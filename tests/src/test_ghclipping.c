@@ -0,0 +1,141 @@
+#include <math.h>
+#include <string.h>
+
+#include <picoscad/cg/ghclipping4d.h>
+
+#include "test.h"
+
+/*
+ * What the clipper returns when the boundaries don't cross, in both
+ * precisions: one polygon inside the other either way round, apart, and
+ * touching along an edge or at a corner. Each case checks the number of
+ * contours and their total area; a hole cut as a keyhole is one contour whose
+ * area already has the hole taken out.
+ */
+
+typedef struct ClipCase {
+    const char *name;
+    double poly[4];
+    double clip[4];
+    PsGHOperation operation;
+    size_t contours;
+    double area;
+} ClipCase;
+
+static const ClipCase cases[] = {
+        {"nested union", {0, 0, 10, 10}, {2, 2, 4, 4}, PS_GH_UNION, 1, 100.0},
+        {"nested intersect", {0, 0, 10, 10}, {2, 2, 4, 4}, PS_GH_INTERSECT, 1, 4.0},
+        {"hole in poly diff", {0, 0, 10, 10}, {2, 2, 4, 4}, PS_GH_DIFF, 1, 96.0},
+        {"poly in clip union", {2, 2, 4, 4}, {0, 0, 10, 10}, PS_GH_UNION, 1, 100.0},
+        {"poly in clip intersect", {2, 2, 4, 4}, {0, 0, 10, 10}, PS_GH_INTERSECT, 1, 4.0},
+        {"poly in clip diff", {2, 2, 4, 4}, {0, 0, 10, 10}, PS_GH_DIFF, 0, 0.0},
+        {"disjoint union", {0, 0, 1, 1}, {5, 5, 7, 7}, PS_GH_UNION, 2, 5.0},
+        {"disjoint intersect", {0, 0, 1, 1}, {5, 5, 7, 7}, PS_GH_INTERSECT, 0, 0.0},
+        {"disjoint diff", {0, 0, 1, 1}, {5, 5, 7, 7}, PS_GH_DIFF, 1, 1.0},
+        {"edge touching union", {0, 0, 1, 1}, {1, 0, 2, 1}, PS_GH_UNION, 2, 2.0},
+        {"edge touching intersect", {0, 0, 1, 1}, {1, 0, 2, 1}, PS_GH_INTERSECT, 0, 0.0},
+        {"edge touching diff", {0, 0, 1, 1}, {1, 0, 2, 1}, PS_GH_DIFF, 1, 1.0},
+        {"corner touching union", {0, 0, 1, 1}, {1, 1, 2, 2}, PS_GH_UNION, 2, 2.0},
+        {"corner touching intersect", {0, 0, 1, 1}, {1, 1, 2, 2}, PS_GH_INTERSECT, 0, 0.0},
+        {"corner touching diff", {0, 0, 1, 1}, {1, 1, 2, 2}, PS_GH_DIFF, 1, 1.0},
+};
+
+// Shoelace sum over one contour, fed a point at a time
+typedef struct Area {
+    double first_x, first_y, last_x, last_y;
+    bool started;
+    double twice;
+} Area;
+
+static void area_add(Area *area, double x, double y) {
+    if (!area->started) {
+        area->first_x = x;
+        area->first_y = y;
+        area->started = true;
+    } else {
+        area->twice += area->last_x * y - x * area->last_y;
+    }
+    area->last_x = x;
+    area->last_y = y;
+}
+
+static double area_close(Area *area) {
+    return fabs(area->twice + area->last_x * area->first_y - area->first_x * area->last_y) * 0.5;
+}
+
+static bool area_add4f(Ps4f *point, void *userdata) {
+    area_add(userdata, ps_4f_x(*point), ps_4f_y(*point));
+    return false;
+}
+
+static bool area_add4d(Ps4d *point, void *userdata) {
+    area_add(userdata, ps_4d_x(*point), ps_4d_y(*point));
+    return false;
+}
+
+static void check_result(const ClipCase *c, const char *precision, size_t contours, double area) {
+    if (contours != c->contours || fabs(area - c->area) > 1e-5) {
+        fprintf(stderr, "%s (%s): got %zu contours of area %g\n", c->name, precision, contours, area);
+        test_failures++;
+    }
+}
+
+static PsGHPolygon *rect4f(const double r[4]) {
+    Ps4f points[4] = {
+            ps_4f((float) r[0], (float) r[1], 0.0f, 1.0f), ps_4f((float) r[2], (float) r[1], 0.0f, 1.0f),
+            ps_4f((float) r[2], (float) r[3], 0.0f, 1.0f), ps_4f((float) r[0], (float) r[3], 0.0f, 1.0f)
+    };
+    return ps_ghpolygon_new_with_points(points, 4);
+}
+
+static PsGHPolygon4d *rect4d(const double r[4]) {
+    Ps4d points[4] = {
+            ps_4d(r[0], r[1], 0.0, 1.0), ps_4d(r[2], r[1], 0.0, 1.0), ps_4d(r[2], r[3], 0.0, 1.0),
+            ps_4d(r[0], r[3], 0.0, 1.0)
+    };
+    return ps_ghpolygon4d_new_with_points(points, 4);
+}
+
+static void test_4f(const ClipCase *c) {
+    PsGHPolygon *poly = rect4f(c->poly), *clip = rect4f(c->clip);
+    PsGHClipStats stats;
+    PsArray *result = ps_ghpolygon_clip(poly, clip, c->operation, &stats);
+    TEST_CHECK(stats.intersections == 0);
+    double area = 0.0;
+    for (size_t i = 0; i < ps_array_get_length(result); ++i) {
+        Area contour = {.started = false};
+        ps_ghpolygon_foreach(ps_array_get(result, i), area_add4f, &contour);
+        area += area_close(&contour);
+        ps_ghpolygon_free(ps_array_get(result, i));
+    }
+    check_result(c, "4f", ps_array_get_length(result), area);
+    ps_array_free(result);
+    ps_ghpolygon_free(poly);
+    ps_ghpolygon_free(clip);
+}
+
+static void test_4d(const ClipCase *c) {
+    PsGHPolygon4d *poly = rect4d(c->poly), *clip = rect4d(c->clip);
+    PsGHClipStats stats;
+    PsArray *result = ps_ghpolygon4d_clip(poly, clip, c->operation, &stats);
+    TEST_CHECK(stats.intersections == 0);
+    double area = 0.0;
+    for (size_t i = 0; i < ps_array_get_length(result); ++i) {
+        Area contour = {.started = false};
+        ps_ghpolygon4d_foreach(ps_array_get(result, i), area_add4d, &contour);
+        area += area_close(&contour);
+        ps_ghpolygon4d_free(ps_array_get(result, i));
+    }
+    check_result(c, "4d", ps_array_get_length(result), area);
+    ps_array_free(result);
+    ps_ghpolygon4d_free(poly);
+    ps_ghpolygon4d_free(clip);
+}
+
+int main() {
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        test_4f(&cases[i]);
+        test_4d(&cases[i]);
+    }
+    return test_failures;
+}
@@ -0,0 +1,217 @@
+#include <math.h>
+
+#include <picoscad/math/mat4f.h>
+#include <picoscad/math/mat4d.h>
+#include <picoscad/sys/cpu.h>
+
+#include "test.h"
+
+static float mat4f_at(const PsMat4f *m4f, int column, int row) {
+    const Ps4f c = column == 0 ? m4f->x : column == 1 ? m4f->y : column == 2 ? m4f->z : m4f->w;
+    return row == 0 ? ps_4f_x(c) : row == 1 ? ps_4f_y(c) : row == 2 ? ps_4f_z(c) : ps_4f_w(c);
+}
+
+static double mat4d_at(const PsMat4d *m4d, int column, int row) {
+    const Ps4d c = column == 0 ? m4d->x : column == 1 ? m4d->y : column == 2 ? m4d->z : m4d->w;
+    return row == 0 ? ps_4d_x(c) : row == 1 ? ps_4d_y(c) : row == 2 ? ps_4d_z(c) : ps_4d_w(c);
+}
+
+static bool mat4f_near(const PsMat4f *a, const PsMat4f *b, float tolerance) {
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            const float expected = mat4f_at(b, column, row);
+            if (!(fabsf(mat4f_at(a, column, row) - expected) <= tolerance * fmaxf(1.0f, fabsf(expected)))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool mat4d_near(const PsMat4d *a, const PsMat4d *b, double tolerance) {
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            const double expected = mat4d_at(b, column, row);
+            if (!(fabs(mat4d_at(a, column, row) - expected) <= tolerance * fmax(1.0, fabs(expected)))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Column-major product one element at a time, what ps_mat4*_mul must match
+static bool mat4f_is_product(const PsMat4f *out, const PsMat4f *lhs, const PsMat4f *rhs) {
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                sum += mat4f_at(lhs, k, row) * mat4f_at(rhs, column, k);
+            }
+            if (!(fabsf(mat4f_at(out, column, row) - sum) <= 1e-5f * fmaxf(1.0f, fabsf(sum)))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool mat4d_is_product(const PsMat4d *out, const PsMat4d *lhs, const PsMat4d *rhs) {
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            double sum = 0.0;
+            for (int k = 0; k < 4; ++k) {
+                sum += mat4d_at(lhs, k, row) * mat4d_at(rhs, column, k);
+            }
+            if (!(fabs(mat4d_at(out, column, row) - sum) <= 1e-14 * fmax(1.0, fabs(sum)))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void test_mat4f() {
+    // A full bottom row, so only the general inverse applies
+    const PsMat4f general = {
+            ps_4f(2.0f, 1.0f, 0.0f, 0.5f), ps_4f(0.0f, 3.0f, 1.0f, 0.0f),
+            ps_4f(1.0f, 0.0f, 4.0f, 0.25f), ps_4f(0.5f, -1.0f, 2.0f, 1.0f)
+    };
+    PsMat4f rot_x, rot_y, scale, translation, perspective, affine, identity;
+    ps_mat4f_rot_x(&rot_x, 0.7f);
+    ps_mat4f_rot_y(&rot_y, -1.3f);
+    ps_mat4f_scale(&scale, 2.0f, 0.5f, 3.0f);
+    ps_mat4f_translation(&translation, 1.0f, -2.0f, 5.0f);
+    ps_mat4f_perspective(&perspective, 1.0f, 1.5f, 1.0f, 10.0f);
+    ps_mat4f_identity(&identity);
+    ps_mat4f_mul(&rot_x, &rot_y, &affine);
+    ps_mat4f_mul(&affine, &scale, &affine);
+    ps_mat4f_mul(&translation, &affine, &affine);
+
+    PsMat4f out, inverse;
+    ps_mat4f_mul(&general, &affine, &out);
+    TEST_CHECK(mat4f_is_product(&out, &general, &affine));
+    ps_mat4f_mul(&affine, &general, &out);
+    TEST_CHECK(mat4f_is_product(&out, &affine, &general));
+
+    const PsMat4f *invertible[] = {&general, &affine, &perspective, &rot_x};
+    for (size_t i = 0; i < sizeof(invertible) / sizeof(invertible[0]); ++i) {
+        TEST_CHECK(ps_mat4f_inverse(invertible[i], &inverse));
+        ps_mat4f_mul(invertible[i], &inverse, &out);
+        TEST_CHECK(mat4f_near(&out, &identity, 1e-5f));
+        ps_mat4f_mul(&inverse, invertible[i], &out);
+        TEST_CHECK(mat4f_near(&out, &identity, 1e-5f));
+    }
+    PsMat4f affine_inverse;
+    TEST_CHECK(ps_mat4f_inverse(&affine, &inverse));
+    TEST_CHECK(ps_mat4f_inverse_affine(&affine, &affine_inverse));
+    TEST_CHECK(mat4f_near(&affine_inverse, &inverse, 1e-5f));
+    // (general * affine) / affine
+    ps_mat4f_mul(&general, &affine, &out);
+    TEST_CHECK(ps_mat4f_div(&out, &affine, &out));
+    TEST_CHECK(mat4f_near(&out, &general, 1e-5f));
+
+    // out aliasing lhs, rhs or both gives the same product as a separate out. Not bit for bit: with -mfma the
+    // compiler may contract the inlined arithmetic differently at each call
+    PsMat4f expected, aliased;
+    ps_mat4f_mul(&general, &affine, &expected);
+    aliased = general;
+    ps_mat4f_mul(&aliased, &affine, &aliased);
+    TEST_CHECK(mat4f_near(&aliased, &expected, 1e-6f));
+    aliased = affine;
+    ps_mat4f_mul(&general, &aliased, &aliased);
+    TEST_CHECK(mat4f_near(&aliased, &expected, 1e-6f));
+    ps_mat4f_mul(&general, &general, &expected);
+    aliased = general;
+    ps_mat4f_mul(&aliased, &aliased, &aliased);
+    TEST_CHECK(mat4f_near(&aliased, &expected, 1e-6f));
+    ps_mat4f_inverse(&general, &expected);
+    aliased = general;
+    TEST_CHECK(ps_mat4f_inverse(&aliased, &aliased));
+    TEST_CHECK(mat4f_near(&aliased, &expected, 1e-6f));
+    aliased = affine;
+    TEST_CHECK(ps_mat4f_inverse_affine(&aliased, &aliased));
+    TEST_CHECK(mat4f_near(&aliased, &affine_inverse, 1e-6f));
+
+    PsMat4f singular;
+    ps_mat4f_scale(&singular, 1.0f, 0.0f, 1.0f);
+    TEST_CHECK(!ps_mat4f_inverse(&singular, &out));
+    TEST_CHECK(!ps_mat4f_inverse_affine(&singular, &out));
+    TEST_CHECK(!ps_mat4f_div(&general, &singular, &out));
+}
+
+static void test_mat4d() {
+    const PsMat4d general = {
+            ps_4d(2.0, 1.0, 0.0, 0.5), ps_4d(0.0, 3.0, 1.0, 0.0),
+            ps_4d(1.0, 0.0, 4.0, 0.25), ps_4d(0.5, -1.0, 2.0, 1.0)
+    };
+    PsMat4d rot_x, rot_y, scale, translation, perspective, affine, identity;
+    ps_mat4d_rot_x(&rot_x, 0.7);
+    ps_mat4d_rot_y(&rot_y, -1.3);
+    ps_mat4d_scale(&scale, 2.0, 0.5, 3.0);
+    ps_mat4d_translation(&translation, 1.0, -2.0, 5.0);
+    ps_mat4d_perspective(&perspective, 1.0, 1.5, 1.0, 10.0);
+    ps_mat4d_identity(&identity);
+    ps_mat4d_mul(&rot_x, &rot_y, &affine);
+    ps_mat4d_mul(&affine, &scale, &affine);
+    ps_mat4d_mul(&translation, &affine, &affine);
+
+    PsMat4d out, inverse;
+    ps_mat4d_mul(&general, &affine, &out);
+    TEST_CHECK(mat4d_is_product(&out, &general, &affine));
+    ps_mat4d_mul(&affine, &general, &out);
+    TEST_CHECK(mat4d_is_product(&out, &affine, &general));
+
+    const PsMat4d *invertible[] = {&general, &affine, &perspective, &rot_x};
+    for (size_t i = 0; i < sizeof(invertible) / sizeof(invertible[0]); ++i) {
+        TEST_CHECK(ps_mat4d_inverse(invertible[i], &inverse));
+        ps_mat4d_mul(invertible[i], &inverse, &out);
+        TEST_CHECK(mat4d_near(&out, &identity, 1e-13));
+        ps_mat4d_mul(&inverse, invertible[i], &out);
+        TEST_CHECK(mat4d_near(&out, &identity, 1e-13));
+    }
+    PsMat4d affine_inverse;
+    TEST_CHECK(ps_mat4d_inverse(&affine, &inverse));
+    TEST_CHECK(ps_mat4d_inverse_affine(&affine, &affine_inverse));
+    TEST_CHECK(mat4d_near(&affine_inverse, &inverse, 1e-13));
+    ps_mat4d_mul(&general, &affine, &out);
+    TEST_CHECK(ps_mat4d_div(&out, &affine, &out));
+    TEST_CHECK(mat4d_near(&out, &general, 1e-13));
+
+    PsMat4d expected, aliased;
+    ps_mat4d_mul(&general, &affine, &expected);
+    aliased = general;
+    ps_mat4d_mul(&aliased, &affine, &aliased);
+    TEST_CHECK(mat4d_near(&aliased, &expected, 1e-15));
+    aliased = affine;
+    ps_mat4d_mul(&general, &aliased, &aliased);
+    TEST_CHECK(mat4d_near(&aliased, &expected, 1e-15));
+    ps_mat4d_mul(&general, &general, &expected);
+    aliased = general;
+    ps_mat4d_mul(&aliased, &aliased, &aliased);
+    TEST_CHECK(mat4d_near(&aliased, &expected, 1e-15));
+    ps_mat4d_inverse(&general, &expected);
+    aliased = general;
+    TEST_CHECK(ps_mat4d_inverse(&aliased, &aliased));
+    TEST_CHECK(mat4d_near(&aliased, &expected, 1e-15));
+    aliased = affine;
+    TEST_CHECK(ps_mat4d_inverse_affine(&aliased, &aliased));
+    TEST_CHECK(mat4d_near(&aliased, &affine_inverse, 1e-15));
+
+    PsMat4d singular;
+    ps_mat4d_scale(&singular, 1.0, 0.0, 1.0);
+    TEST_CHECK(!ps_mat4d_inverse(&singular, &out));
+    TEST_CHECK(!ps_mat4d_inverse_affine(&singular, &out));
+    TEST_CHECK(!ps_mat4d_div(&general, &singular, &out));
+}
+
+int main() {
+#ifdef TEST_MATH_ISA
+    if (ps_cpu_detect_isa() < TEST_MATH_ISA) {
+        return TEST_SKIP;
+    }
+#endif
+    test_mat4f();
+    test_mat4d();
+    return test_failures;
+}
@@ -0,0 +1,100 @@
+#include <math.h>
+#include <string.h>
+
+#include <picoscad/lang/scad.h>
+
+#include "test.h"
+
+// Evaluates the 2D part of source, NULL if it doesn't run
+static PsArray *evaluate(const char *source) {
+    PsScadError error;
+    PsScadProgram *program = ps_scad_compile(source, strlen(source), &error);
+    PsScadResult result;
+    const bool ok = program && ps_scad_run(program, &result, &error);
+    if (program) {
+        ps_scad_program_free(program);
+    }
+    if (!ok) {
+        fprintf(stderr, "%d:%d: %s\n", error.line, error.column, error.message);
+        return NULL;
+    }
+    PsCsg *csg = ps_csg_new();
+    PsArray *polygons = ps_csg_evaluate(csg, ps_scad_result_to_csg(&result, 0.0, csg, NULL), NULL, NULL);
+    ps_csg_free(csg);
+    ps_scad_result_free(&result);
+    return polygons;
+}
+
+static bool min_x(Ps4d *point, void *userdata) {
+    *(double *) userdata = fmin(*(double *) userdata, ps_4d_x(*point));
+    return false;
+}
+
+// Shoelace formula, twice the signed area summed over the vertices
+typedef struct Area {
+    Ps4d first, previous;
+    bool started;
+    double twice;
+} Area;
+
+static bool add_area(Ps4d *point, void *userdata) {
+    Area *area = userdata;
+    if (!area->started) {
+        area->first = *point;
+        area->started = true;
+    } else {
+        area->twice += ps_4d_x(area->previous) * ps_4d_y(*point) - ps_4d_x(*point) * ps_4d_y(area->previous);
+    }
+    area->previous = *point;
+    return false;
+}
+
+static double polygon_area(PsGHPolygon4d *polygon) {
+    Area area = {.started = false, .twice = 0.0};
+    ps_ghpolygon4d_foreach(polygon, add_area, &area);
+    area.twice += ps_4d_x(area.previous) * ps_4d_y(area.first) - ps_4d_x(area.first) * ps_4d_y(area.previous);
+    return fabs(area.twice) * 0.5;
+}
+
+static void free_polygons(PsArray *polygons) {
+    for (size_t i = 0; i < ps_array_get_length(polygons); ++i) {
+        ps_ghpolygon4d_free(ps_array_get(polygons, i));
+    }
+    ps_array_free(polygons);
+}
+
+int main() {
+    // Rounding through float would give 0.10000000149011612
+    PsArray *polygons = evaluate("translate([0.1, 0]) square(1);");
+    TEST_CHECK(polygons && ps_array_get_length(polygons) == 1);
+    if (polygons && ps_array_get_length(polygons) == 1) {
+        double x = INFINITY;
+        ps_ghpolygon4d_foreach(ps_array_get(polygons, 0), min_x, &x);
+        TEST_CHECK(x == 0.1);
+    }
+    if (polygons) {
+        free_polygons(polygons);
+    }
+
+    polygons = evaluate("rotate(30) square(10);");
+    TEST_CHECK(polygons && ps_array_get_length(polygons) == 1);
+    if (polygons && ps_array_get_length(polygons) == 1) {
+        TEST_CHECK(fabs(polygon_area(ps_array_get(polygons, 0)) - 100.0) < 1e-12);
+    }
+    if (polygons) {
+        free_polygons(polygons);
+    }
+
+    // Polygon points keep their precision too
+    polygons = evaluate("polygon([[0.1, 0.2], [1.3, 0.2], [0.1, 1.7]]);");
+    TEST_CHECK(polygons && ps_array_get_length(polygons) == 1);
+    if (polygons && ps_array_get_length(polygons) == 1) {
+        double x = INFINITY;
+        ps_ghpolygon4d_foreach(ps_array_get(polygons, 0), min_x, &x);
+        TEST_CHECK(x == 0.1);
+    }
+    if (polygons) {
+        free_polygons(polygons);
+    }
+    return test_failures;
+}
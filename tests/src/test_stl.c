@@ -0,0 +1,142 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <picoscad/io/stl.h>
+
+#include "test.h"
+
+// Enough triangles to flush the writer's 1 MB buffer several times in either format
+#define TRIANGLES 30000
+
+typedef struct Drain {
+    int from;
+    int to;
+} Drain;
+
+// Copies a pipe into a file while the writer fills it
+static void *drain_pipe(void *userdata) {
+    Drain *drain = userdata;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(drain->from, buffer, sizeof(buffer))) > 0) {
+        if (write(drain->to, buffer, (size_t) length) != length) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static bool write_stl(int fd, PsStlFormat format, const char *name, uint32_t count, const Ps4f *corners) {
+    PsStlWriter *writer = ps_stl_writer_new(fd, format, name, count);
+    if (!writer) {
+        return false;
+    }
+    // Uneven batches, so batch and buffer boundaries don't line up
+    bool ok = true;
+    for (size_t i = 0; i < TRIANGLES; i += 7) {
+        ok = ps_stl_writer_add(writer, corners + i * 3, i + 7 <= TRIANGLES ? 7 : TRIANGLES - i) && ok;
+    }
+    return ps_stl_writer_close(writer) && ok;
+}
+
+// Every corner read back exactly, %.9g round trips a float in ASCII too
+static bool read_back(const char *path, const Ps4f *corners) {
+    const char *error = NULL;
+    PsMesh *mesh = ps_stl_read(path, &error);
+    if (!mesh) {
+        fprintf(stderr, "%s: %s\n", path, error);
+        return false;
+    }
+    bool same = mesh->triangle_count == TRIANGLES && !mesh->indices;
+    for (size_t i = 0; same && i < TRIANGLES * 3; ++i) {
+        same = ps_4f_x(mesh->vertices[i]) == ps_4f_x(corners[i]) &&
+               ps_4f_y(mesh->vertices[i]) == ps_4f_y(corners[i]) &&
+               ps_4f_z(mesh->vertices[i]) == ps_4f_z(corners[i]);
+    }
+    ps_mesh_free(mesh);
+    return same;
+}
+
+static void test_file(const char *path, PsStlFormat format, const char *name, const Ps4f *corners) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    TEST_CHECK(fd >= 0);
+    // A seekable file gets the real count patched in, whatever was promised
+    TEST_CHECK(write_stl(fd, format, name, 0, corners));
+    close(fd);
+    TEST_CHECK(read_back(path, corners));
+}
+
+static void test_pipe(const char *path, PsStlFormat format, const Ps4f *corners) {
+    int fds[2];
+    TEST_CHECK(pipe(fds) == 0);
+    Drain drain = {fds[0], open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+    TEST_CHECK(drain.to >= 0);
+    pthread_t thread;
+    TEST_CHECK(pthread_create(&thread, NULL, drain_pipe, &drain) == 0);
+    TEST_CHECK(write_stl(fds[1], format, "piped", TRIANGLES, corners));
+    close(fds[1]);
+    pthread_join(thread, NULL);
+    close(fds[0]);
+    close(drain.to);
+    TEST_CHECK(read_back(path, corners));
+}
+
+static void test_indexed(const char *path, const Ps4f *corners) {
+    // The same triangles through an index buffer over a pool of shared vertices
+    uint32_t *indices = malloc(sizeof(uint32_t) * TRIANGLES * 3);
+    for (uint32_t i = 0; i < TRIANGLES * 3; ++i) {
+        indices[i] = (i * 7919u) % (TRIANGLES * 3);
+    }
+    Ps4f *soup = aligned_alloc(16, sizeof(Ps4f) * TRIANGLES * 3);
+    for (size_t i = 0; i < TRIANGLES * 3; ++i) {
+        soup[i] = corners[indices[i]];
+    }
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    PsStlWriter *writer = ps_stl_writer_new(fd, PS_STL_BINARY, "indexed", TRIANGLES);
+    TEST_CHECK(ps_stl_writer_add_indexed(writer, corners, indices, TRIANGLES));
+    TEST_CHECK(ps_stl_writer_close(writer));
+    close(fd);
+    TEST_CHECK(read_back(path, soup));
+    free(soup);
+    free(indices);
+}
+
+static void test_truncated(const char *path) {
+    // Cut the last binary record in half
+    TEST_CHECK(truncate(path, 84 + 50 * TRIANGLES - 25) == 0);
+    const char *error = NULL;
+    TEST_CHECK(ps_stl_read(path, &error) == NULL);
+    TEST_CHECK(error && strcmp(error, "truncated binary STL") == 0);
+}
+
+int main() {
+    char directory[] = "/tmp/test_stl_XXXXXX";
+    TEST_CHECK(mkdtemp(directory) != NULL);
+    char path[256];
+    snprintf(path, sizeof(path), "%s/out.stl", directory);
+
+    Ps4f *corners = aligned_alloc(16, sizeof(Ps4f) * TRIANGLES * 3);
+    srand(37);
+    for (size_t i = 0; i < TRIANGLES * 3; ++i) {
+        // Fractions and signs that need all 9 significant digits
+        corners[i] = ps_4f((float) rand() / (float) RAND_MAX * 200.0f - 100.0f,
+                           (float) rand() / (float) RAND_MAX * 1e-3f,
+                           -(float) rand() / (float) RAND_MAX * 1e5f, 1.0f);
+    }
+    test_file(path, PS_STL_BINARY, "mesh", corners);
+    // A name starting with "solid" must not make the binary header look like ASCII
+    test_file(path, PS_STL_BINARY, "solid mesh", corners);
+    test_file(path, PS_STL_ASCII, "mesh", corners);
+    test_pipe(path, PS_STL_BINARY, corners);
+    test_pipe(path, PS_STL_ASCII, corners);
+    test_indexed(path, corners);
+    test_truncated(path);
+
+    free(corners);
+    unlink(path);
+    rmdir(directory);
+    return test_failures;
+}
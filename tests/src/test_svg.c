@@ -0,0 +1,86 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <picoscad/io/svg.h>
+
+#include "test.h"
+
+typedef struct Bounds {
+    float min_x, min_y, max_x, max_y;
+} Bounds;
+
+static bool bounds_add(Ps4f *point, void *userdata) {
+    Bounds *bounds = userdata;
+    bounds->min_x = ps_4f_x(*point) < bounds->min_x ? ps_4f_x(*point) : bounds->min_x;
+    bounds->min_y = ps_4f_y(*point) < bounds->min_y ? ps_4f_y(*point) : bounds->min_y;
+    bounds->max_x = ps_4f_x(*point) > bounds->max_x ? ps_4f_x(*point) : bounds->max_x;
+    bounds->max_y = ps_4f_y(*point) > bounds->max_y ? ps_4f_y(*point) : bounds->max_y;
+    // True would stop the walk
+    return false;
+}
+
+// Imports text from a temporary file, the contours are returned in document order
+static PsArray *read_svg(const char *text, const char **error) {
+    char path[] = "/tmp/test_svg_XXXXXX";
+    const int fd = mkstemp(path);
+    TEST_CHECK(fd >= 0);
+    TEST_CHECK(write(fd, text, strlen(text)) == (ssize_t) strlen(text));
+    close(fd);
+    PsArray *contours = ps_array_new(8);
+    *error = NULL;
+    if (!ps_svg_read(path, 0.01, ps_outline_collect, contours, error)) {
+        ps_array_free(contours);
+        contours = NULL;
+    }
+    unlink(path);
+    return contours;
+}
+
+static void check_bounds(PsArray *contours, size_t index, float min_x, float min_y, float max_x, float max_y) {
+    Bounds bounds = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+    ps_ghpolygon_foreach(ps_array_get(contours, index), bounds_add, &bounds);
+    if (fabsf(bounds.min_x - min_x) > 1e-5f || fabsf(bounds.min_y - min_y) > 1e-5f ||
+        fabsf(bounds.max_x - max_x) > 1e-5f || fabsf(bounds.max_y - max_y) > 1e-5f) {
+        fprintf(stderr, "contour %zu: got %g %g %g %g\n", index, bounds.min_x, bounds.min_y, bounds.max_x,
+                bounds.max_y);
+        test_failures++;
+    }
+}
+
+int main() {
+    const char *error;
+    PsArray *contours = read_svg("<svg xmlns=\"http://www.w3.org/2000/svg\">\n"
+                                 "<g transform=\"translate(10,0)\"><rect width=\"2\" height=\"3\"/></g>\n"
+                                 // Self-closing, so it has no children to move
+                                 "<g transform=\"translate(100,0)\"/>\n"
+                                 "<rect width=\"1\" height=\"1\"/>\n"
+                                 "<g transform=\"scale(2)\"><g transform=\"translate(1 1)\">\n"
+                                 "<rect width=\"1\" height=\"1\" transform=\"rotate(90)\"/>\n"
+                                 "</g></g>\n"
+                                 "<path d=\"M0 0h1v1z\" transform=\"matrix(1 0 0 1 5 5) skewX(0)\"/>\n"
+                                 "</svg>\n",
+                                 &error);
+    TEST_CHECK(contours != NULL);
+    if (contours) {
+        TEST_CHECK(ps_array_get_length(contours) == 4);
+        if (ps_array_get_length(contours) == 4) {
+            // y is negated after the transforms
+            check_bounds(contours, 0, 10.0f, -3.0f, 12.0f, 0.0f);
+            check_bounds(contours, 1, 0.0f, -1.0f, 1.0f, 0.0f);
+            check_bounds(contours, 2, 0.0f, -4.0f, 2.0f, -2.0f);
+            check_bounds(contours, 3, 5.0f, -6.0f, 6.0f, -5.0f);
+        }
+        for (size_t i = 0; i < ps_array_get_length(contours); ++i) {
+            ps_ghpolygon_free(ps_array_get(contours, i));
+        }
+        ps_array_free(contours);
+    }
+
+    // An unknown transform fails the import rather than placing the shape wrong
+    contours = read_svg("<svg><rect width=\"1\" height=\"1\" transform=\"spin(3)\"/></svg>", &error);
+    TEST_CHECK(contours == NULL);
+    TEST_CHECK(error && strcmp(error, "malformed transform") == 0);
+    return test_failures;
+}
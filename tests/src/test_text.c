@@ -0,0 +1,39 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "io/text.h"
+
+#include "test.h"
+
+// Parses all of text, which must be one number, and compares it with strtod
+static void check_double(const char *text) {
+    const char *cursor = text, *end = text + strlen(text);
+    double value = 0.0;
+    const bool parsed = io_parse_double(&cursor, end, &value);
+    TEST_CHECK(parsed);
+    TEST_CHECK(cursor == end);
+    if (value != strtod(text, NULL)) {
+        fprintf(stderr, "%s: got %.17g\n", text, value);
+        test_failures++;
+    }
+}
+
+int main() {
+    check_double("1.5");
+    check_double("-0.1");
+    check_double("6.02214076e23");
+    check_double("12345678901234567890123");
+    // Longer than any stack buffer, as high precision exporters write
+    check_double("0.1000000000000000055511151231257827021181583404541015625000000000000000000000000000000001");
+    check_double("-3.14159265358979323846264338327950288419716939937510582097494459230781640628620899862803482534211706798");
+    check_double("000000000000000000000000000000000000000000000000000000000000000000000000000000000000000012.5e-1");
+
+    // The rest of a line is left for the caller
+    const char *line = "1.00000000000000000000000000000000000000000000000000000000000000000000000001 2";
+    const char *cursor = line;
+    double first = 0.0, second = 0.0;
+    TEST_CHECK(io_parse_double(&cursor, line + strlen(line), &first));
+    TEST_CHECK(io_parse_double(&cursor, line + strlen(line), &second));
+    TEST_CHECK(first == 1.0 && second == 2.0);
+    return test_failures;
+}
@@ -0,0 +1,73 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <picoscad/sys/trace.h>
+
+#include "test.h"
+
+static void *trace_worker(void *userdata) {
+    (void) userdata;
+    ps_trace_thread_name("worker");
+    PS_TRACE_BEGIN(zone, "test/worker");
+    PS_TRACE_END(zone);
+    return NULL;
+}
+
+static size_t count_rings(const char *trace) {
+    size_t count = 0;
+    for (const char *c = trace; (c = strstr(c, "\"thread_name\"")); ++c) {
+        count++;
+    }
+    return count;
+}
+
+static char *write_trace(size_t size) {
+    char *buffer = calloc(size, 1);
+    FILE *file = fmemopen(buffer, size - 1, "w");
+    TEST_CHECK(ps_trace_write(file));
+    fclose(file);
+    return buffer;
+}
+
+int main() {
+    ps_trace_thread_name("worker \"1\" \\ main\n");
+    ps_trace_start();
+    PS_TRACE_BEGIN(zone, "test/zone");
+    PS_TRACE_END(zone);
+    ps_trace_stop();
+
+    char *buffer = write_trace(4096);
+    TEST_CHECK(strstr(buffer, "\"args\":{\"name\":\"worker \\\"1\\\" \\\\ main\\u000a\"}}") != NULL);
+#ifdef PS_TRACE
+    TEST_CHECK(strstr(buffer, "{\"name\":\"test/zone\",\"ph\":\"X\"") != NULL);
+#endif
+    if (test_failures) {
+        fprintf(stderr, "%s\n", buffer);
+    }
+    free(buffer);
+
+    // Rounds of short lived workers, as ps_csg_evaluate_parallel starts them, reuse the rings of exited ones
+    ps_trace_start();
+    for (size_t round = 0; round < 16; ++round) {
+        pthread_t threads[4];
+        for (size_t i = 0; i < 4; ++i) {
+            TEST_CHECK(pthread_create(&threads[i], NULL, trace_worker, NULL) == 0);
+        }
+        for (size_t i = 0; i < 4; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    ps_trace_stop();
+    buffer = write_trace(1 << 16);
+    TEST_CHECK(count_rings(buffer) <= 5);
+#ifdef PS_TRACE
+    size_t zones = 0;
+    for (const char *c = buffer; (c = strstr(c, "\"test/worker\"")); ++c) {
+        zones++;
+    }
+    TEST_CHECK(zones == 64);
+#endif
+    free(buffer);
+    return test_failures;
+}
@@ -0,0 +1,196 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <picoscad/math/4d.h>
+#include <picoscad/math/4f.h>
+#include <picoscad/math/8f.h>
+#include <picoscad/sys/cpu.h>
+
+#include "test.h"
+
+/*
+ * The vector acos and atan2 against libm, lane by lane: at the ends of their
+ * domains, at signed zeros, either side of every point where the polynomials
+ * switch branches, and on a sweep in between. Errors are in units in the last
+ * place of the result, allowing the documented maximum plus libm's own error.
+ */
+
+#define TEST_SWEEP 4096
+
+// Distance between two doubles counted in representable values, signed zeros are one apart
+static uint64_t ulps_double(double a, double b) {
+    int64_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    ia = ia < 0 ? INT64_MIN - ia : ia;
+    ib = ib < 0 ? INT64_MIN - ib : ib;
+    return ia > ib ? (uint64_t) ia - (uint64_t) ib : (uint64_t) ib - (uint64_t) ia;
+}
+
+static uint32_t ulps_float(float a, float b) {
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    ia = ia < 0 ? INT32_MIN - ia : ia;
+    ib = ib < 0 ? INT32_MIN - ib : ib;
+    return ia > ib ? (uint32_t) ia - (uint32_t) ib : (uint32_t) ib - (uint32_t) ia;
+}
+
+static void check_ulps(const char *function, double y, double x, double got, double expected, uint64_t ulps,
+                       uint64_t limit) {
+    if (!(ulps <= limit)) {
+        fprintf(stderr, "%s(%.17g, %.17g): got %.17g, libm %.17g (%llu ulp)\n", function, y, x, got, expected,
+                (unsigned long long) ulps);
+        test_failures++;
+    }
+}
+
+// acos inputs: the ends, zeros and the |x| = 0.5 switch with their neighbors, then a sweep of [-1, 1]
+static size_t acos_inputs(double *out) {
+    const double specials[] = {1.0, -1.0, 0.0, -0.0, 0.5, -0.5};
+    size_t count = 0;
+    for (size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); ++i) {
+        out[count++] = specials[i];
+        if (fabs(specials[i]) != 0.0) {
+            out[count++] = nextafter(specials[i], 0.0);
+        }
+        if (fabs(specials[i]) == 0.5) {
+            out[count++] = nextafter(specials[i], specials[i] * 2.0);
+        }
+    }
+    for (size_t i = 0; i <= TEST_SWEEP; ++i) {
+        out[count++] = -1.0 + 2.0 * (double) i / TEST_SWEEP;
+    }
+    return count;
+}
+
+/*
+ * atan2 inputs: the axes with signed zeros, the diagonals, the ratios where
+ * the reduction switches (0.4375 and 0.6875) both ways round and in every
+ * quadrant, then a sweep of the circle. atan2(0, -0) is left out, the vector
+ * versions document it as 0 where libm gives pi.
+ */
+static size_t atan2_inputs(double *ys, double *xs) {
+    static const double axes[][2] = {
+            {0.0, 1.0}, {-0.0, 1.0}, {0.0, -1.0}, {-0.0, -1.0}, {1.0, 0.0}, {1.0, -0.0}, {-1.0, 0.0},
+            {-1.0, -0.0}, {0.0, 0.0}, {1.0, 1.0}, {-1.0, 1.0}, {1.0, -1.0}, {-1.0, -1.0}
+    };
+    size_t count = 0;
+    for (size_t i = 0; i < sizeof(axes) / sizeof(axes[0]); ++i) {
+        ys[count] = axes[i][0];
+        xs[count++] = axes[i][1];
+    }
+    const double ratios[] = {0.4375, 0.6875, 1.0};
+    for (size_t i = 0; i < sizeof(ratios) / sizeof(ratios[0]); ++i) {
+        const double around[] = {nextafter(ratios[i], 0.0), ratios[i], nextafter(ratios[i], 2.0)};
+        for (size_t j = 0; j < 3; ++j) {
+            for (int quadrant = 0; quadrant < 4; ++quadrant) {
+                const double sy = quadrant & 1 ? -1.0 : 1.0, sx = quadrant & 2 ? -1.0 : 1.0;
+                ys[count] = sy * around[j];
+                xs[count++] = sx;
+                ys[count] = sy;
+                xs[count++] = sx * around[j];
+            }
+        }
+    }
+    for (size_t i = 0; i < TEST_SWEEP; ++i) {
+        const double angle = 6.283185307179586 * (double) i / TEST_SWEEP, radius = 0.001 + (double) i;
+        ys[count] = radius * sin(angle);
+        xs[count++] = radius * cos(angle);
+    }
+    return count;
+}
+
+static void test_4f(const double *inputs, size_t count, const double *ys, const double *xs, size_t pairs) {
+    for (size_t i = 0; i < count; i += 4) {
+        float in[4], out[4];
+        for (size_t j = 0; j < 4; ++j) {
+            in[j] = (float) inputs[i + j < count ? i + j : 0];
+        }
+        ps_4f_store(ps_4f_acos(ps_4f_load(in)), out);
+        for (size_t j = 0; j < 4; ++j) {
+            const float expected = (float) acos(in[j]);
+            check_ulps("ps_4f_acos", in[j], 0.0, out[j], expected, ulps_float(out[j], expected), 2);
+        }
+    }
+    for (size_t i = 0; i < pairs; i += 4) {
+        float y[4], x[4], out[4];
+        for (size_t j = 0; j < 4; ++j) {
+            y[j] = (float) ys[i + j < pairs ? i + j : 0];
+            x[j] = (float) xs[i + j < pairs ? i + j : 0];
+        }
+        ps_4f_store(ps_4f_atan2(ps_4f_load(y), ps_4f_load(x)), out);
+        for (size_t j = 0; j < 4; ++j) {
+            const float expected = (float) atan2(y[j], x[j]);
+            check_ulps("ps_4f_atan2", y[j], x[j], out[j], expected, ulps_float(out[j], expected), 4);
+        }
+    }
+}
+
+static void test_8f(const double *inputs, size_t count, const double *ys, const double *xs, size_t pairs) {
+    for (size_t i = 0; i < count; i += 8) {
+        float in[8], out[8];
+        for (size_t j = 0; j < 8; ++j) {
+            in[j] = (float) inputs[i + j < count ? i + j : 0];
+        }
+        ps_8f_store(ps_8f_acos(ps_8f_load(in)), out);
+        for (size_t j = 0; j < 8; ++j) {
+            const float expected = (float) acos(in[j]);
+            check_ulps("ps_8f_acos", in[j], 0.0, out[j], expected, ulps_float(out[j], expected), 2);
+        }
+    }
+    for (size_t i = 0; i < pairs; i += 8) {
+        float y[8], x[8], out[8];
+        for (size_t j = 0; j < 8; ++j) {
+            y[j] = (float) ys[i + j < pairs ? i + j : 0];
+            x[j] = (float) xs[i + j < pairs ? i + j : 0];
+        }
+        ps_8f_store(ps_8f_atan2(ps_8f_load(y), ps_8f_load(x)), out);
+        for (size_t j = 0; j < 8; ++j) {
+            const float expected = (float) atan2(y[j], x[j]);
+            check_ulps("ps_8f_atan2", y[j], x[j], out[j], expected, ulps_float(out[j], expected), 4);
+        }
+    }
+}
+
+static void test_4d(const double *inputs, size_t count, const double *ys, const double *xs, size_t pairs) {
+    for (size_t i = 0; i < count; i += 4) {
+        double in[4], out[4];
+        for (size_t j = 0; j < 4; ++j) {
+            in[j] = inputs[i + j < count ? i + j : 0];
+        }
+        ps_4d_store(ps_4d_acos(ps_4d_load(in)), out);
+        for (size_t j = 0; j < 4; ++j) {
+            const double expected = acos(in[j]);
+            check_ulps("ps_4d_acos", in[j], 0.0, out[j], expected, ulps_double(out[j], expected), 2);
+        }
+    }
+    for (size_t i = 0; i < pairs; i += 4) {
+        double y[4], x[4], out[4];
+        for (size_t j = 0; j < 4; ++j) {
+            y[j] = ys[i + j < pairs ? i + j : 0];
+            x[j] = xs[i + j < pairs ? i + j : 0];
+        }
+        ps_4d_store(ps_4d_atan2(ps_4d_load(y), ps_4d_load(x)), out);
+        for (size_t j = 0; j < 4; ++j) {
+            const double expected = atan2(y[j], x[j]);
+            check_ulps("ps_4d_atan2", y[j], x[j], out[j], expected, ulps_double(out[j], expected), 3);
+        }
+    }
+}
+
+int main() {
+#ifdef TEST_MATH_ISA
+    if (ps_cpu_detect_isa() < TEST_MATH_ISA) {
+        return TEST_SKIP;
+    }
+#endif
+    static double inputs[TEST_SWEEP + 32], ys[TEST_SWEEP + 128], xs[TEST_SWEEP + 128];
+    const size_t count = acos_inputs(inputs);
+    const size_t pairs = atan2_inputs(ys, xs);
+    test_4f(inputs, count, ys, xs, pairs);
+    test_8f(inputs, count, ys, xs, pairs);
+    test_4d(inputs, count, ys, xs, pairs);
+    return test_failures;
+}